@@ -252,3 +252,71 @@ bool loadvcp_by_file(const char * fn, Display_Handle * dh) {
    DBGMSF(debug, "Returning: %s", bool_repr(ok));
    return ok;
 }
+
+
+/* Apply the VCP settings stored in multiple files, each to the monitor
+ * indicated in that file.
+ *
+ * Monitors on different buses are loaded concurrently.  Files for the
+ * same monitor are applied in order, stopping at the first error for
+ * that monitor.  A summary line is reported for each file.
+ *
+ * Arguments:
+ *    fn_ct       number of file names
+ *    fns         file names
+ *
+ * Returns:  true if every file was loaded, false if not
+ */
+bool loadvcp_by_files(int fn_ct, char ** fns) {
+   FILE * fout = stdout;
+   bool debug = false;
+   DBGMSF(debug, "Starting. fn_ct=%d", fn_ct);
+
+   bool ok = true;
+   Loadvcp_Result * results = calloc(fn_ct, sizeof(Loadvcp_Result));
+   char **          result_fns = calloc(fn_ct, sizeof(char *));
+   int result_ct = 0;
+   for (int ndx = 0; ndx < fn_ct; ndx++) {
+      Dumpload_Data * pdata = read_vcp_file(fns[ndx]);
+      if (!pdata) {
+         // read_vcp_file() issues message
+         f0printf(fout, "%s: Unable to load VCP data\n", fns[ndx]);
+         ok = false;
+      }
+      else {
+         results[result_ct].pdata = pdata;
+         result_fns[result_ct] = fns[ndx];
+         result_ct++;
+      }
+   }
+
+   loadvcp_by_dumpload_data_multiple(result_ct, results);
+
+   for (int ndx = 0; ndx < result_ct; ndx++) {
+      Loadvcp_Result * result = &results[ndx];
+      char * status = NULL;
+      if (!result->dref)
+         status = "Monitor not connected";
+      else if (result->skipped)
+         status = "Skipped after earlier error on monitor";
+      else if (result->ddc_excp)
+         status = psc_desc(result->ddc_excp->status_code);
+      else
+         status = "Loaded";
+      f0printf(fout, "%s: monitor \"%s\", sn \"%s\"%s%s: %s\n",
+                     result_fns[ndx], result->pdata->model, result->pdata->serial_ascii,
+                     (result->dref) ? ", " : "",
+                     (result->dref) ? dref_repr_t(result->dref) : "",
+                     status);
+      if (result->ddc_excp || result->skipped || !result->dref)
+         ok = false;
+      if (result->ddc_excp)
+         ERRINFO_FREE_WITH_REPORT(result->ddc_excp, debug || report_freed_exceptions);
+      free_dumpload_data(result->pdata);
+   }
+   free(results);
+   free(result_fns);
+
+   DBGMSF(debug, "Returning: %s", bool_repr(ok));
+   return ok;
+}
@@ -13,6 +13,7 @@
 #include <base/status_code_mgt.h>
 
 bool loadvcp_by_file(const char * fn, Display_Handle * dh);
+bool loadvcp_by_files(int fn_ct, char ** fns);
 
 Public_Status_Code dumpvcp_as_file(Display_Handle * dh, char * optional_filename);
 
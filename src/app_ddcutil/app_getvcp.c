@@ -38,6 +38,7 @@
 #include "ddc/ddc_packet_io.h"
 #include "ddc/ddc_vcp_version.h"
 #include "ddc/ddc_vcp.h"
+#include "ddc/ddc_watch.h"
 
 #include "app_ddcutil/app_getvcp.h"
 
@@ -324,194 +325,90 @@ app_show_feature_set_values_by_display_handle(
 // Watch for changed VCP values
 //
 
-void reset_vcp_x02(Display_Handle * dh) {
-   Error_Info * ddc_excp = ddc_set_nontable_vcp_value(dh, 0x02, 0x01);
-   if (ddc_excp) {
-      DBGMSG("set_nontable_vcp_value_by_display_handle() returned %s", errinfo_summary(ddc_excp) );
-      errinfo_free(ddc_excp);
+static GMutex watch_output_mutex;     // changes are reported on multiple threads
+
+// Display path in a form without embedded blanks
+static char * watch_path_name(DDCA_IO_Path * dpath, char * buf, int bufsz) {
+   switch(dpath->io_mode) {
+   case DDCA_IO_I2C:
+      snprintf(buf, bufsz, "/dev/i2c-%d", dpath->path.i2c_busno);
+      break;
+   case DDCA_IO_ADL:
+      snprintf(buf, bufsz, "adl-%d.%d", dpath->path.adlno.iAdapterIndex, dpath->path.adlno.iDisplayIndex);
+      break;
+   case DDCA_IO_USB:
+      snprintf(buf, bufsz, "/dev/usb/hiddev%d", dpath->path.hiddev_devno);
+      break;
    }
-   else
-      DBGMSG("reset feature x02 (new control value) successful");
+   return buf;
 }
 
-bool new_control_values_exist(Display_Handle * dh) {
-   bool debug = false;
-   Parsed_Nontable_Vcp_Response * p_nontable_response = NULL;
-   // DBGMSF(debug, "VCP version: %d.%d", vspec.major, vspec.minor);
-   bool result = false;
-    Error_Info * ddc_excp = ddc_get_nontable_vcp_value(
-             dh,
-             0x02,
-             &p_nontable_response);
-    if (ddc_excp) {
-       DBGMSG("get_nontable_vcp_value() returned %s", errinfo_summary(ddc_excp) );
-       errinfo_free(ddc_excp);
-    }
-
-    else if (p_nontable_response->sl == 0x01) {
-       DBGMSF(debug, "No new control values found");
-       free(p_nontable_response);
-    }
-    else {
-       DBGMSG("New control values exist. x02 value: 0x%02x", p_nontable_response->sl);
-       free(p_nontable_response);
-       p_nontable_response = NULL;
-       result = true;
-    }
-    return result;
-}
-
-
-/** Gets the ID of the next changed feature from VCP feature x52,
- *  then reads and displays the value of that feature.
- *
- *  \param   dh  #Display_Handle
- *  \return  id of changed feature, 0x00 if none
- */
 
-Byte show_changed_feature(Display_Handle * dh) {
-   Parsed_Nontable_Vcp_Response * p_nontable_response = NULL;
-   Byte changed_feature = 0x00;
-   Error_Info * ddc_excp = ddc_get_nontable_vcp_value(
-              dh,
-              0x52,
-              &p_nontable_response);
-  // psc = (ddc_excp) ? ddc_excp->psc : 0;
-  if (ddc_excp) {
-     DBGMSG("get_nontable_vcp_value() for VCP feature x52 returned %s", errinfo_summary(ddc_excp) );
-     errinfo_free(ddc_excp);
-  }
-  else {
-     changed_feature = p_nontable_response->sl;
-     free(p_nontable_response);
-     if (changed_feature)
-        app_show_single_vcp_value_by_feature_id_new_dfm(dh, changed_feature, false);
-  }
-  return changed_feature;
-}
-
-
-/* Checks for VCP feature changes by:
- *   - reading feature x02 to check if changes exist,
- *   - querying feature x52 for the id of a changed feature
- *   - reading the value of the changed feature.
+/** Writes one line describing a VCP feature change to the current
+ *  output destination.
+ *  Registered as a #DDCA_Vcp_Change_Callback.
  *
- * If the VCP version is 2.1 or less a single feature is
- * read from x52.  For VCP version 3.0 and 2.2, x52 is a
- * FIFO queue of changed features.
- *
- * Finally, 1 is written to feature x02 as a reset.
- *
- * Arguments:
- *    dh      display handle
+ *  \param event  change event
+ *  \param data   non-NULL for JSON output, NULL for text
  */
-void
-app_read_changes(Display_Handle * dh) {
-   bool debug = false;
-   DBGMSF(debug, "Starting");
-   int MAX_CHANGES = 20;
-
-   // read 02h
-   // xff: no user controls
-   // x01: no new control values
-   // x02: new control values exist
-
-   /* Per the 3.0 and 2.2 specs, feature x52 is a FIFO to be read until value x00 indicates empty
-    * What apparently happens on 2.1 (U3011) is that each time feature x02 is reset with value x01
-    * the subsequent read of feature x02 returns x02 (new control values exists) until the queue
-    * of changes is flushed
-    */
-
-   DDCA_MCCS_Version_Spec vspec = get_vcp_version_by_display_handle(dh);
-
-   if (new_control_values_exist(dh)) {
-      if ( vcp_version_le(vspec, DDCA_VSPEC_V21) ) {
-         show_changed_feature(dh);
-      }
-      else {  // x52 is a FIFO
-         int ctr = 0;
-         for (;ctr < MAX_CHANGES; ctr++) {
-            Byte cur_feature = show_changed_feature(dh);
-            if (cur_feature == 0x00) {
-               DBGMSG("No more changed features found");
-               break;
-            }
-         }
-         if (ctr == MAX_CHANGES) {
-            DBGMSG("Reached loop guard value MAX_CHANGES (%d)", MAX_CHANGES);
-         }
-      }
-      reset_vcp_x02(dh);
-   }
-}
-
-
-#ifdef USE_USB
-void
-app_read_changes_usb(Display_Handle * dh) {
-   bool debug = true;
-   DBGMSF(debug, "Starting");
-   // bool new_values_found = false;
-
-   assert(dh->dref->io_path.io_mode == DDCA_IO_USB);
-   int fd = dh->fh;
-   int flaguref = HIDDEV_FLAG_UREF;
-   struct hiddev_usage_ref uref;
-   int rc = ioctl(fd, HIDIOCSFLAG, &flaguref);
-   if (rc < 0) {
-      REPORT_IOCTL_ERROR("HIDIOCSFLAG", errno);
-      return;
-   }
-
-   ssize_t ct = read(fd, &uref, sizeof(uref));
-   if (ct < 0) {
-      int errsv = errno;
-      // report the error
-      printf("(%s) read failed, errno=%d\n", __func__, errsv);
-   }
-   else if (ct > 0) {
-      rpt_vstring(1, "Read new value:");
-      if (ct < sizeof(uref)) {
-         rpt_vstring(1, "Short read");
-      }
-      else {
-         report_hiddev_usage_ref(&uref, 1);
-         rpt_vstring(1, "New value: 0x%04x (%d)", uref.value, uref.value);
-      }
+static void show_vcp_change_event(DDCA_Vcp_Change_Event * event, void * data) {
+   bool json = (data != NULL);
+   Display_Ref * dref = event->dref;
+   char path[40];
+   watch_path_name(&dref->io_path, path, sizeof(path));
+   double secs = event->timestamp_nanos / 1000000000.0;
+   int cur_val = event->value.sh << 8 | event->value.sl;
+   int max_val = event->value.mh << 8 | event->value.ml;
+
+   FILE * fh = fout();
+   g_mutex_lock(&watch_output_mutex);
+   if (json) {
+      f0printf(fh, "{\"time\":%.3f,\"display\":%d,\"path\":\"%s\",\"feature\":\"0x%02x\",\"status\":%d",
+                   secs, dref->dispno, path, event->feature_code, event->status);
+      if (event->status == 0)
+         f0printf(fh, ",\"value\":%d,\"max\":%d,\"sh\":%d,\"sl\":%d}\n",
+                      cur_val, max_val, event->value.sh, event->value.sl);
+      else
+         f0printf(fh, ",\"error\":\"%s\"}\n", psc_name(event->status));
    }
    else {
-      DBGMSF(debug, "tick");
+      f0printf(fh, "%.3f display=%d path=%s feature=0x%02x ", secs, dref->dispno, path, event->feature_code);
+      if (event->status == 0)
+         f0printf(fh, "value=%d max=%d\n", cur_val, max_val);
+      else
+         f0printf(fh, "error=%s\n", psc_name(event->status));
    }
+   fflush(fh);
+   g_mutex_unlock(&watch_output_mutex);
 }
-#endif
-
 
 
-/* Infinite loop watching for VCP feature changes reported by the display.
+/** Watches displays for VCP feature changes made using the monitor controls,
+ *  writing a line to stdout for each change.
  *
- * Arguments:
- *    dh        display handle
+ *  \param  dref_ct  number of displays
+ *  \param  drefs    displays to watch
+ *  \param  json     if true, write each change as a JSON object,
+ *                   otherwise as space separated name=value pairs
+ *  \return status code if the watch cannot be started, otherwise
+ *          does not return - halts with program termination
  *
- * Returns:
- *    does not return - halts with program termination
+ *  \remark
+ *  The displays must not be open.
  */
-void
-app_read_changes_forever(Display_Handle * dh) {
-   bool debug = false;
-
-   printf("Watching for VCP feature changes on display %s\n", dh_repr(dh));
-   printf("Type ^C to exit...\n");
-   // show version here instead of in called function to declutter debug output:
-   DDCA_MCCS_Version_Spec vspec = get_vcp_version_by_display_handle(dh);
-   DBGMSF(debug, "VCP version: %d.%d", vspec.major, vspec.minor);
-   while(true) {
-#ifdef USE_USB
-      if (dh->dref->io_path.io_mode == DDCA_IO_USB)
-         app_read_changes_usb(dh);
-      else
-#endif
-         app_read_changes(dh);
-
-      sleep_millis( 2500);
+Public_Status_Code
+app_watch_vcp_changes(int dref_ct, Display_Ref ** drefs, bool json) {
+   char path[40];
+   for (int ndx = 0; ndx < dref_ct; ndx++)
+      fprintf(stderr, "Watching for VCP feature changes on display %d, %s\n",
+                      drefs[ndx]->dispno, watch_path_name(&drefs[ndx]->io_path, path, sizeof(path)));
+   fprintf(stderr, "Type ^C to exit...\n");
+
+   ddc_register_vcp_change_callback(show_vcp_change_event, (json) ? (void *) 1 : NULL);
+   Public_Status_Code psc = ddc_start_watch(dref_ct, drefs);
+   if (psc == 0) {
+      while(true)
+         sleep(60);
    }
+   return psc;
 }
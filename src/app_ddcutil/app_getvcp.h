@@ -61,10 +61,7 @@ app_show_feature_set_values_by_display_handle(
       Feature_Set_Flags     flags);
 
 
-void
-app_read_changes(Display_Handle * dh);
-
-void
-app_read_changes_forever(Display_Handle * dh);
+Public_Status_Code
+app_watch_vcp_changes(int dref_ct, Display_Ref ** drefs, bool json);
 
 #endif /* APP_GETVCP_H_ */
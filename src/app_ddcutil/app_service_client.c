@@ -0,0 +1,199 @@
+/** @file app_service_client.c
+ *
+ *  Forwards simple commands to the ddcutild service, which has already
+ *  detected the displays and read their capabilities.
+ *
+ *  A command is forwarded only if it is one the service executes, and
+ *  no option is specified that the service would not honor.  If the
+ *  service is not running, or does not know the display, the command is
+ *  executed normally.
+ */
+
+// Copyright (C) 2019 Sanford Rockowitz <rockowitz@minsoft.com>
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+/** \cond */
+#include <assert.h>
+#include <errno.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include "util/string_util.h"
+/** \endcond */
+
+#include "base/core.h"
+#include "base/ddc_errno.h"
+#include "base/displays.h"
+#include "base/feature_sets.h"
+
+#include "cmdline/parsed_cmd.h"
+
+#include "daemon/ddcutild_protocol.h"
+
+#include "app_ddcutil/app_service_client.h"
+
+
+// Trace class for this file
+static DDCA_Trace_Group TRACE_GROUP = DDCA_TRC_TOP;
+
+/** Maximum time to wait for the service to reply.
+ *  Reading capabilities from a monitor not yet read can take several seconds. */
+#define SERVICE_REPLY_TIMEOUT_SECONDS  30
+
+// Flags that do not affect the commands executed by the service.
+// Must include the flags that are set by default, i.e. CMD_FLAG_VERIFY,
+// CMD_FLAG_DSA, and CMD_FLAG_NOTABLE, otherwise nothing is forwarded.
+#define SERVICE_COMPATIBLE_FLAGS  \
+   (CMD_FLAG_VERIFY | CMD_FLAG_DSA | CMD_FLAG_NOTABLE | CMD_FLAG_NODETECT | CMD_FLAG_ASYNC)
+
+
+// Formats the request line for a command, returns false if the command
+// cannot be executed by the service.
+static bool format_service_request(Parsed_Cmd * parsed_cmd, char * buf, int bufsz) {
+   if ( (parsed_cmd->flags & ~SERVICE_COMPATIBLE_FLAGS) ||
+        !(parsed_cmd->flags & CMD_FLAG_VERIFY)          ||
+        parsed_cmd->output_level != DDCA_OL_NORMAL      ||
+        parsed_cmd->stats_types  != DDCA_STATS_NONE     ||
+        parsed_cmd->traced_groups || parsed_cmd->traced_files || parsed_cmd->traced_functions ||
+        parsed_cmd->event_ring_fn || parsed_cmd->failsim_control_fn ||
+        parsed_cmd->max_tries[0] || parsed_cmd->max_tries[1] || parsed_cmd->max_tries[2] ||
+        parsed_cmd->sleep_strategy >= 0 || parsed_cmd->i2c_io_strategy >= 0 )
+      return false;
+
+   char display[20] = "d1";      // default monitor
+   if (parsed_cmd->pdid) {
+      if (parsed_cmd->pdid->id_type == DISP_ID_DISPNO)
+         snprintf(display, sizeof(display), "d%d", parsed_cmd->pdid->dispno);
+      else if (parsed_cmd->pdid->id_type == DISP_ID_BUSNO)
+         snprintf(display, sizeof(display), "b%d", parsed_cmd->pdid->busno);
+      else
+         return false;
+   }
+
+   bool ok = false;
+   switch(parsed_cmd->cmd_id) {
+   case CMDID_DETECT:
+      ok = !parsed_cmd->pdid;
+      if (ok)
+         snprintf(buf, bufsz, "detect %s\n", display);
+      break;
+   case CMDID_CAPABILITIES:
+      snprintf(buf, bufsz, "capabilities %s\n", display);
+      ok = true;
+      break;
+   case CMDID_GETVCP:
+      ok = (parsed_cmd->fref && parsed_cmd->fref->subset == VCP_SUBSET_SINGLE_FEATURE);
+      if (ok)
+         snprintf(buf, bufsz, "getvcp %s %02x\n", display, parsed_cmd->fref->specific_feature);
+      break;
+   case CMDID_SETVCP:
+      // relative values, e.g. "+ 5", are not forwarded
+      // table features are declined by the service, see ddcutild_protocol.h
+      ok = (parsed_cmd->argct == 2 &&
+            parsed_cmd->args[1][0] != '+' && parsed_cmd->args[1][0] != '-' &&
+            strlen(parsed_cmd->args[0]) + strlen(parsed_cmd->args[1]) < 40);
+      if (ok)
+         snprintf(buf, bufsz, "setvcp %s %s %s\n", display, parsed_cmd->args[0], parsed_cmd->args[1]);
+      break;
+   default:
+      break;
+   }
+   return ok;
+}
+
+
+// Returns connected socket, or -1 if the service is not running
+static int connect_to_service() {
+   const char * path = getenv(DDCUTILD_SOCKET_ENV);
+   if (!path)
+      path = DDCUTILD_SOCKET_PATH;
+
+   struct sockaddr_un addr;
+   memset(&addr, 0, sizeof(addr));
+   addr.sun_family = AF_UNIX;
+   if (strlen(path) >= sizeof(addr.sun_path))
+      return -1;
+   strcpy(addr.sun_path, path);
+
+   int fd = socket(AF_UNIX, SOCK_STREAM|SOCK_CLOEXEC, 0);
+   if (fd >= 0 && connect(fd, (struct sockaddr *) &addr, sizeof(addr)) < 0) {
+      close(fd);
+      fd = -1;
+   }
+   return fd;
+}
+
+
+/** Executes a command using the ddcutild service, if possible.
+ *
+ *  \param  parsed_cmd   parsed command line
+ *  \param  main_rc_loc  where to return the program exit code
+ *                       if the command was executed by the service
+ *  \return **true** if the command was executed by the service,
+ *          **false** if it must be executed normally
+ *
+ *  \remark
+ *  Option --noservice disables use of the service.
+ */
+bool app_execute_by_service(Parsed_Cmd * parsed_cmd, int * main_rc_loc) {
+   bool debug = false;
+   char request[DDCUTILD_MAX_REQUEST_SIZE];
+   if ( (parsed_cmd->flags & CMD_FLAG_NO_SERVICE) ||
+        !format_service_request(parsed_cmd, request, sizeof(request)) )
+      return false;
+
+   int fd = connect_to_service();
+   if (fd < 0) {
+      DBGTRC(debug, TRACE_GROUP, "Service not running");
+      return false;
+   }
+   DBGTRC(debug, TRACE_GROUP, "Sending request: %s", request);
+
+   bool executed = false;
+   struct timeval tv = {SERVICE_REPLY_TIMEOUT_SECONDS, 0};
+   setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+   FILE * fp = fdopen(fd, "r+");
+   if (fp && fputs(request, fp) >= 0 && fflush(fp) == 0) {
+      char header[80];
+      char tag[20];
+      int  version;
+      int  rc;
+      // Once the request is sent, the command must not be executed again,
+      // unless the service reports that it has not executed it
+      executed = true;
+      if (fgets(header, sizeof(header), fp) &&
+          sscanf(header, "%19s %d %d", tag, &version, &rc) == 3 &&
+          streq(tag, DDCUTILD_RESPONSE_TAG) &&
+          version == DDCUTILD_PROTOCOL_VERSION)
+      {
+         if (rc == DDCRC_INVALID_DISPLAY) {
+            DBGTRC(debug, TRACE_GROUP, "Request declined by service");
+            executed = false;
+         }
+         else {
+            char buf[1024];
+            size_t ct;
+            while ( (ct = fread(buf, 1, sizeof(buf), fp)) > 0)
+               fwrite(buf, 1, ct, fout());
+            *main_rc_loc = (rc == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+         }
+      }
+      else {
+         f0printf(ferr(), "Invalid response from ddcutild service\n");
+         *main_rc_loc = EXIT_FAILURE;
+      }
+   }
+   if (fp)
+      fclose(fp);
+   else
+      close(fd);
+
+   DBGTRC(debug, TRACE_GROUP, "Returning: %s", bool_repr(executed));
+   return executed;
+}
@@ -0,0 +1,18 @@
+/** @file app_service_client.h
+ *
+ *  Execute commands using the ddcutild service, if it is running
+ */
+
+// Copyright (C) 2019 Sanford Rockowitz <rockowitz@minsoft.com>
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+#ifndef APP_SERVICE_CLIENT_H_
+#define APP_SERVICE_CLIENT_H_
+
+#include <stdbool.h>
+
+#include "cmdline/parsed_cmd.h"
+
+bool app_execute_by_service(Parsed_Cmd * parsed_cmd, int * main_rc_loc);
+
+#endif /* APP_SERVICE_CLIENT_H_ */
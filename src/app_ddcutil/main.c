@@ -36,6 +36,8 @@
 #include "base/ddc_errno.h"
 #include "base/ddc_packets.h"
 #include "base/displays.h"
+#include "base/dynamic_sleep.h"
+#include "base/event_ring.h"
 #include "base/linux_errno.h"
 #include "base/parms.h"
 #include "base/sleep.h"
@@ -46,6 +48,7 @@
 
 #include "dynvcp/dyn_dynamic_features.h"
 
+#include "i2c/i2c_bus_cache.h"
 #include "i2c/i2c_bus_core.h"
 #include "i2c/i2c_do_io.h"
 
@@ -53,7 +56,11 @@
 
 #include "usb/usb_displays.h"
 
+#include "ddc/ddc_capabilities_cache.h"
+#include "ddc/ddc_display_cache.h"
+#include "ddc/ddc_display_lock.h"
 #include "ddc/ddc_displays.h"
+#include "ddc/ddc_dumpload.h"
 #include "ddc/ddc_multi_part_io.h"
 #include "ddc/ddc_output.h"
 #include "ddc/ddc_packet_io.h"
@@ -70,6 +77,7 @@
 #include "app_ddcutil/app_dynamic_features.h"
 #include "app_ddcutil/app_dumpload.h"
 #include "app_ddcutil/app_getvcp.h"
+#include "app_ddcutil/app_service_client.h"
 #include "app_ddcutil/app_setvcp.h"
 
 #include "app_sysenv/query_sysenv.h"
@@ -387,10 +395,18 @@ int main(int argc, char *argv[]) {
    if (!parsed_cmd) {
       goto bye;      // main_rc == EXIT_FAILURE
    }
+   if (app_execute_by_service(parsed_cmd, &main_rc)) {
+      free_parsed_cmd(parsed_cmd);
+      goto bye;
+   }
    if (parsed_cmd->flags & CMD_FLAG_TIMESTAMP_TRACE)         // timestamps on debug and trace messages?
       dbgtrc_show_time = true;              // extern in core.h
    report_freed_exceptions = parsed_cmd->flags & CMD_FLAG_REPORT_FREED_EXCP;   // extern in core.h
    set_trace_levels(parsed_cmd->traced_groups);
+   if (parsed_cmd->event_ring_fn) {
+      event_ring_enable(true);
+      event_ring_dump_at_exit(parsed_cmd->event_ring_fn);
+   }
    if (parsed_cmd->traced_functions) {
       for (int ndx = 0; ndx < ntsa_length(parsed_cmd->traced_functions); ndx++)
          add_traced_function(parsed_cmd->traced_functions[ndx]);
@@ -419,7 +435,10 @@ int main(int argc, char *argv[]) {
 
    init_ddc_services();  // n. initializes start timestamp
    // overrides setting in init_ddc_services():
-   i2c_set_io_strategy(DEFAULT_I2C_IO_STRATEGY);
+   if (parsed_cmd->i2c_io_strategy >= 0)
+      i2c_set_io_strategy(parsed_cmd->i2c_io_strategy);
+   else
+      i2c_set_io_strategy(DEFAULT_I2C_IO_STRATEGY);
 
    ddc_set_verify_setvcp(parsed_cmd->flags & CMD_FLAG_VERIFY);
 
@@ -484,6 +503,27 @@ int main(int argc, char *argv[]) {
    if (parsed_cmd->sleep_strategy >= 0)
       set_sleep_strategy(parsed_cmd->sleep_strategy);
 
+#ifdef USE_API
+   ddca_enable_dynamic_sleep(parsed_cmd->flags & CMD_FLAG_DSA);
+   ddca_enable_differential_load(parsed_cmd->flags & CMD_FLAG_DIFFERENTIAL_LOAD);
+   ddca_enable_cross_process_lock(parsed_cmd->flags & CMD_FLAG_FLOCK);
+#else
+   dsa_enable(parsed_cmd->flags & CMD_FLAG_DSA);
+   ddc_enable_differential_load(parsed_cmd->flags & CMD_FLAG_DIFFERENTIAL_LOAD);
+   ddc_enable_cross_process_lock(parsed_cmd->flags & CMD_FLAG_FLOCK);
+#endif
+
+   if (parsed_cmd->flags & CMD_FLAG_REFRESH_CACHE) {
+      ddc_discard_display_cache();
+      ddc_discard_capabilities_cache();
+      i2c_discard_bus_cache();
+   }
+   if (parsed_cmd->flags & CMD_FLAG_NO_CACHE) {
+      ddc_enable_display_cache(false);
+      ddc_enable_capabilities_cache(false);
+      i2c_enable_bus_cache(false);
+   }
+
    int threshold = DISPLAY_CHECK_ASYNC_NEVER;
    if (parsed_cmd->flags & CMD_FLAG_ASYNC)
       threshold = DISPLAY_CHECK_ASYNC_THRESHOLD;
@@ -568,6 +608,19 @@ int main(int argc, char *argv[]) {
    }
 #endif
 
+   else if (parsed_cmd->cmd_id == CMDID_LOADVCP && parsed_cmd->argct > 1) {
+      ddc_ensure_displays_detected();
+
+      if (parsed_cmd->pdid) {
+         fprintf(stderr, "Monitor cannot be specified when loading multiple files\n");
+         main_rc = EXIT_FAILURE;
+      }
+      else {
+         bool loadvcp_ok = loadvcp_by_files(parsed_cmd->argct, parsed_cmd->args);
+         main_rc = (loadvcp_ok) ? EXIT_SUCCESS : EXIT_FAILURE;
+      }
+   }
+
    else if (parsed_cmd->cmd_id == CMDID_LOADVCP) {
       ddc_ensure_displays_detected();
 
@@ -596,6 +649,45 @@ int main(int argc, char *argv[]) {
       main_rc = (loadvcp_ok) ? EXIT_SUCCESS : EXIT_FAILURE;
    }
 
+   else if (parsed_cmd->cmd_id == CMDID_READCHANGES &&
+            ntsa_find(parsed_cmd->args, "all") >= 0)   // watch all displays
+   {
+      if (parsed_cmd->pdid) {
+         fprintf(stderr, "Monitor cannot be specified when watching all displays\n");
+         main_rc = EXIT_FAILURE;
+      }
+      else {
+         ddc_ensure_displays_detected();
+         bool json = (ntsa_find(parsed_cmd->args, "json") >= 0);
+         GPtrArray * all_displays = ddc_get_all_displays();
+         GPtrArray * drefs = g_ptr_array_new();
+         for (int ndx = 0; ndx < all_displays->len; ndx++) {
+            Display_Ref * dref = g_ptr_array_index(all_displays, ndx);
+            if (dref->dispno > 0)       // valid displays only
+               g_ptr_array_add(drefs, dref);
+         }
+         if (drefs->len == 0) {
+            f0printf(fout, "No active displays found\n");
+            main_rc = EXIT_FAILURE;
+         }
+         else {
+            Public_Status_Code psc =
+                  app_watch_vcp_changes(drefs->len, (Display_Ref **) drefs->pdata, json);
+            main_rc = (psc == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+         }
+         g_ptr_array_free(drefs, true);
+      }
+   }
+
+   else if (parsed_cmd->cmd_id == CMDID_EVENTS) {
+      bool json = (parsed_cmd->argct > 1 && streq(parsed_cmd->args[1], "json"));
+      int rc = event_ring_decode(parsed_cmd->args[0], json, stdout);
+      if (rc != 0)
+         f0printf(ferr(), "Unable to decode event file %s: %s\n",
+                          parsed_cmd->args[0], (rc == -EINVAL) ? "invalid format" : strerror(-rc));
+      main_rc = (rc == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+   }
+
    else if (parsed_cmd->cmd_id == CMDID_ENVIRONMENT) {
       dup2(1,2);   // redirect stderr to stdout
       ddc_ensure_displays_detected();   // *** NEEDED HERE ??? ***
@@ -861,11 +953,19 @@ int main(int argc, char *argv[]) {
                }
 
             case CMDID_READCHANGES:
-               // DBGMSG("Case CMDID_READCHANGES");
-               // report_parsed_cmd(parsed_cmd,0);
-               app_read_changes_forever(dh);
-               main_rc = EXIT_SUCCESS;
-               break;
+               {
+                  // the watch opens the display only while checking it
+                  ddc_close_display(dh);
+                  dh = NULL;
+                  bool json = false;
+                  for (int ndx = 0; ndx < parsed_cmd->argct; ndx++) {
+                     if (streq(parsed_cmd->args[ndx], "json"))
+                        json = true;
+                  }
+                  Public_Status_Code psc = app_watch_vcp_changes(1, &dref, json);
+                  main_rc = (psc == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+                  break;
+               }
 
             case CMDID_PROBE:
                check_dynamic_features(dref);
@@ -879,7 +979,8 @@ int main(int argc, char *argv[]) {
                break;
             }
 
-            ddc_close_display(dh);
+            if (dh)
+               ddc_close_display(dh);
          }
          if (dref->flags & DREF_TRANSIENT)
             free_display_ref(dref);
@@ -889,8 +990,16 @@ int main(int argc, char *argv[]) {
       }
    }
 
+   ddc_save_learned_display_info();
+
    if (parsed_cmd->stats_types != DDCA_STATS_NONE && parsed_cmd->cmd_id != CMDID_INTERROGATE) {
-      report_stats(parsed_cmd->stats_types);
+      if (parsed_cmd->stats_format == DDCA_STATS_FORMAT_TEXT)
+         report_stats(parsed_cmd->stats_types);
+      else {
+         char * exported = ddc_export_stats_main(parsed_cmd->stats_types, parsed_cmd->stats_format, false);
+         f0printf(fout, "%s", exported);
+         free(exported);
+      }
       // report_timestamp_history();  // debugging function
    }
    free_parsed_cmd(parsed_cmd);
@@ -318,7 +318,7 @@ void report_device_identification(char * sysfs_device_dir, int depth) {
    assert(dev_ids.subvendor_id == dev_ids2.subvendor_id);
    assert(dev_ids.subdevice_id == dev_ids2.subdevice_id);
 
-   bool pci_ids_ok = devid_ensure_initialized();
+   bool pci_ids_ok = devid_pci_ids_available();
    if (pci_ids_ok) {
       Pci_Usb_Id_Names names = devid_get_pci_names(
                       dev_ids.vendor_id,
@@ -30,6 +30,7 @@
 #include "core.h"
 #include "ddc_packets.h"
 #include "displays.h"
+#include "dynamic_sleep.h"
 #include "execution_stats.h"
 #include "linux_errno.h"
 #include "sleep.h"
@@ -44,6 +45,7 @@ void init_base_services() {
    errinfo_init(psc_name, psc_desc);
    init_sleep_stats();
    init_execution_stats();
+   init_dynamic_sleep();
    init_status_code_mgt();
    // init_linux_errno();
    init_displays();
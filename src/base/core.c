@@ -402,7 +402,21 @@ DDCA_Trace_Group trace_class_name_to_value(char * name) {
                            DDCA_TRC_NONE);
 }
 
-static DDCA_Trace_Group trace_levels = DDCA_TRC_NONE;   // 0x00
+
+/** Given a trace group identifier, returns its name.
+ *
+ *  @param trace_group trace group identifier
+ *  @return trace group name, NULL if not a single recognized group
+ */
+char * trace_group_name(DDCA_Trace_Group trace_group) {
+   return vnt_name(trace_group_table, trace_group);
+}
+
+DDCA_Trace_Group trace_levels = DDCA_TRC_NONE;   // 0x00
+
+// Incremented each time a function or file is added to the traced names,
+// invalidating the results cached by is_traced_site().
+volatile int traced_names_generation = 0;
 
 
 /** Specifies the trace groups to be traced.
@@ -438,8 +452,10 @@ void add_traced_function(const char * funcname) {
    if (!traced_function_table)
       traced_function_table = g_ptr_array_new();
    // n. g_ptr_array_find_with_equal_func() requires glib 2.54
-   if (gaux_string_ptr_array_find(traced_function_table, funcname) < 0)
+   if (gaux_string_ptr_array_find(traced_function_table, funcname) < 0) {
       g_ptr_array_add(traced_function_table, g_strdup(funcname));
+      traced_names_generation++;
+   }
 }
 
 /** Adds a file to the list of files to be traced.
@@ -466,8 +482,10 @@ void add_traced_file(const char * filename) {
       bname = temp;
    }
 
-   if (gaux_string_ptr_array_find(traced_file_table, bname) < 0)
+   if (gaux_string_ptr_array_find(traced_file_table, bname) < 0) {
       g_ptr_array_add(traced_file_table, bname);
+      traced_names_generation++;
+   }
    else
       free(bname);
    // printf("(%s) filename=|%s|, bname=|%s|, found=%s\n", __func__, filename, bname, bool_repr(found));
@@ -574,7 +592,8 @@ void show_traced_files() {
 bool is_tracing(DDCA_Trace_Group trace_group, const char * filename, const char * funcname) {
    bool result =  (trace_group == 0xff) || (trace_levels & trace_group); // is trace_group being traced?
 
-   result = result || is_traced_function(funcname) || is_traced_file(filename);
+   result = result || (traced_names_generation &&
+                       (is_traced_function(funcname) || is_traced_file(filename)) );
 
    // printf("(%s) trace_group = %02x, filename=%s, funcname=%s, traceLevels=0x%02x, returning %d\n",
    //        __func__, trace_group, filename, funcname, trace_levels, result);
@@ -582,6 +601,35 @@ bool is_tracing(DDCA_Trace_Group trace_group, const char * filename, const char
 }
 
 
+/** Checks if the file or function of a trace call site is being traced.
+ *
+ *  The result is cached in the call site's #Trace_Site_Cache, and recomputed
+ *  only when a function or file has been added to the traced names since
+ *  the last check.
+ *
+ *  @param site      call site cache
+ *  @param filename  file containing the call site
+ *  @param funcname  function containing the call site
+ *  @return **true** if the file or function is traced, **false** if not
+ *
+ *  @remark
+ *  The cached state is a single int, so a concurrent update by another
+ *  thread at the same site at worst repeats the name lookup.
+ *
+ *  @ingroup dbgtrace
+ */
+bool is_traced_site(Trace_Site_Cache * site, const char * filename, const char * funcname) {
+   int generation = traced_names_generation;
+   int state = site->state;
+   if ( (state >> 1) != generation ) {
+      bool traced = is_traced_function(funcname) || is_traced_file(filename);
+      state = (generation << 1) | (traced ? 1 : 0);
+      site->state = state;
+   }
+   return state & 1;
+}
+
+
 /** Outputs a line reporting the active trace groups.
  *  Output is written to the current **FOUT** device.
  */
@@ -800,41 +848,24 @@ bool dbgtrc(
         char *       format,
         ...)
 {
-   static char * buffer = NULL;
-   static int    bufsz  = 200;     // initial value
-   static char * buf2   = NULL;
-
-   if (!buffer) {      // first call
-      buffer = calloc(bufsz,    sizeof(char));
-      buf2   = calloc(bufsz+60, sizeof(char));
-   }
-
    bool msg_emitted = false;
    if ( is_tracing(trace_group, filename, funcname) ) {
+      // Formatted into per-call buffers, since messages can be issued
+      // concurrently from multiple threads
       va_list(args);
       va_start(args, format);
-      int ct = vsnprintf(buffer, bufsz, format, args);
+      gchar * buffer = g_strdup_vprintf(format, args);
       va_end(args);
-      if (ct >= bufsz) {   // if buffer too small, reallocate
-         free(buffer);
-         free(buf2);
-
-         bufsz = ct+1;
-         buffer = calloc(bufsz, sizeof(char));
-         buf2   = calloc(bufsz+50, sizeof(char));
-         va_list(args);
-         va_start(args, format);
-         ct = vsnprintf(buffer, bufsz, format, args);
-         assert(ct < bufsz);
-         va_end(args);
-      }
 
+      gchar * buf2 = NULL;
       if (dbgtrc_show_time)
-         snprintf(buf2, bufsz+60, "[%s](%s) %s\n", formatted_elapsed_time(), funcname, buffer);
+         buf2 = g_strdup_printf("[%s](%s) %s\n", formatted_elapsed_time(), funcname, buffer);
       else
-         snprintf(buf2, bufsz+60, "(%s) %s\n", funcname, buffer);
+         buf2 = g_strdup_printf("(%s) %s\n", funcname, buffer);
       f0puts(buf2, fout());    // no automatic terminating null
       fflush(fout());
+      g_free(buf2);
+      g_free(buffer);
       msg_emitted = true;
    }
 
@@ -20,6 +20,8 @@
 #define BASE_CORE_H_
 
 /** \cond */
+#include "config.h"
+
 #include <linux/limits.h>
 #include <stdarg.h>
 #include <stdbool.h>
@@ -32,6 +34,8 @@
 #include "util/coredefs.h"
 #include "util/error_info.h"
 
+#include "base/event_ring.h"
+
 
 //
 // Common macros
@@ -116,23 +120,60 @@ bool is_traced_file( const char * filename);
 void show_traced_files();
 
 DDCA_Trace_Group trace_class_name_to_value(char * name);
+char *           trace_group_name(DDCA_Trace_Group trace_group);
 void set_trace_levels(DDCA_Trace_Group trace_flags);
 // char * get_active_trace_group_names();  // unimplemented
 void show_trace_groups();
 
 bool is_tracing(DDCA_Trace_Group trace_group, const char * filename, const char * funcname);
 
+/** Per call site cache of whether the site's file or function is traced.
+ *  Holds the value of #traced_names_generation at the time the check was made,
+ *  shifted left one bit, with the result in the low order bit.
+ */
+typedef struct {
+   int state;
+} Trace_Site_Cache;
+
+extern DDCA_Trace_Group trace_levels;             // active trace groups
+extern volatile int     traced_names_generation;  // 0 if no traced functions or files
+
+bool is_traced_site(Trace_Site_Cache * site, const char * filename, const char * funcname);
+
+#ifdef DISABLE_TRACE
+// Trace groups are compiled out.  The trace group is referenced so that
+// TRACE_GROUP variables used only for tracing do not become unused.
+#define IS_TRACING_SITE(_site, _grp)  ( (void)(_site), (void)(_grp), false )
+#define RECORD_TRACE_EVENT(_grp)
+#else
+/** Checks if tracing is active for a call site.
+ *
+ *  Trace groups are tested inline.  Traced function and file names are
+ *  checked only if any have been registered, and then only once per call
+ *  site each time the set of names changes, so that a disabled trace site
+ *  costs a couple of loads and a predictable branch.
+ */
+#define IS_TRACING_SITE(_site, _grp) \
+   ( (_grp) == 0xff || (trace_levels & (_grp)) || \
+     (traced_names_generation && is_traced_site((_site), __FILE__, __func__)) )
+
+/** Records that a trace site was reached, if event recording is enabled. */
+#define RECORD_TRACE_EVENT(_grp) \
+   do { if (event_ring_enabled) event_ring_record(ER_TRACE, (_grp), __LINE__, __func__, 0, 0); } while(0)
+#endif
+
 /** Checks if tracking is currently active for the globally defined TRACE_GROUP value,
  *  current file and function.
  *
- *  Wrappers call to **is_tracing()**, using the current **TRACE_GROUP** value,
+ *  Wrappers call to **IS_TRACING_SITE()**, using the current **TRACE_GROUP** value,
  *  filename, and function as implicit arguments.
  */
-#define IS_TRACING() is_tracing(TRACE_GROUP, __FILE__, __func__)
+#define IS_TRACING() IS_TRACING_GROUP(TRACE_GROUP)
 
-#define IS_TRACING_GROUP(grp) is_tracing((grp), __FILE__, __func__)
+#define IS_TRACING_GROUP(grp) \
+   ({ static Trace_Site_Cache _trace_site; IS_TRACING_SITE(&_trace_site, (grp)); })
 
-#define IS_TRACING_BY_FUNC_OR_FILE() is_tracing(DDCA_TRC_NONE, __FILE__, __func__)
+#define IS_TRACING_BY_FUNC_OR_FILE() IS_TRACING_GROUP(DDCA_TRC_NONE)
 
 
 //
@@ -224,7 +265,7 @@ bool dbgtrc(
 
 
 #define TRCMSG(            format, ...) \
-   dbgtrc(TRACE_GROUP, __func__, __LINE__, __FILE__, format, ##__VA_ARGS__)
+   DBGTRC(false, TRACE_GROUP, format, ##__VA_ARGS__)
 
 // which of these are really useful?
 // not currently used: TRCALWAYS, TRCMSGTG, TRCMSGTF
@@ -237,12 +278,17 @@ bool dbgtrc(
 // alt: dbgtrc( ( (trace_flag) ? (0xff) : TRACE_GROUP ), __func__, __LINE__, __FILE__, format, ##__VA_ARGS__)
 
 // For messages that are issued either if tracing is enabled for the appropriate trace group or
-// if a debug flag is set.
+// if a debug flag is set.  The message arguments are evaluated only if the message is issued.
+// Evaluates to true if the message was issued.
 #define DBGTRC(debug_flag, trace_group, format, ...) \
-    dbgtrc( ( (debug_flag) ) ? 0xff : (trace_group), __func__, __LINE__, __FILE__, format, ##__VA_ARGS__)
+   ({ static Trace_Site_Cache _trace_site; \
+      RECORD_TRACE_EVENT(trace_group); \
+      ( (debug_flag) || IS_TRACING_SITE(&_trace_site, (trace_group)) ) \
+         ? dbgtrc(0xff, __func__, __LINE__, __FILE__, format, ##__VA_ARGS__) \
+         : false; })
 
 #define DBGTRC0(debug_flag, trace_group, format) \
-    dbgtrc( ( (debug_flag) ) ? 0xff : (trace_group), __func__, __LINE__, __FILE__, format)
+   DBGTRC(debug_flag, trace_group, format)
 
 
 // typedef (*dbg_struct_func)(void * structptr, int depth);
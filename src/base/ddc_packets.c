@@ -437,6 +437,29 @@ create_ddc_getvcp_request_packet(Byte vcp_code, const char * tag)
 }
 
 
+/** Changes the feature code in an existing Get VCP request packet,
+ *  so that the packet can be reused to read another feature.
+ *
+ *  \param  packet    Get VCP request packet
+ *  \param  vcp_code  new VCP feature code
+ */
+void
+update_ddc_getvcp_request_packet_feature_code(
+      DDC_Packet * packet,
+      Byte         vcp_code)
+{
+   assert(packet->type == DDC_PACKET_TYPE_QUERY_VCP_REQUEST);
+
+   Byte * data_bytes = get_data_start(packet);
+   data_bytes[1] = vcp_code;
+
+   // update checksum
+   Byte * bytes = get_packet_start(packet);
+   int packet_size_wo_checksum = get_packet_len(packet)-1;
+   bytes[packet_size_wo_checksum] = ddc_checksum(bytes, packet_size_wo_checksum, false);
+}
+
+
 /** Creates a Set VCP request packet
  *
  *  \param   vcp_code  VCP feature code
@@ -196,6 +196,11 @@ create_ddc_getvcp_request_packet(
       Byte          vcp_code,
       const char *  tag);
 
+void
+update_ddc_getvcp_request_packet_feature_code(
+      DDC_Packet *  packet,
+      Byte          vcp_code);
+
 Status_DDC
 create_ddc_getvcp_response_packet(
       Byte *        i2c_response_bytes,
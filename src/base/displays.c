@@ -626,6 +626,8 @@ static Display_Ref * create_base_display_ref(DDCA_IO_Path io_path) {
    dref->vcp_version = DDCA_VSPEC_UNQUERIED;
 
    dref->async_rec  = get_display_async_rec(io_path);    // keep?
+   if (io_path.io_mode == DDCA_IO_I2C)
+      dref->dsd = dsd_get(io_path);
 
    return dref;
 }
@@ -844,6 +846,7 @@ void dbgrpt_display_ref(Display_Ref * dref, int depth) {
    rpt_vstring(d2, "DDC normal all byte 0 response may indicate unsupported: %s", sbool(dref->flags & DREF_DDC_USES_MH_ML_SH_SL_ZERO_FOR_UNSUPPORTED));
    rpt_vstring(d2, "DDC does not indicate unsupported:          %s", sbool(dref->flags & DREF_DDC_DOES_NOT_INDICATE_UNSUPPORTED));
    rpt_vstring(d2, "Display Ref is open:                        %s", sbool(dref->flags & DREF_OPEN));
+   rpt_vstring(d2, "Display removed:                            %s", sbool(dref->flags & DREF_REMOVED));
    rpt_vstring(d2, "mmid:                                       %s", (dref->mmid) ? mmk_repr(*dref->mmid) : "NULL");}
 
 
@@ -21,6 +21,7 @@
 
 #include "core.h"
 #include "dynamic_features.h"
+#include "dynamic_sleep.h"
 #include "feature_sets.h"
 #include "vcp_version.h"
 
@@ -162,6 +163,7 @@ bool               dsel_validate(          Display_Selector * dsel);
 // *** Display_Ref ***
 
 typedef uint16_t Dref_Flags;
+#define DREF_REMOVED                                   0x1000
 #define DREF_DDC_COMMUNICATION_CHECKED                 0x0080
 #define DREF_DDC_COMMUNICATION_WORKING                 0x0040
 #define DREF_DDC_NULL_RESPONSE_CHECKED                 0x0020
@@ -196,6 +198,7 @@ typedef struct _display_ref {
    void *                   detail;    // I2C_Bus_Info, ADL_Display_Detail, or Usb_Monitor_Info
    Display_Async_Rec *      async_rec;
    Dynamic_Features_Rec *   dfr;                   // user defined feature metadata
+   Dynamic_Sleep_Data *     dsd;                   // learned sleep adjustment, I2C only
 } Display_Ref;
 
 #define ASSERT_DREF_IO_MODE(_dref, _mode)  \
@@ -221,6 +224,10 @@ bool dref_eq(Display_Ref* this, Display_Ref* that);
 
 // *** Display_Handle ***
 
+/** Size of the scratch buffer for DDC responses in a #Display_Handle,
+ *  at least MAX_DDC_PACKET_INC_CHECKSUM */
+#define DH_READBUF_SIZE  40
+
 #define DISPLAY_HANDLE_MARKER "DSPH"
 /** Describes an open display device. */
 typedef struct {
@@ -228,6 +235,9 @@ typedef struct {
    Display_Ref* dref;
    int          fh;     // file handle if ddc_io_mode == DDC_IO_DEVI2C or USB_IO                           // added 7/2016
    char *       repr;
+   bool         defer_post_read_sleep;  ///< if true, SE_POST_READ sleep is deferred until the next write
+   uint64_t     deferred_sleep_end;     ///< if non-zero, time (realtime nanosec) at which deferred sleep ends
+   Byte         readbuf[DH_READBUF_SIZE]; ///< scratch buffer reused for each DDC response read
 } Display_Handle;
 
 Display_Handle * create_bus_display_handle_from_display_ref(int fh, Display_Ref * dref);
@@ -0,0 +1,291 @@
+/** @file dynamic_sleep.c
+ *
+ *  Adaptive per-display adjustment of DDC protocol sleep times.
+ *
+ *  The DDC/CI specification requires fixed waits between a write and the
+ *  subsequent read, but most monitors respond correctly with much shorter
+ *  waits.  For each display path a sleep multiplier is maintained.  It is
+ *  lowered while write/read exchanges keep succeeding on the first try, and
+ *  raised when an exchange sees a DDC Null Response or an all zero response,
+ *  which are the typical symptoms of a monitor that has not had enough time.
+ */
+
+// Copyright (C) 2019 Sanford Rockowitz <rockowitz@minsoft.com>
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+/** \cond */
+#include <assert.h>
+#include <glib-2.0/glib.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+/** \endcond */
+
+#include "util/report_util.h"
+#include "util/string_util.h"
+
+#include "base/core.h"
+#include "base/displays.h"
+#include "base/parms.h"
+
+#include "base/dynamic_sleep.h"
+
+
+static bool        dsa_enabled = true;
+static GMutex      dynamic_sleep_data_list_mutex;
+static GPtrArray * dynamic_sleep_data_list = NULL;   // only a handful of displays
+
+
+/** Enables or disables dynamic sleep adjustment.
+ *
+ *  \param  onoff  true to enable, false to disable
+ *  \return prior setting
+ *
+ *  \remark
+ *  This setting is global to all threads.
+ */
+bool dsa_enable(bool onoff) {
+   bool old = dsa_enabled;
+   dsa_enabled = onoff;
+   return old;
+}
+
+
+/** Reports whether dynamic sleep adjustment is enabled.
+ *
+ *  \return true/false
+ */
+bool dsa_is_enabled() {
+   return dsa_enabled;
+}
+
+
+static Dynamic_Sleep_Data * dsd_new(DDCA_IO_Path dpath) {
+   Dynamic_Sleep_Data * dsd = calloc(1, sizeof(Dynamic_Sleep_Data));
+   memcpy(dsd->marker, DYNAMIC_SLEEP_DATA_MARKER, 4);
+   dsd->dpath = dpath;
+   g_mutex_init(&dsd->mutex);
+   dsd->sleep_multiplier       = 1.0;
+   dsd->min_multiplier_reached = 1.0;
+   dsd->max_multiplier_reached = 1.0;
+   return dsd;
+}
+
+
+/** Obtains the #Dynamic_Sleep_Data record for a display path,
+ *  creating it if necessary.
+ *
+ *  \param  dpath  display path
+ *  \return pointer to #Dynamic_Sleep_Data (do not free)
+ */
+Dynamic_Sleep_Data * dsd_get(DDCA_IO_Path dpath) {
+   bool debug = false;
+   assert(dynamic_sleep_data_list);
+
+   g_mutex_lock(&dynamic_sleep_data_list_mutex);
+   Dynamic_Sleep_Data * result = NULL;
+   for (int ndx = 0; ndx < dynamic_sleep_data_list->len; ndx++) {
+      Dynamic_Sleep_Data * cur = g_ptr_array_index(dynamic_sleep_data_list, ndx);
+      if (dpath_eq(cur->dpath, dpath)) {
+         result = cur;
+         break;
+      }
+   }
+   if (!result) {
+      result = dsd_new(dpath);
+      g_ptr_array_add(dynamic_sleep_data_list, result);
+   }
+   g_mutex_unlock(&dynamic_sleep_data_list_mutex);
+
+   DBGMSF(debug, "dpath=%s, returning %p", dpath_repr_t(&dpath), result);
+   return result;
+}
+
+
+/** Returns the current sleep multiplier for a display.
+ *
+ *  \param  dsd  pointer to #Dynamic_Sleep_Data
+ *  \return sleep multiplier
+ */
+double dsd_get_sleep_multiplier(Dynamic_Sleep_Data * dsd) {
+   ASSERT_MARKER(dsd, DYNAMIC_SLEEP_DATA_MARKER);
+   g_mutex_lock(&dsd->mutex);
+   double result = dsd->sleep_multiplier;
+   g_mutex_unlock(&dsd->mutex);
+   return result;
+}
+
+
+/** Sets the sleep multiplier for a display, e.g. from a previously learned value.
+ *
+ *  \param  dsd         pointer to #Dynamic_Sleep_Data
+ *  \param  multiplier  new value, forced into the range
+ *                      #DSA_MIN_MULTIPLIER..#DSA_MAX_MULTIPLIER
+ */
+void dsd_set_sleep_multiplier(Dynamic_Sleep_Data * dsd, double multiplier) {
+   ASSERT_MARKER(dsd, DYNAMIC_SLEEP_DATA_MARKER);
+   if (multiplier < DSA_MIN_MULTIPLIER)
+      multiplier = DSA_MIN_MULTIPLIER;
+   else if (multiplier > DSA_MAX_MULTIPLIER)
+      multiplier = DSA_MAX_MULTIPLIER;
+
+   g_mutex_lock(&dsd->mutex);
+   dsd->sleep_multiplier = multiplier;
+   if (multiplier < dsd->min_multiplier_reached)
+      dsd->min_multiplier_reached = multiplier;
+   if (multiplier > dsd->max_multiplier_reached)
+      dsd->max_multiplier_reached = multiplier;
+   dsd->consecutive_successes = 0;
+   g_mutex_unlock(&dsd->mutex);
+}
+
+
+/** Applies the current multiplier to a protocol sleep time.
+ *
+ *  \param  dsd           pointer to #Dynamic_Sleep_Data
+ *  \param  sleep_millis  unadjusted sleep time in milliseconds
+ *  \return adjusted sleep time in milliseconds
+ *
+ *  If dynamic sleep adjustment is disabled, the sleep time is returned
+ *  unchanged.
+ */
+int dsd_adjust_sleep_millis(Dynamic_Sleep_Data * dsd, int sleep_millis) {
+   ASSERT_MARKER(dsd, DYNAMIC_SLEEP_DATA_MARKER);
+   int result = sleep_millis;
+
+   g_mutex_lock(&dsd->mutex);
+   if (dsa_enabled)
+      result = (int) (sleep_millis * dsd->sleep_multiplier + 0.5);
+   dsd->unadjusted_sleep_millis += sleep_millis;
+   dsd->adjusted_sleep_millis   += result;
+   g_mutex_unlock(&dsd->mutex);
+
+   return result;
+}
+
+
+/** Records the outcome of a write/read exchange, adjusting the
+ *  sleep multiplier for the display.
+ *
+ *  \param  dsd                 pointer to #Dynamic_Sleep_Data
+ *  \param  ok                  true if the exchange ultimately succeeded
+ *  \param  tryct               number of tries performed
+ *  \param  backoff_failure_ct  number of tries that failed with a DDC Null Response
+ *                              or all zero response that the monitor does not
+ *                              use to indicate an unsupported feature
+ */
+void dsd_record_exchange(
+      Dynamic_Sleep_Data * dsd,
+      bool                 ok,
+      int                  tryct,
+      int                  backoff_failure_ct)
+{
+   bool debug = false;
+   ASSERT_MARKER(dsd, DYNAMIC_SLEEP_DATA_MARKER);
+
+   g_mutex_lock(&dsd->mutex);
+   dsd->exchange_ct++;
+   dsd->backoff_failure_ct += backoff_failure_ct;
+
+   if (ok && tryct == 1) {
+      dsd->first_try_success_ct++;
+      if (dsa_enabled && ++dsd->consecutive_successes >= DSA_SUCCESSES_BEFORE_DECREASE) {
+         if (dsd->sleep_multiplier > DSA_MIN_MULTIPLIER) {
+            dsd->sleep_multiplier -= DSA_MULTIPLIER_DECREMENT;
+            if (dsd->sleep_multiplier < DSA_MIN_MULTIPLIER)
+               dsd->sleep_multiplier = DSA_MIN_MULTIPLIER;
+            if (dsd->sleep_multiplier < dsd->min_multiplier_reached)
+               dsd->min_multiplier_reached = dsd->sleep_multiplier;
+            dsd->decrease_ct++;
+         }
+         dsd->consecutive_successes = 0;
+      }
+   }
+   else if (backoff_failure_ct > 0) {
+      dsd->consecutive_successes = 0;
+      if (dsa_enabled && dsd->sleep_multiplier < DSA_MAX_MULTIPLIER) {
+         dsd->sleep_multiplier *= DSA_MULTIPLIER_BACKOFF_FACTOR;
+         if (dsd->sleep_multiplier > DSA_MAX_MULTIPLIER)
+            dsd->sleep_multiplier = DSA_MAX_MULTIPLIER;
+         if (dsd->sleep_multiplier > dsd->max_multiplier_reached)
+            dsd->max_multiplier_reached = dsd->sleep_multiplier;
+         dsd->increase_ct++;
+      }
+   }
+   else {
+      // retries for other reasons say nothing about the sleep time
+      dsd->consecutive_successes = 0;
+   }
+   double new_multiplier = dsd->sleep_multiplier;
+   g_mutex_unlock(&dsd->mutex);
+
+   DBGMSF(debug, "%s: ok=%s, tryct=%d, backoff_failure_ct=%d, sleep_multiplier=%5.2f",
+                 dpath_repr_t(&dsd->dpath), bool_repr(ok), tryct, backoff_failure_ct, new_multiplier);
+}
+
+
+/** Resets the counters in all #Dynamic_Sleep_Data records.
+ *  The learned multipliers are retained.
+ */
+void dsd_reset_all_stats() {
+   if (!dynamic_sleep_data_list)
+      return;
+
+   g_mutex_lock(&dynamic_sleep_data_list_mutex);
+   for (int ndx = 0; ndx < dynamic_sleep_data_list->len; ndx++) {
+      Dynamic_Sleep_Data * dsd = g_ptr_array_index(dynamic_sleep_data_list, ndx);
+      g_mutex_lock(&dsd->mutex);
+      dsd->min_multiplier_reached  = dsd->sleep_multiplier;
+      dsd->max_multiplier_reached  = dsd->sleep_multiplier;
+      dsd->exchange_ct             = 0;
+      dsd->first_try_success_ct    = 0;
+      dsd->backoff_failure_ct      = 0;
+      dsd->decrease_ct             = 0;
+      dsd->increase_ct             = 0;
+      dsd->unadjusted_sleep_millis = 0;
+      dsd->adjusted_sleep_millis   = 0;
+      g_mutex_unlock(&dsd->mutex);
+   }
+   g_mutex_unlock(&dynamic_sleep_data_list_mutex);
+}
+
+
+/** Reports the learned sleep adjustments for all displays.
+ *
+ *  \param depth logical indentation depth
+ */
+void report_dynamic_sleep_stats(int depth) {
+   int d1 = depth+1;
+   int d2 = depth+2;
+   rpt_vstring(depth, "Dynamic sleep adjustment:  %s", (dsa_enabled) ? "enabled" : "disabled");
+   if (!dynamic_sleep_data_list)
+      return;
+
+   g_mutex_lock(&dynamic_sleep_data_list_mutex);
+   for (int ndx = 0; ndx < dynamic_sleep_data_list->len; ndx++) {
+      Dynamic_Sleep_Data * dsd = g_ptr_array_index(dynamic_sleep_data_list, ndx);
+      g_mutex_lock(&dsd->mutex);
+      rpt_vstring(d1, "%s:", dpath_repr_t(&dsd->dpath));
+      rpt_vstring(d2, "Current sleep multiplier:          %5.2f", dsd->sleep_multiplier);
+      rpt_vstring(d2, "Multiplier range reached:          %5.2f - %5.2f",
+                      dsd->min_multiplier_reached, dsd->max_multiplier_reached);
+      rpt_vstring(d2, "Write/read exchanges:              %5d", dsd->exchange_ct);
+      rpt_vstring(d2, "Succeeded on first try:            %5d", dsd->first_try_success_ct);
+      rpt_vstring(d2, "Null or all zero response tries:   %5d", dsd->backoff_failure_ct);
+      rpt_vstring(d2, "Multiplier decreases, increases:   %5d, %d", dsd->decrease_ct, dsd->increase_ct);
+      rpt_vstring(d2, "Unadjusted sleep milliseconds:     %10"PRIu64, dsd->unadjusted_sleep_millis);
+      rpt_vstring(d2, "Adjusted sleep milliseconds:       %10"PRIu64, dsd->adjusted_sleep_millis);
+      g_mutex_unlock(&dsd->mutex);
+   }
+   g_mutex_unlock(&dynamic_sleep_data_list_mutex);
+}
+
+
+/** Initializes this module.
+ *
+ *  Must be called before any #Display_Ref is created.
+ */
+void init_dynamic_sleep() {
+   if (!dynamic_sleep_data_list)
+      dynamic_sleep_data_list = g_ptr_array_new();
+}
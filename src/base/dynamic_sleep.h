@@ -0,0 +1,62 @@
+/** @file dynamic_sleep.h
+ *
+ *  Adaptive per-display adjustment of DDC protocol sleep times.
+ */
+
+// Copyright (C) 2019 Sanford Rockowitz <rockowitz@minsoft.com>
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+#ifndef DYNAMIC_SLEEP_H_
+#define DYNAMIC_SLEEP_H_
+
+/** \cond */
+#include <glib-2.0/glib.h>
+#include <inttypes.h>
+#include <stdbool.h>
+/** \endcond */
+
+#include "public/ddcutil_types.h"
+
+
+#define DYNAMIC_SLEEP_DATA_MARKER "DSLP"
+/** Learned sleep adjustment for a single display path.
+ *
+ *  One instance exists for each #DDCA_IO_Path, so the learned value
+ *  survives the creation and destruction of transient #Display_Ref's.
+ */
+typedef struct {
+   char          marker[4];
+   DDCA_IO_Path  dpath;                    ///< key
+   GMutex        mutex;
+   double        sleep_multiplier;         ///< current multiplier applied to protocol sleeps
+   double        min_multiplier_reached;
+   double        max_multiplier_reached;
+   int           consecutive_successes;    ///< first try successes since last adjustment
+   int           exchange_ct;              ///< write/read exchanges recorded
+   int           first_try_success_ct;     ///< exchanges that succeeded on the first try
+   int           backoff_failure_ct;       ///< Null Response or all zero tries seen
+   int           decrease_ct;              ///< number of times multiplier was lowered
+   int           increase_ct;              ///< number of times multiplier was raised
+   uint64_t      unadjusted_sleep_millis;  ///< sleep time before adjustment
+   uint64_t      adjusted_sleep_millis;    ///< sleep time actually requested
+} Dynamic_Sleep_Data;
+
+void                 init_dynamic_sleep();
+
+bool                 dsa_enable(bool onoff);
+bool                 dsa_is_enabled();
+
+Dynamic_Sleep_Data * dsd_get(DDCA_IO_Path dpath);
+double               dsd_get_sleep_multiplier(Dynamic_Sleep_Data * dsd);
+void                 dsd_set_sleep_multiplier(Dynamic_Sleep_Data * dsd, double multiplier);
+int                  dsd_adjust_sleep_millis(Dynamic_Sleep_Data * dsd, int sleep_millis);
+void                 dsd_record_exchange(
+                           Dynamic_Sleep_Data * dsd,
+                           bool                 ok,
+                           int                  tryct,
+                           int                  backoff_failure_ct);
+
+void                 dsd_reset_all_stats();
+void                 report_dynamic_sleep_stats(int depth);
+
+#endif /* DYNAMIC_SLEEP_H_ */
@@ -0,0 +1,550 @@
+/** @file event_ring.c
+ *
+ *  Per-thread binary ring of trace, IO, sleep, and status code events.
+ *
+ *  When enabled, each thread records fixed size event records in its own
+ *  ring, overwriting the oldest records once the ring is full.  Recording
+ *  takes no locks and does no formatting: only the event type, a few
+ *  integers, the timestamp, the current display, and a pointer to the
+ *  function name of the recording site are saved.  The rings can be
+ *  dumped on demand or at program exit to a compact binary file, which
+ *  is rendered as text or as Chrome trace JSON by event_ring_decode().
+ *
+ *  Since the rings are written without locks, a dump taken while other
+ *  threads are active may contain records being overwritten at that
+ *  moment.  This is acceptable for diagnostic use.
+ */
+
+// Copyright (C) 2019 Sanford Rockowitz <rockowitz@minsoft.com>
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+/** \cond */
+#include <assert.h>
+#include <errno.h>
+#include <glib-2.0/glib.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+/** \endcond */
+
+#include "util/timestamp.h"
+
+#include "base/core.h"
+#include "base/execution_stats.h"
+#include "base/parms.h"
+#include "base/status_code_mgt.h"
+
+#include "base/event_ring.h"
+
+
+// Trace class for this file
+static DDCA_Trace_Group TRACE_GROUP = DDCA_TRC_NONE;
+
+bool event_ring_enabled = false;
+
+
+//
+// In memory rings
+//
+
+typedef struct {
+   uint64_t      timestamp;         ///< start of event, realtime clock nanoseconds
+   uint32_t      duration_micros;   ///< 0 for instantaneous events
+   int32_t       value;             ///< meaning depends on event type
+   const char *  location;          ///< function name, static storage, may be NULL
+   uint16_t      subtype;           ///< meaning depends on event type
+   int16_t       busno;             ///< bus or device number of current display, -1 if none
+   uint8_t       event_type;        ///< #Event_Ring_Event_Type
+   uint8_t       io_mode;           ///< #DDCA_IO_Mode of current display
+} Event_Record;
+
+#define EVENT_RING_MARKER "EVRG"
+typedef struct {
+   char          marker[4];
+   int           thread_ordinal;
+   gint          head;              ///< next slot to write, accessed atomically
+   bool          wrapped;           ///< all slots have been written
+   int16_t       busno;             ///< current display, set by event_ring_set_display()
+   uint8_t       io_mode;
+   Event_Record  records[EVENT_RING_SIZE];
+} Event_Ring;
+
+static GPrivate    thread_ring_key = G_PRIVATE_INIT(NULL);   // rings outlive their threads
+static GMutex      ring_registry_mutex;
+static GPtrArray * ring_registry = NULL;                     // all rings, never freed
+static char *      exit_dump_fn = NULL;
+
+
+/** Enables or disables event recording.
+ *
+ *  \param  onoff  true to enable, false to disable
+ *  \return prior setting
+ *
+ *  \remark
+ *  Previously recorded events are retained when recording is disabled.
+ */
+bool event_ring_enable(bool onoff) {
+   bool old = event_ring_enabled;
+   event_ring_enabled = onoff;
+   return old;
+}
+
+
+/** Reports whether event recording is enabled.
+ *
+ *  \return true/false
+ */
+bool event_ring_is_enabled() {
+   return event_ring_enabled;
+}
+
+
+static Event_Ring * get_thread_event_ring() {
+   Event_Ring * ring = g_private_get(&thread_ring_key);
+   if (!ring) {
+      ring = calloc(1, sizeof(Event_Ring));
+      memcpy(ring->marker, EVENT_RING_MARKER, 4);
+      ring->busno = -1;
+      g_mutex_lock(&ring_registry_mutex);
+      if (!ring_registry)
+         ring_registry = g_ptr_array_new();
+      g_ptr_array_add(ring_registry, ring);
+      ring->thread_ordinal = ring_registry->len;
+      g_mutex_unlock(&ring_registry_mutex);
+      g_private_set(&thread_ring_key, ring);
+   }
+   return ring;
+}
+
+
+/** Sets the display to which subsequent events in the current thread
+ *  are attributed.
+ *
+ *  \param  dpath  display path, NULL if no current display
+ */
+void event_ring_set_display(DDCA_IO_Path * dpath) {
+   if (!event_ring_enabled)
+      return;
+   Event_Ring * ring = get_thread_event_ring();
+   if (dpath) {
+      ring->io_mode = dpath->io_mode;
+      switch(dpath->io_mode) {
+      case DDCA_IO_I2C: ring->busno = dpath->path.i2c_busno;             break;
+      case DDCA_IO_ADL: ring->busno = dpath->path.adlno.iAdapterIndex;   break;
+      case DDCA_IO_USB: ring->busno = dpath->path.hiddev_devno;          break;
+      }
+   }
+   else {
+      ring->busno = -1;
+   }
+}
+
+
+/** Records an event in the current thread's ring.
+ *
+ *  \param  event_type   event type
+ *  \param  subtype      meaning depends on event type
+ *  \param  value        meaning depends on event type
+ *  \param  location     function name, must have static storage duration
+ *  \param  start_nanos  event start time, 0 for the current time
+ *  \param  end_nanos    event end time, 0 for an instantaneous event
+ *
+ *  \remark
+ *  Callers normally check #event_ring_enabled before calling, to avoid
+ *  the call when recording is disabled.
+ */
+void event_ring_record(
+        Event_Ring_Event_Type  event_type,
+        int                    subtype,
+        int                    value,
+        const char *           location,
+        uint64_t               start_nanos,
+        uint64_t               end_nanos)
+{
+   Event_Ring * ring = get_thread_event_ring();
+   if (start_nanos == 0)
+      start_nanos = cur_realtime_nanosec();
+   uint64_t duration_micros = (end_nanos > start_nanos) ? (end_nanos - start_nanos) / 1000 : 0;
+
+   int head = ring->head;       // only this thread writes head
+   Event_Record * rec = &ring->records[head];
+   rec->timestamp       = start_nanos;
+   rec->duration_micros = (duration_micros > UINT32_MAX) ? UINT32_MAX : duration_micros;
+   rec->value           = value;
+   rec->location        = location;
+   rec->subtype         = subtype;
+   rec->busno           = ring->busno;
+   rec->event_type      = event_type;
+   rec->io_mode         = ring->io_mode;
+
+   if (++head == EVENT_RING_SIZE) {
+      ring->wrapped = true;
+      head = 0;
+   }
+   g_atomic_int_set(&ring->head, head);
+}
+
+
+//
+// Dump file
+//
+// Layout, in native byte order:
+//   Event_File_Header
+//   location_ct strings, each a uint16_t length followed by that many bytes
+//   record_ct Event_File_Record's
+//
+
+#define EVENT_FILE_MAGIC "DDCEVTS"
+
+typedef struct {
+   char      magic[8];
+   uint32_t  format_version;
+   uint32_t  location_ct;
+   uint32_t  record_ct;
+   uint32_t  thread_ct;
+   uint64_t  dump_timestamp;
+} Event_File_Header;
+
+typedef struct {
+   uint64_t  timestamp;
+   uint32_t  duration_micros;
+   int32_t   value;
+   uint32_t  location_ndx;          ///< index into string table, UINT32_MAX if none
+   uint16_t  thread_ordinal;
+   uint16_t  subtype;
+   int16_t   busno;
+   uint8_t   event_type;
+   uint8_t   io_mode;
+   uint8_t   reserved[4];
+} Event_File_Record;
+
+
+// Appends the records of one ring, oldest first
+static void collect_ring_records(
+      Event_Ring * ring,
+      GArray *     records,
+      GHashTable * location_ndxs,
+      GPtrArray *  locations)
+{
+   ASSERT_MARKER(ring, EVENT_RING_MARKER);
+   int  head    = g_atomic_int_get(&ring->head);
+   bool wrapped = ring->wrapped;
+   int  first   = (wrapped) ? head : 0;
+   int  ct      = (wrapped) ? EVENT_RING_SIZE : head;
+
+   for (int ctr = 0; ctr < ct; ctr++) {
+      Event_Record * rec = &ring->records[(first + ctr) % EVENT_RING_SIZE];
+      Event_File_Record frec = {0};
+      frec.timestamp       = rec->timestamp;
+      frec.duration_micros = rec->duration_micros;
+      frec.value           = rec->value;
+      frec.thread_ordinal  = ring->thread_ordinal;
+      frec.subtype         = rec->subtype;
+      frec.busno           = rec->busno;
+      frec.event_type      = rec->event_type;
+      frec.io_mode         = rec->io_mode;
+      frec.location_ndx    = UINT32_MAX;
+      if (rec->location) {
+         gpointer ndx_plus_1 = g_hash_table_lookup(location_ndxs, rec->location);
+         if (!ndx_plus_1) {
+            g_ptr_array_add(locations, (gpointer) rec->location);
+            ndx_plus_1 = GUINT_TO_POINTER(locations->len);
+            g_hash_table_insert(location_ndxs, (gpointer) rec->location, ndx_plus_1);
+         }
+         frec.location_ndx = GPOINTER_TO_UINT(ndx_plus_1) - 1;
+      }
+      g_array_append_val(records, frec);
+   }
+}
+
+
+/** Writes the contents of all event rings to a file.
+ *
+ *  \param  filename  name of file to write
+ *  \return 0 if success, -errno if error
+ */
+int event_ring_dump(const char * filename) {
+   bool debug = false;
+   assert(filename);
+
+   GArray *     records       = g_array_new(false, false, sizeof(Event_File_Record));
+   GHashTable * location_ndxs = g_hash_table_new(g_direct_hash, g_direct_equal);
+   GPtrArray *  locations     = g_ptr_array_new();
+   int          thread_ct     = 0;
+
+   g_mutex_lock(&ring_registry_mutex);
+   if (ring_registry) {
+      thread_ct = ring_registry->len;
+      for (int ndx = 0; ndx < ring_registry->len; ndx++)
+         collect_ring_records(g_ptr_array_index(ring_registry, ndx), records, location_ndxs, locations);
+   }
+   g_mutex_unlock(&ring_registry_mutex);
+
+   int rc = 0;
+   FILE * fp = fopen(filename, "w");
+   if (!fp) {
+      rc = -errno;
+   }
+   else {
+      Event_File_Header hdr = {0};
+      memcpy(hdr.magic, EVENT_FILE_MAGIC, sizeof(EVENT_FILE_MAGIC));
+      hdr.format_version = EVENT_RING_FORMAT_VERSION;
+      hdr.location_ct    = locations->len;
+      hdr.record_ct      = records->len;
+      hdr.thread_ct      = thread_ct;
+      hdr.dump_timestamp = cur_realtime_nanosec();
+      bool ok = fwrite(&hdr, sizeof(hdr), 1, fp) == 1;
+      for (int ndx = 0; ok && ndx < locations->len; ndx++) {
+         const char * loc = g_ptr_array_index(locations, ndx);
+         uint16_t len = strlen(loc);
+         ok = fwrite(&len, sizeof(len), 1, fp) == 1 &&
+              fwrite(loc, 1, len, fp) == len;
+      }
+      if (ok && records->len > 0)
+         ok = fwrite(records->data, sizeof(Event_File_Record), records->len, fp) == records->len;
+      if (!ok)
+         rc = -errno;
+      if (fclose(fp) != 0 && rc == 0)
+         rc = -errno;
+   }
+
+   DBGTRC(debug, TRACE_GROUP, "Wrote %d records, %d locations to %s, rc=%d",
+                              records->len, locations->len, filename, rc);
+   g_ptr_array_free(locations, true);
+   g_hash_table_destroy(location_ndxs);
+   g_array_free(records, true);
+   return rc;
+}
+
+
+static void dump_event_rings_at_exit() {
+   if (exit_dump_fn) {
+      int rc = event_ring_dump(exit_dump_fn);
+      if (rc != 0)
+         fprintf(stderr, "Unable to write event ring file %s: %s\n", exit_dump_fn, strerror(-rc));
+   }
+}
+
+
+/** Requests that the event rings be written to a file at program exit.
+ *
+ *  \param  filename  name of file to write, NULL to cancel
+ */
+void event_ring_dump_at_exit(const char * filename) {
+   static bool registered = false;
+   free(exit_dump_fn);
+   exit_dump_fn = (filename) ? strdup(filename) : NULL;
+   if (exit_dump_fn && !registered) {
+      atexit(dump_event_rings_at_exit);
+      registered = true;
+   }
+}
+
+
+//
+// Decoder
+//
+
+static int compare_file_records(const void * a, const void * b) {
+   const Event_File_Record * r1 = a;
+   const Event_File_Record * r2 = b;
+   if (r1->timestamp != r2->timestamp)
+      return (r1->timestamp < r2->timestamp) ? -1 : 1;
+   return (int) r1->thread_ordinal - (int) r2->thread_ordinal;
+}
+
+
+static const char * event_type_name(uint8_t event_type) {
+   switch(event_type) {
+   case ER_TRACE:   return "trace";
+   case ER_IO:      return "io";
+   case ER_SLEEP:   return "sleep";
+   case ER_STATUS:  return "status";
+   }
+   return "unknown";
+}
+
+
+// Name of the event, e.g. the IO event name or status code name.
+// Returns a pointer to a static or caller supplied buffer.
+static const char * event_name(Event_File_Record * rec, char * buf, int bufsz) {
+   const char * result = NULL;
+   switch(rec->event_type) {
+   case ER_TRACE:
+      result = (rec->subtype == 0xff) ? "debug" : trace_group_name(rec->subtype);
+      break;
+   case ER_IO:
+      if (rec->subtype <= IE_OTHER)
+         result = io_event_name(rec->subtype);
+      break;
+   case ER_SLEEP:
+      if (rec->subtype <= SE_POST_SAVE_SETTINGS)
+         result = sleep_event_name(rec->subtype);
+      break;
+   case ER_STATUS:
+      result = psc_name(rec->value);
+      break;
+   }
+   if (!result) {
+      snprintf(buf, bufsz, "%d", rec->subtype);
+      result = buf;
+   }
+   return result;
+}
+
+
+static const char * display_name(Event_File_Record * rec, char * buf, int bufsz) {
+   if (rec->busno < 0)
+      return "-";
+   switch(rec->io_mode) {
+   case DDCA_IO_I2C: snprintf(buf, bufsz, "i2c-%d",    rec->busno); break;
+   case DDCA_IO_ADL: snprintf(buf, bufsz, "adl-%d",    rec->busno); break;
+   case DDCA_IO_USB: snprintf(buf, bufsz, "hiddev%d",  rec->busno); break;
+   default:          snprintf(buf, bufsz, "%d",        rec->busno); break;
+   }
+   return buf;
+}
+
+
+static void write_text_record(
+      Event_File_Record * rec,
+      uint64_t            base_timestamp,
+      const char *        location,
+      FILE *              fh)
+{
+   char namebuf[20];
+   char dispbuf[20];
+   char detail[60] = "";
+   switch(rec->event_type) {
+   case ER_TRACE:
+      snprintf(detail, sizeof(detail), "line %d", rec->value);
+      break;
+   case ER_IO:
+      snprintf(detail, sizeof(detail), "%d.%03d ms",
+                       rec->duration_micros / 1000, rec->duration_micros % 1000);
+      break;
+   case ER_SLEEP:
+      snprintf(detail, sizeof(detail), "%d ms requested, %d.%03d ms slept",
+                       rec->value, rec->duration_micros / 1000, rec->duration_micros % 1000);
+      break;
+   case ER_STATUS:
+      snprintf(detail, sizeof(detail), "%d%s", rec->value, (rec->subtype) ? ", retryable" : "");
+      break;
+   }
+   uint64_t relative_micros = (rec->timestamp - base_timestamp) / 1000;
+   fprintf(fh, "%6"PRIu64".%06"PRIu64"  t%-3d %-10s %-6s %-28s %-32s %s\n",
+               relative_micros / 1000000, relative_micros % 1000000,
+               rec->thread_ordinal,
+               display_name(rec, dispbuf, sizeof(dispbuf)),
+               event_type_name(rec->event_type),
+               event_name(rec, namebuf, sizeof(namebuf)),
+               detail,
+               location);
+}
+
+
+// Writes a Chrome trace event, see the Trace Event Format specification.
+// Events with a duration are complete ("X") events, others instant ("i") events.
+static void write_json_record(
+      Event_File_Record * rec,
+      uint64_t            base_timestamp,
+      const char *        location,
+      bool                first,
+      FILE *              fh)
+{
+   char namebuf[20];
+   char dispbuf[20];
+   uint64_t relative_nanos = rec->timestamp - base_timestamp;
+   bool has_duration = (rec->event_type == ER_IO || rec->event_type == ER_SLEEP);
+   fprintf(fh, "%s\n{\"name\":\"%s\",\"cat\":\"%s\",\"ph\":\"%s\",\"ts\":%"PRIu64".%03"PRIu64,
+               (first) ? "" : ",",
+               event_name(rec, namebuf, sizeof(namebuf)),
+               event_type_name(rec->event_type),
+               (has_duration) ? "X" : "i",
+               relative_nanos / 1000, relative_nanos % 1000);
+   if (has_duration)
+      fprintf(fh, ",\"dur\":%u", rec->duration_micros);
+   else
+      fprintf(fh, ",\"s\":\"t\"");
+   fprintf(fh, ",\"pid\":1,\"tid\":%d,\"args\":{\"display\":\"%s\",\"location\":\"%s\",\"value\":%d}}",
+               rec->thread_ordinal,
+               display_name(rec, dispbuf, sizeof(dispbuf)),
+               location,
+               rec->value);
+}
+
+
+/** Renders an event ring dump file.
+ *
+ *  \param  filename  name of file written by #event_ring_dump()
+ *  \param  json      if true, write Chrome trace JSON, if false write text
+ *  \param  fh        where to write output
+ *  \return 0 if success, -EINVAL if the file is not a valid dump file,
+ *          -errno if the file cannot be read
+ */
+int event_ring_decode(const char * filename, bool json, FILE * fh) {
+   bool debug = false;
+   gchar * contents = NULL;
+   gsize   len = 0;
+   GError * error = NULL;
+   if (!g_file_get_contents(filename, &contents, &len, &error)) {
+      int rc = (error->domain == G_FILE_ERROR && error->code == G_FILE_ERROR_NOENT) ? -ENOENT : -EIO;
+      DBGTRC(debug, TRACE_GROUP, "Unable to read %s: %s", filename, error->message);
+      g_error_free(error);
+      return rc;
+   }
+
+   int rc = -EINVAL;
+   GPtrArray * locations = g_ptr_array_new_with_free_func(g_free);
+   Event_File_Header hdr;
+   if (len < sizeof(hdr))
+      goto bye;
+   memcpy(&hdr, contents, sizeof(hdr));
+   if (memcmp(hdr.magic, EVENT_FILE_MAGIC, sizeof(EVENT_FILE_MAGIC)) != 0 ||
+       hdr.format_version != EVENT_RING_FORMAT_VERSION)
+      goto bye;
+
+   gsize pos = sizeof(hdr);
+   for (int ndx = 0; ndx < hdr.location_ct; ndx++) {
+      uint16_t slen;
+      if (pos + sizeof(slen) > len)
+         goto bye;
+      memcpy(&slen, contents+pos, sizeof(slen));
+      pos += sizeof(slen);
+      if (pos + slen > len)
+         goto bye;
+      g_ptr_array_add(locations, g_strndup(contents+pos, slen));
+      pos += slen;
+   }
+   if (len - pos != (gsize) hdr.record_ct * sizeof(Event_File_Record))
+      goto bye;
+
+   Event_File_Record * records = (Event_File_Record *) g_memdup(contents+pos, len-pos);
+   qsort(records, hdr.record_ct, sizeof(Event_File_Record), compare_file_records);
+   uint64_t base_timestamp = (hdr.record_ct > 0) ? records[0].timestamp : 0;
+
+   if (json)
+      fprintf(fh, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[");
+   else
+      fprintf(fh, "%d events from %d threads\n", hdr.record_ct, hdr.thread_ct);
+   for (int ndx = 0; ndx < hdr.record_ct; ndx++) {
+      Event_File_Record * rec = &records[ndx];
+      const char * location = (rec->location_ndx < locations->len)
+                                 ? g_ptr_array_index(locations, rec->location_ndx)
+                                 : "-";
+      if (json)
+         write_json_record(rec, base_timestamp, location, ndx == 0, fh);
+      else
+         write_text_record(rec, base_timestamp, location, fh);
+   }
+   if (json)
+      fprintf(fh, "\n]}\n");
+   g_free(records);
+   rc = 0;
+
+bye:
+   DBGTRC(debug, TRACE_GROUP, "Done. filename=%s, rc=%d", filename, rc);
+   g_ptr_array_free(locations, true);
+   g_free(contents);
+   return rc;
+}
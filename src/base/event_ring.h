@@ -0,0 +1,50 @@
+/** @file event_ring.h
+ *
+ *  Per-thread binary ring of trace, IO, sleep, and status code events.
+ */
+
+// Copyright (C) 2019 Sanford Rockowitz <rockowitz@minsoft.com>
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+#ifndef EVENT_RING_H_
+#define EVENT_RING_H_
+
+/** \cond */
+#include <inttypes.h>
+#include <stdbool.h>
+#include <stdio.h>
+/** \endcond */
+
+#include "public/ddcutil_types.h"
+
+/** Version of the event ring dump file format */
+#define EVENT_RING_FORMAT_VERSION  1
+
+/** Event ring event types */
+typedef enum {
+   ER_TRACE  = 1,     ///< trace site reached, subtype is trace group, value is line number
+   ER_IO     = 2,     ///< IO call, subtype is #IO_Event_Type
+   ER_SLEEP  = 3,     ///< protocol sleep, subtype is #Sleep_Event_Type, value is milliseconds
+   ER_STATUS = 4,     ///< status code logged, subtype 1 if retryable, value is status code
+} Event_Ring_Event_Type;
+
+extern bool event_ring_enabled;   // checked inline by recording sites
+
+bool event_ring_enable(bool onoff);
+bool event_ring_is_enabled();
+
+void event_ring_set_display(DDCA_IO_Path * dpath);
+
+void event_ring_record(
+        Event_Ring_Event_Type  event_type,
+        int                    subtype,
+        int                    value,
+        const char *           location,
+        uint64_t               start_nanos,
+        uint64_t               end_nanos);
+
+int  event_ring_dump(const char * filename);
+void event_ring_dump_at_exit(const char * filename);
+int  event_ring_decode(const char * filename, bool json, FILE * fh);
+
+#endif /* EVENT_RING_H_ */
@@ -37,11 +37,17 @@
 
 #include "util/glib_util.h"
 #include "util/report_util.h"
+#include "util/string_util.h"
 
 #include "base/core.h"
 #include "base/sleep.h"
 #include "base/parms.h"
 #include "base/ddc_errno.h"
+#include "base/dynamic_sleep.h"
+#include "base/event_ring.h"
+#include "base/latency_stats.h"
+#include "base/stat_counters.h"
+#include "base/stats_export.h"
 
 #include "base/execution_stats.h"
 
@@ -54,8 +60,6 @@ typedef struct {
    IO_Event_Type  id;
    const char *   name;
    const char *   desc;
-   uint64_t       call_nanosec;
-   int            call_count;
 } IO_Event_Type_Stats;
 
 
@@ -65,11 +69,18 @@ typedef struct {
 // hence the name field.
 // But currently there is only 1 instance.
 
+// Status codes are negative, and range down to -RCRANGE_DDC_MAX.
+// Counts for those are kept in an array indexed by the negated status code,
+// which is updated atomically without a lock.  Any other status code, e.g.
+// a positive ADL code, is counted in a hash table guarded by a mutex.
+#define STATUS_CODE_SLOT_CT (RCRANGE_DDC_MAX+1)
+
 #define STATUS_CODE_COUNTS_MARKER "SCCT"
 typedef struct {
    char marker[4];
-   GHashTable * error_counts_hash;  // hash table whose key is a status code, and whose
-                                    // value is the number of occurrences of that status code
+   int          counts[STATUS_CODE_SLOT_CT]; // number of occurrences of each status code, by -status code
+   GHashTable * other_counts_hash;  // hash table whose key is a status code outside the range
+                                    // of counts[], and whose value is the number of occurrences
    int          total_status_counts;
    char *       name;
 } Status_Code_Counts;
@@ -90,7 +101,7 @@ static GMutex               status_code_counts_mutex;
 static GMutex               global_stats_mutex;
 static bool                 debug_status_code_counts_mutex  = false;
 static bool                 debug_global_stats_mutex = false;
-static bool                 debug_sleep_stats_mutex = false;
+static bool                 debug_sleep_stats = false;
 
 
 
@@ -100,29 +111,26 @@ static bool                 debug_sleep_stats_mutex = false;
 
 static
 IO_Event_Type_Stats io_event_stats[] = {
-      // id           name             desc           nanosec  count
-      {IE_WRITE,      "IE_WRITE",      "write calls",       0, 0},
-      {IE_READ,       "IE_READ",       "read calls",        0, 0},
-      {IE_WRITE_READ, "IE_WRITE_READ", "write/read calls",  0, 0},
-      {IE_OPEN,       "IE_OPEN",       "open file calls",   0, 0},
-      {IE_CLOSE,      "IE_CLOSE",      "close file calls",  0, 0},
-      {IE_OTHER,      "IE_OTHER",      "other I/O calls",   0, 0},
+      // id           name             desc
+      {IE_WRITE,      "IE_WRITE",      "write calls"      },
+      {IE_READ,       "IE_READ",       "read calls"       },
+      {IE_WRITE_READ, "IE_WRITE_READ", "write/read calls" },
+      {IE_OPEN,       "IE_OPEN",       "open file calls"  },
+      {IE_CLOSE,      "IE_CLOSE",      "close file calls" },
+      {IE_OTHER,      "IE_OTHER",      "other I/O calls"  },
 };
 #define IO_EVENT_TYPE_CT (sizeof(io_event_stats)/sizeof(IO_Event_Type_Stats))
-static GMutex io_event_stats_mutex;
-static bool   debug_io_event_stats_mutex;
+static bool   debug_io_event_stats;
+
+// Call counts and times, and DDC response sizes, are kept in the
+// per-thread counters SC_IO_CALL_CT through SC_READ_BYTES_REQUESTED
 
 static
 void reset_io_event_stats() {
-   bool debug = false || debug_io_event_stats_mutex;
+   bool debug = false || debug_io_event_stats;
    DBGMSF(debug, "Starting");
 
-   g_mutex_lock(&io_event_stats_mutex);
-   for (int ndx = 0; ndx < IO_EVENT_TYPE_CT; ndx++) {
-      io_event_stats[ndx].call_count   = 0;
-      io_event_stats[ndx].call_nanosec = 0;
-   }
-   g_mutex_unlock(&io_event_stats_mutex);
+   stat_counters_reset(SC_IO_CALL_CT, SC_READ_BYTES_REQUESTED+1 - SC_IO_CALL_CT);
 
    DBGMSF(debug, "Done");
 }
@@ -155,7 +163,7 @@ static int total_io_event_count() {
    int total = 0;
    int ndx = 0;
    for (;ndx < IO_EVENT_TYPE_CT; ndx++)
-      total += io_event_stats[ndx].call_count;
+      total += stat_counter_get(SC_IO_CALL_CT + ndx);
    return total;
 }
 
@@ -164,7 +172,7 @@ uint64_t total_io_event_nanosec() {
    uint64_t total = 0;
    int ndx = 0;
    for (;ndx < IO_EVENT_TYPE_CT; ndx++)
-      total += io_event_stats[ndx].call_nanosec;
+      total += stat_counter_get(SC_IO_CALL_NANOS + ndx);
    return total;
 }
 
@@ -196,21 +204,31 @@ void log_io_call(
         uint64_t             start_time_nanos,
         uint64_t             end_time_nanos)
 {
-   bool debug = false || debug_io_event_stats_mutex;
+   bool debug = false || debug_io_event_stats;
 
    uint64_t elapsed_nanos = (end_time_nanos-start_time_nanos);
    DBGMSF(debug, "event_type=%d %-10s, elapsed_nanos=%"PRIu64", as millis=%"PRIu64,
                   event_type, io_event_name(event_type), elapsed_nanos, elapsed_nanos/(1000*1000) );
 
-   g_mutex_lock(&io_event_stats_mutex);
+   assert(event_type < STAT_SLOT_CT);
+   stat_counter_add(SC_IO_CALL_CT    + event_type, 1);
+   stat_counter_add(SC_IO_CALL_NANOS + event_type, elapsed_nanos);
 
-   io_event_stats[event_type].call_count++;
-   io_event_stats[event_type].call_nanosec += elapsed_nanos;
+   switch(event_type) {
+   case IE_WRITE:       record_latency(DDCA_LATENCY_WRITE,      elapsed_nanos);  break;
+   case IE_READ:        record_latency(DDCA_LATENCY_READ,       elapsed_nanos);  break;
+   case IE_WRITE_READ:  record_latency(DDCA_LATENCY_WRITE_READ, elapsed_nanos);  break;
+   default:             break;
+   }
 
-   g_mutex_unlock(&io_event_stats_mutex);
+   if (event_ring_enabled)
+      event_ring_record(ER_IO, event_type, 0, location, start_time_nanos, end_time_nanos);
 
-   DBGMSF(debug, "Updated total nanosec = %"PRIu64", as millis=%"PRIu64,
-                  io_event_stats[event_type].call_nanosec, io_event_stats[event_type].call_nanosec /(1000*1000) );
+   if (debug) {
+      uint64_t total_nanos = stat_counter_get(SC_IO_CALL_NANOS + event_type);
+      DBGMSG("Updated total nanosec = %"PRIu64", as millis=%"PRIu64,
+             total_nanos, total_nanos /(1000*1000) );
+   }
 
    // unused
    // last_io_event = event_type;
@@ -219,6 +237,19 @@ void log_io_call(
 }
 
 
+/** Records the size of a DDC response read.
+ *
+ *  @param  bytes_read       number of bytes actually read
+ *  @param  bytes_requested  size of the response buffer supplied by the caller,
+ *                           i.e. the number of bytes a fixed size read would have read
+ */
+void log_io_read_size(int bytes_read, int bytes_requested) {
+   stat_counter_add(SC_SIZED_READ_CT, 1);
+   stat_counter_add(SC_READ_BYTES_ACTUAL,    bytes_read);
+   stat_counter_add(SC_READ_BYTES_REQUESTED, bytes_requested);
+}
+
+
 /** Reports the accumulated execution statistics
  *
  * @param depth logical indentation depth
@@ -234,18 +265,20 @@ void report_io_call_stats(int depth) {
    // DBGMSG("max_name_length=%d", max_name_length);
    rpt_vstring(d1, "%-40s Count    Millisec  (      Nanosec)", "Type");
    for (;ndx < IO_EVENT_TYPE_CT; ndx++) {
-      if (io_event_stats[ndx].call_count > 0) {
+      int      call_count   = stat_counter_get(SC_IO_CALL_CT    + ndx);
+      uint64_t call_nanosec = stat_counter_get(SC_IO_CALL_NANOS + ndx);
+      if (call_count > 0) {
          IO_Event_Type_Stats* curstat = &io_event_stats[ndx];
          char buf[100];
          snprintf(buf, 100, "%-17s (%s)", curstat->desc, curstat->name);
          rpt_vstring(d1, "%-40s  %4d  %10" PRIu64 "  (%13" PRIu64 ")",
                      buf,
-                     curstat->call_count,
-                     curstat->call_nanosec / (1000*1000),
-                     curstat->call_nanosec
+                     call_count,
+                     call_nanosec / (1000*1000),
+                     call_nanosec
                     );
-         total_ct += curstat->call_count;
-         total_nanos += curstat->call_nanosec;
+         total_ct += call_count;
+         total_nanos += call_nanosec;
       }
    }
    rpt_vstring(d1, "%-40s  %4d  %10"PRIu64"  (%13" PRIu64 ")",
@@ -254,6 +287,20 @@ void report_io_call_stats(int depth) {
                total_nanos / (1000*1000),
                total_nanos
               );
+   int      sized_read_ct        = stat_counter_get(SC_SIZED_READ_CT);
+   uint64_t read_bytes_actual    = stat_counter_get(SC_READ_BYTES_ACTUAL);
+   uint64_t read_bytes_requested = stat_counter_get(SC_READ_BYTES_REQUESTED);
+   if (sized_read_ct > 0) {
+      rpt_vstring(d1, "DDC response reads: %d, bytes read: %"PRIu64", bytes in response buffers: %"PRIu64,
+                      sized_read_ct, read_bytes_actual, read_bytes_requested);
+      rpt_vstring(d1, "Estimated bus time for reads: %"PRIu64" millisec, reading full buffers: %"PRIu64" millisec",
+                      read_bytes_actual    * DDC_BUS_NANOS_PER_BYTE / (1000*1000),
+                      read_bytes_requested * DDC_BUS_NANOS_PER_BYTE / (1000*1000) );
+   }
+   rpt_nl();
+   report_latency_percentiles(d1);
+   rpt_nl();
+   report_latency_stats_by_display(d1);
 }
 
 
@@ -275,7 +322,7 @@ Status_Code_Counts * new_status_code_counts(char * name) {
    g_mutex_lock(&status_code_counts_mutex);
    Status_Code_Counts * pcounts = calloc(1,sizeof(Status_Code_Counts));
    memcpy(pcounts->marker, STATUS_CODE_COUNTS_MARKER, 4);
-   pcounts->error_counts_hash =  g_hash_table_new(NULL,NULL);
+   pcounts->other_counts_hash =  g_hash_table_new(NULL,NULL);
    pcounts->total_status_counts = 0;
    if (name)
       pcounts->name = strdup(name);
@@ -292,9 +339,11 @@ reset_status_code_counts_struct(Status_Code_Counts * pcounts) {
    assert(pcounts);
 
    g_mutex_lock(&status_code_counts_mutex);
-   if (pcounts->error_counts_hash)
-      g_hash_table_remove_all(pcounts->error_counts_hash);
-   pcounts->total_status_counts = 0;
+   for (int ndx = 0; ndx < STATUS_CODE_SLOT_CT; ndx++)
+      g_atomic_int_set(&pcounts->counts[ndx], 0);
+   if (pcounts->other_counts_hash)
+      g_hash_table_remove_all(pcounts->other_counts_hash);
+   g_atomic_int_set(&pcounts->total_status_counts, 0);
    g_mutex_unlock(&status_code_counts_mutex);
 
    DBGMSF(debug, "Done");
@@ -309,29 +358,52 @@ reset_status_code_counts() {
 }
 
 
+static inline bool
+status_code_has_slot(int rc) {
+   return (rc <= 0 && rc > -STATUS_CODE_SLOT_CT);
+}
+
+
+// Returns the number of occurrences of a status code
+static int
+get_status_code_count(Status_Code_Counts * pcounts, int rc) {
+   int ct = 0;
+   if (status_code_has_slot(rc)) {
+      ct = g_atomic_int_get(&pcounts->counts[-rc]);
+   }
+   else {
+      g_mutex_lock(&status_code_counts_mutex);
+      // n. if key rc not found, returns NULL, which is 0
+      ct = GPOINTER_TO_INT(g_hash_table_lookup(pcounts->other_counts_hash, GINT_TO_POINTER(rc)));
+      g_mutex_unlock(&status_code_counts_mutex);
+   }
+   return ct;
+}
+
 
 static
 int log_any_status_code(Status_Code_Counts * pcounts, int rc, const char * caller_name) {
    bool debug = false || debug_status_code_counts_mutex;
    DBGMSF(debug, "caller=%s, rc=%d", caller_name, rc);
-   assert(pcounts->error_counts_hash);
+   assert(pcounts->other_counts_hash);
 
    if (rc == 0) {
       DBGMSG("Called with rc = 0, from function %s", caller_name);
    }
 
-   g_mutex_lock(&status_code_counts_mutex);
-   pcounts->total_status_counts++;
-   // n. if key rc not found, returns NULL, which is 0
-   int ct = GPOINTER_TO_INT(g_hash_table_lookup(pcounts->error_counts_hash,  GINT_TO_POINTER(rc)) );
-   g_hash_table_insert(pcounts->error_counts_hash, GINT_TO_POINTER(rc), GINT_TO_POINTER(ct+1));
-   // DBGMSG("Old count=%d", ct);
-
-   // check the new value
-   int newct = GPOINTER_TO_INT(g_hash_table_lookup(pcounts->error_counts_hash,  GINT_TO_POINTER(rc)) );
-   g_mutex_unlock(&status_code_counts_mutex);
-   // DBGMSG("new count for key %d = %d", rc, newct);
-   assert(newct == ct+1);
+   int ct;
+   g_atomic_int_inc(&pcounts->total_status_counts);
+   if (status_code_has_slot(rc)) {
+      ct = g_atomic_int_add(&pcounts->counts[-rc], 1);   // returns the prior value
+   }
+   else {
+      g_mutex_lock(&status_code_counts_mutex);
+      ct = GPOINTER_TO_INT(g_hash_table_lookup(pcounts->other_counts_hash,  GINT_TO_POINTER(rc)) );
+      g_hash_table_insert(pcounts->other_counts_hash, GINT_TO_POINTER(rc), GINT_TO_POINTER(ct+1));
+      g_mutex_unlock(&status_code_counts_mutex);
+   }
+   if (event_ring_enabled)
+      event_ring_record(ER_STATUS, pcounts == retryable_error_code_counts, rc, caller_name, 0, 0);
 
    DBGMSF(debug, "Done");
    return ct+1;
@@ -377,7 +449,7 @@ log_retryable_status_code(Public_Status_Code rc, const char * caller_name) {
 }
 
 
-// Used by qsort in show_specific_status_counts()
+// Used to sort status codes in descending order in get_logged_status_codes()
 static
 int compare( const void* a, const void* b)
 {
@@ -390,52 +462,52 @@ int compare( const void* a, const void* b)
 }
 
 
+// Returns the status codes that have occurred, in the order reported
+// by show_specific_status_counts()
+static GArray *
+get_logged_status_codes(Status_Code_Counts * pcounts) {
+   GArray * codes = g_array_new(false, false, sizeof(int));
+   g_mutex_lock(&status_code_counts_mutex);
+   GList * glist = g_hash_table_get_keys(pcounts->other_counts_hash);
+   for (GList * l = glist; l; l = l->next) {
+      int key = GPOINTER_TO_INT(l->data);
+      g_array_append_val(codes, key);
+   }
+   g_list_free(glist);
+   g_mutex_unlock(&status_code_counts_mutex);
+   for (int ndx = 0; ndx < STATUS_CODE_SLOT_CT; ndx++) {
+      if (g_atomic_int_get(&pcounts->counts[ndx]) > 0) {
+         int key = -ndx;
+         g_array_append_val(codes, key);
+      }
+   }
+   g_array_sort(codes, compare);
+   return codes;
+}
+
+
 static
 void show_specific_status_counts(Status_Code_Counts * pcounts) {
    bool debug = false;
    DBGMSF(debug, "Starting");
 
    char * title = (pcounts->name) ? pcounts->name : "Errors";
-   assert(pcounts->error_counts_hash);
-   unsigned int keyct;
-
-   // g_hash_table_get_keys_as_array() new in v 2.40, which is not later than the version
-   // in all but the most recent distros, .e.g SUSE 13.2 is v 2.18
-   // gpointer * keysp = g_hash_table_get_keys_as_array(pcounts->error_counts_hash, &keyct);
-   GList * glist = g_hash_table_get_keys(pcounts->error_counts_hash);
-   // copies the pointers in the linked list to the array, does not duplicate
-   gpointer * keysp = g_list_to_g_array(glist, &keyct);
-   g_list_free(glist);
-   if (debug) {
-      DBGMSG("Keys.  keyct=%d", keyct);
-      for (int ndx = 0; ndx < keyct; ndx++) {
-         DBGMSG( "keysp[%d]:  %d   %p  %d",
-                 ndx,  keysp[ndx], keysp[ndx], GPOINTER_TO_INT(keysp[ndx]) );
-      }
-   }
+   assert(pcounts->other_counts_hash);
+
+   GArray * codes = get_logged_status_codes(pcounts);
+   int keyct = codes->len;
    int summed_ct = 0;
    // fprintf(stdout, "DDC packet error status codes with non-zero counts:  %s\n",
-   fprintf(stdout, "%s:  %s\n",
+   fprintf(fout(), "%s:  %s\n",
            title,
            (keyct == 0) ? "None" : "");
    if (keyct > 0) {
-      qsort(keysp, keyct, sizeof(gpointer), compare);    // sort keys
-      fprintf(stdout, "Count   Status Code                          Description\n");
+      fprintf(fout(), "Count   Status Code                          Description\n");
       int ndx;
       for (ndx=0; ndx<keyct; ndx++) {
-         gpointer keyp = keysp[ndx];
-         long key = GPOINTER_TO_INT(keyp);                  // Public_Status_Code
-         // DBGMSF(debug, "key:  %d   %p", key, keyp);
-         // wrong hunch about bug
-         // if (key == 0) {
-         //    DBGMSG("=====> Invalid status code key = %d", key);
-         //    break;
-         // }
-         assert( GINT_TO_POINTER(key) == keyp);
-
-         int ct  = GPOINTER_TO_INT(g_hash_table_lookup(pcounts->error_counts_hash,keyp));
+         long key = g_array_index(codes, int, ndx);            // Public_Status_Code
+         int ct  = get_status_code_count(pcounts, key);
          summed_ct += ct;
-         // fprintf(stdout, "%4d    %6d\n", ct, key);
 
          Status_Code_Info * desc = find_status_code_info(key);
 
@@ -445,7 +517,7 @@ void show_specific_status_counts(Status_Code_Counts * pcounts) {
             aux_msg = " (derived)";
          else if (ddcrc_is_not_error(key))
             aux_msg = " (not an error)";
-         fprintf(stdout, "%5d   %-28s (%5ld) %s %s\n",
+         fprintf(fout(), "%5d   %-28s (%5ld) %s %s\n",
               ct,
               (desc) ? desc->name : "",
               key,
@@ -454,10 +526,11 @@ void show_specific_status_counts(Status_Code_Counts * pcounts) {
              );
       }
    }
-   printf("Total errors: %d\n", pcounts->total_status_counts);
-   assert(summed_ct == pcounts->total_status_counts);
-   g_free(keysp);
-   // fprintf(stdout,"\n");
+   // n. counts are not frozen while reporting, so the sum of the individual
+   // counts can differ from the total if other threads are logging status codes
+   fprintf(fout(), "Total errors: %d\n", g_atomic_int_get(&pcounts->total_status_counts));
+   DBGMSF(debug, "summed_ct=%d", summed_ct);
+   g_array_free(codes, true);
    DBGMSF(debug, "Done");
 }
 
@@ -475,30 +548,14 @@ void show_all_status_counts() {
 
 static
 int get_true_io_error_count(Status_Code_Counts * pcounts) {
-   assert(pcounts->error_counts_hash);
-     unsigned int keyct;
-
-     // g_hash_table_get_keys_as_array() new in v 2.40, which is not later than the version
-     // in all but the most recent distros, .e.g SUSE 13.2 is v 2.18
-     // gpointer * keysp = g_hash_table_get_keys_as_array(pcounts->error_counts_hash, &keyct);
-     GList * glist = g_hash_table_get_keys(pcounts->error_counts_hash);
-     gpointer * keysp = g_list_to_g_array(glist, &keyct);
-     g_list_free(glist);
-
-     int summed_ct = 0;
-
-     int ndx;
-     for (ndx=0; ndx<keyct; ndx++) {
-        gpointer keyp = keysp[ndx];
-        int key = GPOINTER_TO_INT(keyp);
-        // TODO: filter out DDCRC_NULL_RESPONSE, perhaps others DDCRC_UNSUPPORTED
-        int ct  = GPOINTER_TO_INT(g_hash_table_lookup(pcounts->error_counts_hash,GINT_TO_POINTER(key)));
-        summed_ct += ct;
-     }
-     // DBGMSG("Total errors: %d", total_counts);
-     assert(summed_ct == pcounts->total_status_counts);
-     g_free(keysp);
-     return summed_ct;
+   GArray * codes = get_logged_status_codes(pcounts);
+   int summed_ct = 0;
+   for (int ndx = 0; ndx < codes->len; ndx++) {
+      // TODO: filter out DDCRC_NULL_RESPONSE, perhaps others DDCRC_UNSUPPORTED
+      summed_ct += get_status_code_count(pcounts, g_array_index(codes, int, ndx));
+   }
+   g_array_free(codes, true);
+   return summed_ct;
 }
 
 
@@ -522,22 +579,19 @@ const char * sleep_event_name(Sleep_Event_Type event_type) {
    return sleep_event_names[event_type];
 }
 
-static int sleep_event_cts_by_id[SLEEP_EVENT_ID_CT];
-static int total_sleep_event_ct = 0;
 static int sleep_strategy = 0;
-static GMutex sleep_stats_mutex;
+// Sleep event counts are kept in the per-thread counters SC_SLEEP_EVENT_CT
+// through SC_DEFERRED_SLEPT_MILLIS.  SC_DEFERRED_SLEEP_CT counts SE_POST_READ
+// sleeps deferred, SC_DEFERRED_SLEEP_MILLIS their total time, and
+// SC_DEFERRED_SLEPT_MILLIS the part of that time actually slept.
 
 
 static
 void reset_sleep_event_counts() {
-   bool debug = false || debug_sleep_stats_mutex;
+   bool debug = false || debug_sleep_stats;
    DBGMSF(debug, "Starting");
 
-   g_mutex_lock(&sleep_stats_mutex);
-   for (int ndx = 0; ndx < SLEEP_EVENT_ID_CT; ndx++) {
-      sleep_event_cts_by_id[ndx] = 0;
-   }
-   g_mutex_unlock(&sleep_stats_mutex);
+   stat_counters_reset(SC_SLEEP_EVENT_CT, SC_DEFERRED_SLEPT_MILLIS+1 - SC_SLEEP_EVENT_CT);
 
    DBGMSF(debug, "Done");
 }
@@ -613,7 +667,7 @@ call_dynamic_tuned_sleep(
       Sleep_Event_Type event_type,
       int occno)
 {
-   bool debug =  false || debug_sleep_stats_mutex;
+   bool debug =  false || debug_sleep_stats;
 
    int sleep_time_millis = 0;
    assert(io_mode == DDCA_IO_I2C);
@@ -632,12 +686,12 @@ call_dynamic_tuned_sleep(
    DBGMSF(debug, "Event type=%s, occno=%d, calculated sleep time = %d millisec",
                  sleep_event_name(event_type), occno, sleep_time_millis);
 
-   g_mutex_lock(&sleep_stats_mutex);
-   sleep_event_cts_by_id[event_type]++;
-   total_sleep_event_ct++;
-   g_mutex_unlock(&sleep_stats_mutex);
+   stat_counter_add(SC_SLEEP_EVENT_CT + event_type, 1);
+   stat_counter_add(SC_SLEEP_EVENT_TOTAL, 1);
 
+   uint64_t start_nanos = cur_realtime_nanosec();
    sleep_millis(sleep_time_millis);
+   record_latency(DDCA_LATENCY_SLEEP, cur_realtime_nanosec() - start_nanos);
 
    DBGMSF(debug, "Done");
 }
@@ -658,30 +712,14 @@ call_dynamic_tuned_sleep_i2c(
 }
 
 
-/** Sleep for a period required by the DDC protocol.
- *
- *  This function allows for tuning the actual sleep time.
- *
- *  This function does 3 things:
- *  1.  Determine the sleep period based on the communication
- *      mechanism, call type, sleep strategy in effect,
- *      and potentially other information.
- *  2. Record the sleep event.
- *  3. Sleep for period determined.
+/** Determines the sleep period required by the DDC protocol for
+ *  the communication mechanism, event type and sleep strategy in effect.
  *
  * @param io_mode     communication mechanism
  * @param event_type  reason for sleep
- *
- * @todo
- * Extend to take account of actual time since return from
- * last system call, previous error rate, etc.
+ * @return sleep time in milliseconds
  */
-void call_tuned_sleep(DDCA_IO_Mode io_mode, Sleep_Event_Type event_type) {
-   bool debug = false || debug_sleep_stats_mutex;
-   DBGMSF(debug, "Starting");
-
-   assert(event_type != SE_DDC_NULL);  // SE_DDC_NULL uses call_dynamic_tuned_sleep()
-
+static int tuned_sleep_millis(DDCA_IO_Mode io_mode, Sleep_Event_Type event_type) {
    int sleep_time_millis = 0;    // should be a default
    switch(io_mode) {
 
@@ -751,20 +789,73 @@ void call_tuned_sleep(DDCA_IO_Mode io_mode, Sleep_Event_Type event_type) {
       break;
 
    }
+   return sleep_time_millis;
+}
 
-   // TODO:
-   //   get error rate (total calls, total errors), current adjustment value
-   //   adjust by time since last i2c event
-   // Is tracing useful, given that we know the event type?
-   // void sleep_millis_with_trace(int milliseconds, const char * caller_location, const char * message);
 
+/** Records a sleep event and sleeps for the specified period.
+ *
+ * @param event_type        reason for sleep
+ * @param sleep_time_millis sleep time in milliseconds
+ */
+static void record_and_sleep(Sleep_Event_Type event_type, int sleep_time_millis) {
    // For better performance, separate mutex for each index in array
-   g_mutex_lock(&sleep_stats_mutex);
-   sleep_event_cts_by_id[event_type]++;
-   total_sleep_event_ct++;
-   g_mutex_unlock(&sleep_stats_mutex);
+   stat_counter_add(SC_SLEEP_EVENT_CT + event_type, 1);
+   stat_counter_add(SC_SLEEP_EVENT_TOTAL, 1);
 
+   uint64_t start_nanos = cur_realtime_nanosec();
    sleep_millis(sleep_time_millis);
+   uint64_t end_nanos = cur_realtime_nanosec();
+   record_latency(DDCA_LATENCY_SLEEP, end_nanos - start_nanos);
+   if (event_ring_enabled)
+      event_ring_record(ER_SLEEP, event_type, sleep_time_millis, NULL, start_nanos, end_nanos);
+}
+
+
+/** Records a sleep event whose sleep is deferred until the next write
+ *  to the display.
+ *
+ * @param dh                display handle
+ * @param event_type        reason for sleep
+ * @param sleep_time_millis sleep time in milliseconds
+ */
+static void record_deferred_sleep(Display_Handle * dh, Sleep_Event_Type event_type, int sleep_time_millis) {
+   stat_counter_add(SC_SLEEP_EVENT_CT + event_type, 1);
+   stat_counter_add(SC_SLEEP_EVENT_TOTAL, 1);
+   stat_counter_add(SC_DEFERRED_SLEEP_CT, 1);
+   stat_counter_add(SC_DEFERRED_SLEEP_MILLIS, sleep_time_millis);
+
+   dh->deferred_sleep_end = cur_realtime_nanosec() + sleep_time_millis * (uint64_t) 1000000;
+   if (event_ring_enabled)
+      event_ring_record(ER_SLEEP, event_type, sleep_time_millis, __func__, 0, 0);
+}
+
+
+/** Sleep for a period required by the DDC protocol.
+ *
+ *  This function allows for tuning the actual sleep time.
+ *
+ *  This function does 3 things:
+ *  1.  Determine the sleep period based on the communication
+ *      mechanism, call type, sleep strategy in effect,
+ *      and potentially other information.
+ *  2. Record the sleep event.
+ *  3. Sleep for period determined.
+ *
+ * @param io_mode     communication mechanism
+ * @param event_type  reason for sleep
+ *
+ * @remark
+ * Does not apply the per-display adjustment of #call_tuned_sleep_dh().
+ */
+void call_tuned_sleep(DDCA_IO_Mode io_mode, Sleep_Event_Type event_type) {
+   bool debug = false || debug_sleep_stats;
+   DBGMSF(debug, "Starting");
+
+   assert(event_type != SE_DDC_NULL);  // SE_DDC_NULL uses call_dynamic_tuned_sleep()
+
+   int sleep_time_millis = tuned_sleep_millis(io_mode, event_type);
+   record_and_sleep(event_type, sleep_time_millis);
 
    DBGMSF(debug, "Done");
 }
@@ -791,13 +882,60 @@ void call_tuned_sleep_adl(Sleep_Event_Type event_type) {
    call_tuned_sleep(DDCA_IO_ADL, event_type);
 }
 
-/** Convenience function that determines the device type from the
- *  #Display_Handle before invoking all_tuned_sleep().
+/** Sleeps for the period required by the DDC protocol for the
+ *  display's communication mechanism.
+ *
+ *  For I2C write/read exchanges, the period is scaled by the multiplier
+ *  learned for the display by dynamic sleep adjustment.
+ *
  *  @param dh         display handle of open device
  *  @param event_type sleep event type
  */
 void call_tuned_sleep_dh(Display_Handle* dh, Sleep_Event_Type event_type) {
-   call_tuned_sleep(dh->dref->io_path.io_mode, event_type);
+   bool debug = false || debug_sleep_stats;
+   assert(event_type != SE_DDC_NULL);  // SE_DDC_NULL uses call_dynamic_tuned_sleep()
+
+   Display_Ref * dref = dh->dref;
+   int sleep_time_millis = tuned_sleep_millis(dref->io_path.io_mode, event_type);
+   if ( dref->dsd && (event_type == SE_WRITE_TO_READ || event_type == SE_POST_READ) )
+      sleep_time_millis = dsd_adjust_sleep_millis(dref->dsd, sleep_time_millis);
+   DBGMSF(debug, "dh=%s, event_type=%s, sleep_time_millis=%d, defer_post_read_sleep=%s",
+                 dh_repr_t(dh), sleep_event_name(event_type), sleep_time_millis,
+                 bool_repr(dh->defer_post_read_sleep));
+
+   if (event_type == SE_POST_READ && dh->defer_post_read_sleep)
+      record_deferred_sleep(dh, event_type, sleep_time_millis);
+   else
+      record_and_sleep(event_type, sleep_time_millis);
+}
+
+
+/** Completes a sleep deferred by #call_tuned_sleep_dh().
+ *
+ *  Sleeps only for whatever part of the deferred period has not already
+ *  elapsed, so that work performed since the read that caused the sleep
+ *  overlaps it.  Must be called before writing to the display.
+ *
+ *  @param dh  display handle of open device
+ */
+void complete_deferred_sleep_dh(Display_Handle * dh) {
+   if (dh->deferred_sleep_end) {
+      uint64_t now = cur_realtime_nanosec();
+      int remaining_millis = 0;
+      if (now < dh->deferred_sleep_end)
+         remaining_millis = (dh->deferred_sleep_end - now + 999999) / 1000000;
+      dh->deferred_sleep_end = 0;
+      if (remaining_millis > 0) {
+         stat_counter_add(SC_DEFERRED_SLEPT_MILLIS, remaining_millis);
+         uint64_t start_nanos = cur_realtime_nanosec();
+         sleep_millis(remaining_millis);
+         uint64_t end_nanos = cur_realtime_nanosec();
+         record_latency(DDCA_LATENCY_SLEEP, end_nanos - start_nanos);
+         if (event_ring_enabled)
+            event_ring_record(ER_SLEEP, SE_POST_READ, remaining_millis, __func__,
+                              start_nanos, end_nanos);
+      }
+   }
 }
 
 
@@ -810,12 +948,188 @@ void report_sleep_strategy_stats(int depth) {
    rpt_title("Sleep Strategy Stats:", depth);
    rpt_vstring(d1, "Total IO events:      %5d", total_io_event_count());
    rpt_vstring(d1, "IO error count:       %5d", get_true_io_error_count(primary_error_code_counts));
-   rpt_vstring(d1, "Total sleep events:   %5d", total_sleep_event_ct);
+   rpt_vstring(d1, "Total sleep events:   %5d", (int) stat_counter_get(SC_SLEEP_EVENT_TOTAL));
+   rpt_vstring(d1, "Deferred sleeps:      %5d", (int) stat_counter_get(SC_DEFERRED_SLEEP_CT));
+   rpt_vstring(d1, "Deferred sleep milliseconds, actually slept: %"PRIu64", %"PRIu64,
+                   stat_counter_get(SC_DEFERRED_SLEEP_MILLIS), stat_counter_get(SC_DEFERRED_SLEPT_MILLIS));
    rpt_nl();
    rpt_title("Sleep Event type      Count", d1);
    for (int id=0; id < SLEEP_EVENT_ID_CT; id++) {
-      rpt_vstring(d1, "%-21s  %4d", sleep_event_names[id], sleep_event_cts_by_id[id]);
+      rpt_vstring(d1, "%-21s  %4d", sleep_event_names[id], (int) stat_counter_get(SC_SLEEP_EVENT_CT + id));
    }
+   rpt_nl();
+   report_dynamic_sleep_stats(d1);
+}
+
+
+//
+// Export
+//
+
+// A status code and its count, used when exporting status code counts
+typedef struct {
+   int  code;
+   int  ct;
+} Status_Code_Count;
+
+// Used to sort exported status codes in descending order
+static
+int compare_status_code_count(const void * a, const void * b) {
+   return compare(&((Status_Code_Count *) a)->code, &((Status_Code_Count *) b)->code);
+}
+
+
+// Adds the non-zero counts of a Status_Code_Counts to an export.  If reset is
+// true, each count is read and cleared in one atomic operation.
+static void
+export_status_code_counts(
+      Status_Code_Counts * pcounts,
+      const char *         category,
+      Stats_Export *       exp,
+      bool                 reset)
+{
+   GArray * counts = g_array_new(false, false, sizeof(Status_Code_Count));
+   for (int ndx = 0; ndx < STATUS_CODE_SLOT_CT; ndx++) {
+      Status_Code_Count cur = {-ndx, 0};
+      cur.ct = (reset) ? __atomic_exchange_n(&pcounts->counts[ndx], 0, __ATOMIC_RELAXED)
+                       : g_atomic_int_get(&pcounts->counts[ndx]);
+      if (cur.ct > 0)
+         g_array_append_val(counts, cur);
+   }
+   int total = (reset) ? __atomic_exchange_n(&pcounts->total_status_counts, 0, __ATOMIC_RELAXED)
+                       : g_atomic_int_get(&pcounts->total_status_counts);
+
+   g_mutex_lock(&status_code_counts_mutex);
+   GHashTableIter iter;
+   gpointer key, value;
+   g_hash_table_iter_init(&iter, pcounts->other_counts_hash);
+   while (g_hash_table_iter_next(&iter, &key, &value)) {
+      Status_Code_Count cur = {GPOINTER_TO_INT(key), GPOINTER_TO_INT(value)};
+      g_array_append_val(counts, cur);
+   }
+   if (reset)
+      g_hash_table_remove_all(pcounts->other_counts_hash);
+   g_mutex_unlock(&status_code_counts_mutex);
+
+   g_array_sort(counts, compare_status_code_count);
+   for (int ndx = 0; ndx < counts->len; ndx++) {
+      Status_Code_Count * cur = &g_array_index(counts, Status_Code_Count, ndx);
+      Status_Code_Info * desc = find_status_code_info(cur->code);
+      char codebuf[20];
+      snprintf(codebuf, sizeof(codebuf), "%d", cur->code);
+      stats_export_add(exp, "ddcutil_status_codes_total", cur->ct,
+                       "category", category,
+                       "code",     codebuf,
+                       "name",     (desc) ? desc->name : "",
+                       NULL);
+   }
+   stats_export_add(exp, "ddcutil_status_codes_logged_total", total, "category", category, NULL);
+   g_array_free(counts, true);
+}
+
+
+/** Adds execution statistics to an export.
+ *
+ *  @param  exp    where to add statistics
+ *  @param  stats  bitflags of statistics types to add, elapsed time is added for
+ *                 #DDCA_STATS_ELAPSED or #DDCA_STATS_CALLS as in #report_elapsed_stats()
+ *  @param  reset  if true, reset the statistics added
+ *
+ *  @remark
+ *  When resetting, each counter is read and cleared in a single atomic
+ *  operation, so no event recorded concurrently by another thread is lost
+ *  or counted twice.  Distinct counters are not read at the same instant,
+ *  however, so e.g. a call count and its elapsed time can differ by an
+ *  event in progress.
+ */
+void export_execution_stats(Stats_Export * exp, DDCA_Stats_Type stats, bool reset) {
+   bool debug = false || debug_global_stats_mutex;
+   DBGMSF(debug, "Starting. stats=0x%02x, reset=%s", stats, bool_repr(reset));
+
+   if (stats & DDCA_STATS_ERRORS) {
+      stats_export_family(exp, "ddcutil_status_codes_total", STATS_COUNTER, false,
+                               "Occurrences of each status code");
+      stats_export_family(exp, "ddcutil_status_codes_logged_total", STATS_COUNTER, false,
+                               "Status codes logged");
+      export_status_code_counts(primary_error_code_counts,   "primary",   exp, reset);
+      export_status_code_counts(retryable_error_code_counts, "retryable", exp, reset);
+   }
+
+   if (stats & DDCA_STATS_CALLS) {
+      uint64_t io[SC_READ_BYTES_REQUESTED+1 - SC_IO_CALL_CT];
+      stat_counters_snapshot(SC_IO_CALL_CT, SC_READ_BYTES_REQUESTED+1 - SC_IO_CALL_CT, io, reset);
+      stats_export_family(exp, "ddcutil_io_calls_total", STATS_COUNTER, false,
+                               "IO calls, by event type");
+      stats_export_family(exp, "ddcutil_io_call_seconds_total", STATS_COUNTER, true,
+                               "Time spent in IO calls, by event type");
+      for (int ndx = 0; ndx < IO_EVENT_TYPE_CT; ndx++)
+         stats_export_add(exp, "ddcutil_io_calls_total", io[ndx],
+                               "event", io_event_stats[ndx].name, NULL);
+      for (int ndx = 0; ndx < IO_EVENT_TYPE_CT; ndx++)
+         stats_export_add(exp, "ddcutil_io_call_seconds_total", io[SC_IO_CALL_NANOS - SC_IO_CALL_CT + ndx],
+                               "event", io_event_stats[ndx].name, NULL);
+      stats_export_family(exp, "ddcutil_ddc_response_reads_total", STATS_COUNTER, false,
+                               "DDC response reads");
+      stats_export_family(exp, "ddcutil_ddc_response_read_bytes_total", STATS_COUNTER, false,
+                               "Bytes read by DDC response reads");
+      stats_export_family(exp, "ddcutil_ddc_response_buffer_bytes_total", STATS_COUNTER, false,
+                               "Size of the response buffers of DDC response reads");
+      stats_export_add(exp, "ddcutil_ddc_response_reads_total",
+                            io[SC_SIZED_READ_CT - SC_IO_CALL_CT], NULL);
+      stats_export_add(exp, "ddcutil_ddc_response_read_bytes_total",
+                            io[SC_READ_BYTES_ACTUAL - SC_IO_CALL_CT], NULL);
+      stats_export_add(exp, "ddcutil_ddc_response_buffer_bytes_total",
+                            io[SC_READ_BYTES_REQUESTED - SC_IO_CALL_CT], NULL);
+
+      uint64_t se[SC_DEFERRED_SLEPT_MILLIS+1 - SC_SLEEP_EVENT_CT];
+      stat_counters_snapshot(SC_SLEEP_EVENT_CT, SC_DEFERRED_SLEPT_MILLIS+1 - SC_SLEEP_EVENT_CT, se, reset);
+      stats_export_family(exp, "ddcutil_sleep_events_total", STATS_COUNTER, false,
+                               "Protocol sleep events, by event type");
+      for (int ndx = 0; ndx < SLEEP_EVENT_ID_CT; ndx++)
+         stats_export_add(exp, "ddcutil_sleep_events_total", se[ndx],
+                               "event", sleep_event_names[ndx], NULL);
+      stats_export_family(exp, "ddcutil_deferred_sleeps_total", STATS_COUNTER, false,
+                               "Post read sleeps deferred until the next write");
+      stats_export_family(exp, "ddcutil_deferred_sleep_seconds_total", STATS_COUNTER, true,
+                               "Time of deferred sleeps");
+      stats_export_family(exp, "ddcutil_deferred_slept_seconds_total", STATS_COUNTER, true,
+                               "Part of the time of deferred sleeps actually slept");
+      stats_export_add(exp, "ddcutil_deferred_sleeps_total",
+                            se[SC_DEFERRED_SLEEP_CT - SC_SLEEP_EVENT_CT], NULL);
+      stats_export_add(exp, "ddcutil_deferred_sleep_seconds_total",
+                            se[SC_DEFERRED_SLEEP_MILLIS - SC_SLEEP_EVENT_CT] * 1000 * 1000, NULL);
+      stats_export_add(exp, "ddcutil_deferred_slept_seconds_total",
+                            se[SC_DEFERRED_SLEPT_MILLIS - SC_SLEEP_EVENT_CT] * 1000 * 1000, NULL);
+
+      Sleep_Stats sleep_stats = snapshot_sleep_stats(reset);
+      stats_export_family(exp, "ddcutil_sleep_calls_total", STATS_COUNTER, false,
+                               "Calls to sleep");
+      stats_export_family(exp, "ddcutil_sleep_requested_seconds_total", STATS_COUNTER, true,
+                               "Requested sleep time");
+      stats_export_family(exp, "ddcutil_sleep_actual_seconds_total", STATS_COUNTER, true,
+                               "Actual sleep time");
+      stats_export_add(exp, "ddcutil_sleep_calls_total", sleep_stats.total_sleep_calls, NULL);
+      stats_export_add(exp, "ddcutil_sleep_requested_seconds_total",
+                            sleep_stats.requested_sleep_milliseconds * (uint64_t) (1000*1000), NULL);
+      stats_export_add(exp, "ddcutil_sleep_actual_seconds_total", sleep_stats.actual_sleep_nanos, NULL);
+   }
+
+   if (stats & (DDCA_STATS_ELAPSED | DDCA_STATS_CALLS)) {
+      g_mutex_lock(&global_stats_mutex);
+      uint64_t now = cur_realtime_nanosec();
+      uint64_t since_reset_nanos = now - resettable_start_timestamp;
+      if (reset)
+         resettable_start_timestamp = now;
+      g_mutex_unlock(&global_stats_mutex);
+      stats_export_family(exp, "ddcutil_elapsed_seconds", STATS_GAUGE, true,
+                               "Time since program start");
+      stats_export_family(exp, "ddcutil_elapsed_since_reset_seconds", STATS_GAUGE, true,
+                               "Time since statistics were last reset");
+      stats_export_add(exp, "ddcutil_elapsed_seconds", now - program_start_timestamp, NULL);
+      stats_export_add(exp, "ddcutil_elapsed_since_reset_seconds", since_reset_nanos, NULL);
+   }
+
+   DBGMSF(debug, "Done");
 }
 
 
@@ -845,6 +1159,8 @@ void reset_execution_stats() {
    reset_sleep_event_counts();
    reset_status_code_counts();
    reset_io_event_stats();
+   reset_latency_stats();
+   dsd_reset_all_stats();
 
    g_mutex_lock(&global_stats_mutex);
    resettable_start_timestamp = cur_realtime_nanosec();
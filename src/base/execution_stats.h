@@ -38,6 +38,7 @@
 #include "util/timestamp.h"
 
 #include "base/displays.h"
+#include "base/stats_export.h"
 #include "base/status_code_mgt.h"
 
 
@@ -52,6 +53,8 @@ void reset_execution_stats();
 
 void report_elapsed_stats(int depth);
 
+void export_execution_stats(Stats_Export * exp, DDCA_Stats_Type stats, bool reset);
+
 
 // IO Event Tracking
 
@@ -84,6 +87,8 @@ void log_io_call(
    log_io_call(event_type, __func__, _start_time, cur_realtime_nanosec()); \
 }
 
+void log_io_read_size(int bytes_read, int bytes_requested);
+
 void report_io_call_stats(int depth);
 
 
@@ -122,6 +127,7 @@ const char * sleep_event_name(Sleep_Event_Type event_type);
 void call_tuned_sleep_i2c(Sleep_Event_Type event_type);   // DDC_IO_DEVI2C
 void call_tuned_sleep_adl(Sleep_Event_Type event_type);   // DDC_IO_ADL
 void call_tuned_sleep_dh(Display_Handle* dh, Sleep_Event_Type event_type);
+void complete_deferred_sleep_dh(Display_Handle * dh);
 // The workhorse:
 void call_tuned_sleep(DDCA_IO_Mode io_mode, Sleep_Event_Type event_type);
 void call_dynamic_tuned_sleep( DDCA_IO_Mode io_mode,Sleep_Event_Type event_type, int occno);
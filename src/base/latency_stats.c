@@ -0,0 +1,431 @@
+/** @file latency_stats.c
+ *
+ *  Latency histograms for IO and sleep events, by display and VCP feature.
+ *
+ *  Elapsed times are counted in buckets whose bounds are successive powers
+ *  of 2 microseconds, so percentiles can be estimated cheaply, to within a
+ *  factor of 2, from a fixed amount of data per histogram.
+ *
+ *  Events are attributed to the display and feature of the DDC exchange
+ *  in progress on the current thread, as set by #latency_set_context().
+ *  Events outside an exchange are only included in the totals for all
+ *  displays.
+ *
+ *  Each thread records events in its own shard.  A shard's mutex is only
+ *  contended while statistics are being reported, when the shards are
+ *  merged.  When a thread exits, its shard is merged into the shard for
+ *  exited threads.
+ */
+
+// Copyright (C) 2019 Sanford Rockowitz <rockowitz@minsoft.com>
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+/** \cond */
+#include <assert.h>
+#include <glib-2.0/glib.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "util/report_util.h"
+/** \endcond */
+
+#include "base/core.h"
+#include "base/displays.h"
+
+#include "base/latency_stats.h"
+
+
+/** Number of histogram buckets.  Bucket 0 counts times under 1 microsecond,
+ *  bucket n times in [2**(n-1), 2**n) microseconds.  The last bucket also
+ *  counts all longer times. */
+#define LATENCY_BUCKET_CT 26
+
+typedef struct {
+   int       counts[LATENCY_BUCKET_CT];
+   int       total_ct;
+   uint64_t  total_nanos;
+   uint64_t  max_nanos;
+} Latency_Histogram;
+
+#define DISPLAY_LATENCY_STATS_MARKER "DLAT"
+typedef struct {
+   char          marker[4];
+   DDCA_IO_Path  dpath;
+   GHashTable *  histograms;    // key encodes feature code and event type, see histogram_key()
+} Display_Latency_Stats;
+
+#define LATENCY_SHARD_MARKER "LSHD"
+typedef struct {
+   char               marker[4];
+   GMutex             mutex;      // guards the histograms
+   Latency_Histogram  all_displays[LATENCY_EVENT_TYPE_CT];
+   GPtrArray *        displays;   // array of Display_Latency_Stats *
+   // context of the owning thread, accessed only by that thread
+   bool               context_active;
+   DDCA_IO_Path       context_dpath;
+   int                context_feature_code;
+} Latency_Shard;
+
+static GMutex          shards_mutex;                 // guards the following
+static GPtrArray *     latency_shards = NULL;        // shards of running threads
+static Latency_Shard * exited_threads_shard = NULL;
+
+static char * latency_event_names[] = {"write", "read", "write/read", "sleep"};
+
+
+/** Returns the name of a latency event type.
+ *
+ *  \param  event_type  event type
+ *  \return name
+ */
+const char * latency_event_name(DDCA_Latency_Event_Type event_type) {
+   assert(event_type >= 0 && event_type < LATENCY_EVENT_TYPE_CT);
+   return latency_event_names[event_type];
+}
+
+
+//
+// Shards
+//
+
+static inline int histogram_key(int feature_code, DDCA_Latency_Event_Type event_type) {
+   return (feature_code+1) * LATENCY_EVENT_TYPE_CT + event_type;
+}
+
+
+static Latency_Shard * new_latency_shard() {
+   Latency_Shard * shard = calloc(1, sizeof(Latency_Shard));
+   memcpy(shard->marker, LATENCY_SHARD_MARKER, 4);
+   g_mutex_init(&shard->mutex);
+   shard->displays = g_ptr_array_new();
+   return shard;
+}
+
+
+static void free_display_latency_stats(gpointer data) {
+   Display_Latency_Stats * dstats = data;
+   g_hash_table_destroy(dstats->histograms);
+   free(dstats);
+}
+
+
+static void free_latency_shard(Latency_Shard * shard) {
+   g_ptr_array_set_free_func(shard->displays, free_display_latency_stats);
+   g_ptr_array_free(shard->displays, true);
+   g_mutex_clear(&shard->mutex);
+   free(shard);
+}
+
+
+// Must be called with the shard's mutex locked
+static Display_Latency_Stats * get_display_latency_stats(Latency_Shard * shard, DDCA_IO_Path dpath) {
+   for (int ndx = 0; ndx < shard->displays->len; ndx++) {
+      Display_Latency_Stats * cur = g_ptr_array_index(shard->displays, ndx);
+      if (dpath_eq(cur->dpath, dpath))
+         return cur;
+   }
+   Display_Latency_Stats * dstats = calloc(1, sizeof(Display_Latency_Stats));
+   memcpy(dstats->marker, DISPLAY_LATENCY_STATS_MARKER, 4);
+   dstats->dpath = dpath;
+   dstats->histograms = g_hash_table_new_full(g_direct_hash, g_direct_equal, NULL, g_free);
+   g_ptr_array_add(shard->displays, dstats);
+   return dstats;
+}
+
+
+// Must be called with the shard's mutex locked
+static Latency_Histogram * get_display_histogram(Display_Latency_Stats * dstats, int key) {
+   Latency_Histogram * h = g_hash_table_lookup(dstats->histograms, GINT_TO_POINTER(key));
+   if (!h) {
+      h = g_new0(Latency_Histogram, 1);
+      g_hash_table_insert(dstats->histograms, GINT_TO_POINTER(key), h);
+   }
+   return h;
+}
+
+
+static void merge_histogram(Latency_Histogram * dest, Latency_Histogram * src) {
+   for (int ndx = 0; ndx < LATENCY_BUCKET_CT; ndx++)
+      dest->counts[ndx] += src->counts[ndx];
+   dest->total_ct    += src->total_ct;
+   dest->total_nanos += src->total_nanos;
+   if (src->max_nanos > dest->max_nanos)
+      dest->max_nanos = src->max_nanos;
+}
+
+
+// Must be called with both shards' mutexes locked
+static void merge_shard(Latency_Shard * dest, Latency_Shard * src) {
+   for (int ndx = 0; ndx < LATENCY_EVENT_TYPE_CT; ndx++)
+      merge_histogram(&dest->all_displays[ndx], &src->all_displays[ndx]);
+   for (int ndx = 0; ndx < src->displays->len; ndx++) {
+      Display_Latency_Stats * src_dstats = g_ptr_array_index(src->displays, ndx);
+      Display_Latency_Stats * dest_dstats = get_display_latency_stats(dest, src_dstats->dpath);
+      GHashTableIter iter;
+      gpointer key, value;
+      g_hash_table_iter_init(&iter, src_dstats->histograms);
+      while (g_hash_table_iter_next(&iter, &key, &value))
+         merge_histogram(get_display_histogram(dest_dstats, GPOINTER_TO_INT(key)), value);
+   }
+}
+
+
+// Called when a thread exits
+static void retire_shard(gpointer data) {
+   Latency_Shard * shard = data;
+   g_mutex_lock(&shards_mutex);
+   if (!exited_threads_shard)
+      exited_threads_shard = new_latency_shard();
+   g_mutex_lock(&exited_threads_shard->mutex);
+   g_mutex_lock(&shard->mutex);
+   merge_shard(exited_threads_shard, shard);
+   g_mutex_unlock(&shard->mutex);
+   g_mutex_unlock(&exited_threads_shard->mutex);
+   g_ptr_array_remove(latency_shards, shard);
+   g_mutex_unlock(&shards_mutex);
+   free_latency_shard(shard);
+}
+
+
+static Latency_Shard * get_thread_latency_shard() {
+   static GPrivate per_thread_key = G_PRIVATE_INIT(retire_shard);
+
+   Latency_Shard * shard = g_private_get(&per_thread_key);
+   if (!shard) {
+      shard = new_latency_shard();
+      g_mutex_lock(&shards_mutex);
+      if (!latency_shards)
+         latency_shards = g_ptr_array_new();
+      g_ptr_array_add(latency_shards, shard);
+      g_mutex_unlock(&shards_mutex);
+      g_private_set(&per_thread_key, shard);
+   }
+   return shard;
+}
+
+
+// Returns a newly allocated shard containing the totals for all threads
+static Latency_Shard * merge_all_shards() {
+   Latency_Shard * merged = new_latency_shard();
+   g_mutex_lock(&shards_mutex);
+   GPtrArray * all = g_ptr_array_new();
+   if (exited_threads_shard)
+      g_ptr_array_add(all, exited_threads_shard);
+   for (int ndx = 0; latency_shards && ndx < latency_shards->len; ndx++)
+      g_ptr_array_add(all, g_ptr_array_index(latency_shards, ndx));
+   for (int ndx = 0; ndx < all->len; ndx++) {
+      Latency_Shard * cur = g_ptr_array_index(all, ndx);
+      g_mutex_lock(&cur->mutex);
+      merge_shard(merged, cur);
+      g_mutex_unlock(&cur->mutex);
+   }
+   g_ptr_array_free(all, true);
+   g_mutex_unlock(&shards_mutex);
+   return merged;
+}
+
+
+//
+// Context
+//
+
+/** Sets the display and feature to which subsequent events on the
+ *  current thread are attributed.
+ *
+ *  \param  dpath         display
+ *  \param  feature_code  VCP feature code, -1 if none
+ */
+void latency_set_context(DDCA_IO_Path * dpath, int feature_code) {
+   Latency_Shard * shard = get_thread_latency_shard();
+   shard->context_active = true;
+   shard->context_dpath = *dpath;
+   shard->context_feature_code = feature_code;
+}
+
+
+/** Ends attribution of events on the current thread to a display. */
+void latency_clear_context() {
+   get_thread_latency_shard()->context_active = false;
+}
+
+
+//
+// Recording
+//
+
+static void add_to_histogram(Latency_Histogram * h, uint64_t elapsed_nanos) {
+   uint64_t micros = elapsed_nanos / 1000;
+   int ndx = 0;
+   while (micros > 0 && ndx < LATENCY_BUCKET_CT-1) {
+      micros >>= 1;
+      ndx++;
+   }
+   h->counts[ndx]++;
+   h->total_ct++;
+   h->total_nanos += elapsed_nanos;
+   if (elapsed_nanos > h->max_nanos)
+      h->max_nanos = elapsed_nanos;
+}
+
+
+/** Records the elapsed time of an event.
+ *
+ *  \param  event_type     event type
+ *  \param  elapsed_nanos  elapsed time in nanoseconds
+ */
+void record_latency(DDCA_Latency_Event_Type event_type, uint64_t elapsed_nanos) {
+   Latency_Shard * shard = get_thread_latency_shard();
+
+   g_mutex_lock(&shard->mutex);
+   add_to_histogram(&shard->all_displays[event_type], elapsed_nanos);
+   if (shard->context_active) {
+      Display_Latency_Stats * dstats = get_display_latency_stats(shard, shard->context_dpath);
+      add_to_histogram(
+            get_display_histogram(dstats, histogram_key(shard->context_feature_code, event_type)),
+            elapsed_nanos);
+   }
+   g_mutex_unlock(&shard->mutex);
+}
+
+
+static void reset_shard(Latency_Shard * shard) {
+   g_mutex_lock(&shard->mutex);
+   memset(shard->all_displays, 0, sizeof(shard->all_displays));
+   for (int ndx = 0; ndx < shard->displays->len; ndx++) {
+      Display_Latency_Stats * cur = g_ptr_array_index(shard->displays, ndx);
+      g_hash_table_remove_all(cur->histograms);
+   }
+   g_mutex_unlock(&shard->mutex);
+}
+
+
+/** Discards all recorded latencies. */
+void reset_latency_stats() {
+   g_mutex_lock(&shards_mutex);
+   if (exited_threads_shard)
+      reset_shard(exited_threads_shard);
+   for (int ndx = 0; latency_shards && ndx < latency_shards->len; ndx++)
+      reset_shard(g_ptr_array_index(latency_shards, ndx));
+   g_mutex_unlock(&shards_mutex);
+}
+
+
+//
+// Retrieval and reporting
+//
+
+// Returns the upper bound of the bucket containing the pct percentile,
+// but no more than the maximum time recorded.
+static uint64_t histogram_percentile(Latency_Histogram * h, int pct) {
+   if (h->total_ct == 0)
+      return 0;
+   int target = (h->total_ct * pct + 99) / 100;
+   int cumulative = 0;
+   int ndx = 0;
+   for (; ndx < LATENCY_BUCKET_CT-1; ndx++) {
+      cumulative += h->counts[ndx];
+      if (cumulative >= target)
+         break;
+   }
+   uint64_t upper_nanos = ((uint64_t) 1 << ndx) * 1000;
+   return (upper_nanos < h->max_nanos) ? upper_nanos : h->max_nanos;
+}
+
+
+static gint compare_keys(gconstpointer a, gconstpointer b) {
+   return GPOINTER_TO_INT(a) - GPOINTER_TO_INT(b);
+}
+
+
+/** Returns the latency statistics for each display, feature, and event type
+ *  recorded.
+ *
+ *  \return newly allocated #DDCA_Latency_Stats_List, caller must free
+ */
+DDCA_Latency_Stats_List * get_latency_stats() {
+   Latency_Shard * merged = merge_all_shards();
+   int ct = 0;
+   for (int ndx = 0; ndx < merged->displays->len; ndx++) {
+      Display_Latency_Stats * cur = g_ptr_array_index(merged->displays, ndx);
+      ct += g_hash_table_size(cur->histograms);
+   }
+   DDCA_Latency_Stats_List * list =
+         calloc(1, sizeof(DDCA_Latency_Stats_List) + ct * sizeof(DDCA_Latency_Stats));
+   for (int ndx = 0; ndx < merged->displays->len; ndx++) {
+      Display_Latency_Stats * cur = g_ptr_array_index(merged->displays, ndx);
+      GList * keys = g_list_sort(g_hash_table_get_keys(cur->histograms), compare_keys);
+      for (GList * l = keys; l; l = l->next) {
+         int key = GPOINTER_TO_INT(l->data);
+         Latency_Histogram * h = g_hash_table_lookup(cur->histograms, l->data);
+         DDCA_Latency_Stats * stats = &list->stats[list->ct++];
+         stats->io_path      = cur->dpath;
+         stats->feature_code = key / LATENCY_EVENT_TYPE_CT - 1;
+         stats->event_type   = key % LATENCY_EVENT_TYPE_CT;
+         stats->count        = h->total_ct;
+         stats->total_nanos  = h->total_nanos;
+         stats->max_nanos    = h->max_nanos;
+         stats->p50_nanos    = histogram_percentile(h, 50);
+         stats->p95_nanos    = histogram_percentile(h, 95);
+         stats->p99_nanos    = histogram_percentile(h, 99);
+      }
+      g_list_free(keys);
+   }
+   free_latency_shard(merged);
+   return list;
+}
+
+
+/** Reports latency percentiles for each event type, for all displays combined.
+ *
+ *  \param  depth  logical indentation depth
+ */
+void report_latency_percentiles(int depth) {
+   int d1 = depth+1;
+   rpt_title("Latency percentiles, all displays (microsec):", depth);
+   rpt_vstring(d1, "%-12s %6s %9s %9s %9s %9s", "Type", "Count", "p50", "p95", "p99", "Max");
+   Latency_Shard * merged = merge_all_shards();
+   for (int ndx = 0; ndx < LATENCY_EVENT_TYPE_CT; ndx++) {
+      Latency_Histogram * h = &merged->all_displays[ndx];
+      if (h->total_ct > 0) {
+         rpt_vstring(d1, "%-12s %6d %9"PRIu64" %9"PRIu64" %9"PRIu64" %9"PRIu64,
+                         latency_event_names[ndx], h->total_ct,
+                         histogram_percentile(h, 50) / 1000,
+                         histogram_percentile(h, 95) / 1000,
+                         histogram_percentile(h, 99) / 1000,
+                         h->max_nanos / 1000);
+      }
+   }
+   free_latency_shard(merged);
+}
+
+
+/** Reports latency percentiles by display, feature, and event type.
+ *
+ *  \param  depth  logical indentation depth
+ */
+void report_latency_stats_by_display(int depth) {
+   int d1 = depth+1;
+   int d2 = depth+2;
+   rpt_title("Latency by display and feature (microsec):", depth);
+   DDCA_Latency_Stats_List * list = get_latency_stats();
+   DDCA_IO_Path * cur_dpath = NULL;
+   for (int ndx = 0; ndx < list->ct; ndx++) {
+      DDCA_Latency_Stats * cur = &list->stats[ndx];
+      if (!cur_dpath || !dpath_eq(*cur_dpath, cur->io_path)) {
+         cur_dpath = &cur->io_path;
+         rpt_vstring(d1, "Display %s:", dpath_repr_t(cur_dpath));
+         rpt_vstring(d2, "%-7s %-12s %6s %9s %9s %9s %9s",
+                         "Feature", "Type", "Count", "p50", "p95", "p99", "Max");
+      }
+      char feature[8] = "none";
+      if (cur->feature_code >= 0)
+         g_snprintf(feature, sizeof(feature), "x%02x", cur->feature_code);
+      rpt_vstring(d2, "%-7s %-12s %6d %9"PRIu64" %9"PRIu64" %9"PRIu64" %9"PRIu64,
+                      feature, latency_event_names[cur->event_type], cur->count,
+                      cur->p50_nanos / 1000, cur->p95_nanos / 1000,
+                      cur->p99_nanos / 1000, cur->max_nanos / 1000);
+   }
+   if (list->ct == 0)
+      rpt_vstring(d1, "None recorded");
+   free(list);
+}
@@ -0,0 +1,34 @@
+/** @file latency_stats.h
+ *
+ *  Latency histograms for IO and sleep events, by display and VCP feature
+ */
+
+// Copyright (C) 2019 Sanford Rockowitz <rockowitz@minsoft.com>
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+#ifndef LATENCY_STATS_H_
+#define LATENCY_STATS_H_
+
+/** \cond */
+#include <inttypes.h>
+#include <stdbool.h>
+/** \endcond */
+
+#include "public/ddcutil_types.h"
+
+/** Number of latency event types, see #DDCA_Latency_Event_Type */
+#define LATENCY_EVENT_TYPE_CT 4
+
+const char * latency_event_name(DDCA_Latency_Event_Type event_type);
+
+void latency_set_context(DDCA_IO_Path * dpath, int feature_code);
+void latency_clear_context();
+
+void record_latency(DDCA_Latency_Event_Type event_type, uint64_t elapsed_nanos);
+
+DDCA_Latency_Stats_List * get_latency_stats();
+void reset_latency_stats();
+void report_latency_percentiles(int depth);
+void report_latency_stats_by_display(int depth);
+
+#endif /* LATENCY_STATS_H_ */
@@ -68,6 +68,26 @@
 #define DDC_TIMEOUT_MILLIS_NULL_RESPONSE_INCREMENT  100
 
 
+//
+// *** Dynamic sleep adjustment
+//
+
+/** Number of consecutive first try successes before the sleep multiplier is lowered */
+#define DSA_SUCCESSES_BEFORE_DECREASE     3
+
+/** Amount by which the sleep multiplier is lowered */
+#define DSA_MULTIPLIER_DECREMENT          0.1
+
+/** Factor by which the sleep multiplier is raised after Null Response or all zero response */
+#define DSA_MULTIPLIER_BACKOFF_FACTOR     1.5
+
+/** Lower bound on the sleep multiplier */
+#define DSA_MIN_MULTIPLIER                0.3
+
+/** Upper bound on the sleep multiplier */
+#define DSA_MAX_MULTIPLIER                2.0
+
+
 //
 // *** Choose method of low level IC2 communication
 //
@@ -76,6 +96,11 @@
 
 #define DEFAULT_I2C_IO_STRATEGY  I2C_IO_STRATEGY_FILEIO
 // #define DEFAULT_I2C_IO_STRATEGY  I2C_IO_STRATEGY_IOCTL
+// #define DEFAULT_I2C_IO_STRATEGY  I2C_IO_STRATEGY_IOCTL_COMBINED
+
+/** With strategy I2C_IO_STRATEGY_IOCTL_COMBINED, number of failed single
+ *  transaction write/reads on a bus before it reverts to separate write and read */
+#define I2C_COMBINED_WRITE_READ_MAX_FAILURES  2
 
 
 // Parms used only within testcase portion of code:
@@ -130,4 +155,51 @@
 #define DISPLAY_CHECK_ASYNC_THRESHOLD   2
 #define DISPLAY_CHECK_ASYNC_NEVER    0xff
 
+/** Maximum number of threads in the shared display I/O worker pool */
+#define DDC_WORKER_POOL_MAX_THREADS     8
+
+/** Entries in the persistent display cache older than this are discarded */
+#define DISPLAY_CACHE_MAX_AGE_SECONDS  (7*24*60*60)
+
+/** Maximum number of threads probing I2C buses concurrently during detection */
+#define I2C_BUS_PROBE_MAX_THREADS  8
+
+/** Entries in the persistent I2C bus cache older than this are discarded */
+#define I2C_BUS_CACHE_MAX_AGE_SECONDS  (7*24*60*60)
+
+/** Number of events retained per thread when event recording is enabled */
+#define EVENT_RING_SIZE  8192
+
+/** Interval between checks for VCP feature changes immediately after a change */
+#define WATCH_POLL_FAST_MILLIS   100
+
+/** Interval between checks for VCP feature changes once a display is idle.
+ *  The interval doubles on each check finding no change, up to this value. */
+#define WATCH_POLL_SLOW_MILLIS   500
+
+/** Maximum number of changed features read from VCP feature x52 in one check */
+#define WATCH_MAX_CHANGES_PER_POLL  20
+
+/** Time to wait after a hotplug event for related events to arrive,
+ *  so that a burst of events is handled by a single redetection pass */
+#define DISPLAY_HOTPLUG_SETTLE_MILLIS  500
+
+/** Lock open displays against access by other processes, see --flock */
+#define DEFAULT_CROSS_PROCESS_LOCK  false
+
+/** Maximum time to wait for another process to release a display */
+#define CROSS_PROCESS_LOCK_MAX_WAIT_MILLIS  2000
+
+/** Cache recently read VCP feature values, see ddca_enable_value_cache() */
+#define DEFAULT_VALUE_CACHE  false
+
+/** How long to retain cached values of continuous features */
+#define VALUE_CACHE_CONTINUOUS_MILLIS  1000
+
+/** How long to retain cached values of other read/write features */
+#define VALUE_CACHE_NC_MILLIS  5000
+
+/** Approximate I2C bus time per byte transferred, 9 clock cycles at 100 kHz */
+#define DDC_BUS_NANOS_PER_BYTE  90000
+
 #endif /* PARMS_H_ */
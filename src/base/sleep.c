@@ -40,6 +40,7 @@
 #include "util/timestamp.h"
 
 #include "base/core.h"
+#include "base/stat_counters.h"
 #include "base/sleep.h"
 
 
@@ -47,13 +48,12 @@
 // Sleep and sleep statistics
 //
 
-static Sleep_Stats sleep_stats;
+// Sleep statistics are kept in per-thread counters, since sleeps
+// occur concurrently in multiple threads
 
 /** Sets all sleep statistics to 0. */
 void init_sleep_stats() {
-   sleep_stats.total_sleep_calls = 0;
-   sleep_stats.requested_sleep_milliseconds = 0;
-   sleep_stats.actual_sleep_nanos = 0;
+   stat_counters_reset(SC_SLEEP_CALL_CT, SC_SLEEP_ACTUAL_NANOS+1 - SC_SLEEP_CALL_CT);
 }
 
 
@@ -62,6 +62,25 @@ void init_sleep_stats() {
  * \return the current value of the accumulated sleep stats
  */
 Sleep_Stats get_sleep_stats() {
+   Sleep_Stats sleep_stats;
+   sleep_stats.total_sleep_calls            = stat_counter_get(SC_SLEEP_CALL_CT);
+   sleep_stats.requested_sleep_milliseconds = stat_counter_get(SC_SLEEP_REQUESTED_MILLIS);
+   sleep_stats.actual_sleep_nanos           = stat_counter_get(SC_SLEEP_ACTUAL_NANOS);
+   return sleep_stats;
+}
+
+/** Returns the current sleep statistics, optionally setting them to 0.
+ *
+ * \param reset if true, reset the statistics as part of the same operation
+ * \return the accumulated sleep stats
+ */
+Sleep_Stats snapshot_sleep_stats(bool reset) {
+   uint64_t values[SC_SLEEP_ACTUAL_NANOS+1 - SC_SLEEP_CALL_CT];
+   stat_counters_snapshot(SC_SLEEP_CALL_CT, SC_SLEEP_ACTUAL_NANOS+1 - SC_SLEEP_CALL_CT, values, reset);
+   Sleep_Stats sleep_stats;
+   sleep_stats.total_sleep_calls            = values[SC_SLEEP_CALL_CT          - SC_SLEEP_CALL_CT];
+   sleep_stats.requested_sleep_milliseconds = values[SC_SLEEP_REQUESTED_MILLIS - SC_SLEEP_CALL_CT];
+   sleep_stats.actual_sleep_nanos           = values[SC_SLEEP_ACTUAL_NANOS     - SC_SLEEP_CALL_CT];
    return sleep_stats;
 }
 
@@ -71,6 +90,7 @@ Sleep_Stats get_sleep_stats() {
  */
 void report_sleep_stats(int depth) {
    int d1 = depth+1;
+   Sleep_Stats sleep_stats = get_sleep_stats();
    rpt_title("Sleep Call Stats:", depth);
    rpt_vstring(d1, "Total sleep calls:                              %10d",
                    sleep_stats.total_sleep_calls);
@@ -88,9 +108,9 @@ void report_sleep_stats(int depth) {
 void sleep_millis(int milliseconds) {
    uint64_t start_nanos = cur_realtime_nanosec();
    usleep(milliseconds*1000);   // usleep takes microseconds, not milliseconds
-   sleep_stats.actual_sleep_nanos += (cur_realtime_nanosec()-start_nanos);
-   sleep_stats.requested_sleep_milliseconds += milliseconds;
-   sleep_stats.total_sleep_calls++;
+   stat_counter_add(SC_SLEEP_ACTUAL_NANOS, cur_realtime_nanosec()-start_nanos);
+   stat_counter_add(SC_SLEEP_REQUESTED_MILLIS, milliseconds);
+   stat_counter_add(SC_SLEEP_CALL_CT, 1);
 }
 
 
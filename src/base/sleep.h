@@ -34,6 +34,7 @@
 #define BASE_SLEEP_H_
 
 #include <inttypes.h>
+#include <stdbool.h>
 
 //
 // Sleep and sleep statistics
@@ -50,6 +51,7 @@ typedef struct {
 
 void         init_sleep_stats();
 Sleep_Stats  get_sleep_stats();
+Sleep_Stats  snapshot_sleep_stats(bool reset);
 void         report_sleep_stats(int depth);
 
 #endif /* BASE_SLEEP_H_ */
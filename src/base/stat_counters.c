@@ -0,0 +1,156 @@
+/** @file stat_counters.c
+ *
+ *  Per-thread statistics counters, summed when reported.
+ *
+ *  Each thread increments counters in its own shard, so frequent events
+ *  such as IO calls and sleeps neither take a lock nor contend for a
+ *  shared cache line.  The shards are summed only when statistics are
+ *  reported.  Updates use relaxed atomic operations, so a reporting thread
+ *  sees a consistent value for each individual counter.
+ *
+ *  When a thread exits, its counts are folded into a set of totals for
+ *  exited threads and its shard is freed.
+ */
+
+// Copyright (C) 2019 Sanford Rockowitz <rockowitz@minsoft.com>
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+/** \cond */
+#include <assert.h>
+#include <glib-2.0/glib.h>
+#include <stdlib.h>
+#include <string.h>
+/** \endcond */
+
+#include "base/stat_counters.h"
+
+
+// Aligned to avoid false sharing with another thread's shard
+typedef struct {
+   uint64_t  counters[STAT_COUNTER_CT];
+} __attribute__((aligned(64))) Stat_Counter_Shard;
+
+static GMutex       shards_mutex;              // guards the following
+static GPtrArray *  shards = NULL;             // shards of running threads
+static uint64_t     exited_thread_counters[STAT_COUNTER_CT];
+
+
+// Called when a thread exits
+static void retire_shard(gpointer data) {
+   Stat_Counter_Shard * shard = data;
+   g_mutex_lock(&shards_mutex);
+   for (int ndx = 0; ndx < STAT_COUNTER_CT; ndx++)
+      exited_thread_counters[ndx] += __atomic_load_n(&shard->counters[ndx], __ATOMIC_RELAXED);
+   g_ptr_array_remove(shards, shard);
+   g_mutex_unlock(&shards_mutex);
+   free(shard);
+}
+
+
+static Stat_Counter_Shard * get_thread_shard() {
+   static GPrivate per_thread_key = G_PRIVATE_INIT(retire_shard);
+
+   Stat_Counter_Shard * shard = g_private_get(&per_thread_key);
+   if (!shard) {
+      void * p = NULL;
+      if (posix_memalign(&p, 64, sizeof(Stat_Counter_Shard)) == 0)
+         memset(p, 0, sizeof(Stat_Counter_Shard));
+      else
+         p = calloc(1, sizeof(Stat_Counter_Shard));    // unaligned, but still correct
+      shard = p;
+      g_mutex_lock(&shards_mutex);
+      if (!shards)
+         shards = g_ptr_array_new();
+      g_ptr_array_add(shards, shard);
+      g_mutex_unlock(&shards_mutex);
+      g_private_set(&per_thread_key, shard);
+   }
+   return shard;
+}
+
+
+/** Adds to a counter.
+ *
+ *  \param  id     counter
+ *  \param  value  amount to add
+ */
+void stat_counter_add(Stat_Counter_Id id, uint64_t value) {
+   assert(id >= 0 && id < STAT_COUNTER_CT);
+   Stat_Counter_Shard * shard = get_thread_shard();
+   __atomic_fetch_add(&shard->counters[id], value, __ATOMIC_RELAXED);
+}
+
+
+/** Returns the value of a counter, summed over all threads.
+ *
+ *  \param  id  counter
+ *  \return value
+ */
+uint64_t stat_counter_get(Stat_Counter_Id id) {
+   assert(id >= 0 && id < STAT_COUNTER_CT);
+   g_mutex_lock(&shards_mutex);
+   uint64_t result = exited_thread_counters[id];
+   if (shards) {
+      for (int ndx = 0; ndx < shards->len; ndx++) {
+         Stat_Counter_Shard * shard = g_ptr_array_index(shards, ndx);
+         result += __atomic_load_n(&shard->counters[id], __ATOMIC_RELAXED);
+      }
+   }
+   g_mutex_unlock(&shards_mutex);
+   return result;
+}
+
+
+/** Sets a range of counters to 0 for all threads.
+ *
+ *  \param  first  first counter
+ *  \param  ct     number of counters
+ */
+void stat_counters_reset(Stat_Counter_Id first, int ct) {
+   assert(first >= 0 && first + ct <= STAT_COUNTER_CT);
+   g_mutex_lock(&shards_mutex);
+   for (int id = first; id < first + ct; id++) {
+      exited_thread_counters[id] = 0;
+      if (shards) {
+         for (int ndx = 0; ndx < shards->len; ndx++) {
+            Stat_Counter_Shard * shard = g_ptr_array_index(shards, ndx);
+            __atomic_store_n(&shard->counters[id], 0, __ATOMIC_RELAXED);
+         }
+      }
+   }
+   g_mutex_unlock(&shards_mutex);
+}
+
+
+/** Returns the values of a range of counters, summed over all threads,
+ *  optionally setting them to 0.
+ *
+ *  When resetting, each per-thread counter is read and cleared by a single
+ *  atomic exchange, so an increment made concurrently by another thread is
+ *  counted either in the returned value or after the reset, never lost.
+ *
+ *  \param  first   first counter
+ *  \param  ct      number of counters
+ *  \param  values  where to return the ct values
+ *  \param  reset   if true, set the counters to 0
+ */
+void stat_counters_snapshot(Stat_Counter_Id first, int ct, uint64_t * values, bool reset) {
+   assert(first >= 0 && first + ct <= STAT_COUNTER_CT);
+   g_mutex_lock(&shards_mutex);
+   for (int id = first; id < first + ct; id++) {
+      uint64_t sum = exited_thread_counters[id];
+      if (reset)
+         exited_thread_counters[id] = 0;
+      if (shards) {
+         for (int ndx = 0; ndx < shards->len; ndx++) {
+            Stat_Counter_Shard * shard = g_ptr_array_index(shards, ndx);
+            if (reset)
+               sum += __atomic_exchange_n(&shard->counters[id], 0, __ATOMIC_RELAXED);
+            else
+               sum += __atomic_load_n(&shard->counters[id], __ATOMIC_RELAXED);
+         }
+      }
+      values[id-first] = sum;
+   }
+   g_mutex_unlock(&shards_mutex);
+}
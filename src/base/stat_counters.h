@@ -0,0 +1,48 @@
+/** @file stat_counters.h
+ *
+ *  Per-thread statistics counters, summed when reported
+ */
+
+// Copyright (C) 2019 Sanford Rockowitz <rockowitz@minsoft.com>
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+#ifndef STAT_COUNTERS_H_
+#define STAT_COUNTERS_H_
+
+/** \cond */
+#include <inttypes.h>
+#include <stdbool.h>
+/** \endcond */
+
+/** Number of counters reserved for each counter indexed by an event type */
+#define STAT_SLOT_CT  8
+
+/** Identifies a counter.  Counters followed by STAT_SLOT_CT counters are
+ *  arrays, indexed by #IO_Event_Type or #Sleep_Event_Type. */
+typedef enum {
+   SC_IO_CALL_CT            = 0,                                     ///< by IO_Event_Type
+   SC_IO_CALL_NANOS         = SC_IO_CALL_CT         + STAT_SLOT_CT,  ///< by IO_Event_Type
+   SC_SIZED_READ_CT         = SC_IO_CALL_NANOS      + STAT_SLOT_CT,
+   SC_READ_BYTES_ACTUAL,
+   SC_READ_BYTES_REQUESTED,
+   SC_SLEEP_EVENT_CT,                                                ///< by Sleep_Event_Type
+   SC_SLEEP_EVENT_TOTAL     = SC_SLEEP_EVENT_CT     + STAT_SLOT_CT,
+   SC_DEFERRED_SLEEP_CT,
+   SC_DEFERRED_SLEEP_MILLIS,
+   SC_DEFERRED_SLEPT_MILLIS,
+   SC_SLEEP_CALL_CT,
+   SC_SLEEP_REQUESTED_MILLIS,
+   SC_SLEEP_ACTUAL_NANOS,
+   SC_COMBINED_WRITE_READ_CT,        ///< exchanges attempted as a single transaction
+   SC_COMBINED_WRITE_READ_OK_CT,     ///< ... that succeeded
+   SC_COMBINED_FALLBACK_CT,          ///< ... that were retried as separate write and read
+   SC_COMBINED_UNSUPPORTED_BUS_CT,   ///< buses found not to support single transactions
+   STAT_COUNTER_CT
+} Stat_Counter_Id;
+
+void     stat_counter_add(Stat_Counter_Id id, uint64_t value);
+uint64_t stat_counter_get(Stat_Counter_Id id);
+void     stat_counters_reset(Stat_Counter_Id first, int ct);
+void     stat_counters_snapshot(Stat_Counter_Id first, int ct, uint64_t * values, bool reset);
+
+#endif /* STAT_COUNTERS_H_ */
@@ -0,0 +1,279 @@
+/** @file stats_export.c
+ *
+ *  Collects statistics as named metrics and renders them as JSON or
+ *  in the Prometheus text exposition format.
+ *
+ *  Each module that keeps statistics adds its values to a #Stats_Export
+ *  as a set of metric families.  A family has a name, a kind (counter or
+ *  gauge), and help text, and contains one sample for each combination
+ *  of label values, e.g. one sample per IO event type.
+ *
+ *  Metric names follow Prometheus conventions: the "ddcutil_" prefix,
+ *  a "_total" suffix for counters, and a unit suffix such as "_seconds".
+ *  Times are collected in nanoseconds and rendered as seconds.
+ */
+
+// Copyright (C) 2019 Sanford Rockowitz <rockowitz@minsoft.com>
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+/** \cond */
+#include <assert.h>
+#include <glib-2.0/glib.h>
+#include <stdarg.h>
+#include <stdlib.h>
+#include <string.h>
+/** \endcond */
+
+#include "base/stats_export.h"
+
+
+typedef struct {
+   GPtrArray * labels;          // label name, label value, label name, ...
+   uint64_t    value;
+} Stats_Sample;
+
+typedef struct {
+   char *            name;
+   char *            help;
+   Stats_Metric_Kind kind;
+   bool              nanos_as_seconds;
+   GPtrArray *       samples;   // Stats_Sample *
+} Stats_Family;
+
+
+static void free_sample(gpointer data) {
+   Stats_Sample * sample = data;
+   g_ptr_array_free(sample->labels, true);
+   free(sample);
+}
+
+
+static void free_family(gpointer data) {
+   Stats_Family * family = data;
+   free(family->name);
+   free(family->help);
+   g_ptr_array_free(family->samples, true);
+   free(family);
+}
+
+
+/** Creates an empty #Stats_Export.
+ *
+ *  \return newly allocated #Stats_Export
+ */
+Stats_Export * stats_export_new() {
+   Stats_Export * exp = calloc(1, sizeof(Stats_Export));
+   memcpy(exp->marker, STATS_EXPORT_MARKER, 4);
+   exp->families = g_ptr_array_new_with_free_func(free_family);
+   return exp;
+}
+
+
+/** Frees a #Stats_Export.
+ *
+ *  \param  exp  pointer to #Stats_Export, may be NULL
+ */
+void stats_export_free(Stats_Export * exp) {
+   if (exp) {
+      assert(memcmp(exp->marker, STATS_EXPORT_MARKER, 4) == 0);
+      exp->marker[3] = 'x';
+      g_ptr_array_free(exp->families, true);
+      free(exp);
+   }
+}
+
+
+static Stats_Family * find_family(Stats_Export * exp, const char * name) {
+   for (int ndx = 0; ndx < exp->families->len; ndx++) {
+      Stats_Family * family = g_ptr_array_index(exp->families, ndx);
+      if (strcmp(family->name, name) == 0)
+         return family;
+   }
+   return NULL;
+}
+
+
+/** Declares a metric family.  Declaring a family that already exists has no effect.
+ *
+ *  \param  exp               #Stats_Export
+ *  \param  name              metric name
+ *  \param  kind              counter or gauge
+ *  \param  nanos_as_seconds  values are added in nanoseconds, and rendered in seconds
+ *  \param  help              description
+ */
+void stats_export_family(
+      Stats_Export *     exp,
+      const char *       name,
+      Stats_Metric_Kind  kind,
+      bool               nanos_as_seconds,
+      const char *       help)
+{
+   assert(exp && memcmp(exp->marker, STATS_EXPORT_MARKER, 4) == 0);
+   if (!find_family(exp, name)) {
+      Stats_Family * family = calloc(1, sizeof(Stats_Family));
+      family->name             = strdup(name);
+      family->help             = strdup(help);
+      family->kind             = kind;
+      family->nanos_as_seconds = nanos_as_seconds;
+      family->samples          = g_ptr_array_new_with_free_func(free_sample);
+      g_ptr_array_add(exp->families, family);
+   }
+}
+
+
+/** Adds a sample to a previously declared metric family.
+ *
+ *  The value is followed by any number of label name, label value pairs,
+ *  terminated by NULL.
+ *
+ *  \param  exp    #Stats_Export
+ *  \param  name   metric name
+ *  \param  value  sample value
+ */
+void stats_export_add(
+      Stats_Export *     exp,
+      const char *       name,
+      uint64_t           value,
+      ...)
+{
+   assert(exp && memcmp(exp->marker, STATS_EXPORT_MARKER, 4) == 0);
+   Stats_Family * family = find_family(exp, name);
+   assert(family);
+
+   Stats_Sample * sample = calloc(1, sizeof(Stats_Sample));
+   sample->labels = g_ptr_array_new_with_free_func(g_free);
+   sample->value  = value;
+
+   va_list args;
+   va_start(args, value);
+   const char * label_name;
+   while ( (label_name = va_arg(args, const char *)) ) {
+      const char * label_value = va_arg(args, const char *);
+      g_ptr_array_add(sample->labels, g_strdup(label_name));
+      g_ptr_array_add(sample->labels, g_strdup(label_value));
+   }
+   va_end(args);
+
+   g_ptr_array_add(family->samples, sample);
+}
+
+
+// Appends a string value, escaped for either a JSON string
+// or a Prometheus label value, both of which use backslash escapes.
+static void append_escaped(GString * buf, const char * s, bool json) {
+   for (; *s; s++) {
+      switch (*s) {
+      case '"':   g_string_append(buf, "\\\"");  break;
+      case '\\':  g_string_append(buf, "\\\\");  break;
+      case '\n':  g_string_append(buf, "\\n");   break;
+      default:
+         if (json && (unsigned char) *s < 0x20)
+            g_string_append_printf(buf, "\\u%04x", *s);
+         else
+            g_string_append_c(buf, *s);
+      }
+   }
+}
+
+
+static void append_value(GString * buf, Stats_Family * family, uint64_t value) {
+   if (family->nanos_as_seconds)
+      g_string_append_printf(buf, "%"PRIu64".%09"PRIu64,
+                                  value / (1000*1000*1000), value % (1000*1000*1000));
+   else
+      g_string_append_printf(buf, "%"PRIu64, value);
+}
+
+
+static void render_prometheus(Stats_Export * exp, GString * buf) {
+   for (int fndx = 0; fndx < exp->families->len; fndx++) {
+      Stats_Family * family = g_ptr_array_index(exp->families, fndx);
+      if (family->samples->len == 0)
+         continue;
+      // help text escapes only backslash and newline
+      g_string_append_printf(buf, "# HELP %s ", family->name);
+      for (const char * s = family->help; *s; s++) {
+         if (*s == '\\')      g_string_append(buf, "\\\\");
+         else if (*s == '\n') g_string_append(buf, "\\n");
+         else                 g_string_append_c(buf, *s);
+      }
+      g_string_append_printf(buf, "\n# TYPE %s %s\n", family->name,
+                                  (family->kind == STATS_COUNTER) ? "counter" : "gauge");
+      for (int sndx = 0; sndx < family->samples->len; sndx++) {
+         Stats_Sample * sample = g_ptr_array_index(family->samples, sndx);
+         g_string_append(buf, family->name);
+         if (sample->labels->len > 0) {
+            g_string_append_c(buf, '{');
+            for (int lndx = 0; lndx < sample->labels->len; lndx += 2) {
+               g_string_append_printf(buf, "%s%s=\"", (lndx > 0) ? "," : "",
+                                           (char *) g_ptr_array_index(sample->labels, lndx));
+               append_escaped(buf, g_ptr_array_index(sample->labels, lndx+1), false);
+               g_string_append_c(buf, '"');
+            }
+            g_string_append_c(buf, '}');
+         }
+         g_string_append_c(buf, ' ');
+         append_value(buf, family, sample->value);
+         g_string_append_c(buf, '\n');
+      }
+   }
+}
+
+
+// Renders a single JSON object whose members are the metric families:
+//   {"name": {"type": "counter", "help": "...",
+//             "samples": [{"labels": {"event": "IE_WRITE"}, "value": 12}, ...]}, ...}
+static void render_json(Stats_Export * exp, GString * buf) {
+   g_string_append(buf, "{");
+   bool first_family = true;
+   for (int fndx = 0; fndx < exp->families->len; fndx++) {
+      Stats_Family * family = g_ptr_array_index(exp->families, fndx);
+      if (family->samples->len == 0)
+         continue;
+      g_string_append_printf(buf, "%s\n\"%s\":{\"type\":\"%s\",\"help\":\"",
+                                  (first_family) ? "" : ",",
+                                  family->name,
+                                  (family->kind == STATS_COUNTER) ? "counter" : "gauge");
+      append_escaped(buf, family->help, true);
+      g_string_append(buf, "\",\"samples\":[");
+      first_family = false;
+      for (int sndx = 0; sndx < family->samples->len; sndx++) {
+         Stats_Sample * sample = g_ptr_array_index(family->samples, sndx);
+         g_string_append_printf(buf, "%s{\"labels\":{", (sndx > 0) ? "," : "");
+         for (int lndx = 0; lndx < sample->labels->len; lndx += 2) {
+            g_string_append_printf(buf, "%s\"%s\":\"", (lndx > 0) ? "," : "",
+                                        (char *) g_ptr_array_index(sample->labels, lndx));
+            append_escaped(buf, g_ptr_array_index(sample->labels, lndx+1), true);
+            g_string_append_c(buf, '"');
+         }
+         g_string_append(buf, "},\"value\":");
+         append_value(buf, family, sample->value);
+         g_string_append_c(buf, '}');
+      }
+      g_string_append(buf, "]}");
+   }
+   g_string_append(buf, "\n}\n");
+}
+
+
+/** Renders the collected metrics.
+ *
+ *  \param  exp     #Stats_Export
+ *  \param  format  #DDCA_STATS_FORMAT_JSON or #DDCA_STATS_FORMAT_PROMETHEUS
+ *  \return newly allocated string, caller must free
+ *
+ *  \remark
+ *  Families without samples are omitted.
+ */
+char * stats_export_render(Stats_Export * exp, DDCA_Stats_Format format) {
+   assert(exp && memcmp(exp->marker, STATS_EXPORT_MARKER, 4) == 0);
+   assert(format == DDCA_STATS_FORMAT_JSON || format == DDCA_STATS_FORMAT_PROMETHEUS);
+   GString * buf = g_string_new(NULL);
+   if (format == DDCA_STATS_FORMAT_JSON)
+      render_json(exp, buf);
+   else
+      render_prometheus(exp, buf);
+   char * result = strdup(buf->str);
+   g_string_free(buf, true);
+   return result;
+}
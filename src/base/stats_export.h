@@ -0,0 +1,52 @@
+/** @file stats_export.h
+ *
+ *  Collects statistics as named metrics and renders them as JSON or
+ *  in the Prometheus text exposition format
+ */
+
+// Copyright (C) 2019 Sanford Rockowitz <rockowitz@minsoft.com>
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+#ifndef STATS_EXPORT_H_
+#define STATS_EXPORT_H_
+
+/** \cond */
+#include <glib-2.0/glib.h>
+#include <inttypes.h>
+#include <stdbool.h>
+/** \endcond */
+
+#include "public/ddcutil_types.h"
+
+/** Kind of metric */
+typedef enum {
+   STATS_COUNTER,       ///< count that only increases, until reset
+   STATS_GAUGE          ///< value that can go up or down
+} Stats_Metric_Kind;
+
+#define STATS_EXPORT_MARKER "SEXP"
+/** Metrics collected for export */
+typedef struct {
+   char        marker[4];
+   GPtrArray * families;        ///< metric families, in the order first declared
+} Stats_Export;
+
+Stats_Export * stats_export_new();
+void           stats_export_free(Stats_Export * exp);
+
+void stats_export_family(
+        Stats_Export *     exp,
+        const char *       name,
+        Stats_Metric_Kind  kind,
+        bool               nanos_as_seconds,
+        const char *       help);
+
+void stats_export_add(
+        Stats_Export *     exp,
+        const char *       name,
+        uint64_t           value,
+        ...);                    // NULL terminated label name, label value pairs
+
+char * stats_export_render(Stats_Export * exp, DDCA_Stats_Format format);
+
+#endif /* STATS_EXPORT_H_ */
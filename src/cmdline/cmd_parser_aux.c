@@ -37,18 +37,19 @@ static Cmd_Desc cmdinfo[] = {
    {CMDID_TESTCASE,     "testcase",       3,  1,       1},
    {CMDID_LISTTESTS,    "listtests",      5,  0,       0},
 #endif
-   {CMDID_LOADVCP,      "loadvcp",        3,  1,       1},
+   {CMDID_LOADVCP,      "loadvcp",        3,  1,       MAX_ARGS},
    {CMDID_DUMPVCP,      "dumpvcp",        3,  0,       1},
    {CMDID_INTERROGATE,  "interrogate",    3,  0,       0},
    {CMDID_ENVIRONMENT,  "environment",    3,  0,       0},
    {CMDID_USBENV,       "usbenvironment", 6,  0,       0},
    {CMDID_VCPINFO,      "vcpinfo",        5,  0,       1},
-   {CMDID_READCHANGES,  "watch",          3,  0,       0},
+   {CMDID_READCHANGES,  "watch",          3,  0,       2},
 #ifdef USE_USB
    {CMDID_CHKUSBMON,    "chkusbmon",      3,  1,       1},
 #endif
    {CMDID_PROBE,        "probe",          5,  0,       0},
    {CMDID_SAVE_SETTINGS,"scs",            3,  0,       0},
+   {CMDID_EVENTS,       "events",         6,  1,       2},
 };
 static int cmdct = sizeof(cmdinfo)/sizeof(Cmd_Desc);
 
@@ -312,13 +313,14 @@ char * commands_list_help =
        "   getvcp <feature-code-or-group>          Report VCP feature value(s)\n"
        "   setvcp <feature-code> [+|-] <new-value> Set VCP feature value\n"
        "   dumpvcp (filename)                      Write color profile related settings to file\n"
-       "   loadvcp <filename>                      Load profile related settings from file\n"
+       "   loadvcp <filename> [<filename>...]      Load profile related settings from file(s)\n"
        "   scs                                     Store current settings in monitor's nonvolatile storage\n"
 #ifdef INCLUDE_TESTCASES
        "   testcase <testcase-number>\n"
        "   listtests\n"
 #endif
        "   environment                             Probe execution environment\n"
+       "   events <filename> (text|json)           Render file written by option --event-ring\n"
 #ifdef USE_USB
        "   usbenv                                  Probe for USB connected monitors\n"
 #endif
@@ -327,7 +329,7 @@ char * commands_list_help =
 #ifdef USE_USB
        "   chkusbmon                               Check if USB device is monitor (for UDEV)\n"
 #endif
-       "   watch                                   Watch display for reported changes (under development)\n"
+       "   watch [all] [text|json]                 Report VCP feature changes made using monitor controls\n"
        "\n";
 
 #ifdef OLD
@@ -435,6 +437,8 @@ char * stats_multiple_call_option_help =
        "  Statistics class names are not case sensitive and can abbreviated to 3 characters.\n"
        "  If no argument is specified, or ALL is specified, then all statistics classes are\n"
        "  output.\n"
+       "  Option --stats-format json or --stats-format prometheus reports statistics as\n"
+       "  metrics for monitoring tools instead of as text.\n"
       ;
 
 char * maxtries_option_help =
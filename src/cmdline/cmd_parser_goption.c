@@ -42,6 +42,8 @@
 #include "base/displays.h"
 #include "base/parms.h"
 
+#include "i2c/i2c_do_io.h"
+
 #include "cmdline/cmd_parser_aux.h"
 #include "cmdline/cmd_parser.h"
 #include "cmdline/parsed_cmd.h"
@@ -190,6 +192,12 @@ Parsed_Cmd * parse_command(int argc, char * argv[]) {
    gboolean ro_only_flag   = false;
    gboolean wo_only_flag   = false;
    gboolean enable_udf_flag = false;
+   gboolean dsa_flag       = true;
+   gboolean nocache_flag   = false;
+   gboolean refresh_cache_flag = false;
+   gboolean diff_flag      = false;
+   gboolean flock_flag     = false;
+   gboolean noservice_flag = false;
    char *   mfg_id_work    = NULL;
    char *   modelwork      = NULL;
    char *   snwork         = NULL;
@@ -206,6 +214,9 @@ Parsed_Cmd * parse_command(int argc, char * argv[]) {
    char *   maxtrywork      = NULL;
    gint     sleep_strategy_work = -1;
    char *   failsim_fn_work = NULL;
+   char *   event_ring_fn_work = NULL;
+   char *   io_strategy_work = NULL;
+   char *   stats_format_work = NULL;
    // gboolean enable_failsim_flag = false;
 
    GOptionEntry option_entries[] = {
@@ -246,14 +257,25 @@ Parsed_Cmd * parse_command(int argc, char * argv[]) {
       {"maxtries",'\0', 0, G_OPTION_ARG_STRING,   &maxtrywork,       "Max try adjustment",  "comma separated list" },
       {"stats",   's',  G_OPTION_FLAG_OPTIONAL_ARG,
                            G_OPTION_ARG_CALLBACK, stats_arg_func,    "Show retry statistics",    "stats type"},
+      {"stats-format",
+                  '\0', 0, G_OPTION_ARG_STRING,   &stats_format_work, "Statistics output format", "text|json|prometheus" },
       {"force-slave-address",
                   '\0', 0, G_OPTION_ARG_NONE,     &force_slave_flag, "Force I2C slave address",         NULL},
       {"force",   'f',  G_OPTION_FLAG_HIDDEN,
                            G_OPTION_ARG_NONE,     &force_flag,       "Ignore certain checks",           NULL},
+      {"diff",    '\0', 0, G_OPTION_ARG_NONE,     &diff_flag,        "loadvcp writes only changed values", NULL},
+      {"flock",   '\0', 0, G_OPTION_ARG_NONE,     &flock_flag,       "Lock display against access by other processes", NULL},
+      {"noservice",'\0',0, G_OPTION_ARG_NONE,     &noservice_flag,   "Do not use ddcutild service",     NULL},
       {"verify",  '\0', 0, G_OPTION_ARG_NONE,     &verify_flag,      "Read VCP value after setting it", NULL},
       {"noverify",'\0', 0, G_OPTION_ARG_NONE,     &noverify_flag,    "Do not read VCP value after setting it", NULL},
       {"nodetect",'\0', 0, G_OPTION_ARG_NONE,     &nodetect_flag,    "Skip initial monitor detection",  NULL},
       {"async",   '\0', 0, G_OPTION_ARG_NONE,     &async_flag,       "Enable asynchronous display detection", NULL},
+      {"dsa",     '\0', 0, G_OPTION_ARG_NONE,     &dsa_flag,         "Enable dynamic sleep adjustment", NULL},
+      {"nodsa",   '\0', G_OPTION_FLAG_REVERSE,
+                           G_OPTION_ARG_NONE,     &dsa_flag,         "Disable dynamic sleep adjustment", NULL},
+      {"nocache", '\0', 0, G_OPTION_ARG_NONE,     &nocache_flag,     "Do not use or save cached monitor information", NULL},
+      {"refresh-cache",
+                  '\0', 0, G_OPTION_ARG_NONE,     &refresh_cache_flag, "Discard cached monitor information", NULL},
 
       {"udf",     '\0', 0, G_OPTION_ARG_NONE,     &enable_udf_flag,  "Enable user defined feature support", NULL},
       {"noudf",   '\0', G_OPTION_FLAG_REVERSE,
@@ -267,12 +289,15 @@ Parsed_Cmd * parse_command(int argc, char * argv[]) {
       {"trcfile", '\0',0, G_OPTION_ARG_STRING_ARRAY, &trace_filenames,    "Trace files",     "file name" },
       {"timestamp",'\0',  0, G_OPTION_ARG_NONE,   &timestamp_trace_flag, "Prepend trace msgs with elapsed time",  NULL},
       {"ts",      '\0',   0, G_OPTION_ARG_NONE,   &timestamp_trace_flag, "Prepend trace msgs with elapsed time",  NULL},
+      {"event-ring",'\0', 0, G_OPTION_ARG_FILENAME, &event_ring_fn_work, "Record events, write them to file at exit", "file name"},
 
 
 //    {"myusage", '\0', 0, G_OPTION_ARG_NONE,     &myusage_flag,     "Show usage", NULL},
 //    {"myhelp", '\0', 0,  G_OPTION_ARG_NONE,     &myhelp_flag,      "Show usage", NULL},
       {"sleep-strategy",
                   'y', 0,  G_OPTION_ARG_INT,      &sleep_strategy_work, "Set sleep strategy", "strategy number" },
+      {"io-strategy",
+                  '\0', 0, G_OPTION_ARG_STRING,   &io_strategy_work, "Set I2C IO strategy", "fileio|ioctl|combined" },
       {"failsim", '\0', 0,
                            G_OPTION_ARG_FILENAME, &failsim_fn_work, "Enable simulation", "control file name"},
 
@@ -379,6 +404,12 @@ Parsed_Cmd * parse_command(int argc, char * argv[]) {
    SET_CMDFLAG(CMD_FLAG_WO_ONLY,           wo_only_flag);
    SET_CMDFLAG(CMD_FLAG_FORCE,             force_flag);
    SET_CMDFLAG(CMD_FLAG_ENABLE_UDF,        enable_udf_flag);
+   SET_CMDFLAG(CMD_FLAG_DSA,               dsa_flag);
+   SET_CMDFLAG(CMD_FLAG_NO_CACHE,          nocache_flag);
+   SET_CMDFLAG(CMD_FLAG_REFRESH_CACHE,     refresh_cache_flag);
+   SET_CMDFLAG(CMD_FLAG_DIFFERENTIAL_LOAD, diff_flag);
+   SET_CMDFLAG(CMD_FLAG_FLOCK,             flock_flag);
+   SET_CMDFLAG(CMD_FLAG_NO_SERVICE,        noservice_flag);
 
    if (failsim_fn_work) {
 #ifdef ENABLE_FAILSIM
@@ -391,6 +422,39 @@ Parsed_Cmd * parse_command(int argc, char * argv[]) {
 #endif
    }
 
+   parsed_cmd->event_ring_fn = event_ring_fn_work;
+
+   if (io_strategy_work) {
+      if (is_abbrev(io_strategy_work, "fileio", 1))
+         parsed_cmd->i2c_io_strategy = I2C_IO_STRATEGY_FILEIO;
+      else if (is_abbrev(io_strategy_work, "ioctl", 1))
+         parsed_cmd->i2c_io_strategy = I2C_IO_STRATEGY_IOCTL;
+      else if (is_abbrev(io_strategy_work, "combined", 1))
+         parsed_cmd->i2c_io_strategy = I2C_IO_STRATEGY_IOCTL_COMBINED;
+      else {
+         fprintf(stderr, "Invalid I2C IO strategy: %s\n", io_strategy_work);
+         ok = false;
+      }
+      free(io_strategy_work);
+   }
+
+   if (stats_format_work) {
+      if (is_abbrev(stats_format_work, "text", 1))
+         parsed_cmd->stats_format = DDCA_STATS_FORMAT_TEXT;
+      else if (is_abbrev(stats_format_work, "json", 1))
+         parsed_cmd->stats_format = DDCA_STATS_FORMAT_JSON;
+      else if (is_abbrev(stats_format_work, "prometheus", 1))
+         parsed_cmd->stats_format = DDCA_STATS_FORMAT_PROMETHEUS;
+      else {
+         fprintf(stderr, "Invalid statistics format: %s\n", stats_format_work);
+         ok = false;
+      }
+      // --stats-format without --stats reports all statistics
+      if (parsed_cmd->stats_types == DDCA_STATS_NONE)
+         parsed_cmd->stats_types = DDCA_STATS_ALL;
+      free(stats_format_work);
+   }
+
 #undef SET_CMDFLAG
 
 
@@ -770,6 +834,23 @@ Parsed_Cmd * parse_command(int argc, char * argv[]) {
             parsed_cmd->flags &= ~CMD_FLAG_WO_ONLY;
          }
 
+         if (ok && parsed_cmd->cmd_id == CMDID_EVENTS && parsed_cmd->argct == 2 &&
+                   !streq(parsed_cmd->args[1], "text") && !streq(parsed_cmd->args[1], "json") )
+         {
+            fprintf(stderr, "Invalid output format: %s.  Must be text or json\n", parsed_cmd->args[1]);
+            ok = false;
+         }
+
+         if (ok && parsed_cmd->cmd_id == CMDID_READCHANGES) {
+            for (int ndx = 0; ndx < parsed_cmd->argct; ndx++) {
+               char * arg = parsed_cmd->args[ndx];
+               if ( !streq(arg, "all") && !streq(arg, "text") && !streq(arg, "json") ) {
+                  fprintf(stderr, "Invalid watch argument: %s.  Must be all, text, or json\n", arg);
+                  ok = false;
+               }
+            }
+         }
+
          if (ok && parsed_cmd->cmd_id == CMDID_SETVCP) {
             if (parsed_cmd->argct == 3) {
                if (streq(parsed_cmd->args[1],"+") || streq(parsed_cmd->args[1], "-")) {
@@ -72,6 +72,7 @@ Parsed_Cmd *  new_parsed_cmd() {
    // parsed_cmd->output_level = OL_DEFAULT;
    parsed_cmd->output_level = DDCA_OL_NORMAL;
    parsed_cmd->sleep_strategy = -1;    // use default
+   parsed_cmd->i2c_io_strategy = -1;   // use default
    // parsed_cmd->nodetect = true;
    parsed_cmd->flags |= CMD_FLAG_NODETECT;
    return parsed_cmd;
@@ -95,6 +96,7 @@ void dbgrpt_parsed_cmd(Parsed_Cmd * parsed_cmd, int depth) {
 
    rpt_int_as_hex(
             "stats",            NULL, parsed_cmd->stats_types,                       d1);
+   rpt_int( "stats_format",     NULL, parsed_cmd->stats_format,                      d1);
    rpt_bool("ddcdata",          NULL, parsed_cmd->flags & CMD_FLAG_DDCDATA,          d1);
    rpt_str( "output_level",     NULL, output_level_name(parsed_cmd->output_level),   d1);
    rpt_bool("force_slave_addr", NULL, parsed_cmd->flags & CMD_FLAG_FORCE_SLAVE_ADDR, d1);
@@ -126,10 +128,18 @@ void dbgrpt_parsed_cmd(Parsed_Cmd * parsed_cmd, int depth) {
    snprintf(buf,20, "%d,%d,%d", parsed_cmd->max_tries[0], parsed_cmd->max_tries[1], parsed_cmd->max_tries[2] );
    rpt_str("max_retries",        NULL, buf,                                                   d1);
    rpt_int("sleep_stragegy",     NULL, parsed_cmd->sleep_strategy,                            d1);
+   rpt_int("i2c_io_strategy",    NULL, parsed_cmd->i2c_io_strategy,                           d1);
    rpt_bool("enable_failure_simulation", NULL, parsed_cmd->flags & CMD_FLAG_ENABLE_FAILSIM,   d1);
    rpt_str("failsim_control_fn", NULL, parsed_cmd->failsim_control_fn,                        d1);
+   rpt_str("event_ring_fn",      NULL, parsed_cmd->event_ring_fn,                             d1);
    rpt_bool("nodetect",          NULL, parsed_cmd->flags & CMD_FLAG_NODETECT,                 d1);
    rpt_bool("async",             NULL, parsed_cmd->flags & CMD_FLAG_ASYNC,                    d1);
+   rpt_bool("dynamic sleep adjustment", NULL, parsed_cmd->flags & CMD_FLAG_DSA,               d1);
+   rpt_bool("no cache",          NULL, parsed_cmd->flags & CMD_FLAG_NO_CACHE,                 d1);
+   rpt_bool("refresh cache",     NULL, parsed_cmd->flags & CMD_FLAG_REFRESH_CACHE,            d1);
+   rpt_bool("differential load", NULL, parsed_cmd->flags & CMD_FLAG_DIFFERENTIAL_LOAD,        d1);
+   rpt_bool("cross process lock", NULL, parsed_cmd->flags & CMD_FLAG_FLOCK,                   d1);
+   rpt_bool("no service",        NULL, parsed_cmd->flags & CMD_FLAG_NO_SERVICE,               d1);
    rpt_bool("report_freed_exceptions", NULL, parsed_cmd->flags & CMD_FLAG_REPORT_FREED_EXCP,  d1);
    rpt_bool("force",             NULL, parsed_cmd->flags & CMD_FLAG_FORCE,                    d1);
    rpt_bool("notable",           NULL, parsed_cmd->flags & CMD_FLAG_NOTABLE,                  d1);
@@ -161,6 +171,7 @@ void free_parsed_cmd(Parsed_Cmd * parsed_cmd) {
       free_display_identifier(parsed_cmd->pdid);
 
    free(parsed_cmd->failsim_control_fn);
+   free(parsed_cmd->event_ring_fn);
    free(parsed_cmd->fref);
    ntsa_free(parsed_cmd->traced_files, true);
    ntsa_free(parsed_cmd->traced_functions, true);
@@ -57,6 +57,7 @@ typedef enum {
    CMDID_CHKUSBMON     =   0x4000,
    CMDID_PROBE         =   0x8000,
    CMDID_SAVE_SETTINGS = 0x010000,
+   CMDID_EVENTS        = 0x020000,
 } Cmd_Id_Type;
 
 
@@ -74,10 +75,16 @@ typedef enum {
    CMD_FLAG_ASYNC               = 0x0100,
    CMD_FLAG_REPORT_FREED_EXCP   = 0x0200,
    CMD_FLAG_NOTABLE             = 0x0400,
+   CMD_FLAG_DSA                 = 0x0800,  // dynamic sleep adjustment
+   CMD_FLAG_NO_CACHE            = 0x1000,  // do not use persistent caches
+   CMD_FLAG_REFRESH_CACHE       = 0x2000,  // discard persistent caches
+   CMD_FLAG_DIFFERENTIAL_LOAD   = 0x4000,  // loadvcp writes only changed values
+   CMD_FLAG_FLOCK               = 0x8000,  // lock displays against other processes
    CMD_FLAG_RW_ONLY           = 0x010000,
    CMD_FLAG_RO_ONLY           = 0x020000,
    CMD_FLAG_WO_ONLY           = 0x040000,
    CMD_FLAG_ENABLE_UDF        = 0x100000,
+   CMD_FLAG_NO_SERVICE        = 0x200000,  // do not forward command to ddcutild
 } Parsed_Cmd_Flags;
 
 
@@ -91,7 +98,9 @@ struct {
    char *              args[MAX_ARGS];
    Feature_Set_Ref*    fref;
    DDCA_Stats_Type     stats_types;
+   DDCA_Stats_Format   stats_format;
    char *              failsim_control_fn;
+   char *              event_ring_fn;
    Display_Identifier* pdid;
    DDCA_Trace_Group         traced_groups;
    gchar **            traced_files;
@@ -99,6 +108,7 @@ struct {
    DDCA_Output_Level   output_level;
    int                 max_tries[3];
    int                 sleep_strategy;
+   int                 i2c_io_strategy;   // I2C_IO_Strategy_Id, -1 to use default
    uint32_t            flags;      // Parsed_Cmd_Flags
 
    // which?
@@ -0,0 +1,596 @@
+/** @file ddcutild.c
+ *
+ *  Service that executes ddcutil getvcp, setvcp, capabilities, and detect
+ *  requests received on a UNIX domain socket.
+ *
+ *  Displays are detected at startup, and remain open.  Capabilities
+ *  strings are read at startup, and VCP values that have been read are
+ *  retained for a short time.  A request therefore avoids the bus scan,
+ *  EDID reads, and initial display checks that each ddcutil invocation
+ *  otherwise performs, and often avoids DDC communication entirely.
+ *
+ *  Requests are executed one at a time, in the order received.
+ *  Unless option --allow-set is given, setvcp requests are rejected.
+ *  Values set are verified, as by the ddcutil command.
+ *
+ *  Displays connected or disconnected while the service is running are
+ *  found by watching udev events, or if that is not possible by checking
+ *  for changes before each request.  Requests for a display that is not
+ *  connected, and setvcp requests for table features, are answered with
+ *  status DDCRC_INVALID_DISPLAY and no output, and ddcutil then executes
+ *  the command itself.
+ *
+ *  The service is built on the libddcutil API.  For the request format,
+ *  see ddcutild_protocol.h.
+ */
+
+// Copyright (C) 2019 Sanford Rockowitz <rockowitz@minsoft.com>
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+#include <assert.h>
+#include <errno.h>
+#include <getopt.h>
+#include <signal.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <sys/un.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "public/ddcutil_c_api.h"
+#include "public/ddcutil_status_codes.h"
+
+#include "daemon/ddcutild_protocol.h"
+
+
+/** Default maximum age of a retained VCP value */
+#define DEFAULT_VALUE_MAX_AGE_MILLIS   1000
+
+/** Largest value accepted for option --max-age */
+#define MAX_VALUE_MAX_AGE_MILLIS       (60*60*1000)
+
+/** Maximum time to wait for a client to send its request */
+#define REQUEST_TIMEOUT_SECONDS           5
+
+#define SERVICE_DISPLAY_MARKER "SDSP"
+typedef struct {
+   char                      marker[4];
+   int                       dispno;
+   int                       busno;                // -1 if not an I2C display
+   DDCA_Display_Ref          dref;
+   DDCA_Display_Handle       dh;                   // opened on first use, then kept open
+   uint64_t                  value_millis[256];    // when value was read, 0 if none
+   DDCA_Non_Table_Vcp_Value  values[256];
+} Service_Display;
+
+static DDCA_Display_Info_List * dlist          = NULL;
+static Service_Display *        displays       = NULL;
+static int                      display_ct     = 0;
+
+static bool                     allow_set      = false;
+static int                      value_max_age_millis = DEFAULT_VALUE_MAX_AGE_MILLIS;
+static volatile sig_atomic_t    terminate_requested = 0;
+static bool                     watching_displays   = false;
+static volatile sig_atomic_t    displays_changed    = 0;    // set by display event callback
+
+// statistics
+static int request_ct       = 0;
+static int value_hit_ct     = 0;
+static int value_miss_ct    = 0;
+
+
+static uint64_t cur_millis() {
+   struct timespec ts;
+   clock_gettime(CLOCK_MONOTONIC, &ts);
+   return (uint64_t) ts.tv_sec * 1000 + ts.tv_nsec / (1000*1000);
+}
+
+
+//
+// Displays
+//
+
+// Builds the list of connected displays.  When called again after displays
+// have been connected or disconnected, a display still connected retains its
+// open handle and retained values, and a display no longer connected is closed.
+static DDCA_Status detect_displays() {
+   DDCA_Display_Info_List * new_dlist = NULL;
+   DDCA_Status rc = ddca_get_display_info_list2(false, &new_dlist);
+   if (rc != 0)
+      return rc;
+   Service_Display * new_displays = calloc(new_dlist->ct, sizeof(Service_Display));
+   for (int ndx = 0; ndx < new_dlist->ct; ndx++) {
+      DDCA_Display_Info * info = &new_dlist->info[ndx];
+      Service_Display * sdisp = &new_displays[ndx];
+      for (int old_ndx = 0; old_ndx < display_ct; old_ndx++) {
+         if (displays[old_ndx].dref == info->dref) {
+            *sdisp = displays[old_ndx];
+            displays[old_ndx].dh = NULL;
+            break;
+         }
+      }
+      memcpy(sdisp->marker, SERVICE_DISPLAY_MARKER, 4);
+      sdisp->dispno = info->dispno;
+      sdisp->busno  = (info->path.io_mode == DDCA_IO_I2C) ? info->path.path.i2c_busno : -1;
+      sdisp->dref   = info->dref;
+   }
+
+   for (int ndx = 0; ndx < display_ct; ndx++) {
+      if (displays[ndx].dh)
+         ddca_close_display(displays[ndx].dh);
+   }
+   free(displays);
+   if (dlist)
+      ddca_free_display_info_list(dlist);
+   dlist      = new_dlist;
+   displays   = new_displays;
+   display_ct = new_dlist->ct;
+   return 0;
+}
+
+
+// Called by libddcutil when a display is connected or disconnected,
+// in the udev watch thread or within ddca_redetect_displays().
+static void display_event_callback(DDCA_Display_Event * event, void * data) {
+   displays_changed = 1;
+}
+
+
+// Brings the display list up to date before a request is executed.
+static void refresh_displays() {
+   if (!watching_displays)
+      ddca_redetect_displays();
+   if (displays_changed) {
+      displays_changed = 0;
+      DDCA_Status rc = detect_displays();
+      if (rc != 0)
+         fprintf(stderr, "Display redetection failed: %s\n", ddca_rc_desc(rc));
+   }
+}
+
+
+static Service_Display * find_display(const char * selector) {
+   Service_Display * result = NULL;
+   if (selector && (selector[0] == 'd' || selector[0] == 'b') ) {
+      char * endptr;
+      long n = strtol(selector+1, &endptr, 10);
+      if (*endptr == '\0' && endptr != selector+1) {
+         for (int ndx = 0; ndx < display_ct && !result; ndx++) {
+            Service_Display * cur = &displays[ndx];
+            if ( (selector[0] == 'd' && cur->dispno == n) ||
+                 (selector[0] == 'b' && cur->busno  == n) )
+               result = cur;
+         }
+      }
+   }
+   return result;
+}
+
+
+static DDCA_Status ensure_display_open(Service_Display * sdisp) {
+   DDCA_Status rc = 0;
+   if (!sdisp->dh)
+      rc = ddca_open_display2(sdisp->dref, true, &sdisp->dh);
+   return rc;
+}
+
+
+static void discard_values(Service_Display * sdisp) {
+   memset(sdisp->value_millis, 0, sizeof(sdisp->value_millis));
+}
+
+
+//
+// Request execution
+//
+// Each function writes the command output to fout, and returns the status code
+// reported to the client.
+//
+
+static bool parse_feature_code(const char * s, DDCA_Vcp_Feature_Code * code_loc) {
+   if (s[0] == '0' && (s[1] == 'x' || s[1] == 'X'))
+      s += 2;
+   else if (s[0] == 'x' || s[0] == 'X')
+      s += 1;
+   char * endptr;
+   long n = strtol(s, &endptr, 16);
+   bool ok = (*s && *endptr == '\0' && n >= 0 && n <= 255);
+   if (ok)
+      *code_loc = n;
+   return ok;
+}
+
+
+// Accepts a decimal value, or a hexadecimal value prefixed by "x" or "0x"
+static bool parse_new_value(const char * s, uint16_t * value_loc) {
+   int base = 10;
+   if (s[0] == '0' && (s[1] == 'x' || s[1] == 'X')) {
+      s += 2;
+      base = 16;
+   }
+   else if (s[0] == 'x' || s[0] == 'X') {
+      s += 1;
+      base = 16;
+   }
+   char * endptr;
+   long n = strtol(s, &endptr, base);
+   bool ok = (*s && *endptr == '\0' && n >= 0 && n <= 0xffff);
+   if (ok)
+      *value_loc = n;
+   return ok;
+}
+
+
+static DDCA_Status execute_getvcp(Service_Display * sdisp, const char * arg, FILE * fout) {
+   DDCA_Vcp_Feature_Code code;
+   if (!arg || !parse_feature_code(arg, &code)) {
+      fprintf(fout, "Invalid feature code: %s\n", (arg) ? arg : "");
+      return DDCRC_ARG;
+   }
+
+   DDCA_Status rc = 0;
+   char * formatted = NULL;
+   uint64_t now = cur_millis();
+   if (sdisp->value_millis[code] && now - sdisp->value_millis[code] <= value_max_age_millis) {
+      value_hit_ct++;
+      rc = ddca_format_non_table_vcp_value_by_dref(code, sdisp->dref, &sdisp->values[code], &formatted);
+   }
+   else {
+      value_miss_ct++;
+      rc = ensure_display_open(sdisp);
+      if (rc == 0) {
+         DDCA_Any_Vcp_Value * valrec = NULL;
+         rc = ddca_get_any_vcp_value_using_implicit_type(sdisp->dh, code, &valrec);
+         if (rc == 0) {
+            if (valrec->value_type == DDCA_NON_TABLE_VCP_VALUE) {
+               sdisp->values[code].mh = valrec->val.c_nc.mh;
+               sdisp->values[code].ml = valrec->val.c_nc.ml;
+               sdisp->values[code].sh = valrec->val.c_nc.sh;
+               sdisp->values[code].sl = valrec->val.c_nc.sl;
+               sdisp->value_millis[code] = now;
+            }
+            rc = ddca_format_any_vcp_value_by_dref(code, sdisp->dref, valrec, &formatted);
+            ddca_free_any_vcp_value(valrec);
+         }
+      }
+   }
+
+   DDCA_Feature_Metadata * meta = NULL;
+   ddca_get_feature_metadata_by_dref(code, sdisp->dref, true, &meta);
+   const char * name = (meta && meta->feature_name) ? meta->feature_name : "Unknown feature";
+   if (rc == 0)
+      fprintf(fout, "VCP code 0x%02x (%-30s): %s\n", code, name, formatted);
+   else if (rc == DDCRC_REPORTED_UNSUPPORTED || rc == DDCRC_DETERMINED_UNSUPPORTED)
+      fprintf(fout, "VCP code 0x%02x (%-30s): Unsupported feature code\n", code, name);
+   else
+      fprintf(fout, "VCP code 0x%02x (%-30s): %s\n", code, name, ddca_rc_desc(rc));
+   free(formatted);
+   if (meta)
+      ddca_free_feature_metadata(meta);
+   return rc;
+}
+
+
+static DDCA_Status execute_setvcp(Service_Display * sdisp, char ** args, int argct, FILE * fout) {
+   if (!allow_set) {
+      fprintf(fout, "setvcp is not permitted, ddcutild was started without --allow-set\n");
+      return DDCRC_INVALID_OPERATION;
+   }
+   DDCA_Vcp_Feature_Code code;
+   uint16_t new_value;
+   if (argct != 2 || !parse_feature_code(args[0], &code)) {
+      fprintf(fout, "Invalid setvcp arguments\n");
+      return DDCRC_ARG;
+   }
+
+   // Table values are not handled, not reported in the output,
+   // the client executes the command itself
+   DDCA_Feature_Metadata * meta = NULL;
+   ddca_get_feature_metadata_by_dref(code, sdisp->dref, true, &meta);
+   bool is_table = meta && (meta->feature_flags & DDCA_TABLE);
+   if (meta)
+      ddca_free_feature_metadata(meta);
+   if (is_table)
+      return DDCRC_INVALID_DISPLAY;
+
+   if (!parse_new_value(args[1], &new_value)) {
+      fprintf(fout, "Invalid setvcp arguments\n");
+      return DDCRC_ARG;
+   }
+
+   DDCA_Status rc = ensure_display_open(sdisp);
+   if (rc == 0) {
+      rc = ddca_set_non_table_vcp_value(sdisp->dh, code, new_value >> 8, new_value & 0xff);
+      // Setting one feature, e.g. color preset, can change others
+      discard_values(sdisp);
+   }
+   if (rc != 0)
+      fprintf(fout, "Setting value failed for feature %02x: %s\n", code, ddca_rc_desc(rc));
+   return rc;
+}
+
+
+static DDCA_Status execute_capabilities(Service_Display * sdisp, FILE * fout) {
+   char * caps = NULL;
+   DDCA_Status rc = ensure_display_open(sdisp);
+   if (rc == 0)
+      rc = ddca_get_capabilities_string(sdisp->dh, &caps);
+   if (rc == 0) {
+      DDCA_Capabilities * parsed = NULL;
+      rc = ddca_parse_capabilities_string(caps, &parsed);
+      if (rc == 0) {
+         ddca_report_parsed_capabilities_by_dref(parsed, sdisp->dref, 0);
+         ddca_free_parsed_capabilities(parsed);
+      }
+      free(caps);
+   }
+   if (rc != 0)
+      fprintf(fout, "Unable to get capabilities: %s\n", ddca_rc_desc(rc));
+   return rc;
+}
+
+
+static DDCA_Status execute_stats(FILE * fout) {
+   fprintf(fout, "Service Stats:\n");
+   fprintf(fout, "   Requests:                        %5d\n", request_ct);
+   fprintf(fout, "   VCP values found in service:     %5d\n", value_hit_ct);
+   fprintf(fout, "   VCP values read from display:    %5d\n", value_miss_ct);
+   fprintf(fout, "   Maximum retained value age:      %5d milliseconds\n", value_max_age_millis);
+   fprintf(fout, "\n");
+   ddca_show_stats(DDCA_STATS_ALL, 0);
+   return 0;
+}
+
+
+static DDCA_Status execute_request(char * request, FILE * fout) {
+   char * args[4];
+   int    argct = 0;
+   char * saveptr = NULL;
+   char * tok = strtok_r(request, " \t\r\n", &saveptr);
+   while (tok && argct < 4) {
+      args[argct++] = tok;
+      tok = strtok_r(NULL, " \t\r\n", &saveptr);
+   }
+   if (tok || argct < 2) {
+      fprintf(fout, "Invalid request\n");
+      return DDCRC_ARG;
+   }
+
+   refresh_displays();
+
+   char * command = args[0];
+   if (strcmp(command, "detect") == 0) {
+      ddca_report_displays(false, 0);
+      return 0;
+   }
+   if (strcmp(command, "stats") == 0)
+      return execute_stats(fout);
+
+   // Not reported in the output, the client executes the command itself
+   Service_Display * sdisp = find_display(args[1]);
+   if (!sdisp)
+      return DDCRC_INVALID_DISPLAY;
+   assert(memcmp(sdisp->marker, SERVICE_DISPLAY_MARKER, 4) == 0);
+
+   DDCA_Status rc;
+   if (strcmp(command, "getvcp") == 0)
+      rc = execute_getvcp(sdisp, (argct > 2) ? args[2] : NULL, fout);
+   else if (strcmp(command, "setvcp") == 0)
+      rc = execute_setvcp(sdisp, args+2, argct-2, fout);
+   else if (strcmp(command, "capabilities") == 0)
+      rc = execute_capabilities(sdisp, fout);
+   else {
+      fprintf(fout, "Unrecognized command: %s\n", command);
+      rc = DDCRC_ARG;
+   }
+   return rc;
+}
+
+
+//
+// Socket handling
+//
+
+static void serve_connection(int fd) {
+   struct timeval tv = {REQUEST_TIMEOUT_SECONDS, 0};
+   setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+
+   char request[DDCUTILD_MAX_REQUEST_SIZE+1];
+   int  len = 0;
+   while (len < DDCUTILD_MAX_REQUEST_SIZE && !memchr(request, '\n', len)) {
+      ssize_t ct = read(fd, request+len, DDCUTILD_MAX_REQUEST_SIZE-len);
+      if (ct <= 0) {
+         if (ct < 0 && errno == EINTR && !terminate_requested)
+            continue;
+         return;      // client went away or timed out
+      }
+      len += ct;
+   }
+   request[len] = '\0';
+   request_ct++;
+
+   char * output = NULL;
+   size_t output_size = 0;
+   FILE * fout = open_memstream(&output, &output_size);
+   ddca_set_fout(fout);
+   ddca_set_ferr(fout);
+   DDCA_Status rc = execute_request(request, fout);
+   ddca_set_fout_to_default();
+   ddca_set_ferr_to_default();
+   fclose(fout);
+
+   FILE * fp = fdopen(dup(fd), "w");
+   if (fp) {
+      fprintf(fp, "%s %d %d\n", DDCUTILD_RESPONSE_TAG, DDCUTILD_PROTOCOL_VERSION, rc);
+      fwrite(output, 1, output_size, fp);
+      fclose(fp);
+   }
+   free(output);
+}
+
+
+// Returns listening socket, or -1 if error
+static int create_service_socket(const char * path) {
+   struct sockaddr_un addr;
+   memset(&addr, 0, sizeof(addr));
+   addr.sun_family = AF_UNIX;
+   if (strlen(path) >= sizeof(addr.sun_path)) {
+      fprintf(stderr, "Socket name too long: %s\n", path);
+      return -1;
+   }
+   strcpy(addr.sun_path, path);
+
+   int fd = socket(AF_UNIX, SOCK_STREAM|SOCK_CLOEXEC, 0);
+   if (fd < 0) {
+      fprintf(stderr, "Unable to create socket: %s\n", strerror(errno));
+      return -1;
+   }
+
+   // A socket left by a service that terminated abnormally is removed,
+   // but not that of a service still running.
+   if (connect(fd, (struct sockaddr *) &addr, sizeof(addr)) == 0) {
+      fprintf(stderr, "ddcutild is already running on %s\n", path);
+      close(fd);
+      return -1;
+   }
+   unlink(path);
+
+   if (bind(fd, (struct sockaddr *) &addr, sizeof(addr)) < 0 || listen(fd, 16) < 0) {
+      fprintf(stderr, "Unable to listen on %s: %s\n", path, strerror(errno));
+      close(fd);
+      return -1;
+   }
+   // Any local user may query the service, but only the owner and group may change settings
+   chmod(path, (allow_set) ? 0660 : 0666);
+   return fd;
+}
+
+
+static void terminate_handler(int signum) {
+   terminate_requested = 1;
+}
+
+
+static void usage(FILE * fp) {
+   fprintf(fp,
+         "Usage: ddcutild [--socket <path>] [--allow-set] [--max-age <milliseconds>]\n"
+         "\n"
+         "   --socket <path>   UNIX socket on which to listen, default is $%s or %s\n"
+         "   --allow-set       execute setvcp requests\n"
+         "   --max-age <ms>    maximum age of retained VCP values, 0 to always read (default %d)\n",
+         DDCUTILD_SOCKET_ENV, DDCUTILD_SOCKET_PATH, DEFAULT_VALUE_MAX_AGE_MILLIS);
+}
+
+
+int main(int argc, char * argv[]) {
+   const char * socket_path = getenv(DDCUTILD_SOCKET_ENV);
+   if (!socket_path)
+      socket_path = DDCUTILD_SOCKET_PATH;
+
+   static struct option long_options[] = {
+      {"socket",    required_argument, NULL, 's'},
+      {"allow-set", no_argument,       NULL, 'a'},
+      {"max-age",   required_argument, NULL, 'm'},
+      {"help",      no_argument,       NULL, 'h'},
+      {NULL,        0,                 NULL,  0 }
+   };
+   int opt;
+   while ( (opt = getopt_long(argc, argv, "h", long_options, NULL)) != -1) {
+      switch(opt) {
+      case 's':
+         socket_path = optarg;
+         break;
+      case 'a':
+         allow_set = true;
+         break;
+      case 'm':
+         {
+            char * endptr = NULL;
+            errno = 0;
+            long n = strtol(optarg, &endptr, 10);
+            if (errno != 0 || endptr == optarg || *endptr != '\0' ||
+                n < 0 || n > MAX_VALUE_MAX_AGE_MILLIS)
+            {
+               fprintf(stderr, "Invalid --max-age value: %s, must be 0..%d\n",
+                               optarg, MAX_VALUE_MAX_AGE_MILLIS);
+               return EXIT_FAILURE;
+            }
+            value_max_age_millis = n;
+         }
+         break;
+      case 'h':
+         usage(stdout);
+         return EXIT_SUCCESS;
+      default:
+         usage(stderr);
+         return EXIT_FAILURE;
+      }
+   }
+   if (optind < argc) {
+      usage(stderr);
+      return EXIT_FAILURE;
+   }
+
+   struct sigaction sa;
+   memset(&sa, 0, sizeof(sa));
+   sa.sa_handler = terminate_handler;     // no SA_RESTART, so that accept() is interrupted
+   sigaction(SIGTERM, &sa, NULL);
+   sigaction(SIGINT,  &sa, NULL);
+   signal(SIGPIPE, SIG_IGN);
+
+   // The ddcutil command verifies values set unless --noverify is given,
+   // and forwards setvcp only if verification is in effect
+   ddca_enable_verify(true);
+
+   DDCA_Status rc = detect_displays();
+   if (rc != 0) {
+      fprintf(stderr, "Display detection failed: %s\n", ddca_rc_desc(rc));
+      return EXIT_FAILURE;
+   }
+   ddca_register_display_event_callback(display_event_callback, NULL);
+   rc = ddca_start_watching_displays();
+   watching_displays = (rc == 0);
+   if (!watching_displays)
+      fprintf(stderr, "Unable to watch for display changes (%s), checking before each request\n",
+                      ddca_rc_desc(rc));
+   for (int ndx = 0; ndx < display_ct; ndx++) {
+      char * caps = NULL;
+      if (ensure_display_open(&displays[ndx]) == 0 &&
+          ddca_get_capabilities_string(displays[ndx].dh, &caps) == 0)
+         free(caps);
+   }
+
+   int sfd = create_service_socket(socket_path);
+   if (sfd < 0)
+      return EXIT_FAILURE;
+   printf("ddcutild: %d display(s), listening on %s\n", display_ct, socket_path);
+   fflush(stdout);
+
+   while (!terminate_requested) {
+      int cfd = accept(sfd, NULL, NULL);
+      if (cfd < 0) {
+         if (errno != EINTR)
+            fprintf(stderr, "accept() failed: %s\n", strerror(errno));
+         continue;
+      }
+      serve_connection(cfd);
+      close(cfd);
+   }
+
+   close(sfd);
+   unlink(socket_path);
+   if (watching_displays)
+      ddca_stop_watching_displays();
+   for (int ndx = 0; ndx < display_ct; ndx++) {
+      if (displays[ndx].dh)
+         ddca_close_display(displays[ndx].dh);
+   }
+   free(displays);
+   ddca_free_display_info_list(dlist);
+   return EXIT_SUCCESS;
+}
@@ -0,0 +1,53 @@
+/** @file ddcutild_protocol.h
+ *
+ *  Request and response format used between the ddcutil command and
+ *  the ddcutild service.
+ *
+ *  A client connects to the service's UNIX domain socket and writes a single
+ *  request line:
+ *
+ *     <command> <display> [<argument>...]\n
+ *
+ *  where \<display\> is "d<n>" for display number n or "b<n>" for
+ *  I2C bus /dev/i2c-n.  Commands are:
+ *
+ *     detect       <display>
+ *     capabilities <display>
+ *     getvcp       <display> <feature-code>
+ *     setvcp       <display> <feature-code> <new-value>
+ *     stats        <display>
+ *
+ *  (\<display\> is ignored by detect and stats.)
+ *
+ *  The service replies with a header line:
+ *
+ *     DDCUTILD <protocol version> <status code>\n
+ *
+ *  followed by the output of the command, then closes the connection.
+ *
+ *  If \<display\> is not currently connected, or the request is one the
+ *  service does not execute (setvcp of a table feature), the status code is
+ *  DDCRC_INVALID_DISPLAY, there is no output, and nothing has been executed.
+ *  The client then executes the command itself.
+ */
+
+// Copyright (C) 2019 Sanford Rockowitz <rockowitz@minsoft.com>
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+#ifndef DDCUTILD_PROTOCOL_H_
+#define DDCUTILD_PROTOCOL_H_
+
+/** Socket used if environment variable #DDCUTILD_SOCKET_ENV is not set */
+#define DDCUTILD_SOCKET_PATH      "/run/ddcutild.socket"
+
+/** Environment variable naming the service socket, used by both the
+ *  service and the ddcutil command */
+#define DDCUTILD_SOCKET_ENV       "DDCUTILD_SOCKET"
+
+#define DDCUTILD_RESPONSE_TAG     "DDCUTILD"
+#define DDCUTILD_PROTOCOL_VERSION 1
+
+/** Maximum length of a request line, including the terminating newline */
+#define DDCUTILD_MAX_REQUEST_SIZE 256
+
+#endif /* DDCUTILD_PROTOCOL_H_ */
@@ -7,11 +7,13 @@
 // SPDX-License-Identifier: GPL-2.0-or-later
 
 #include <assert.h>
+#include <stdlib.h>
 #include <string.h>
 
 #include "base/core.h"
 
 #include "ddc_vcp.h"
+#include "ddc_worker_pool.h"
 
 #include "ddc_async.h"
 
@@ -30,9 +32,9 @@ typedef struct {
    DDCA_Notification_Func callback_func;
 } Async_Getvcp_Data;
 
-// function to be run in thread
-gpointer threaded_get_vcp_value(gpointer data) {
-      bool debug = true;
+// function to be run in a worker pool thread
+static void pooled_get_vcp_value(gpointer data) {
+      bool debug = false;
 
       Async_Getvcp_Data * parms = data;
       assert(memcmp(parms->marker, ASYNC_GETVCP_DATA_MARKER, 4) == 0 );
@@ -55,10 +57,22 @@ gpointer threaded_get_vcp_value(gpointer data) {
       }
 
       parms->callback_func(psc, anyval);
-      // g_thread_exit(NULL);
-      return NULL;
+      parms->marker[3] = 'x';
+      free(parms);
    }
 
+
+/** Reads a VCP feature value in a worker pool thread, passing the result
+ *  to a callback function.
+ *
+ *  Reads for the same display are executed in the order requested.
+ *
+ *  \param  dh             display handle, must remain open until the callback is invoked
+ *  \param  feature_code   VCP feature code
+ *  \param  call_type      value type
+ *  \param  callback_func  function to receive the result
+ *  \return NULL
+ */
 Error_Info *
 start_get_vcp_value(
        Display_Handle *          dh,
@@ -72,17 +86,14 @@ start_get_vcp_value(
 
    Error_Info * ddc_excp = NULL;
 
-   Async_Getvcp_Data parms;
-   parms.call_type = call_type;
-   parms.feature_code = feature_code;
-   parms.dh = dh;
-   parms.callback_func = callback_func;
-
-   // GThread * th =
-   g_thread_new(
-         "getvcp",
-         threaded_get_vcp_value,
-         &parms);
+   // freed by pooled_get_vcp_value()
+   Async_Getvcp_Data * parms = calloc(1, sizeof(Async_Getvcp_Data));
+   memcpy(parms->marker, ASYNC_GETVCP_DATA_MARKER, 4);
+   parms->call_type = call_type;
+   parms->feature_code = feature_code;
+   parms->dh = dh;
+   parms->callback_func = callback_func;
+
+   ddc_worker_pool_submit(dh->dref->io_path, pooled_get_vcp_value, parms, NULL);
    return ddc_excp;
 }
-
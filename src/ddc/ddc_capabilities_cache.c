@@ -0,0 +1,258 @@
+/** @file ddc_capabilities_cache.c
+ *
+ *  Persistent cache of monitor capabilities strings, keyed by EDID.
+ *
+ *  Reading the capabilities string is a multi-part read of 32 byte
+ *  fragments, each followed by a protocol sleep, and typically takes
+ *  seconds.  Since the string for a given monitor does not change,
+ *  it is saved in file ddcutil/capabilities in the user's XDG cache
+ *  directory.  The key is the hex representation of the full 128 byte
+ *  EDID, so a monitor presenting a different EDID (e.g. after a firmware
+ *  update, or on a different input) is treated as a different monitor.
+ */
+
+// Copyright (C) 2019 Sanford Rockowitz <rockowitz@minsoft.com>
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+/** \cond */
+#include <assert.h>
+#include <errno.h>
+#include <glib-2.0/glib.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+/** \endcond */
+
+#include "util/file_util.h"
+#include "util/report_util.h"
+#include "util/string_util.h"
+
+#include "base/core.h"
+
+#include "ddc/ddc_capabilities_cache.h"
+
+
+// Trace class for this file
+static DDCA_Trace_Group TRACE_GROUP = DDCA_TRC_DDC;
+
+#define CAPABILITIES_CACHE_FN  "capabilities"
+
+static bool         capabilities_cache_enabled = true;
+static GHashTable * capabilities_cache = NULL;      // key: EDID hex string, value: capabilities
+static GMutex       capabilities_cache_mutex;
+static int          capabilities_cache_hit_ct = 0;
+static int          capabilities_cache_miss_ct = 0;
+static int          capabilities_cache_store_ct = 0;
+
+
+static char * capabilities_cache_file_name() {
+   return xdg_user_cache_file("ddcutil", CAPABILITIES_CACHE_FN);
+}
+
+
+/** Enables or disables the persistent capabilities cache.
+ *
+ *  When disabled, capabilities strings are neither read from
+ *  nor written to the cache.
+ *
+ *  \param  onoff  true to enable, false to disable
+ *  \return prior setting
+ */
+bool ddc_enable_capabilities_cache(bool onoff) {
+   bool old = capabilities_cache_enabled;
+   capabilities_cache_enabled = onoff;
+   return old;
+}
+
+
+/** Reports whether the persistent capabilities cache is enabled.
+ *
+ *  \return true/false
+ */
+bool ddc_is_capabilities_cache_enabled() {
+   return capabilities_cache_enabled;
+}
+
+
+// Must be called with capabilities_cache_mutex locked
+static void load_capabilities_cache() {
+   bool debug = false;
+   if (capabilities_cache)
+      return;
+
+   capabilities_cache = g_hash_table_new_full(g_str_hash, g_str_equal, free, free);
+   char * fn = capabilities_cache_file_name();
+   if (fn && regular_file_exists(fn)) {
+      GPtrArray * lines = g_ptr_array_new_with_free_func(free);
+      file_getlines(fn, lines, false);
+      bool format_ok = false;
+      for (int ndx = 0; ndx < lines->len; ndx++) {
+         char * line = g_ptr_array_index(lines, ndx);
+         if (strlen(line) == 0 || line[0] == '#')
+            continue;
+         if (!format_ok) {
+            int version = 0;
+            format_ok = (sscanf(line, "FORMAT %d", &version) == 1 &&
+                         version == CAPABILITIES_CACHE_FORMAT_VERSION);
+            if (!format_ok) {
+               DBGMSF(debug, "Ignoring %s, unrecognized format: %s", fn, line);
+               break;
+            }
+            continue;
+         }
+         char * tab = strchr(line, '\t');
+         if (tab && tab - line == 2*128 && strlen(tab+1) > 0) {
+            char * key = strndup(line, 2*128);
+            g_hash_table_replace(capabilities_cache, key, strdup(tab+1));
+         }
+         else {
+            DBGMSF(debug, "Ignoring invalid line: %s", line);
+         }
+      }
+      g_ptr_array_free(lines, true);
+   }
+   DBGTRC(debug, TRACE_GROUP, "Loaded %d entries from %s", g_hash_table_size(capabilities_cache), fn);
+   free(fn);
+}
+
+
+// Must be called with capabilities_cache_mutex locked
+static void save_capabilities_cache() {
+   bool debug = false;
+   char * fn = capabilities_cache_file_name();
+   if (!fn)
+      return;
+
+   GString * contents = g_string_new(NULL);
+   g_string_append(contents, "# ddcutil capabilities cache, regenerated automatically\n");
+   g_string_append_printf(contents, "FORMAT %d\n", CAPABILITIES_CACHE_FORMAT_VERSION);
+   GHashTableIter iter;
+   gpointer key, value;
+   g_hash_table_iter_init(&iter, capabilities_cache);
+   while (g_hash_table_iter_next(&iter, &key, &value)) {
+      g_string_append_printf(contents, "%s\t%s\n", (char *) key, (char *) value);
+   }
+
+   char * dir = g_path_get_dirname(fn);
+   GError * error = NULL;
+   if (g_mkdir_with_parents(dir, 0755) != 0 ||
+       !g_file_set_contents(fn, contents->str, contents->len, &error))
+   {
+      DBGTRC(debug, TRACE_GROUP, "Unable to write %s: %s",
+                                 fn, (error) ? error->message : strerror(errno));
+      if (error)
+         g_error_free(error);
+   }
+   g_free(dir);
+   g_string_free(contents, true);
+   free(fn);
+}
+
+
+/** Looks up the capabilities string for a monitor in the cache.
+ *
+ *  \param  edidbytes  128 byte EDID
+ *  \return capabilities string, caller must free, NULL if not found
+ */
+char * ddc_get_cached_capabilities(const Byte * edidbytes) {
+   bool debug = false;
+   assert(edidbytes);
+   if (!capabilities_cache_enabled)
+      return NULL;
+
+   char * key = hexstring(edidbytes, 128);
+   g_mutex_lock(&capabilities_cache_mutex);
+   load_capabilities_cache();
+   char * result = g_hash_table_lookup(capabilities_cache, key);
+   if (result) {
+      result = strdup(result);
+      capabilities_cache_hit_ct++;
+   }
+   else {
+      capabilities_cache_miss_ct++;
+   }
+   g_mutex_unlock(&capabilities_cache_mutex);
+   free(key);
+
+   DBGTRC(debug, TRACE_GROUP, "Returning: %s", result);
+   return result;
+}
+
+
+/** Saves the capabilities string for a monitor in the cache.
+ *
+ *  \param  edidbytes     128 byte EDID
+ *  \param  capabilities  capabilities string
+ *
+ *  \remark
+ *  Strings containing tabs or newlines cannot be represented
+ *  in the cache file and are not saved.
+ */
+void ddc_set_cached_capabilities(const Byte * edidbytes, const char * capabilities) {
+   bool debug = false;
+   assert(edidbytes);
+   assert(capabilities);
+   if (!capabilities_cache_enabled || strlen(capabilities) == 0 || strpbrk(capabilities, "\t\r\n"))
+      return;
+
+   char * key = hexstring(edidbytes, 128);
+   g_mutex_lock(&capabilities_cache_mutex);
+   load_capabilities_cache();
+   char * old = g_hash_table_lookup(capabilities_cache, key);
+   if (old && streq(old, capabilities)) {
+      free(key);
+   }
+   else {
+      g_hash_table_replace(capabilities_cache, key, strdup(capabilities));
+      capabilities_cache_store_ct++;
+      save_capabilities_cache();
+   }
+   g_mutex_unlock(&capabilities_cache_mutex);
+
+   DBGTRC(debug, TRACE_GROUP, "Done. capabilities=%s", capabilities);
+}
+
+
+/** Discards all cached capabilities strings, both in memory and on disk. */
+void ddc_discard_capabilities_cache() {
+   bool debug = false;
+   g_mutex_lock(&capabilities_cache_mutex);
+   if (capabilities_cache)
+      g_hash_table_remove_all(capabilities_cache);
+   else
+      capabilities_cache = g_hash_table_new_full(g_str_hash, g_str_equal, free, free);
+   char * fn = capabilities_cache_file_name();
+   if (fn) {
+      int rc = unlink(fn);
+      DBGTRC(debug, TRACE_GROUP, "unlink(%s) returned %d", fn, rc);
+      free(fn);
+   }
+   g_mutex_unlock(&capabilities_cache_mutex);
+}
+
+
+/** Resets the capabilities cache hit and miss counters. */
+void ddc_reset_capabilities_cache_stats() {
+   g_mutex_lock(&capabilities_cache_mutex);
+   capabilities_cache_hit_ct   = 0;
+   capabilities_cache_miss_ct  = 0;
+   capabilities_cache_store_ct = 0;
+   g_mutex_unlock(&capabilities_cache_mutex);
+}
+
+
+/** Reports capabilities cache statistics.
+ *
+ *  \param depth logical indentation depth
+ */
+void ddc_report_capabilities_cache_stats(int depth) {
+   int d1 = depth+1;
+   rpt_title("Capabilities Cache Stats:", depth);
+   g_mutex_lock(&capabilities_cache_mutex);
+   rpt_vstring(d1, "Cache enabled:        %s",  (capabilities_cache_enabled) ? "true" : "false");
+   rpt_vstring(d1, "Hits:                 %5d", capabilities_cache_hit_ct);
+   rpt_vstring(d1, "Misses:               %5d", capabilities_cache_miss_ct);
+   rpt_vstring(d1, "Entries stored:       %5d", capabilities_cache_store_ct);
+   g_mutex_unlock(&capabilities_cache_mutex);
+}
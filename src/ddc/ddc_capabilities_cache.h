@@ -0,0 +1,31 @@
+/** @file ddc_capabilities_cache.h
+ *
+ *  Persistent cache of monitor capabilities strings, keyed by EDID.
+ */
+
+// Copyright (C) 2019 Sanford Rockowitz <rockowitz@minsoft.com>
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+#ifndef DDC_CAPABILITIES_CACHE_H_
+#define DDC_CAPABILITIES_CACHE_H_
+
+/** \cond */
+#include <stdbool.h>
+/** \endcond */
+
+#include "util/coredefs.h"
+
+/** Version of the cache file format.  Files with a different version are ignored. */
+#define CAPABILITIES_CACHE_FORMAT_VERSION  1
+
+bool   ddc_enable_capabilities_cache(bool onoff);
+bool   ddc_is_capabilities_cache_enabled();
+
+char * ddc_get_cached_capabilities(const Byte * edidbytes);
+void   ddc_set_cached_capabilities(const Byte * edidbytes, const char * capabilities);
+void   ddc_discard_capabilities_cache();
+
+void   ddc_reset_capabilities_cache_stats();
+void   ddc_report_capabilities_cache_stats(int depth);
+
+#endif /* DDC_CAPABILITIES_CACHE_H_ */
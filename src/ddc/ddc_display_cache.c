@@ -0,0 +1,388 @@
+/** @file ddc_display_cache.c
+ *
+ *  Persistent cache of information learned about monitors by DDC communication.
+ *
+ *  Determining how a monitor indicates an unsupported feature requires
+ *  probing feature x00 during display detection, and dynamic sleep adjustment
+ *  starts each invocation from the protocol sleep times.  This module saves
+ *  the results in file ddcutil/display_cache in the user's XDG cache directory,
+ *  so that subsequent invocations can skip the probe and start with the
+ *  learned sleep multiplier.
+ *
+ *  Monitors are identified by manufacturer id, model name, product code, and
+ *  serial number.  An entry is discarded if the EDID read from the monitor no
+ *  longer matches the EDID saved with the entry, or if the entry is older than
+ *  #DISPLAY_CACHE_MAX_AGE_SECONDS.  The file is ignored if its format version
+ *  differs from #DISPLAY_CACHE_FORMAT_VERSION.
+ */
+
+// Copyright (C) 2019 Sanford Rockowitz <rockowitz@minsoft.com>
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+/** \cond */
+#include <assert.h>
+#include <errno.h>
+#include <glib-2.0/glib.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+/** \endcond */
+
+#include "util/edid.h"
+#include "util/file_util.h"
+#include "util/string_util.h"
+
+#include "base/core.h"
+#include "base/displays.h"
+#include "base/dynamic_sleep.h"
+#include "base/monitor_model_key.h"
+#include "base/parms.h"
+
+#include "ddc/ddc_display_cache.h"
+
+
+// Trace class for this file
+static DDCA_Trace_Group TRACE_GROUP = DDCA_TRC_DDC;
+
+#define DISPLAY_CACHE_FN  "display_cache"
+
+/** Display_Ref flags that record the results of the initial DDC checks */
+#define DREF_CACHEABLE_FLAGS  ( DREF_DDC_COMMUNICATION_CHECKED                 | \
+                                DREF_DDC_COMMUNICATION_WORKING                 | \
+                                DREF_DDC_NULL_RESPONSE_CHECKED                 | \
+                                DREF_DDC_USES_NULL_RESPONSE_FOR_UNSUPPORTED    | \
+                                DREF_DDC_USES_MH_ML_SH_SL_ZERO_FOR_UNSUPPORTED | \
+                                DREF_DDC_USES_DDC_FLAG_FOR_UNSUPPORTED         | \
+                                DREF_DDC_DOES_NOT_INDICATE_UNSUPPORTED )
+
+typedef struct {
+   char *      key;
+   char *      edid_hex;               ///< hex representation of 128 byte EDID
+   Dref_Flags  flags;                  ///< DREF_CACHEABLE_FLAGS bits
+   int         sleep_multiplier_pct;   ///< dynamic sleep multiplier, as percent
+   time_t      timestamp;              ///< time entry was last updated
+} Display_Cache_Entry;
+
+static bool         display_cache_enabled = true;
+static bool         display_cache_loaded  = false;
+static bool         display_cache_changed = false;
+static GHashTable * display_cache         = NULL;
+static GMutex       display_cache_mutex;
+
+
+static void free_display_cache_entry(void * data) {
+   Display_Cache_Entry * entry = data;
+   if (entry) {
+      free(entry->key);
+      free(entry->edid_hex);
+      free(entry);
+   }
+}
+
+
+/** Creates the key identifying a monitor in the cache.
+ *
+ *  \param  pedid  parsed EDID
+ *  \return key, caller must free
+ */
+static char * display_cache_key(Parsed_Edid * pedid) {
+   char * model_id = model_id_string(pedid->mfg_id, pedid->model_name, pedid->product_code);
+   char * serial = strdup(pedid->serial_ascii);
+   for (int ndx = 0; ndx < strlen(serial); ndx++) {
+      if ( !g_ascii_isalnum(serial[ndx]) )
+         serial[ndx] = '_';
+   }
+   char * key = g_strdup_printf("%s-%s-%u", model_id, serial, pedid->serial_binary);
+   free(model_id);
+   free(serial);
+   return key;
+}
+
+
+static char * display_cache_file_name() {
+   return xdg_user_cache_file("ddcutil", DISPLAY_CACHE_FN);
+}
+
+
+/** Enables or disables the persistent display cache.
+ *
+ *  \param  onoff  true to enable, false to disable
+ *  \return prior setting
+ */
+bool ddc_enable_display_cache(bool onoff) {
+   bool old = display_cache_enabled;
+   display_cache_enabled = onoff;
+   return old;
+}
+
+
+/** Reports whether the persistent display cache is enabled.
+ *
+ *  \return true/false
+ */
+bool ddc_is_display_cache_enabled() {
+   return display_cache_enabled;
+}
+
+
+static bool parse_display_cache_line(char * line, time_t now, Display_Cache_Entry ** entry_loc) {
+   bool ok = false;
+   *entry_loc = NULL;
+   gchar ** fields = g_strsplit(line, "\t", -1);
+   if (g_strv_length(fields) == 5) {
+      char * endptr = NULL;
+      errno = 0;
+      long flags = strtol(fields[2], &endptr, 16);
+      bool valid = (errno == 0 && *endptr == '\0' && (flags & ~DREF_CACHEABLE_FLAGS) == 0);
+      long pct = strtol(fields[3], &endptr, 10);
+      valid = valid && (errno == 0 && *endptr == '\0');
+      long long timestamp = strtoll(fields[4], &endptr, 10);
+      valid = valid && (errno == 0 && *endptr == '\0');
+      valid = valid && strlen(fields[1]) == 2*128;
+      if (valid) {
+         ok = true;
+         // stale entries are syntactically valid, but are not loaded
+         if (timestamp <= now && now - timestamp <= DISPLAY_CACHE_MAX_AGE_SECONDS) {
+            Display_Cache_Entry * entry = calloc(1, sizeof(Display_Cache_Entry));
+            entry->key                  = strdup(fields[0]);
+            entry->edid_hex             = strdup(fields[1]);
+            entry->flags                = flags;
+            entry->sleep_multiplier_pct = pct;
+            entry->timestamp            = timestamp;
+            *entry_loc = entry;
+         }
+      }
+   }
+   g_strfreev(fields);
+   return ok;
+}
+
+
+/** Loads the display cache file, if it has not already been loaded.
+ *
+ *  A file that cannot be read or has an unexpected format is ignored,
+ *  and will be replaced when the cache is saved.
+ */
+void ddc_load_display_cache() {
+   bool debug = false;
+   DBGTRC(debug, TRACE_GROUP, "Starting. display_cache_enabled=%s, display_cache_loaded=%s",
+                              bool_repr(display_cache_enabled), bool_repr(display_cache_loaded));
+
+   g_mutex_lock(&display_cache_mutex);
+   if (!display_cache_loaded) {
+      display_cache = g_hash_table_new_full(g_str_hash, g_str_equal, NULL, free_display_cache_entry);
+      display_cache_loaded = true;
+
+      char * fn = display_cache_file_name();
+      if (display_cache_enabled && fn && regular_file_exists(fn)) {
+         GPtrArray * lines = g_ptr_array_new_with_free_func(free);
+         int linect = file_getlines(fn, lines, false);
+         DBGMSF(debug, "Read %d lines from %s", linect, fn);
+         time_t now = time(NULL);
+         bool format_ok = false;
+         int  stale_ct  = 0;
+         for (int ndx = 0; ndx < lines->len; ndx++) {
+            char * line = g_strstrip(g_ptr_array_index(lines, ndx));
+            if (strlen(line) == 0 || line[0] == '#')
+               continue;
+            if (!format_ok) {
+               int version = 0;
+               format_ok = (sscanf(line, "FORMAT %d", &version) == 1 &&
+                            version == DISPLAY_CACHE_FORMAT_VERSION);
+               if (!format_ok) {
+                  DBGMSF(debug, "Ignoring %s, unrecognized format: %s", fn, line);
+                  display_cache_changed = true;
+                  break;
+               }
+               continue;
+            }
+            Display_Cache_Entry * entry = NULL;
+            if (!parse_display_cache_line(line, now, &entry)) {
+               DBGMSF(debug, "Ignoring invalid line: %s", line);
+               display_cache_changed = true;
+            }
+            else if (!entry) {
+               stale_ct++;
+               display_cache_changed = true;
+            }
+            else {
+               g_hash_table_replace(display_cache, entry->key, entry);
+            }
+         }
+         DBGMSF(debug, "Loaded %d entries, discarded %d stale entries",
+                       g_hash_table_size(display_cache), stale_ct);
+         g_ptr_array_free(lines, true);
+      }
+      free(fn);
+   }
+   g_mutex_unlock(&display_cache_mutex);
+
+   DBGTRC(debug, TRACE_GROUP, "Done");
+}
+
+
+/** Applies cached information to a newly created #Display_Ref.
+ *
+ *  If a valid entry exists for the monitor, the flags determined by
+ *  the initial DDC checks are set in the #Display_Ref, so that
+ *  #initial_checks_by_dh() does not repeat them, and the learned
+ *  sleep multiplier is restored.
+ *
+ *  \param  dref  display reference, must have a parsed EDID
+ *  \return true if a valid cache entry was applied, false if not
+ *
+ *  \remark
+ *  An entry whose EDID does not match that of the monitor is discarded.
+ */
+bool ddc_apply_display_cache(Display_Ref * dref) {
+   bool debug = false;
+   assert(dref);
+   bool applied = false;
+
+   if (display_cache_enabled && dref->pedid && dref->io_path.io_mode == DDCA_IO_I2C) {
+      ddc_load_display_cache();
+      char * key = display_cache_key(dref->pedid);
+      char * edid_hex = hexstring(dref->pedid->bytes, 128);
+
+      g_mutex_lock(&display_cache_mutex);
+      Display_Cache_Entry * entry = g_hash_table_lookup(display_cache, key);
+      if (entry) {
+         if (!streq(entry->edid_hex, edid_hex)) {
+            DBGMSF(debug, "EDID mismatch, discarding entry for %s", key);
+            g_hash_table_remove(display_cache, key);
+            display_cache_changed = true;
+         }
+         else if (entry->flags & DREF_DDC_COMMUNICATION_WORKING) {
+            dref->flags |= entry->flags;
+            if (dref->dsd)
+               dsd_set_sleep_multiplier(dref->dsd, entry->sleep_multiplier_pct / 100.0);
+            applied = true;
+         }
+      }
+      g_mutex_unlock(&display_cache_mutex);
+
+      DBGTRC(debug, TRACE_GROUP, "dref=%s, key=%s, returning %s",
+                                 dref_repr_t(dref), key, bool_repr(applied));
+      free(edid_hex);
+      free(key);
+   }
+   return applied;
+}
+
+
+/** Records the current DDC check results and sleep multiplier for
+ *  a display in the cache.
+ *
+ *  Only displays for which DDC communication is working are cached.
+ *
+ *  \param  dref  display reference
+ */
+void ddc_update_display_cache(Display_Ref * dref) {
+   bool debug = false;
+   assert(dref);
+
+   if ( display_cache_enabled                         &&
+        dref->pedid                                   &&
+        dref->io_path.io_mode == DDCA_IO_I2C          &&
+        (dref->flags & DREF_DDC_COMMUNICATION_CHECKED) &&
+        (dref->flags & DREF_DDC_COMMUNICATION_WORKING) )
+   {
+      ddc_load_display_cache();
+
+      Display_Cache_Entry * entry = calloc(1, sizeof(Display_Cache_Entry));
+      entry->key      = display_cache_key(dref->pedid);
+      entry->edid_hex = hexstring(dref->pedid->bytes, 128);
+      entry->flags    = dref->flags & DREF_CACHEABLE_FLAGS;
+      entry->sleep_multiplier_pct =
+            (dref->dsd) ? (int) (dsd_get_sleep_multiplier(dref->dsd) * 100 + 0.5) : 100;
+      entry->timestamp = time(NULL);
+
+      g_mutex_lock(&display_cache_mutex);
+      // The timestamp records when the initial checks were performed, so
+      // that restoring them from the cache does not keep them from aging out.
+      Display_Cache_Entry * old = g_hash_table_lookup(display_cache, entry->key);
+      if (old && old->flags == entry->flags && streq(old->edid_hex, entry->edid_hex))
+         entry->timestamp = old->timestamp;
+      DBGTRC(debug, TRACE_GROUP, "key=%s, flags=0x%04x, sleep_multiplier_pct=%d",
+                                 entry->key, entry->flags, entry->sleep_multiplier_pct);
+      g_hash_table_replace(display_cache, entry->key, entry);
+      display_cache_changed = true;
+      g_mutex_unlock(&display_cache_mutex);
+   }
+}
+
+
+/** Writes the display cache file if the cache has changed.
+ *
+ *  The file is written atomically, so concurrent ddcutil instances
+ *  never see a partially written file.  Failure to write the cache
+ *  is not an error.
+ */
+void ddc_save_display_cache() {
+   bool debug = false;
+   DBGTRC(debug, TRACE_GROUP, "Starting. display_cache_changed=%s", bool_repr(display_cache_changed));
+
+   g_mutex_lock(&display_cache_mutex);
+   if (display_cache_enabled && display_cache && display_cache_changed) {
+      char * fn = display_cache_file_name();
+      if (fn) {
+         GString * contents = g_string_new(NULL);
+         g_string_append(contents, "# ddcutil display cache, regenerated automatically\n");
+         g_string_append_printf(contents, "FORMAT %d\n", DISPLAY_CACHE_FORMAT_VERSION);
+
+         GHashTableIter iter;
+         gpointer key, value;
+         g_hash_table_iter_init(&iter, display_cache);
+         while (g_hash_table_iter_next(&iter, &key, &value)) {
+            Display_Cache_Entry * entry = value;
+            g_string_append_printf(contents, "%s\t%s\t%04x\t%d\t%lld\n",
+                                   entry->key,
+                                   entry->edid_hex,
+                                   entry->flags,
+                                   entry->sleep_multiplier_pct,
+                                   (long long) entry->timestamp);
+         }
+
+         char * dir = g_path_get_dirname(fn);
+         GError * error = NULL;
+         if (g_mkdir_with_parents(dir, 0755) == 0 &&
+             g_file_set_contents(fn, contents->str, contents->len, &error))
+         {
+            display_cache_changed = false;
+         }
+         else {
+            DBGTRC(debug, TRACE_GROUP, "Unable to write %s: %s",
+                                       fn, (error) ? error->message : strerror(errno));
+            if (error)
+               g_error_free(error);
+         }
+         g_free(dir);
+         g_string_free(contents, true);
+         free(fn);
+      }
+   }
+   g_mutex_unlock(&display_cache_mutex);
+
+   DBGTRC(debug, TRACE_GROUP, "Done");
+}
+
+
+/** Discards all cached information, both in memory and on disk. */
+void ddc_discard_display_cache() {
+   bool debug = false;
+
+   g_mutex_lock(&display_cache_mutex);
+   if (display_cache)
+      g_hash_table_remove_all(display_cache);
+   display_cache_loaded = (display_cache != NULL);
+   display_cache_changed = false;
+   char * fn = display_cache_file_name();
+   if (fn) {
+      int rc = unlink(fn);
+      DBGTRC(debug, TRACE_GROUP, "unlink(%s) returned %d", fn, rc);
+      free(fn);
+   }
+   g_mutex_unlock(&display_cache_mutex);
+}
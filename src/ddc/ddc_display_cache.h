@@ -0,0 +1,30 @@
+/** @file ddc_display_cache.h
+ *
+ *  Persistent cache of information learned about monitors by DDC communication.
+ */
+
+// Copyright (C) 2019 Sanford Rockowitz <rockowitz@minsoft.com>
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+#ifndef DDC_DISPLAY_CACHE_H_
+#define DDC_DISPLAY_CACHE_H_
+
+/** \cond */
+#include <stdbool.h>
+/** \endcond */
+
+#include "base/displays.h"
+
+/** Version of the cache file format.  Files with a different version are ignored. */
+#define DISPLAY_CACHE_FORMAT_VERSION  1
+
+bool ddc_enable_display_cache(bool onoff);
+bool ddc_is_display_cache_enabled();
+
+void ddc_load_display_cache();
+bool ddc_apply_display_cache(Display_Ref * dref);
+void ddc_update_display_cache(Display_Ref * dref);
+void ddc_save_display_cache();
+void ddc_discard_display_cache();
+
+#endif /* DDC_DISPLAY_CACHE_H_ */
@@ -36,16 +36,41 @@
 #endif
  *
  *  Only the io path to the display is checked.
+ *
+ *  Optionally, an open display is also locked against other processes,
+ *  using flock() on the open I2C or hiddev device.  This serializes
+ *  ddcutil and libddcutil clients in separate processes accessing the
+ *  same bus, so that their DDC exchanges do not interleave.
+ *  Since the lock is held on the open device, it is released by the
+ *  kernel when the holding process exits, and so cannot become stale.
+ *  A lock held by a hung process is handled by waiting a bounded time.
+ *
+ *  The same lock is taken on I2C buses while they are probed during display
+ *  detection and hotplug redetection (see #i2c_set_probe_lock()), but there
+ *  a timeout is not an error: probing proceeds unlocked.  Probing of USB
+ *  hiddev devices during detection is not covered.
  */
 
 #include <assert.h>
 #include <ddc/ddc_display_lock.h>
+#include <errno.h>
 #include <glib-2.0/glib.h>
+#include <stdio.h>
 #include <string.h>
+#include <sys/file.h>
+#include <sys/stat.h>
+#include <sys/sysmacros.h>
 
 #include "util/report_util.h"
 #include "util/string_util.h"
+#include "util/timestamp.h"
+
+#include "base/ddc_errno.h"
 #include "base/displays.h"
+#include "base/parms.h"
+#include "base/sleep.h"
+
+#include "i2c/i2c_bus_core.h"
 
 #include "ddcutil_types.h"
 
@@ -61,6 +86,15 @@ typedef struct {
 #endif
    GMutex       display_mutex;
    GThread *    display_mutex_thread;     // thread owning mutex
+   // statistics, guarded by descriptors_mutex
+   int          lock_ct;                  // in process locks obtained
+   int          thread_wait_ct;           // locks that waited for another thread
+   uint64_t     thread_wait_nanos;
+   int          process_lock_ct;          // cross process locks obtained
+   int          process_wait_ct;          // locks that waited for another process
+   uint64_t     process_wait_nanos;
+   uint64_t     process_max_wait_nanos;
+   int          process_timeout_ct;       // gave up waiting for another process
 } Distinct_Display_Desc;
 
 
@@ -117,6 +151,9 @@ static GPtrArray * display_descriptors = NULL;  // array of Distinct_Display_Des
 static GMutex descriptors_mutex;                // single threads access to display_descriptors
 static GMutex master_display_lock_mutex;
 
+static bool   cross_process_lock_enabled = DEFAULT_CROSS_PROCESS_LOCK;
+static int    cross_process_lock_max_wait_millis = CROSS_PROCESS_LOCK_MAX_WAIT_MILLIS;
+
 
 void init_ddc_display_lock(void) {
    display_descriptors= g_ptr_array_new();
@@ -186,14 +223,27 @@ lock_distinct_display(
       locked = false;
    }
    else {
+      uint64_t wait_nanos = 0;
       if (flags & DDISP_WAIT) {
-         g_mutex_lock(&ddesc->display_mutex);
+         if (!g_mutex_trylock(&ddesc->display_mutex)) {
+            uint64_t start_nanos = cur_realtime_nanosec();
+            g_mutex_lock(&ddesc->display_mutex);
+            wait_nanos = cur_realtime_nanosec() - start_nanos;
+         }
       }
       else {
          locked = g_mutex_trylock(&ddesc->display_mutex);
       }
-      if (locked)
+      if (locked) {
          ddesc->display_mutex_thread = g_thread_self();
+         g_mutex_lock(&descriptors_mutex);
+         ddesc->lock_ct++;
+         if (wait_nanos > 0) {
+            ddesc->thread_wait_ct++;
+            ddesc->thread_wait_nanos += wait_nanos;
+         }
+         g_mutex_unlock(&descriptors_mutex);
+      }
    }
    // need a new DDC status code
    DBGMSF(debug, "Done.  Returning: %s", bool_repr(locked));
@@ -221,6 +271,214 @@ void unlock_distinct_display(Distinct_Display_Ref id) {
 }
 
 
+//
+// Cross process locking
+//
+
+/** Controls whether open displays are also locked against other processes.
+ *
+ *  \param  onoff  **true** for enabled, **false** for disabled
+ *  \return prior setting
+ */
+bool ddc_enable_cross_process_lock(bool onoff) {
+   bool old_value = cross_process_lock_enabled;
+   cross_process_lock_enabled = onoff;
+   i2c_set_probe_lock(cross_process_lock_enabled, cross_process_lock_max_wait_millis);
+   return old_value;
+}
+
+
+/** Reports whether open displays are locked against other processes.
+ *
+ *  \return **true** if enabled, **false** if not
+ */
+bool ddc_is_cross_process_lock_enabled() {
+   return cross_process_lock_enabled;
+}
+
+
+/** Sets the maximum time to wait for another process to release a display.
+ *
+ *  \param  millis  maximum wait in milliseconds, if 0 do not wait
+ *  \return prior setting
+ */
+int ddc_set_cross_process_lock_max_wait(int millis) {
+   int old_value = cross_process_lock_max_wait_millis;
+   if (millis >= 0)
+      cross_process_lock_max_wait_millis = millis;
+   i2c_set_probe_lock(cross_process_lock_enabled, cross_process_lock_max_wait_millis);
+   return old_value;
+}
+
+
+// Returns the id of the process holding an flock() lock on an open file,
+// as reported in /proc/locks, or 0 if not found.
+static pid_t flock_holder_pid(int fd) {
+   pid_t result = 0;
+   struct stat statbuf;
+   if (fstat(fd, &statbuf) == 0) {
+      FILE * fp = fopen("/proc/locks", "r");
+      if (fp) {
+         char line[200];
+         while (!result && fgets(line, sizeof(line), fp)) {
+            char locktype[20];
+            int  pid;
+            unsigned int  maj, min;
+            unsigned long ino;
+            // e.g. "3: FLOCK  ADVISORY  WRITE 1234 00:06:321 0 EOF"
+            if (sscanf(line, "%*s %19s %*s %*s %d %x:%x:%lu", locktype, &pid, &maj, &min, &ino) == 5 &&
+                streq(locktype, "FLOCK")                &&
+                maj == major(statbuf.st_dev)            &&
+                min == minor(statbuf.st_dev)            &&
+                ino == statbuf.st_ino)
+            {
+               result = pid;
+            }
+         }
+         fclose(fp);
+      }
+   }
+   return result;
+}
+
+
+/** Locks the open device for a display against access by other processes,
+ *  waiting a bounded time if another process holds the lock.
+ *
+ *  Does nothing if cross process locking is not enabled.
+ *
+ *  \param  id        distinct display identifier
+ *  \param  fd        file descriptor of open I2C or hiddev device
+ *  \param  callopts  if CALLOPT_ERR_MSG set, report a lock held too long
+ *  \retval 0             success
+ *  \retval DDCRC_LOCKED  display locked by another process
+ *  \retval -errno        flock() failed
+ *
+ *  \remark
+ *  The lock is released by #unlock_display_device(), or when **fd** is closed.
+ */
+Status_Errno_DDC lock_display_device(Distinct_Display_Ref id, int fd, Call_Options callopts) {
+   bool debug = false;
+   DBGMSF(debug, "Starting. id=%p, fd=%d", id, fd);
+   Distinct_Display_Desc * ddesc = (Distinct_Display_Desc *) id;
+   assert(memcmp(ddesc->marker, DISTINCT_DISPLAY_DESC_MARKER, 4) == 0);
+
+   Status_Errno_DDC rc = 0;
+   if (cross_process_lock_enabled) {
+      uint64_t start_nanos = 0;
+      uint64_t max_wait_nanos = cross_process_lock_max_wait_millis * (uint64_t)(1000*1000);
+      int sleep_millis_ct = 1;
+      while (flock(fd, LOCK_EX|LOCK_NB) != 0) {
+         if (errno != EWOULDBLOCK) {
+            rc = -errno;
+            DBGMSF(debug, "flock() failed. errno=%d", errno);
+            break;
+         }
+         uint64_t now = cur_realtime_nanosec();
+         if (start_nanos == 0)
+            start_nanos = now;
+         if (now - start_nanos >= max_wait_nanos) {
+            rc = DDCRC_LOCKED;
+            if (callopts & CALLOPT_ERR_MSG)
+               f0printf(ferr(), "Display %s locked by process %d\n",
+                                dpath_repr_t(&ddesc->io_path), flock_holder_pid(fd));
+            break;
+         }
+         // back off, to poll the lock at most every 20 milliseconds
+         sleep_millis(sleep_millis_ct);
+         if (sleep_millis_ct < 20)
+            sleep_millis_ct *= 2;
+      }
+      uint64_t wait_nanos = (start_nanos) ? cur_realtime_nanosec() - start_nanos : 0;
+
+      g_mutex_lock(&descriptors_mutex);
+      if (rc == 0)
+         ddesc->process_lock_ct++;
+      else if (rc == DDCRC_LOCKED)
+         ddesc->process_timeout_ct++;
+      if (wait_nanos > 0) {
+         ddesc->process_wait_ct++;
+         ddesc->process_wait_nanos += wait_nanos;
+         if (wait_nanos > ddesc->process_max_wait_nanos)
+            ddesc->process_max_wait_nanos = wait_nanos;
+      }
+      g_mutex_unlock(&descriptors_mutex);
+   }
+
+   DBGMSF(debug, "Done.  Returning: %s", psc_desc(rc));
+   return rc;
+}
+
+
+/** Releases the lock obtained by #lock_display_device().
+ *
+ *  \param  id      distinct display identifier
+ *  \param  fd      file descriptor of open I2C or hiddev device
+ */
+void unlock_display_device(Distinct_Display_Ref id, int fd) {
+   Distinct_Display_Desc * ddesc = (Distinct_Display_Desc *) id;
+   assert(memcmp(ddesc->marker, DISTINCT_DISPLAY_DESC_MARKER, 4) == 0);
+   if (cross_process_lock_enabled && fd >= 0)
+      flock(fd, LOCK_UN);
+}
+
+
+//
+// Statistics
+//
+
+/** Resets display lock statistics. */
+void ddc_reset_display_lock_stats() {
+   g_mutex_lock(&descriptors_mutex);
+   for (int ndx=0; ndx < display_descriptors->len; ndx++) {
+      Distinct_Display_Desc * cur = g_ptr_array_index(display_descriptors, ndx);
+      cur->lock_ct                = 0;
+      cur->thread_wait_ct         = 0;
+      cur->thread_wait_nanos      = 0;
+      cur->process_lock_ct        = 0;
+      cur->process_wait_ct        = 0;
+      cur->process_wait_nanos     = 0;
+      cur->process_max_wait_nanos = 0;
+      cur->process_timeout_ct     = 0;
+   }
+   g_mutex_unlock(&descriptors_mutex);
+}
+
+
+/** Reports display lock statistics, including the time spent
+ *  waiting for other threads and other processes.
+ *
+ *  \param depth logical indentation depth
+ */
+void ddc_report_display_lock_stats(int depth) {
+   int d1 = depth+1;
+   int d2 = depth+2;
+   rpt_title("Display Lock Stats:", depth);
+   rpt_vstring(d1, "Cross process locking:  %s, maximum wait %d milliseconds",
+                   (cross_process_lock_enabled) ? "enabled" : "disabled",
+                   cross_process_lock_max_wait_millis);
+   g_mutex_lock(&descriptors_mutex);
+   for (int ndx=0; ndx < display_descriptors->len; ndx++) {
+      Distinct_Display_Desc * cur = g_ptr_array_index(display_descriptors, ndx);
+      rpt_vstring(d1, "%s:", dpath_repr_t(&cur->io_path));
+      rpt_vstring(d2, "Locks obtained:                  %5d", cur->lock_ct);
+      rpt_vstring(d2, "Waits for other threads:         %5d, total %7.1f millisec",
+                      cur->thread_wait_ct, cur->thread_wait_nanos / (1000.0*1000));
+      if (cross_process_lock_enabled || cur->process_lock_ct > 0) {
+         rpt_vstring(d2, "Cross process locks obtained:    %5d", cur->process_lock_ct);
+         rpt_vstring(d2, "Waits for other processes:       %5d, total %7.1f millisec, maximum %7.1f millisec",
+                         cur->process_wait_ct,
+                         cur->process_wait_nanos     / (1000.0*1000),
+                         cur->process_max_wait_nanos / (1000.0*1000));
+         rpt_vstring(d2, "Timed out waiting:               %5d", cur->process_timeout_ct);
+      }
+   }
+   if (display_descriptors->len == 0)
+      rpt_vstring(d1, "No displays locked");
+   g_mutex_unlock(&descriptors_mutex);
+}
+
+
 void dbgrpt_distinct_display_descriptors(int depth) {
    rpt_vstring(depth, "display_descriptors@%p", display_descriptors);
    g_mutex_lock(&descriptors_mutex);
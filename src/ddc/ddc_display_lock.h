@@ -28,6 +28,7 @@
 
 #include "base/core.h"
 #include "base/displays.h"
+#include "base/status_code_mgt.h"
 
 typedef enum {
    DDISP_NONE  = 0x00,     ///< No flags set
@@ -44,6 +45,16 @@ bool lock_distinct_display(Distinct_Display_Ref id, Distinct_Display_Flags flags
 
 void unlock_distinct_display(Distinct_Display_Ref id);
 
+bool ddc_enable_cross_process_lock(bool onoff);
+bool ddc_is_cross_process_lock_enabled();
+int  ddc_set_cross_process_lock_max_wait(int millis);
+
+Status_Errno_DDC lock_display_device(Distinct_Display_Ref id, int fd, Call_Options callopts);
+void unlock_display_device(Distinct_Display_Ref id, int fd);
+
+void ddc_reset_display_lock_stats();
+void ddc_report_display_lock_stats(int depth);
+
 void dbgrpt_distinct_display_descriptors(int depth);
 
 #endif /* DDC_DISPLAY_LOCK_H_ */
@@ -20,6 +20,7 @@
 #include "util/error_info.h"
 #include "util/failsim.h"
 #include "util/report_util.h"
+#include "util/string_util.h"
 #include "util/udev_usb_util.h"
 #include "util/udev_util.h"
 /** \endcond */
@@ -48,9 +49,12 @@
 
 #include <dynvcp/dyn_dynamic_features.h>
 
+#include "ddc/ddc_display_cache.h"
 #include "ddc/ddc_packet_io.h"
+#include "ddc/ddc_value_cache.h"
 #include "ddc/ddc_vcp.h"
 #include "ddc/ddc_vcp_version.h"
+#include "ddc/ddc_worker_pool.h"
 
 #include "ddc/ddc_displays.h"
 
@@ -61,6 +65,8 @@ static DDCA_Trace_Group TRACE_GROUP = DDCA_TRC_DDCIO;
 
 static GPtrArray * all_displays = NULL;    // all detected displays
 static int dispno_max = 0;                 // highest assigned display number
+static GMutex      redetect_mutex;         // serializes incremental redetection
+static GPtrArray * retired_display_lists = NULL;   // lists replaced by redetection
 static int async_threshold = DISPLAY_CHECK_ASYNC_THRESHOLD;
 
 
@@ -199,13 +205,11 @@ bool initial_checks_by_dref(Display_Ref * dref) {
 }
 
 
-// function to be run in thread
-void * threaded_initial_checks_by_dref(gpointer data) {
+// function to be run in a worker pool thread
+static void pooled_initial_checks_by_dref(gpointer data) {
    Display_Ref * dref = data;
    assert(memcmp(dref->marker, DISPLAY_REF_MARKER, 4) == 0 );
    initial_checks_by_dref(dref);
-   // g_thread_exit(NULL);
-   return NULL;
 }
 
 
@@ -458,9 +462,10 @@ ddc_report_displays(bool include_invalid_displays, int depth) {
 
    ddc_ensure_displays_detected();
 
+   GPtrArray * displays = all_displays;    // n. may be replaced by redetection
    int display_ct = 0;
-   for (int ndx=0; ndx<all_displays->len; ndx++) {
-      Display_Ref * dref = g_ptr_array_index(all_displays, ndx);
+   for (int ndx=0; ndx<displays->len; ndx++) {
+      Display_Ref * dref = g_ptr_array_index(displays, ndx);
       assert(memcmp(dref->marker, DISPLAY_REF_MARKER, 4) == 0);
       if (dref->dispno > 0 || include_invalid_displays) {
          display_ct++;
@@ -678,32 +683,24 @@ bye:
 }
 
 
-/**
+/** Performs the initial checks on all displays concurrently, using the
+ *  shared worker pool.
+ *
  *  \param all_displays #GPtrArray of pointers to #Display_Ref
  */
 void async_scan(GPtrArray * all_displays) {
    bool debug = false;
    DBGTRC(debug, TRACE_GROUP, "Starting. all_displays=%p, display_count=%d", all_displays, all_displays->len);
 
-   GPtrArray * threads = g_ptr_array_new();
+   DDC_Work_Group * group = ddc_work_group_new();
    for (int ndx = 0; ndx < all_displays->len; ndx++) {
       Display_Ref * dref = g_ptr_array_index(all_displays, ndx);
       assert( memcmp(dref->marker, DISPLAY_REF_MARKER, 4) == 0 );
-
-      GThread * th =
-      g_thread_new(
-            dref_repr_t(dref),
-            threaded_initial_checks_by_dref,
-            dref);
-      g_ptr_array_add(threads, th);
-   }
-   DBGMSF(debug, "Started %d threads", threads->len);
-   for (int ndx = 0; ndx < threads->len; ndx++) {
-      GThread * thread = g_ptr_array_index(threads, ndx);
-      g_thread_join(thread);  // implicitly unrefs the GThread
+      ddc_worker_pool_submit(dref->io_path, pooled_initial_checks_by_dref, dref, group);
    }
-   DBGMSF(debug, "Threads joined");
-   g_ptr_array_free(threads, true);
+   DBGMSF(debug, "Submitted %d display checks", all_displays->len);
+   ddc_work_group_wait_and_free(group);
+   DBGMSF(debug, "Display checks complete");
 
 #ifdef OLD
    for (int ndx = 0; ndx < all_displays->len; ndx++) {
@@ -746,9 +743,10 @@ void non_async_scan(GPtrArray * all_displays) {
 
 static Display_Ref *
 ddc_find_display_ref_by_criteria(Display_Criteria * criteria) {
+   GPtrArray * displays = all_displays;    // n. may be replaced by redetection
    Display_Ref * result = NULL;
-   for (int ndx = 0; ndx < all_displays->len; ndx++) {
-      Display_Ref * drec = g_ptr_array_index(all_displays, ndx);
+   for (int ndx = 0; ndx < displays->len; ndx++) {
+      Display_Ref * drec = g_ptr_array_index(displays, ndx);
       assert(memcmp(drec->marker, DISPLAY_REF_MARKER, 4) == 0);
       if (ddc_check_display_ref(drec, criteria)) {
          result = drec;
@@ -857,6 +855,61 @@ get_display_ref_for_display_identifier(
 }
 
 
+/** Creates a #Display_Ref for an I2C bus that has a monitor, i.e. responds
+ *  at address x50 with an EDID.
+ *
+ *  \param  businfo  bus information
+ *  \return newly allocated #Display_Ref, NULL if no monitor on the bus
+ */
+static Display_Ref *
+create_i2c_display_ref_for_bus(I2C_Bus_Info * businfo) {
+   Display_Ref * dref = NULL;
+   if ( (businfo->flags & I2C_BUS_ADDR_0X50)  && businfo->edid ) {
+      dref = create_bus_display_ref(businfo->busno);
+      dref->dispno = -1;
+      dref->pedid = businfo->edid;    // needed?
+      dref->mmid  = monitor_model_key_new(
+                       dref->pedid->mfg_id,
+                       dref->pedid->model_name,
+                       dref->pedid->product_code);
+
+      // drec->detail.bus_detail = businfo;
+      dref->detail = businfo;
+      dref->flags |= DREF_DDC_IS_MONITOR_CHECKED;
+      dref->flags |= DREF_DDC_IS_MONITOR;
+      // skip initial checks if results saved by a prior invocation
+      ddc_apply_display_cache(dref);
+   }
+   return dref;
+}
+
+
+#ifdef USE_USB
+static Display_Ref *
+create_usb_display_ref_for_monitor(Usb_Monitor_Info * curmon) {
+   assert(memcmp(curmon->marker, USB_MONITOR_INFO_MARKER, 4) == 0);
+   Display_Ref * dref = create_usb_display_ref(
+                             curmon->hiddev_devinfo->busnum,
+                             curmon->hiddev_devinfo->devnum,
+                             curmon->hiddev_device_name);
+   dref->dispno = -1;
+   dref->pedid = curmon->edid;
+   if (dref->pedid)
+      dref->mmid  = monitor_model_key_new(
+                       dref->pedid->mfg_id,
+                       dref->pedid->model_name,
+                       dref->pedid->product_code);
+   else
+      dref->mmid = monitor_model_key_new("UNK", "UNK", 0);
+   // drec->detail.usb_detail = curmon;
+   dref->detail = curmon;
+   dref->flags |= DREF_DDC_IS_MONITOR_CHECKED;
+   dref->flags |= DREF_DDC_IS_MONITOR;
+   return dref;
+}
+#endif
+
+
 /** Detects all connected displays by querying the I2C, ADL, and USB subsystems.
  *
  * \return array of #Display_Ref
@@ -874,21 +927,9 @@ ddc_detect_all_displays() {
    int busndx = 0;
    for (busndx=0; busndx < busct; busndx++) {
       I2C_Bus_Info * businfo = i2c_get_bus_info_by_index(busndx);
-      if ( (businfo->flags & I2C_BUS_ADDR_0X50)  && businfo->edid ) {
-         Display_Ref * dref = create_bus_display_ref(businfo->busno);
-         dref->dispno = -1;
-         dref->pedid = businfo->edid;    // needed?
-         dref->mmid  = monitor_model_key_new(
-                          dref->pedid->mfg_id,
-                          dref->pedid->model_name,
-                          dref->pedid->product_code);
-
-         // drec->detail.bus_detail = businfo;
-         dref->detail = businfo;
-         dref->flags |= DREF_DDC_IS_MONITOR_CHECKED;
-         dref->flags |= DREF_DDC_IS_MONITOR;
+      Display_Ref * dref = create_i2c_display_ref_for_bus(businfo);
+      if (dref)
          g_ptr_array_add(display_list, dref);
-      }
    }
 
   GPtrArray * all_adl_details = adlshim_get_valid_display_details();
@@ -918,24 +959,7 @@ ddc_detect_all_displays() {
    // DBGMSF(debug, "Found %d USB displays", usb_monitors->len);
    for (int ndx=0; ndx<usb_monitors->len; ndx++) {
       Usb_Monitor_Info  * curmon = g_ptr_array_index(usb_monitors,ndx);
-      assert(memcmp(curmon->marker, USB_MONITOR_INFO_MARKER, 4) == 0);
-      Display_Ref * dref = create_usb_display_ref(
-                                curmon->hiddev_devinfo->busnum,
-                                curmon->hiddev_devinfo->devnum,
-                                curmon->hiddev_device_name);
-      dref->dispno = -1;
-      dref->pedid = curmon->edid;
-      if (dref->pedid)
-         dref->mmid  = monitor_model_key_new(
-                          dref->pedid->mfg_id,
-                          dref->pedid->model_name,
-                          dref->pedid->product_code);
-      else
-         dref->mmid = monitor_model_key_new("UNK", "UNK", 0);
-      // drec->detail.usb_detail = curmon;
-      dref->detail = curmon;
-      dref->flags |= DREF_DDC_IS_MONITOR_CHECKED;
-      dref->flags |= DREF_DDC_IS_MONITOR;
+      Display_Ref * dref = create_usb_display_ref_for_monitor(curmon);
       g_ptr_array_add(display_list, dref);
    }
 #endif
@@ -964,6 +988,7 @@ ddc_detect_all_displays() {
       assert( memcmp(dref->marker, DISPLAY_REF_MARKER, 4) == 0 );
       if (dref->flags & DREF_DDC_COMMUNICATION_WORKING) {
          dref->dispno = ++dispno_max;
+         ddc_update_display_cache(dref);
 
          // check_dynamic_features(dref);    // wrong location for hook
 
@@ -973,6 +998,8 @@ ddc_detect_all_displays() {
       }
    }
 
+   ddc_save_display_cache();
+
    // if (debug) {
    //    DBGMSG("Displays detected:");
    //    report_display_recs(display_list, 1);
@@ -982,6 +1009,25 @@ ddc_detect_all_displays() {
 }
 
 
+/** Saves information learned about the detected displays during
+ *  execution, such as adjusted sleep times, in the persistent display cache.
+ *
+ *  Does nothing if displays have not been detected.
+ */
+void
+ddc_save_learned_display_info() {
+   GPtrArray * displays = all_displays;
+   if (displays) {
+      for (int ndx = 0; ndx < displays->len; ndx++) {
+         Display_Ref * dref = g_ptr_array_index(displays, ndx);
+         if (dref->dispno > 0)
+            ddc_update_display_cache(dref);
+      }
+      ddc_save_display_cache();
+   }
+}
+
+
 /** Initializes the master display list.
  *
  *  Does nothing if the list has already been initialized.
@@ -994,3 +1040,211 @@ ddc_ensure_displays_detected() {
    }
 }
 
+
+//
+// Incremental redetection
+//
+
+// Checks a newly created display, unless already checked, assigns its display
+// number if communication works, and updates the display cache.
+static void
+check_redetected_display(Display_Ref * dref) {
+   if (!(dref->flags & DREF_DDC_COMMUNICATION_CHECKED))
+      initial_checks_by_dref(dref);
+   if (dref->flags & DREF_DDC_COMMUNICATION_WORKING)
+      dref->dispno = ++dispno_max;
+   else
+      dref->dispno = -1;
+   ddc_update_display_cache(dref);
+   ddc_save_display_cache();
+}
+
+
+// Replaces the master display list with a copy in which old_dref, if non-NULL,
+// is marked removed and omitted, and new_dref, if non-NULL, is appended.
+//
+// Other threads may be iterating over the list, so it is not modified in
+// place.  Neither the prior list nor the removed Display_Ref is freed, since
+// either may still be referenced, e.g. by a #DDCA_Display_Ref held by a client.
+static void
+replace_display(Display_Ref * old_dref, Display_Ref * new_dref) {
+   GPtrArray * old_displays = all_displays;
+   GPtrArray * new_displays = g_ptr_array_sized_new(old_displays->len + 1);
+   for (int ndx = 0; ndx < old_displays->len; ndx++) {
+      Display_Ref * dref = g_ptr_array_index(old_displays, ndx);
+      if (dref != old_dref)
+         g_ptr_array_add(new_displays, dref);
+   }
+   if (new_dref)
+      g_ptr_array_add(new_displays, new_dref);
+   if (old_dref)
+      old_dref->flags |= DREF_REMOVED;
+   g_atomic_pointer_set(&all_displays, new_displays);
+
+   if (!retired_display_lists)
+      retired_display_lists = g_ptr_array_new();
+   g_ptr_array_add(retired_display_lists, old_displays);
+}
+
+
+/** Re-probes a single I2C bus after a hotplug event, updating the master
+ *  display list to reflect the monitor now connected to the bus, if any.
+ *
+ *  If the same monitor (as determined by its EDID) is still connected,
+ *  the existing #Display_Ref is retained and nothing is reported.
+ *  However, if the bus now responds differently, e.g. slave address x37
+ *  has become active, DDC communication is checked again.  If whether
+ *  communication works has changed, the display is replaced, so that one
+ *  first detected without working DDC communication is reported as added
+ *  once it gets a display number.
+ *
+ *  \param  busno        I2C bus number
+ *  \param  removed_loc  where to return the #Display_Ref of a display that
+ *                       is no longer connected, NULL if none
+ *  \param  added_loc    where to return the #Display_Ref of a newly connected
+ *                       display, NULL if none
+ *
+ *  \remark
+ *  A removed #Display_Ref is flagged #DREF_REMOVED and is not freed.
+ *  Attempts to open it fail with #DDCRC_INVALID_DISPLAY.
+ */
+void
+ddc_redetect_i2c_bus(int busno, Display_Ref ** removed_loc, Display_Ref ** added_loc) {
+   bool debug = false;
+   DBGTRC(debug, TRACE_GROUP, "Starting. busno=%d", busno);
+   ddc_ensure_displays_detected();
+
+   g_mutex_lock(&redetect_mutex);
+   Display_Ref * old_dref = NULL;
+   GPtrArray * displays = all_displays;
+   for (int ndx = 0; ndx < displays->len; ndx++) {
+      Display_Ref * dref = g_ptr_array_index(displays, ndx);
+      if (dref->io_path.io_mode == DDCA_IO_I2C && dref->io_path.path.i2c_busno == busno) {
+         old_dref = dref;
+         break;
+      }
+   }
+
+   Display_Ref * new_dref = NULL;
+   I2C_Bus_Info * prior_businfo = i2c_find_bus_info_by_busno(busno);
+   I2C_Bus_Info * businfo = i2c_redetect_bus(busno);
+   if (businfo && businfo == prior_businfo) {
+      DBGTRC(debug, TRACE_GROUP, "Bus %d unchanged", busno);
+      old_dref = NULL;
+   }
+   else {
+      if (businfo)
+         new_dref = create_i2c_display_ref_for_bus(businfo);
+
+      bool same_monitor = old_dref && new_dref &&
+                          memcmp(old_dref->pedid->bytes, new_dref->pedid->bytes, 128) == 0;
+      if (same_monitor && ((I2C_Bus_Info *) old_dref->detail)->flags != businfo->flags) {
+         // The bus responds differently, so whether DDC works may have changed
+         initial_checks_by_dref(new_dref);
+         same_monitor = (new_dref->flags & DREF_DDC_COMMUNICATION_WORKING) ==
+                        (old_dref->flags & DREF_DDC_COMMUNICATION_WORKING);
+         DBGTRC(debug, TRACE_GROUP, "Bus %d flags changed, DDC communication %s",
+                                    busno, (same_monitor) ? "unchanged" : "changed");
+      }
+
+      if (same_monitor) {
+         // The bus was re-probed with a different result, but the same monitor
+         // is connected.  Point the existing display at the current bus record,
+         // retaining what has been learned about the bus.
+         DBGTRC(debug, TRACE_GROUP, "Same monitor still connected to bus %d", busno);
+         I2C_Bus_Info * old_businfo = old_dref->detail;
+         businfo->combined_write_read = old_businfo->combined_write_read;
+         businfo->combined_failure_ct = old_businfo->combined_failure_ct;
+         old_dref->pedid  = businfo->edid;
+         old_dref->detail = businfo;
+         monitor_model_key_free(new_dref->mmid);
+         new_dref->flags |= DREF_TRANSIENT;    // so that free_display_ref() frees it
+         free_display_ref(new_dref);
+         old_dref = NULL;
+         new_dref = NULL;
+      }
+      else {
+         // values cached for the bus belong to the prior monitor
+         if (old_dref)
+            ddc_discard_value_cache(old_dref);
+         if (new_dref) {
+            ddc_discard_value_cache(new_dref);
+            check_redetected_display(new_dref);
+         }
+         if (old_dref || new_dref)
+            replace_display(old_dref, new_dref);
+      }
+   }
+   g_mutex_unlock(&redetect_mutex);
+
+   *removed_loc = old_dref;
+   *added_loc   = new_dref;
+   DBGTRC(debug, TRACE_GROUP, "Done. busno=%d, removed=%p, added=%p", busno, old_dref, new_dref);
+}
+
+
+#ifdef USE_USB
+/** Re-examines a single hiddev device after a hotplug event, updating the
+ *  master display list to reflect the USB monitor now using the device, if any.
+ *
+ *  If the same monitor (as determined by its EDID) is still using the device,
+ *  the existing #Display_Ref is retained and nothing is reported.
+ *
+ *  \param  hiddev_fn    device name, e.g. /dev/usb/hiddev0
+ *  \param  removed_loc  where to return the #Display_Ref of a display that
+ *                       is no longer connected, NULL if none
+ *  \param  added_loc    where to return the #Display_Ref of a newly connected
+ *                       display, NULL if none
+ */
+void
+ddc_redetect_usb_device(char * hiddev_fn, Display_Ref ** removed_loc, Display_Ref ** added_loc) {
+   bool debug = false;
+   DBGTRC(debug, TRACE_GROUP, "Starting. hiddev_fn=%s", hiddev_fn);
+   ddc_ensure_displays_detected();
+
+   g_mutex_lock(&redetect_mutex);
+   Display_Ref * old_dref = NULL;
+   GPtrArray * displays = all_displays;
+   for (int ndx = 0; ndx < displays->len; ndx++) {
+      Display_Ref * dref = g_ptr_array_index(displays, ndx);
+      if (dref->io_path.io_mode == DDCA_IO_USB && dref->usb_hiddev_name &&
+          streq(dref->usb_hiddev_name, hiddev_fn))
+      {
+         old_dref = dref;
+         break;
+      }
+   }
+
+   Display_Ref * new_dref = NULL;
+   Usb_Monitor_Info * curmon = usb_redetect_hiddev_monitor(hiddev_fn);
+   if (old_dref && curmon && old_dref->pedid && curmon->edid &&
+       memcmp(old_dref->pedid->bytes, curmon->edid->bytes, 128) == 0)
+   {
+      // The same monitor is still using the device, e.g. after a USB reset.
+      // Point the existing display at the current monitor record.
+      DBGTRC(debug, TRACE_GROUP, "Same monitor still using %s", hiddev_fn);
+      old_dref->usb_bus    = curmon->hiddev_devinfo->busnum;
+      old_dref->usb_device = curmon->hiddev_devinfo->devnum;
+      old_dref->pedid      = curmon->edid;
+      old_dref->detail     = curmon;
+      old_dref = NULL;
+   }
+   else {
+      // values cached for the device belong to the prior monitor
+      if (old_dref)
+         ddc_discard_value_cache(old_dref);
+      if (curmon) {
+         new_dref = create_usb_display_ref_for_monitor(curmon);
+         ddc_discard_value_cache(new_dref);
+         check_redetected_display(new_dref);
+      }
+      if (old_dref || new_dref)
+         replace_display(old_dref, new_dref);
+   }
+   g_mutex_unlock(&redetect_mutex);
+
+   *removed_loc = old_dref;
+   *added_loc   = new_dref;
+   DBGTRC(debug, TRACE_GROUP, "Done. removed=%p, added=%p", old_dref, new_dref);
+}
+#endif
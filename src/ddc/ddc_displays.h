@@ -65,4 +65,15 @@ ddc_dbgrpt_display_ref(Display_Ref * drec, int depth);
 void
 ddc_ensure_displays_detected();
 
+void
+ddc_save_learned_display_info();
+
+void
+ddc_redetect_i2c_bus(int busno, Display_Ref ** removed_loc, Display_Ref ** added_loc);
+
+#ifdef USE_USB
+void
+ddc_redetect_usb_device(char * hiddev_fn, Display_Ref ** removed_loc, Display_Ref ** added_loc);
+#endif
+
 #endif /* DDC_DISPLAYS_H_ */
@@ -21,6 +21,7 @@
 #include "util/glib_util.h"
 #include "util/glib_string_util.h"
 #include "util/report_util.h"
+#include "util/string_util.h"
 
 #include "ddcutil_types.h"
 /** \endcond */
@@ -29,6 +30,7 @@
 #include "base/ddc_errno.h"
 #include "base/ddc_packets.h"
 #include "base/displays.h"
+#include "base/feature_metadata.h"
 #include "base/monitor_model_key.h"
 #include "base/parms.h"
 #include "base/status_code_mgt.h"
@@ -42,8 +44,10 @@
 #include "ddc/ddc_output.h"
 #include "ddc/ddc_packet_io.h"
 #include "ddc/ddc_read_capabilities.h"
+#include "ddc/ddc_value_cache.h"
 #include "ddc/ddc_vcp.h"
 #include "ddc/ddc_vcp_version.h"
+#include "ddc/ddc_worker_pool.h"
 
 #include "ddc/ddc_dumpload.h"
 
@@ -321,6 +325,306 @@ create_dumpload_data_from_g_ptr_array(
 #undef ADD_DATA_ERROR
 
 
+//
+// Load statistics
+//
+
+/** Counts of how values of one feature were handled by #ddc_set_multiple() */
+typedef struct {
+   int skipped;      ///< value already in effect, not written
+   int written;      ///< value written
+   int verified;     ///< value written and read back successfully
+} Load_Feature_Counts;
+
+static GMutex              load_stats_mutex;
+static Load_Feature_Counts load_stats[256];
+
+
+static void record_load_counts(Byte feature_code, Load_Feature_Counts * counts) {
+   g_mutex_lock(&load_stats_mutex);
+   load_stats[feature_code].skipped  += counts->skipped;
+   load_stats[feature_code].written  += counts->written;
+   load_stats[feature_code].verified += counts->verified;
+   g_mutex_unlock(&load_stats_mutex);
+}
+
+
+/** Resets the per-feature counts of values skipped, written, and verified by loadvcp. */
+void ddc_reset_load_stats() {
+   g_mutex_lock(&load_stats_mutex);
+   memset(load_stats, 0, sizeof(load_stats));
+   g_mutex_unlock(&load_stats_mutex);
+}
+
+
+/** Reports the per-feature counts of values skipped, written, and verified
+ *  by loadvcp.  Only features that were loaded are listed.
+ *
+ *  \param depth logical indentation depth
+ */
+void ddc_report_load_stats(int depth) {
+   int d1 = depth+1;
+   rpt_title("Loadvcp Stats:", depth);
+   rpt_vstring(d1, "Differential load: %s", bool_repr(ddc_is_differential_load_enabled()));
+   Load_Feature_Counts totals = {0};
+   bool found = false;
+   g_mutex_lock(&load_stats_mutex);
+   for (int code = 0; code < 256; code++) {
+      Load_Feature_Counts * cur = &load_stats[code];
+      if (cur->skipped + cur->written > 0) {
+         if (!found) {
+            rpt_vstring(d1, "Feature  Skipped  Written  Verified");
+            found = true;
+         }
+         rpt_vstring(d1, "  0x%02x    %5d    %5d     %5d",
+                         code, cur->skipped, cur->written, cur->verified);
+         totals.skipped  += cur->skipped;
+         totals.written  += cur->written;
+         totals.verified += cur->verified;
+      }
+   }
+   g_mutex_unlock(&load_stats_mutex);
+   if (found)
+      rpt_vstring(d1, "  Total   %5d    %5d     %5d", totals.skipped, totals.written, totals.verified);
+   else
+      rpt_vstring(d1, "No features loaded");
+}
+
+
+//
+// Load VCP values
+//
+
+static bool differential_load_enabled = false;
+
+/** Controls whether loadvcp first reads the current feature values and
+ *  writes only those that differ from the values being loaded.
+ *
+ *  \param onoff  **true** for enabled, **false** for disabled.
+ *  \return prior setting
+ */
+bool ddc_enable_differential_load(bool onoff) {
+   bool old_value = differential_load_enabled;
+   differential_load_enabled = onoff;
+   return old_value;
+}
+
+
+/** Reports whether differential loading is enabled.
+ *
+ *  \return **true** if loadvcp writes only changed values\n
+ *          **false** if it writes all values
+ */
+bool ddc_is_differential_load_enabled() {
+   return differential_load_enabled;
+}
+
+
+// Writes one value, reporting any error.  Increments counts->written and,
+// if the value was read back successfully, counts->verified.
+static Error_Info *
+set_one_value(
+      Display_Handle*       dh,
+      DDCA_Any_Vcp_Value *  vrec,
+      Load_Feature_Counts * counts)
+{
+   DDCA_Any_Vcp_Value * newval = NULL;
+   Error_Info * ddc_excp = ddc_set_vcp_value(dh, vrec, &newval);
+   counts->written++;
+   if (ddc_excp) {
+      Public_Status_Code psc = ddc_excp->status_code;
+      f0printf(ferr(), "Error setting value for VCP feature code 0x%02x: %s\n",
+                      vrec->opcode, psc_desc(psc) );
+      if (psc == DDCRC_RETRIES)
+         f0printf(ferr(), "    Try errors: %s\n", errinfo_causes_string(ddc_excp));
+      f0printf(ferr(), "Terminating.");
+   }
+   else if (newval) {
+      counts->verified++;
+   }
+   if (newval)
+      free_single_vcp_value(newval);
+   return ddc_excp;
+}
+
+
+// Tests whether a value read from the monitor matches the value being loaded.
+// Unlike the verification check of ddc_set_vcp_value(), both bytes of a
+// non-table value are compared, since that is what ddc_set_vcp_value() writes.
+static bool
+load_value_in_effect(
+      DDCA_Any_Vcp_Value * load_value,
+      DDCA_Any_Vcp_Value * cur_value)
+{
+   if (load_value->value_type != cur_value->value_type)
+      return false;
+   if (load_value->value_type == DDCA_NON_TABLE_VCP_VALUE)
+      return VALREC_CUR_VAL(load_value) == VALREC_CUR_VAL(cur_value);
+   return load_value->val.t.bytect == cur_value->val.t.bytect &&
+          memcmp(load_value->val.t.bytes, cur_value->val.t.bytes, load_value->val.t.bytect) == 0;
+}
+
+
+// Order in which classes of features are written by a differential load.
+// Non-continuous features such as Color Preset (x14) or Display Mode (xdc)
+// can change the values of continuous features, so are written first.
+// Input Source (x60) is written last, since after it is changed the monitor
+// may no longer respond on this connection.
+typedef enum {
+   LOAD_PHASE_NC,
+   LOAD_PHASE_OTHER,
+   LOAD_PHASE_INPUT_SOURCE,
+   LOAD_PHASE_CT
+} Load_Phase;
+
+
+static Load_Phase
+load_phase(
+      Display_Handle *     dh,
+      DDCA_Any_Vcp_Value * vrec)
+{
+   if (vrec->opcode == 0x60)
+      return LOAD_PHASE_INPUT_SOURCE;
+   Load_Phase phase = LOAD_PHASE_OTHER;
+   if (vrec->value_type == DDCA_NON_TABLE_VCP_VALUE) {
+      Display_Feature_Metadata * dfm = dyn_get_feature_metadata_by_dh_dfm(vrec->opcode, dh, false);
+      if (dfm) {
+         if (dfm->feature_flags & DDCA_NC)
+            phase = LOAD_PHASE_NC;
+         dfm_free(dfm);
+      }
+   }
+   return phase;
+}
+
+
+// Reads the current values of the features in vrecs, into curvals[]
+static void
+read_current_values(
+      Display_Handle *       dh,
+      GPtrArray *            vrecs,
+      DDCA_Any_Vcp_Value **  curvals)
+{
+   int ct = vrecs->len;
+   DDCA_Vcp_Feature_Code * codes    = calloc(ct, sizeof(DDCA_Vcp_Feature_Code));
+   DDCA_Vcp_Value_Type *   types    = calloc(ct, sizeof(DDCA_Vcp_Value_Type));
+   DDCA_Status *           statuses = calloc(ct, sizeof(DDCA_Status));
+   for (int ndx = 0; ndx < ct; ndx++) {
+      DDCA_Any_Vcp_Value * vrec = g_ptr_array_index(vrecs, ndx);
+      codes[ndx] = vrec->opcode;
+      types[ndx] = vrec->value_type;
+   }
+   // comparisons must use the values actually in effect
+   bool old_bypass = ddc_bypass_value_cache(true);
+   ddc_get_multiple_vcp_values(dh, ct, codes, types, curvals, statuses);
+   ddc_bypass_value_cache(old_bypass);
+   free(codes);
+   free(types);
+   free(statuses);
+}
+
+
+/** Sets multiple VCP values, writing only those that differ from the
+ *  values currently in effect.
+ *
+ * @param   dh      display handle
+ * @param   vset    values to set
+ * @return  #Ddc_Error reflecting the first error, or NULL if no errors
+ *
+ * The current values of all features are read as a batch, then changed
+ * values are written in the order given by #Load_Phase.  If a phase writes
+ * any value, the values for subsequent phases are reread before being
+ * compared.  Features whose current values cannot be read are written.
+ */
+static Error_Info *
+set_multiple_differential(
+      Display_Handle* dh,
+      Vcp_Value_Set   vset)
+{
+   bool debug = false;
+   DBGMSF(debug, "Starting. dh=%s", dh_repr_t(dh));
+   FILE * verbose_msg_dest = fout();
+   if ( get_output_level() < DDCA_OL_VERBOSE && !debug )
+      verbose_msg_dest = NULL;
+
+   int value_ct = vcp_value_set_size(vset);
+   GPtrArray * phases[LOAD_PHASE_CT];
+   for (int phase = 0; phase < LOAD_PHASE_CT; phase++)
+      phases[phase] = g_ptr_array_new();
+   for (int ndx = 0; ndx < value_ct; ndx++) {
+      DDCA_Any_Vcp_Value * vrec = vcp_value_set_get(vset, ndx);
+      g_ptr_array_add(phases[load_phase(dh, vrec)], vrec);
+   }
+
+   // initial batch read of all current values, in load order
+   GPtrArray * all_vrecs = g_ptr_array_sized_new(value_ct);
+   for (int phase = 0; phase < LOAD_PHASE_CT; phase++) {
+      for (int ndx = 0; ndx < phases[phase]->len; ndx++)
+         g_ptr_array_add(all_vrecs, g_ptr_array_index(phases[phase], ndx));
+   }
+   DDCA_Any_Vcp_Value ** curvals = calloc(value_ct, sizeof(DDCA_Any_Vcp_Value *));
+   read_current_values(dh, all_vrecs, curvals);
+   g_ptr_array_free(all_vrecs, true);
+
+   Error_Info * ddc_excp = NULL;
+   Load_Feature_Counts totals = {0};
+   int base = 0;        // index in curvals of first value of current phase
+   bool reread = false;
+   for (int phase = 0; phase < LOAD_PHASE_CT && !ddc_excp; phase++) {
+      GPtrArray * vrecs = phases[phase];
+      if (vrecs->len == 0)
+         continue;
+      if (reread) {
+         DBGMSF(debug, "Rereading %d values for phase %d", vrecs->len, phase);
+         for (int ndx = 0; ndx < vrecs->len; ndx++) {
+            if (curvals[base+ndx]) {
+               free_single_vcp_value(curvals[base+ndx]);
+               curvals[base+ndx] = NULL;
+            }
+         }
+         read_current_values(dh, vrecs, curvals+base);
+      }
+      int phase_written_ct = 0;
+      for (int ndx = 0; ndx < vrecs->len; ndx++) {
+         DDCA_Any_Vcp_Value * vrec = g_ptr_array_index(vrecs, ndx);
+         DDCA_Any_Vcp_Value * curval = curvals[base+ndx];
+         Load_Feature_Counts counts = {0};
+         if (curval && load_value_in_effect(vrec, curval)) {
+            f0printf(verbose_msg_dest, "Feature 0x%02x already set, skipping\n", vrec->opcode);
+            counts.skipped++;
+         }
+         else {
+            ddc_excp = set_one_value(dh, vrec, &counts);
+            phase_written_ct++;
+         }
+         record_load_counts(vrec->opcode, &counts);
+         totals.skipped  += counts.skipped;
+         totals.written  += counts.written;
+         totals.verified += counts.verified;
+         if (ddc_excp)
+            break;
+      }
+      if (phase_written_ct > 0)
+         reread = true;
+      base += vrecs->len;
+   }
+
+   f0printf(verbose_msg_dest, "Loaded %d features: %d skipped, %d written, %d verified\n",
+                   value_ct, totals.skipped, totals.written, totals.verified);
+
+   for (int ndx = 0; ndx < value_ct; ndx++) {
+      if (curvals[ndx])
+         free_single_vcp_value(curvals[ndx]);
+   }
+   free(curvals);
+   for (int phase = 0; phase < LOAD_PHASE_CT; phase++)
+      g_ptr_array_free(phases[phase], true);
+
+   DBGMSF(debug, "Done. Returning: %s", errinfo_summary(ddc_excp));
+   return ddc_excp;
+}
+
+
 /** Sets multiple VCP values.
  *
  * @param   dh      display handle
@@ -329,13 +633,18 @@ create_dumpload_data_from_g_ptr_array(
  *
  * This function stops applying values on the first error encountered, and
  * returns the value of that error as its status code.
+ *
+ * If differential loading is enabled (see #ddc_enable_differential_load()),
+ * only values that differ from those currently in effect are written.
  */
 Error_Info *
 ddc_set_multiple(
       Display_Handle* dh,
       Vcp_Value_Set   vset)
 {
-   Public_Status_Code psc = 0;
+   if (differential_load_enabled)
+      return set_multiple_differential(dh, vset);
+
    Error_Info *        ddc_excp = NULL;
    int value_ct = vcp_value_set_size(vset);
 
@@ -343,7 +652,6 @@ ddc_set_multiple(
    for (ndx=0; ndx < value_ct; ndx++) {
       DDCA_Any_Vcp_Value * vrec
       = vcp_value_set_get(vset, ndx);
-      Byte   feature_code = vrec->opcode;
 
       // HACK: will this affect intermittent error of silently failing sets?
       // pointless, ddc_it2_write_only) calls call_tuned_sleep() after write
@@ -351,16 +659,11 @@ ddc_set_multiple(
       //    sleep_millis_with_trace(DDC_TIMEOUT_MILLIS_DEFAULT, __func__, "before set_vcp_value()");
       // }
 
-      ddc_excp = ddc_set_vcp_value(dh, vrec, NULL);
-      psc = (ddc_excp) ? ddc_excp->status_code : 0;
-      if (ddc_excp) {
-         f0printf(ferr(), "Error setting value for VCP feature code 0x%02x: %s\n",
-                         feature_code, psc_desc(psc) );
-         if (psc == DDCRC_RETRIES)
-            f0printf(ferr(), "    Try errors: %s\n", errinfo_causes_string(ddc_excp));
-         f0printf(ferr(), "Terminating.");
+      Load_Feature_Counts counts = {0};
+      ddc_excp = set_one_value(dh, vrec, &counts);
+      record_load_counts(vrec->opcode, &counts);
+      if (ddc_excp)
          break;
-      }
 
    } // for loop
 
@@ -368,6 +671,30 @@ ddc_set_multiple(
 }
 
 
+// Uses the identifiers in a #Dumpload_Data to find the display to which it
+// applies.  Issues messages if the identifiers are missing or no display matches.
+static Display_Ref *
+find_dref_for_dumpload_data(Dumpload_Data * pdata) {
+   FILE * errf = ferr();
+   if ( strlen(pdata->mfg_id) + strlen(pdata->model) + strlen(pdata->serial_ascii) == 0) {
+      // Pathological.  Someone's been messing with the VCP file.
+      f0printf(errf, "Monitor manufacturer id, model, and serial number all missing from input.\n");
+      return NULL;
+   }
+   Display_Identifier * did = create_mfg_model_sn_display_identifier(
+                          pdata->mfg_id,
+                          pdata->model,
+                          pdata->serial_ascii);
+   assert(did);
+   Display_Ref * dref = get_display_ref_for_display_identifier(
+                           did, CALLOPT_NONE);
+   free_display_identifier(did);
+   if (!dref)
+      f0printf(errf, "Monitor not connected: %s - %s   \n", pdata->model, pdata->serial_ascii );
+   return dref;
+}
+
+
 /** Applies VCP settings from a #Dumpload_Data struct to
  *  the monitor specified in that data structure.
  *
@@ -419,25 +746,10 @@ loadvcp_by_dumpload_data(
       }
    }
 
-   else if ( strlen(pdata->mfg_id) + strlen(pdata->model) + strlen(pdata->serial_ascii) == 0) {
-      // Pathological.  Someone's been messing with the VCP file.
-      f0printf(errf, "Monitor manufacturer id, model, and serial number all missing from input.\n");
-      psc = DDCRC_INVALID_DISPLAY;
-      goto bye;
-   }
-
    else {
      // no Display_Ref passed as argument, just use the identifiers in the data to pick the display
-      Display_Identifier * did = create_mfg_model_sn_display_identifier(
-                             pdata->mfg_id,
-                             pdata->model,
-                             pdata->serial_ascii);
-      assert(did);
-      Display_Ref * dref = get_display_ref_for_display_identifier(
-                              did, CALLOPT_NONE);
-      free_display_identifier(did);
+      Display_Ref * dref = find_dref_for_dumpload_data(pdata);
       if (!dref) {
-         f0printf(errf, "Monitor not connected: %s - %s   \n", pdata->model, pdata->serial_ascii );
          psc = DDCRC_INVALID_DISPLAY;
          goto bye;
       }
@@ -465,6 +777,154 @@ bye:
 }
 
 
+#define DISPLAY_LOAD_MARKER "DLOD"
+/** Work item for #loadvcp_by_dumpload_data_multiple(), applying all the
+ *  data for one display */
+typedef struct {
+   char               marker[4];
+   Display_Ref *      dref;
+   GPtrArray *        results;          ///< #Loadvcp_Result instances for this display
+   // settings of the calling thread
+   DDCA_Output_Level  output_level;
+   FILE *             fout;
+   FILE *             ferr;
+   bool               verify_setvcp;
+} Display_Load;
+
+
+// function to be run in a worker pool thread
+static void pooled_load_display(gpointer data) {
+   bool debug = false;
+   Display_Load * load = data;
+   ASSERT_MARKER(load, DISPLAY_LOAD_MARKER);
+   DBGMSF(debug, "Starting. dref=%s, %d data sets", dref_repr_t(load->dref), load->results->len);
+
+   // output and verification settings are per thread, and the pool thread
+   // is reused, so restore its prior settings when done
+   FILE * saved_fout = fout();
+   FILE * saved_ferr = ferr();
+   DDCA_Output_Level saved_output_level = set_output_level(load->output_level);
+   set_fout(load->fout);
+   set_ferr(load->ferr);
+   bool saved_verify = ddc_set_verify_setvcp(load->verify_setvcp);
+
+   Display_Handle * dh = NULL;
+   Error_Info * open_excp = NULL;
+   Public_Status_Code psc = ddc_open_display(load->dref, CALLOPT_ERR_MSG, &dh);
+   if (!dh)
+      open_excp = errinfo_new(psc ? psc : DDCRC_INVALID_DISPLAY, __func__);
+
+   bool failed = (open_excp != NULL);
+   for (int ndx = 0; ndx < load->results->len; ndx++) {
+      Loadvcp_Result * result = g_ptr_array_index(load->results, ndx);
+      if (open_excp) {
+         // every data set for the display gets its own copy of the error
+         result->ddc_excp = errinfo_new(open_excp->status_code, __func__);
+      }
+      else if (failed) {
+         result->skipped = true;
+      }
+      else {
+         result->ddc_excp = loadvcp_by_dumpload_data(result->pdata, dh);
+         failed = (result->ddc_excp != NULL);
+      }
+   }
+
+   if (open_excp)
+      errinfo_free(open_excp);
+   if (dh)
+      ddc_close_display(dh);
+   ddc_set_verify_setvcp(saved_verify);
+   set_ferr(saved_ferr);
+   set_fout(saved_fout);
+   set_output_level(saved_output_level);
+   DBGMSF(debug, "Done. failed=%s", bool_repr(failed));
+}
+
+
+/** Applies the VCP settings in multiple #Dumpload_Data instances, each to
+ *  the display specified by the identifiers it contains.
+ *
+ *  The data sets for each display are applied in order, stopping at the
+ *  first error for that display; any later data sets for the display are
+ *  marked as skipped.  Displays on different buses are loaded concurrently,
+ *  using the shared worker pool.
+ *
+ * @param  ct         number of data sets
+ * @param  results    array of **ct** #Loadvcp_Result, with field **pdata** set
+ *                    on entry.  Fields **dref**, **ddc_excp** and **skipped**
+ *                    are set on return.
+ * @return number of data sets successfully applied
+ *
+ * @remark
+ * The caller is responsible for freeing the **ddc_excp** fields.
+ */
+int
+loadvcp_by_dumpload_data_multiple(
+      int               ct,
+      Loadvcp_Result *  results)
+{
+   bool debug = false;
+   DBGMSF(debug, "Starting. ct=%d", ct);
+
+   GPtrArray * loads = g_ptr_array_new();
+   for (int ndx = 0; ndx < ct; ndx++) {
+      Loadvcp_Result * result = &results[ndx];
+      assert(result->pdata);
+      result->ddc_excp = NULL;
+      result->skipped  = false;
+      result->dref = find_dref_for_dumpload_data(result->pdata);
+      if (!result->dref) {
+         result->ddc_excp = errinfo_new(DDCRC_INVALID_DISPLAY, __func__);
+         continue;
+      }
+      Display_Load * load = NULL;
+      for (int lndx = 0; lndx < loads->len; lndx++) {
+         Display_Load * cur = g_ptr_array_index(loads, lndx);
+         if (cur->dref == result->dref) {
+            load = cur;
+            break;
+         }
+      }
+      if (!load) {
+         load = calloc(1, sizeof(Display_Load));
+         memcpy(load->marker, DISPLAY_LOAD_MARKER, 4);
+         load->dref          = result->dref;
+         load->results       = g_ptr_array_new();
+         load->output_level  = get_output_level();
+         load->fout          = fout();
+         load->ferr          = ferr();
+         load->verify_setvcp = ddc_get_verify_setvcp();
+         g_ptr_array_add(loads, load);
+      }
+      g_ptr_array_add(load->results, result);
+   }
+
+   DDC_Work_Group * group = ddc_work_group_new();
+   for (int ndx = 0; ndx < loads->len; ndx++) {
+      Display_Load * load = g_ptr_array_index(loads, ndx);
+      ddc_worker_pool_submit(load->dref->io_path, pooled_load_display, load, group);
+   }
+   ddc_work_group_wait_and_free(group);
+
+   for (int ndx = 0; ndx < loads->len; ndx++) {
+      Display_Load * load = g_ptr_array_index(loads, ndx);
+      g_ptr_array_free(load->results, true);
+      load->marker[3] = 'x';
+      free(load);
+   }
+   g_ptr_array_free(loads, true);
+
+   int ok_ct = 0;
+   for (int ndx = 0; ndx < ct; ndx++) {
+      if (!results[ndx].ddc_excp && !results[ndx].skipped)
+         ok_ct++;
+   }
+   DBGMSF(debug, "Done. Returning %d", ok_ct);
+   return ok_ct;
+}
+
+
 /** Reads the monitor identification and VCP values from a null terminated
  *  string array and applies those values to the selected monitor.
  *
@@ -45,6 +45,18 @@ struct {
 void
 dbgrpt_dumpload_data(Dumpload_Data * data, int depth);
 
+bool
+ddc_enable_differential_load(bool onoff);
+
+bool
+ddc_is_differential_load_enabled();
+
+void
+ddc_reset_load_stats();
+
+void
+ddc_report_load_stats(int depth);
+
 void
 free_dumpload_data(Dumpload_Data * pdata);
 
@@ -56,6 +68,20 @@ loadvcp_by_dumpload_data(
       Dumpload_Data*   pdata,
       Display_Handle * dh);
 
+/** Result of applying one #Dumpload_Data by #loadvcp_by_dumpload_data_multiple() */
+typedef
+struct {
+   Dumpload_Data *  pdata;        ///< data to apply
+   Display_Ref *    dref;         ///< display identified by the data, NULL if not found
+   Error_Info *     ddc_excp;     ///< first error applying the data, NULL if success
+   bool             skipped;      ///< not applied due to an earlier error on the same display
+} Loadvcp_Result;
+
+int
+loadvcp_by_dumpload_data_multiple(
+      int               ct,
+      Loadvcp_Result *  results);
+
 Error_Info *
 loadvcp_by_string(
       char *           catenated,
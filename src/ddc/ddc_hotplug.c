@@ -0,0 +1,636 @@
+/** @file ddc_hotplug.c
+ *
+ *  Watch for displays being connected and disconnected.
+ *
+ *  A thread listens for udev events on the drm, i2c-dev, and usbmisc
+ *  (hiddev) subsystems.  Events typically arrive in bursts, so after the
+ *  first event the thread waits briefly for related events, then performs
+ *  a single incremental redetection pass that re-probes only the I2C buses
+ *  and hiddev devices that may have changed, rather than redetecting all
+ *  displays.
+ *
+ *  DRM events do not reliably identify the connector that changed.  Instead
+ *  the EDID that DRM reports for each connector is compared with the EDID
+ *  of the display currently recorded for the connector's I2C bus, and only
+ *  buses whose state differs are re-probed.  Buses without a DRM connector,
+ *  e.g. those of the proprietary nvidia driver, cannot be checked this way.
+ *  For these, slave address x50 is read briefly, without the retries of a
+ *  full probe, and the manufacturer id, product code, and serial number
+ *  compared with the recorded EDID (see #i2c_verify_bus_edid()).  Only if
+ *  they differ is the bus re-probed.
+ *
+ *  Buses that cannot have a monitor, e.g. SMBus devices, are ignored, as
+ *  in initial detection.
+ *
+ *  Each display found to have been connected or disconnected is reported
+ *  to the functions registered using #ddc_register_display_event_callback().
+ */
+
+// Copyright (C) 2019 Sanford Rockowitz <rockowitz@minsoft.com>
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+/** \cond */
+#include <config.h>
+
+#include <assert.h>
+#include <errno.h>
+#include <glib-2.0/glib.h>
+#include <libudev.h>
+#include <poll.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "util/data_structures.h"
+#include "util/report_util.h"
+#include "util/string_util.h"
+#include "util/sysfs_util.h"
+#include "util/timestamp.h"
+#include "util/udev_i2c_util.h"
+#ifdef USE_USB
+#include "usb_util/hiddev_util.h"
+#endif
+/** \endcond */
+
+#include "base/core.h"
+#include "base/ddc_errno.h"
+#include "base/displays.h"
+#include "base/parms.h"
+
+#include "i2c/i2c_bus_cache.h"
+#include "i2c/i2c_bus_core.h"
+
+#include "ddc/ddc_displays.h"
+
+#include "ddc/ddc_hotplug.h"
+
+
+// Trace class for this file
+static DDCA_Trace_Group TRACE_GROUP = DDCA_TRC_DDC;
+
+typedef struct {
+   DDCA_Display_Event_Callback  func;
+   void *                       data;
+} Display_Event_Callback_Rec;
+
+static GMutex      callbacks_mutex;
+static GArray *    callbacks = NULL;       // Display_Event_Callback_Rec
+
+static GMutex      pass_mutex;             // serializes redetection passes
+
+static GMutex      hotplug_mutex;          // guards all of the following
+static GThread *   hotplug_thread = NULL;
+static int         stop_pipe[2] = {-1, -1};   // written to request thread stop
+static int         udev_event_ct = 0;      // udev events received
+static int         pass_ct = 0;            // redetection passes performed
+static int         bus_probe_ct = 0;       // I2C buses re-probed
+static int         hiddev_probe_ct = 0;    // hiddev devices re-examined
+static int         added_ct = 0;           // displays reported added
+static int         removed_ct = 0;         // displays reported removed
+
+
+//
+// Callbacks
+//
+
+/** Registers a function to be called when a display is connected or disconnected.
+ *
+ *  \param  func   function to call
+ *  \param  data   passed to **func**
+ *  \return **true** if registered, **false** if already registered
+ *
+ *  \remark
+ *  The function is called in the thread performing redetection.
+ */
+bool ddc_register_display_event_callback(DDCA_Display_Event_Callback func, void * data) {
+   assert(func);
+   bool result = true;
+   g_mutex_lock(&callbacks_mutex);
+   if (!callbacks)
+      callbacks = g_array_new(false, false, sizeof(Display_Event_Callback_Rec));
+   for (int ndx = 0; ndx < callbacks->len; ndx++) {
+      Display_Event_Callback_Rec * cur = &g_array_index(callbacks, Display_Event_Callback_Rec, ndx);
+      if (cur->func == func && cur->data == data) {
+         result = false;
+         break;
+      }
+   }
+   if (result) {
+      Display_Event_Callback_Rec rec = {func, data};
+      g_array_append_val(callbacks, rec);
+   }
+   g_mutex_unlock(&callbacks_mutex);
+   return result;
+}
+
+
+/** Unregisters a function registered with #ddc_register_display_event_callback().
+ *
+ *  \param  func   function
+ *  \param  data   data value specified when the function was registered
+ *  \return **true** if unregistered, **false** if not found
+ */
+bool ddc_unregister_display_event_callback(DDCA_Display_Event_Callback func, void * data) {
+   bool result = false;
+   g_mutex_lock(&callbacks_mutex);
+   if (callbacks) {
+      for (int ndx = 0; ndx < callbacks->len; ndx++) {
+         Display_Event_Callback_Rec * cur = &g_array_index(callbacks, Display_Event_Callback_Rec, ndx);
+         if (cur->func == func && cur->data == data) {
+            g_array_remove_index(callbacks, ndx);
+            result = true;
+            break;
+         }
+      }
+   }
+   g_mutex_unlock(&callbacks_mutex);
+   return result;
+}
+
+
+// Calls every registered callback.  The callback list is copied, so that
+// a callback can register or unregister callbacks.
+static void emit_display_event(DDCA_Display_Event_Type event_type, Display_Ref * dref) {
+   bool debug = false;
+   DBGTRC(debug, TRACE_GROUP, "%s %s, dispno=%d",
+          (event_type == DDCA_DISPLAY_ADDED) ? "Added" : "Removed",
+          dref_repr_t(dref), dref->dispno);
+
+   DDCA_Display_Event event;
+   memset(&event, 0, sizeof(event));
+   event.event_type      = event_type;
+   event.dref            = dref;
+   event.io_path         = dref->io_path;
+   event.dispno          = dref->dispno;
+   event.timestamp_nanos = cur_realtime_nanosec();
+
+   g_mutex_lock(&hotplug_mutex);
+   if (event_type == DDCA_DISPLAY_ADDED)
+      added_ct++;
+   else
+      removed_ct++;
+   g_mutex_unlock(&hotplug_mutex);
+
+   GArray * work = NULL;
+   g_mutex_lock(&callbacks_mutex);
+   if (callbacks && callbacks->len > 0) {
+      work = g_array_sized_new(false, false, sizeof(Display_Event_Callback_Rec), callbacks->len);
+      g_array_append_vals(work, callbacks->data, callbacks->len);
+   }
+   g_mutex_unlock(&callbacks_mutex);
+
+   if (work) {
+      for (int ndx = 0; ndx < work->len; ndx++) {
+         Display_Event_Callback_Rec * cur = &g_array_index(work, Display_Event_Callback_Rec, ndx);
+         cur->func(&event, cur->data);
+      }
+      g_array_free(work, true);
+   }
+}
+
+
+// Reports the result of redetecting a single bus or device.
+// Returns the number of events reported.
+static int emit_redetect_result(Display_Ref * removed, Display_Ref * added) {
+   int event_ct = 0;
+   if (removed) {
+      emit_display_event(DDCA_DISPLAY_REMOVED, removed);
+      event_ct++;
+   }
+   if (added) {
+      emit_display_event(DDCA_DISPLAY_ADDED, added);
+      event_ct++;
+   }
+   return event_ct;
+}
+
+
+//
+// Redetection
+//
+
+static void add_unique_int(GArray * values, int value) {
+   for (int ndx = 0; ndx < values->len; ndx++) {
+      if (g_array_index(values, int, ndx) == value)
+         return;
+   }
+   g_array_append_val(values, value);
+}
+
+
+static void add_unique_string(GPtrArray * values, const char * value) {
+   for (int ndx = 0; ndx < values->len; ndx++) {
+      if (streq(g_ptr_array_index(values, ndx), value))
+         return;
+   }
+   g_ptr_array_add(values, g_strdup(value));
+}
+
+
+static Display_Ref * find_display_by_io_path(DDCA_IO_Mode io_mode, int busno, const char * hiddev_fn) {
+   GPtrArray * displays = ddc_get_all_displays();
+   for (int ndx = 0; ndx < displays->len; ndx++) {
+      Display_Ref * dref = g_ptr_array_index(displays, ndx);
+      if (dref->io_path.io_mode != io_mode)
+         continue;
+      if (io_mode == DDCA_IO_I2C && dref->io_path.path.i2c_busno == busno)
+         return dref;
+      if (io_mode == DDCA_IO_USB && dref->usb_hiddev_name && streq(dref->usb_hiddev_name, hiddev_fn))
+         return dref;
+   }
+   return NULL;
+}
+
+
+// Compares the EDID that DRM reports for the connector using an I2C bus
+// with the EDID of the display currently recorded for the bus.
+// Returns true if they differ, i.e. if the bus must be probed to determine
+// its state.  If the bus has no DRM connector, a brief read of slave
+// address x50 is compared with the recorded EDID instead.
+static bool i2c_bus_state_may_differ(int busno) {
+   bool debug = false;
+   char * connector_dir = i2c_find_drm_connector_dir(busno);
+   if (!connector_dir) {
+      I2C_Bus_Info * businfo = i2c_find_bus_info_by_busno(busno);
+      bool result = true;
+      if (businfo && !(businfo->flags & I2C_BUS_ACCESSIBLE))
+         result = false;          // probing would fail again
+      else if (businfo)
+         result = !i2c_verify_bus_edid(busno, (businfo->edid) ? businfo->edid->bytes : NULL);
+      DBGMSF(debug, "busno=%d, no DRM connector, returning %s", busno, sbool(result));
+      return result;
+   }
+
+   GByteArray * edid = read_binary_sysfs_attr(connector_dir, "edid", 256, false);
+   bool connected = (edid && edid->len >= 128);    // no EDID if disconnected
+   Display_Ref * dref = find_display_by_io_path(DDCA_IO_I2C, busno, NULL);
+   bool result;
+   if (dref)
+      result = !connected || memcmp(edid->data, dref->pedid->bytes, 128) != 0;
+   else
+      result = connected;
+   if (edid)
+      g_byte_array_free(edid, true);
+   DBGMSF(debug, "busno=%d, connector_dir=%s, connected=%s, dref=%s, returning %s",
+                 busno, connector_dir, sbool(connected), dref_repr_t(dref), sbool(result));
+   free(connector_dir);
+   return result;
+}
+
+
+// Adds to busnos the buses that have been added or removed since the
+// last detection, and the buses whose DRM connector state differs
+// from the recorded display.
+static void collect_changed_i2c_buses(GArray * busnos) {
+   Byte_Value_Array current_busnos = get_i2c_device_numbers_using_udev(false);
+   GPtrArray * buses = i2c_buses;    // n. may be replaced by redetection
+   for (int ndx = 0; ndx < buses->len; ndx++) {
+      I2C_Bus_Info * businfo = g_ptr_array_index(buses, ndx);
+      if (!bva_contains(current_busnos, businfo->busno))
+         add_unique_int(busnos, businfo->busno);     // removed
+   }
+   for (int ndx = 0; ndx < bva_length(current_busnos); ndx++) {
+      int busno = bva_get(current_busnos, ndx);
+      if (!i2c_find_bus_info_by_busno(busno) || i2c_bus_state_may_differ(busno))
+         add_unique_int(busnos, busno);
+   }
+   bva_free(current_busnos);
+}
+
+
+#ifdef USE_USB
+// Adds to hiddev_names the hiddev devices that do not correspond to a
+// detected USB display, and the devices of USB displays that no longer exist.
+static void collect_changed_hiddev_devices(GPtrArray * hiddev_names) {
+   GPtrArray * current_names = get_hiddev_device_names();
+   for (int ndx = 0; ndx < current_names->len; ndx++) {
+      char * hiddev_fn = g_ptr_array_index(current_names, ndx);
+      if (!find_display_by_io_path(DDCA_IO_USB, -1, hiddev_fn))
+         add_unique_string(hiddev_names, hiddev_fn);
+   }
+   GPtrArray * displays = ddc_get_all_displays();
+   for (int ndx = 0; ndx < displays->len; ndx++) {
+      Display_Ref * dref = g_ptr_array_index(displays, ndx);
+      if (dref->io_path.io_mode == DDCA_IO_USB && dref->usb_hiddev_name &&
+          access(dref->usb_hiddev_name, F_OK) != 0)
+      {
+         add_unique_string(hiddev_names, dref->usb_hiddev_name);
+      }
+   }
+   g_ptr_array_set_free_func(current_names, free);
+   g_ptr_array_free(current_names, true);
+}
+#endif
+
+
+// Performs a single redetection pass.
+//
+// Arguments:
+//   busnos        I2C buses to re-probe, may be NULL
+//   hiddev_names  hiddev devices to re-examine, may be NULL
+//   check_all     if true, also determine which buses and devices
+//                 may have changed
+//
+// Returns the number of display events reported.
+static int redetect_pass(GArray * busnos, GPtrArray * hiddev_names, bool check_all) {
+   bool debug = false;
+   DBGTRC(debug, TRACE_GROUP, "Starting. check_all=%s", sbool(check_all));
+   ddc_ensure_displays_detected();
+
+   g_mutex_lock(&pass_mutex);
+   GArray * work_busnos = g_array_new(false, false, sizeof(int));
+   if (busnos) {
+      for (int ndx = 0; ndx < busnos->len; ndx++)
+         add_unique_int(work_busnos, g_array_index(busnos, int, ndx));
+   }
+   if (check_all)
+      collect_changed_i2c_buses(work_busnos);
+
+   int event_ct = 0;
+   for (int ndx = 0; ndx < work_busnos->len; ndx++) {
+      Display_Ref * removed = NULL;
+      Display_Ref * added   = NULL;
+      ddc_redetect_i2c_bus(g_array_index(work_busnos, int, ndx), &removed, &added);
+      event_ct += emit_redetect_result(removed, added);
+   }
+
+   int hiddev_ct = 0;
+#ifdef USE_USB
+   GPtrArray * work_names = g_ptr_array_new_with_free_func(g_free);
+   if (hiddev_names) {
+      for (int ndx = 0; ndx < hiddev_names->len; ndx++)
+         add_unique_string(work_names, g_ptr_array_index(hiddev_names, ndx));
+   }
+   if (check_all)
+      collect_changed_hiddev_devices(work_names);
+   for (int ndx = 0; ndx < work_names->len; ndx++) {
+      Display_Ref * removed = NULL;
+      Display_Ref * added   = NULL;
+      ddc_redetect_usb_device(g_ptr_array_index(work_names, ndx), &removed, &added);
+      event_ct += emit_redetect_result(removed, added);
+   }
+   hiddev_ct = work_names->len;
+   g_ptr_array_free(work_names, true);
+#endif
+
+   g_mutex_lock(&hotplug_mutex);
+   pass_ct++;
+   bus_probe_ct += work_busnos->len;
+   hiddev_probe_ct += hiddev_ct;
+   g_mutex_unlock(&hotplug_mutex);
+
+   g_array_free(work_busnos, true);
+   g_mutex_unlock(&pass_mutex);
+
+   DBGTRC(debug, TRACE_GROUP, "Done. Returning %d", event_ct);
+   return event_ct;
+}
+
+
+/** Checks for displays that have been connected or disconnected since
+ *  they were last detected, reporting each change to the functions registered
+ *  using #ddc_register_display_event_callback().
+ *
+ *  Only the I2C buses and hiddev devices whose state may have changed are
+ *  re-probed.
+ *
+ *  \return number of display events reported
+ */
+int ddc_redetect_displays() {
+   return redetect_pass(NULL, NULL, true);
+}
+
+
+//
+// udev monitor thread
+//
+
+// Changes accumulated while waiting for a burst of events to settle
+typedef struct {
+   bool        drm_changed;
+   GArray *    busnos;           // int, I2C buses added or removed
+   GPtrArray * hiddev_names;     // hiddev devices added or removed
+} Pending_Changes;
+
+
+static void note_udev_event(struct udev_device * dev, Pending_Changes * pending) {
+   bool debug = false;
+   const char * subsystem = udev_device_get_subsystem(dev);
+   const char * sysname   = udev_device_get_sysname(dev);
+   const char * devnode   = udev_device_get_devnode(dev);
+   DBGTRC(debug, TRACE_GROUP, "action=%s, subsystem=%s, sysname=%s, devnode=%s",
+          udev_device_get_action(dev), subsystem, sysname, devnode);
+
+   g_mutex_lock(&hotplug_mutex);
+   udev_event_ct++;
+   g_mutex_unlock(&hotplug_mutex);
+
+   if (!subsystem || !sysname)
+      return;
+   if (streq(subsystem, "drm")) {
+      pending->drm_changed = true;
+   }
+   else if (streq(subsystem, "i2c-dev")) {
+      int busno;
+      // n. a bus being removed has no sysfs name, and so is not ignorable
+      if (sscanf(sysname, "i2c-%d", &busno) == 1 && !is_ignorable_i2c_device(busno))
+         add_unique_int(pending->busnos, busno);
+   }
+   else if (streq(subsystem, "usbmisc")) {
+      if (devnode && str_starts_with(sysname, "hiddev"))
+         add_unique_string(pending->hiddev_names, devnode);
+   }
+}
+
+
+static gpointer hotplug_thread_func(gpointer data) {
+   bool debug = false;
+   struct udev_monitor * mon = data;
+   DBGTRC(debug, TRACE_GROUP, "Starting.");
+
+   Pending_Changes pending;
+   pending.drm_changed  = false;
+   pending.busnos       = g_array_new(false, false, sizeof(int));
+   pending.hiddev_names = g_ptr_array_new_with_free_func(g_free);
+   gint64 settle_time = 0;      // when pending changes are processed, 0 if none
+
+   int mon_fd = udev_monitor_get_fd(mon);
+   while (true) {
+      int timeout = -1;
+      if (settle_time)
+         timeout = MAX(0, (settle_time - g_get_monotonic_time()) / G_TIME_SPAN_MILLISECOND);
+      struct pollfd pfds[2] = { {mon_fd, POLLIN, 0}, {stop_pipe[0], POLLIN, 0} };
+      int rc = poll(pfds, 2, timeout);
+      if (rc < 0 && errno != EINTR)
+         break;
+      if (rc > 0 && pfds[1].revents)
+         break;        // stop requested
+
+      if (rc > 0 && (pfds[0].revents & POLLIN)) {
+         struct udev_device * dev = udev_monitor_receive_device(mon);
+         if (dev) {
+            note_udev_event(dev, &pending);
+            udev_device_unref(dev);
+            if (!settle_time)
+               settle_time = g_get_monotonic_time() +
+                             DISPLAY_HOTPLUG_SETTLE_MILLIS * G_TIME_SPAN_MILLISECOND;
+         }
+      }
+
+      if (settle_time && g_get_monotonic_time() >= settle_time) {
+         redetect_pass(pending.busnos, pending.hiddev_names, pending.drm_changed);
+         pending.drm_changed = false;
+         g_array_set_size(pending.busnos, 0);
+         g_ptr_array_set_size(pending.hiddev_names, 0);
+         settle_time = 0;
+      }
+   }
+
+   g_array_free(pending.busnos, true);
+   g_ptr_array_free(pending.hiddev_names, true);
+   udev_monitor_unref(mon);
+   DBGTRC(debug, TRACE_GROUP, "Done.");
+   return NULL;
+}
+
+
+//
+// Start and stop
+//
+
+/** Starts watching for displays being connected or disconnected.  Each
+ *  change is reported to the functions registered using
+ *  #ddc_register_display_event_callback().
+ *
+ *  \retval 0                        success
+ *  \retval DDCRC_INVALID_OPERATION  already watching
+ *  \retval -errno                   unable to create udev monitor
+ *
+ *  \remark
+ *  The watch runs until #ddc_stop_hotplug_watch() is called.
+ */
+Public_Status_Code ddc_start_hotplug_watch() {
+   bool debug = false;
+   DBGTRC(debug, TRACE_GROUP, "Starting.");
+   ddc_ensure_displays_detected();
+
+   Public_Status_Code psc = 0;
+   struct udev * udev = NULL;
+   g_mutex_lock(&hotplug_mutex);
+   if (hotplug_thread) {
+      psc = DDCRC_INVALID_OPERATION;
+      goto bye;
+   }
+
+   errno = 0;
+   udev = udev_new();
+   struct udev_monitor * mon = (udev) ? udev_monitor_new_from_netlink(udev, "udev") : NULL;
+   if (!mon) {
+      psc = (errno) ? -errno : DDCRC_OTHER;
+      goto bye;
+   }
+   udev_monitor_filter_add_match_subsystem_devtype(mon, "drm", NULL);
+   udev_monitor_filter_add_match_subsystem_devtype(mon, "i2c-dev", NULL);
+#ifdef USE_USB
+   udev_monitor_filter_add_match_subsystem_devtype(mon, "usbmisc", NULL);
+#endif
+   if (udev_monitor_enable_receiving(mon) < 0 || pipe(stop_pipe) < 0) {
+      psc = -errno;
+      udev_monitor_unref(mon);
+      goto bye;
+   }
+   udev_unref(udev);     // n. the monitor holds a reference
+   udev = NULL;
+
+   hotplug_thread = g_thread_new("ddc_hotplug", hotplug_thread_func, mon);
+
+bye:
+   g_mutex_unlock(&hotplug_mutex);
+   if (udev)
+      udev_unref(udev);
+   DBGTRC(debug, TRACE_GROUP, "Done. Returning %s", psc_desc(psc));
+   return psc;
+}
+
+
+/** Stops watching for displays being connected or disconnected, waiting
+ *  for the watch thread to terminate.  Does nothing if no watch is active.
+ *
+ *  \remark
+ *  Must not be called from a callback function.
+ */
+void ddc_stop_hotplug_watch() {
+   bool debug = false;
+   DBGTRC(debug, TRACE_GROUP, "Starting.");
+
+   g_mutex_lock(&hotplug_mutex);
+   GThread * stopping = hotplug_thread;
+   if (stopping) {
+      char c = 0;
+      if (write(stop_pipe[1], &c, 1) < 0)
+         DBGTRC(debug, TRACE_GROUP, "write() to stop pipe failed, errno=%d", errno);
+   }
+   g_mutex_unlock(&hotplug_mutex);
+
+   if (stopping) {
+      g_thread_join(stopping);     // n. thread owns the udev monitor
+      g_mutex_lock(&hotplug_mutex);
+      close(stop_pipe[0]);
+      close(stop_pipe[1]);
+      stop_pipe[0] = stop_pipe[1] = -1;
+      hotplug_thread = NULL;
+      g_mutex_unlock(&hotplug_mutex);
+   }
+
+   DBGTRC(debug, TRACE_GROUP, "Done.");
+}
+
+
+/** Reports whether displays are being watched for connection changes.
+ *
+ *  \return **true** if watching
+ */
+bool ddc_is_hotplug_watching() {
+   g_mutex_lock(&hotplug_mutex);
+   bool result = (hotplug_thread != NULL);
+   g_mutex_unlock(&hotplug_mutex);
+   return result;
+}
+
+
+//
+// Statistics
+//
+
+/** Resets display hotplug statistics. */
+void ddc_reset_hotplug_stats() {
+   g_mutex_lock(&hotplug_mutex);
+   udev_event_ct   = 0;
+   pass_ct         = 0;
+   bus_probe_ct    = 0;
+   hiddev_probe_ct = 0;
+   added_ct        = 0;
+   removed_ct      = 0;
+   g_mutex_unlock(&hotplug_mutex);
+}
+
+
+/** Reports display hotplug statistics.
+ *
+ *  \param depth logical indentation depth
+ */
+void ddc_report_hotplug_stats(int depth) {
+   int d1 = depth+1;
+   rpt_title("Display Hotplug Stats:", depth);
+   g_mutex_lock(&hotplug_mutex);
+   rpt_vstring(d1, "Watching for hotplug events:   %s", sbool(hotplug_thread != NULL));
+   rpt_vstring(d1, "udev events received:          %d", udev_event_ct);
+   rpt_vstring(d1, "Redetection passes:            %d", pass_ct);
+   rpt_vstring(d1, "I2C buses re-probed:           %d", bus_probe_ct);
+   rpt_vstring(d1, "hiddev devices re-examined:    %d", hiddev_probe_ct);
+   rpt_vstring(d1, "Displays added:                %d", added_ct);
+   rpt_vstring(d1, "Displays removed:              %d", removed_ct);
+   g_mutex_unlock(&hotplug_mutex);
+}
@@ -0,0 +1,32 @@
+/** @file ddc_hotplug.h
+ *
+ *  Watch for displays being connected and disconnected.
+ */
+
+// Copyright (C) 2019 Sanford Rockowitz <rockowitz@minsoft.com>
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+#ifndef DDC_HOTPLUG_H_
+#define DDC_HOTPLUG_H_
+
+/** \cond */
+#include <stdbool.h>
+/** \endcond */
+
+#include "public/ddcutil_types.h"
+
+#include "base/status_code_mgt.h"
+
+bool ddc_register_display_event_callback(DDCA_Display_Event_Callback func, void * data);
+bool ddc_unregister_display_event_callback(DDCA_Display_Event_Callback func, void * data);
+
+int                ddc_redetect_displays();
+
+Public_Status_Code ddc_start_hotplug_watch();
+void               ddc_stop_hotplug_watch();
+bool               ddc_is_hotplug_watching();
+
+void ddc_reset_hotplug_stats();
+void ddc_report_hotplug_stats(int depth);
+
+#endif /* DDC_HOTPLUG_H_ */
@@ -69,6 +69,7 @@ static int max_multi_part_read_tries = MAX_MULTI_EXCHANGE_TRIES;
 static int max_multi_part_write_tries = MAX_MULTI_EXCHANGE_TRIES;
 
 static void * multi_part_read_stats_rec = NULL;
+static void * multi_part_read_fragment_stats_rec = NULL;
 static void * multi_part_write_stats_rec = NULL;
 
 /** Resets the statistics for multi-part reads */
@@ -77,6 +78,11 @@ void ddc_reset_multi_part_read_stats() {
       try_data_reset(multi_part_read_stats_rec);
    else
       multi_part_read_stats_rec = try_data_create("multi-part read exchange", max_multi_part_read_tries);
+   if (multi_part_read_fragment_stats_rec)
+      try_data_reset(multi_part_read_fragment_stats_rec);
+   else
+      multi_part_read_fragment_stats_rec =
+            try_data_create("multi-part read fragment", max_multi_part_read_tries);
 }
 
 
@@ -93,6 +99,8 @@ void ddc_reset_multi_part_write_stats() {
 void ddc_report_multi_part_read_stats(int depth) {
    assert(multi_part_read_stats_rec);
    try_data_report(multi_part_read_stats_rec, depth);
+   assert(multi_part_read_fragment_stats_rec);
+   try_data_report(multi_part_read_fragment_stats_rec, depth);
 }
 
 
@@ -111,6 +119,8 @@ void ddc_set_max_multi_part_read_tries(int ct) {
    max_multi_part_read_tries = ct;
    if (multi_part_read_stats_rec)
          try_data_set_max_tries(multi_part_read_stats_rec, ct);
+   if (multi_part_read_fragment_stats_rec)
+         try_data_set_max_tries(multi_part_read_fragment_stats_rec, ct);
 }
 
 /** Resets the maximum number of multi-part write exchange tries allowed.
@@ -140,14 +150,22 @@ int ddc_get_max_multi_part_write_tries() {
 }
 
 
-/** Makes one attempt to read the entire capabilities string or table feature value
+/** Makes one attempt to read the remainder of the capabilities string or
+*  table feature value.
+*
+*  Reading starts at the offset following the fragments already in the
+*  accumulator, so that after a failure the caller can resume with the
+*  fragment that failed instead of starting over.
 *
 * @param  dh             display handle for open i2c or adl device
 * @param  request_type   DDC_PACKET_TYPE_CAPABILITIES_REQUEST or DDC_PACKET_TYPE_TABLE_REQD_REQUEST
 * @param  request_subtype  VCP feature code for table read, ignore for capabilities
 * @param  all_zero_response_ok  if true, an all zero response is not regarded
 *         as an error
-* @param  accumulator    buffer in which to return result
+* @param  accumulator    buffer containing validated fragments, to which
+*                        subsequent fragments are appended
+* @param  fragment_tryct_loc  on entry, number of failed attempts to read the
+*                        fragment at the current offset; updated on return
 *
 * @return status code
 */
@@ -157,12 +175,14 @@ try_multi_part_read(
       Byte             request_type,
       Byte             request_subtype,
       bool             all_zero_response_ok,
-      Buffer *         accumulator)
+      Buffer *         accumulator,
+      int *            fragment_tryct_loc)
 {
    bool debug = false;
    DBGTRC(debug, TRACE_GROUP,
-          "Starting. request_type=0x%02x, request_subtype=x%02x, all_zero_response_ok=%s, accumulator=%p",
-          request_type, request_subtype, bool_repr(all_zero_response_ok), accumulator);
+          "Starting. request_type=0x%02x, request_subtype=x%02x, all_zero_response_ok=%s, accumulator=%p"
+          ", accumulator->len=%d",
+          request_type, request_subtype, bool_repr(all_zero_response_ok), accumulator, accumulator->len);
 
    const int MAX_FRAGMENT_SIZE = 32;
    const int readbuf_size = 6 + MAX_FRAGMENT_SIZE + 1;
@@ -172,10 +192,11 @@ try_multi_part_read(
 
    DDC_Packet * request_packet_ptr  = NULL;
    DDC_Packet * response_packet_ptr = NULL;
+   int  cur_offset = accumulator->len;
    request_packet_ptr = create_ddc_multi_part_read_request_packet(
-                           request_type, request_subtype, 0, "try_multi_part_read");
-   buffer_set_length(accumulator,0);
-   int  cur_offset = 0;
+                           request_type, request_subtype, cur_offset, "try_multi_part_read");
+   if (cur_offset > 0)
+      all_zero_response_ok = false;       // accept all zero response only on first fragment
    bool complete   = false;
    while (!complete && !excp) {         // loop over fragments
       DBGTRC(debug, DDCA_TRC_NONE, "Top of fragment loop", NULL);
@@ -205,6 +226,7 @@ try_multi_part_read(
       // if (psc != 0) {
          if (response_packet_ptr)
             free_ddc_packet(response_packet_ptr);
+         (*fragment_tryct_loc)++;
          continue;
       }
       assert(response_packet_ptr);
@@ -225,12 +247,15 @@ try_multi_part_read(
          psc = DDCRC_MULTI_PART_READ_FRAGMENT;
          excp = errinfo_new(psc, __func__);
          COUNT_STATUS_CODE(psc);
+         (*fragment_tryct_loc)++;
       }
       else {
          DBGTRC(debug, DDCA_TRC_NONE, "display_current_offset = %d matches cur_offset", display_current_offset);
 
          fragment_size = aux_data_ptr->fragment_length;         // ***
          DBGTRC(debug, DDCA_TRC_NONE, "fragment_size = %d", fragment_size);
+         try_data_record_tries(multi_part_read_fragment_stats_rec, 0, *fragment_tryct_loc + 1);
+         *fragment_tryct_loc = 0;
          if (fragment_size == 0) {
             complete = true;   // redundant
          }
@@ -267,6 +292,10 @@ try_multi_part_read(
 *  @retval  NULL    success
 *  @retval  #Ddc_Error containing status DDCRC_UNSUPPORTED does not support Capabilities Request
 *  @retval  #Ddc_Error containing status DDCRC_TRIES  maximum retries exceeded:
+*
+*  @remark
+*  A retry resumes at the fragment that failed.  The number of tries needed
+*  for each fragment is recorded in the "multi-part read fragment" statistics.
 */
 Error_Info *
 multi_part_read_with_retry(
@@ -289,22 +318,34 @@ multi_part_read_with_retry(
 
    int tryctr = 0;
    bool can_retry = true;
+   int  fragment_tryct = 0;     // failed attempts to read fragment at current offset
    Buffer * accumulator = buffer_new(2048, "multi part read buffer");
 
    while (tryctr < max_multi_part_read_tries && rc < 0 && can_retry) {
       DBGTRC(debug, DDCA_TRC_NONE,
-             "Start of while loop. try_ctr=%d, max_multi_part_read_tries=%d",
-             tryctr, max_multi_part_read_tries);
+             "Start of while loop. try_ctr=%d, max_multi_part_read_tries=%d, resume offset=%d",
+             tryctr, max_multi_part_read_tries, accumulator->len);
 
+      // Fragments validated by prior tries are retained in the accumulator,
+      // and try_multi_part_read() resumes with the fragment that failed.
       ddc_excp = try_multi_part_read(
               dh,
               request_type,
               request_subtype,
               all_zero_response_ok,
-              accumulator);
+              accumulator,
+              &fragment_tryct);
       try_errors[tryctr] = ddc_excp;
       rc = (ddc_excp) ? ddc_excp->status_code : 0;
 
+      if (rc == DDCRC_MULTI_PART_READ_FRAGMENT) {
+         // The monitor returned a fragment for an unexpected offset.
+         // Its notion of the read position cannot be trusted, so start over.
+         DBGTRC(debug, DDCA_TRC_NONE, "Fragment offset mismatch, restarting at offset 0");
+         buffer_set_length(accumulator, 0);
+         fragment_tryct = 0;
+      }
+
       if (rc == DDCRC_NULL_RESPONSE) {
          // generally means this, but could conceivably indicate a protocol error.
          // try multiple times to ensure it's really unsupported?
@@ -361,6 +402,8 @@ multi_part_read_with_retry(
 
    // if counts for DDCRC_ALL_TRIES_ZERO?
    try_data_record_tries(multi_part_read_stats_rec, rc, tryctr);
+   if (rc < 0)
+      try_data_record_tries(multi_part_read_fragment_stats_rec, rc, fragment_tryct);
 
    *pp_buffer = accumulator;
    DBGTRC(debug, TRACE_GROUP, "Returning: %s", errinfo_summary(ddc_excp));
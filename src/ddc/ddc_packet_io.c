@@ -24,14 +24,18 @@
 #include <unistd.h>
 
 #include "util/debug_util.h"
+#include "util/report_util.h"
 #include "util/string_util.h"
 #include "util/utilrpt.h"
 /** \endcond */
 
 #include "base/ddc_errno.h"
 #include "base/displays.h"
+#include "base/dynamic_sleep.h"
 #include "base/execution_stats.h"
+#include "base/latency_stats.h"
 #include "base/parms.h"
+#include "base/stat_counters.h"
 #include "base/status_code_mgt.h"
 
 #include "i2c/i2c_bus_core.h"
@@ -90,7 +94,9 @@ bool is_ddc_null_message(Byte * packet) {
  *  \param  callopts        call option flags
  *  \param  pdh             address at which to return display handle
  *  \return status code     as from #i2c_open_bus(), #usb_open_hiddev_device()
- *  \retval DDCRC_LOCKED    display open in another thread
+ *  \retval DDCRC_LOCKED    display open in another thread, or
+ *                          in another process if cross process locking is enabled
+ *  \retval DDCRC_INVALID_DISPLAY  display has been disconnected
  *
  *  **Call_Option** flags recognized:
  *  - CALLOPT_WAIT
@@ -107,6 +113,7 @@ DDCA_Status ddc_open_display(
 
    Display_Handle * dh = NULL;
    DDCA_Status psc = 0;
+   event_ring_set_display(&dref->io_path);
 
    Distinct_Display_Ref display_id = get_distinct_display_ref(dref);
    Distinct_Display_Flags ddisp_flags = DDISP_NONE;
@@ -124,6 +131,11 @@ DDCA_Status ddc_open_display(
       goto bye;
    }
 
+   if (dref->flags & DREF_REMOVED) {    // disconnected, see ddc_redetect_i2c_bus()
+      psc = DDCRC_INVALID_DISPLAY;
+      goto bye;
+   }
+
    switch (dref->io_path.io_mode) {
 
    case DDCA_IO_I2C:
@@ -134,6 +146,12 @@ DDCA_Status ddc_open_display(
             goto bye;
          }
 
+         psc = lock_display_device(display_id, fd, callopts);
+         if (psc != 0) {
+            close(fd);
+            goto bye;
+         }
+
          DBGMSF(debug, "Calling set_addr(0x37) for %s", dref_repr_t(dref));
          Status_Errno base_rc =  i2c_set_addr(fd, 0x37, callopts);
          if (base_rc != 0) {
@@ -189,6 +207,11 @@ DDCA_Status ddc_open_display(
             psc = fd;
             goto bye;
          }
+         psc = lock_display_device(display_id, fd, callopts);
+         if (psc != 0) {
+            close(fd);
+            goto bye;
+         }
          dh = create_usb_display_handle_from_display_ref(fd, dref);
          dref->pedid = usb_get_parsed_edid_by_display_handle(dh);
       }
@@ -235,7 +258,14 @@ ddc_close_display(Display_Handle * dh) {
       DBGMSG0("Starting.");
       dbgrpt_display_handle(dh, __func__, 1);
    }
+   // A post-read sleep may still be pending.  Complete it while the display
+   // is locked, so that the next user does not write to it too soon.
+   complete_deferred_sleep_dh(dh);
+
    Status_Errno rc = 0;
+   Distinct_Display_Ref display_id = get_distinct_display_ref(dh->dref);
+   if (dh->dref->io_path.io_mode != DDCA_IO_ADL)
+      unlock_display_device(display_id, dh->fh);
 
    switch(dh->dref->io_path.io_mode) {
    case DDCA_IO_I2C:
@@ -270,10 +300,10 @@ ddc_close_display(Display_Handle * dh) {
    } //switch
 
    dh->dref->flags &= (~DREF_OPEN);
-   Distinct_Display_Ref display_id = get_distinct_display_ref(dh->dref);
    unlock_distinct_display(display_id);
 
    free_display_handle(dh);
+   event_ring_set_display(NULL);
    return rc;
 }
 
@@ -364,6 +394,122 @@ DDCA_Status (*Write_Read_Raw_Function)(
 // Write and read operations that take DDC_Packets
 //
 
+//
+// Single transaction write/read
+//
+
+// Counted in per-thread stat counters, since exchanges run in worker pool threads
+
+void ddc_reset_combined_write_read_stats() {
+   stat_counters_reset(SC_COMBINED_WRITE_READ_CT,
+                       SC_COMBINED_UNSUPPORTED_BUS_CT+1 - SC_COMBINED_WRITE_READ_CT);
+}
+
+
+void ddc_report_combined_write_read_stats(int depth) {
+   int d1 = depth+1;
+   rpt_title("Single Transaction Write/Read Stats:", depth);
+   rpt_vstring(d1, "Strategy active:                  %s", bool_repr(i2c_io_strategy_has_write_reader()));
+   rpt_vstring(d1, "Attempted:                        %5" PRIu64, stat_counter_get(SC_COMBINED_WRITE_READ_CT));
+   rpt_vstring(d1, "Succeeded:                        %5" PRIu64, stat_counter_get(SC_COMBINED_WRITE_READ_OK_CT));
+   rpt_vstring(d1, "Retried as separate write, read:  %5" PRIu64, stat_counter_get(SC_COMBINED_FALLBACK_CT));
+   rpt_vstring(d1, "Buses reverted to write, read:    %5" PRIu64, stat_counter_get(SC_COMBINED_UNSUPPORTED_BUS_CT));
+}
+
+
+static I2C_Bus_Info * get_bus_info_dh(Display_Handle * dh) {
+   I2C_Bus_Info * businfo = dh->dref->detail;
+   if (!businfo)
+      businfo = i2c_find_bus_info_by_busno(dh->dref->io_path.path.i2c_busno);
+   if (businfo)
+      ASSERT_MARKER(businfo, I2C_BUS_INFO_MARKER);
+   return businfo;
+}
+
+
+// Tests for a DDC Null Message response.  Unlike is_ddc_null_message(),
+// readbuf does not contain the destination address byte.
+static bool is_raw_ddc_null_response(Byte * readbuf, int bytect) {
+   return (bytect >= 3      &&
+           readbuf[0] == 0x6e &&
+           readbuf[1] == 0x80 &&
+           readbuf[2] == 0xbe);
+}
+
+
+/* Attempts a DDC write/read exchange as a single I2C transaction.
+ *
+ * Arguments:
+ *   dh               display handle for open I2C bus
+ *   businfo          bus information, may be NULL
+ *   request_packet_ptr   DDC packet to write
+ *   max_read_bytes   number of bytes to read
+ *   readbuf          where to return response
+ *   fallback_loc     set true if the caller should repeat the exchange
+ *                    using a separate write and read
+ *
+ * Returns:
+ *   0 if success
+ *   -errno if error
+ *   DDCRC_READ_ALL_ZERO
+ *
+ * Until the exchange has succeeded on a bus, any failure, including a
+ * DDC Null Message response, is treated as possibly caused by the monitor
+ * not handling the repeated start condition.  The caller is told to
+ * fall back, and after I2C_COMBINED_WRITE_READ_MAX_FAILURES such failures
+ * the bus is permanently reverted to separate writes and reads.
+ */
+static Status_Errno_DDC ddc_i2c_combined_write_read_raw(
+         Display_Handle * dh,
+         I2C_Bus_Info *   businfo,
+         DDC_Packet *     request_packet_ptr,
+         int              max_read_bytes,
+         Byte *           readbuf,
+         bool *           fallback_loc)
+{
+   bool debug = false;
+   *fallback_loc = false;
+   stat_counter_add(SC_COMBINED_WRITE_READ_CT, 1);
+
+   Status_Errno_DDC rc =
+         invoke_i2c_write_reader(
+                           dh->fh,
+                           get_packet_len(request_packet_ptr)-1,
+                           get_packet_start(request_packet_ptr)+1,
+                           max_read_bytes,
+                           readbuf);
+   // the monitor still needs time to recover before the next request
+   call_tuned_sleep_dh(dh, SE_POST_READ);
+   if (rc == 0 && all_bytes_zero(readbuf, max_read_bytes)) {
+      DDCMSG(debug, "All zero response detected in %s", __func__);
+      rc = DDCRC_READ_ALL_ZERO;
+   }
+
+   bool untested = !businfo || businfo->combined_write_read == I2C_COMBINED_WRITE_READ_UNTESTED;
+   if (rc == 0 && !(untested && is_raw_ddc_null_response(readbuf, max_read_bytes))) {
+      stat_counter_add(SC_COMBINED_WRITE_READ_OK_CT, 1);
+      if (businfo && untested) {
+         businfo->combined_write_read = I2C_COMBINED_WRITE_READ_OK;
+         DBGTRC(debug, TRACE_GROUP, "Single transaction write/read works on bus %d", businfo->busno);
+      }
+   }
+   else if (untested) {
+      stat_counter_add(SC_COMBINED_FALLBACK_CT, 1);
+      *fallback_loc = true;
+      if (businfo && ++businfo->combined_failure_ct >= I2C_COMBINED_WRITE_READ_MAX_FAILURES) {
+         businfo->combined_write_read = I2C_COMBINED_WRITE_READ_UNSUPPORTED;
+         stat_counter_add(SC_COMBINED_UNSUPPORTED_BUS_CT, 1);
+         DBGTRC(debug, TRACE_GROUP,
+                "Single transaction write/read fails on bus %d, using separate write and read",
+                businfo->busno);
+      }
+   }
+
+   DBGTRC(debug, TRACE_GROUP, "Done. fallback=%s, psc=%s", bool_repr(*fallback_loc), psc_desc(rc));
+   return rc;
+}
+
+
 /* Writes a DDC request packet to an open I2C bus
  * and returns the raw response.
  *
@@ -402,6 +548,23 @@ static DDCA_Status ddc_i2c_write_read_raw(
    bool single_byte_reads = false;   // doesn't work
 #endif
 
+   complete_deferred_sleep_dh(dh);
+   if (i2c_io_strategy_has_write_reader()) {
+      I2C_Bus_Info * businfo = get_bus_info_dh(dh);
+      if (!businfo || businfo->combined_write_read != I2C_COMBINED_WRITE_READ_UNSUPPORTED) {
+         bool fallback = false;
+         Status_Errno_DDC rc = ddc_i2c_combined_write_read_raw(
+               dh, businfo, request_packet_ptr, max_read_bytes, readbuf, &fallback);
+         if (!fallback) {
+            if (rc < 0) {
+               COUNT_STATUS_CODE(rc);
+            }
+            DBGTRC(debug, TRACE_GROUP, "Done. psc=%s", psc_desc(rc));
+            return rc;
+         }
+      }
+   }
+
    Status_Errno_DDC rc =
          invoke_i2c_writer(
                            dh->fh,
@@ -409,7 +572,7 @@ static DDCA_Status ddc_i2c_write_read_raw(
                            get_packet_start(request_packet_ptr)+1 );
    DBGMSF(debug, "invoke_i2c_writer() returned %d\n", rc);
    if (rc == 0) {
-      call_tuned_sleep_i2c(SE_WRITE_TO_READ);
+      call_tuned_sleep_dh(dh, SE_WRITE_TO_READ);
 
       // ALTERNATIVE_THAT_DIDNT_WORK:
       // if (single_byte_reads)  // fails
@@ -418,7 +581,7 @@ static DDCA_Status ddc_i2c_write_read_raw(
 
       rc = invoke_i2c_reader(dh->fh, max_read_bytes, readbuf);
       // try adding sleep to see if improves capabilities read for P2411H
-      call_tuned_sleep_i2c(SE_POST_READ);
+      call_tuned_sleep_dh(dh, SE_POST_READ);
 
       if (rc == 0 && all_bytes_zero(readbuf, max_read_bytes)) {
          DDCMSG(debug, "All zero response detected in %s", __func__);
@@ -562,12 +725,34 @@ static DDCA_Status ddc_write_read_raw(
 }
 
 
+// Returns the number of bytes to read over I2C for a response of the given type.
+// A getvcp response has a fixed length.  Capabilities and table read fragments
+// vary in length, so the maximum DDC packet is read.  Reading fewer bytes than
+// the monitor sends is harmless, the master simply ends the transfer.
+static int i2c_response_read_size(Byte expected_response_type, int max_read_bytes) {
+   int result = max_read_bytes;
+   switch(expected_response_type) {
+   case DDC_PACKET_TYPE_QUERY_VCP_RESPONSE:
+      result = 3 + 8;                    // source addr, length, 8 data bytes, checksum
+      break;
+   case DDC_PACKET_TYPE_CAPABILITIES_RESPONSE:
+   case DDC_PACKET_TYPE_TABLE_READ_RESPONSE:
+      result = 3 + MAX_DDC_DATA_SIZE;
+      break;
+   default:
+      break;
+   }
+   return (result < max_read_bytes) ? result : max_read_bytes;
+}
+
+
 /** Writes a DDC request packet to a monitor and provides basic response parsing
  *  based whether the response type is continuous, non-continuous, or table.
  *
  *  \param dh                  display handle (for either I2C or ADL device)
  *  \param request_packet_ptr  DDC packet to write
- *  \param max_read_bytes      maximum number of bytes to read
+ *  \param max_read_bytes      maximum number of bytes to read,
+ *                             at most #DH_READBUF_SIZE
  *  \param expected_response_type expected response type to check for
  *  \param expected_subtype    expected subtype to check for
  *  \param response_packet_ptr_loc  where to write address of response packet received
@@ -589,18 +774,25 @@ ddc_write_read(
    bool debug = false;
    DBGTRC(debug, TRACE_GROUP, "Starting. dh=%s", dh_repr_t(dh) );
 
-   Byte * readbuf = calloc(1, max_read_bytes);
-   int    bytes_received = max_read_bytes;
+   assert(max_read_bytes <= DH_READBUF_SIZE);
+   // n. the response packet is copied out of readbuf, so it can be reused
+   Byte * readbuf = dh->readbuf;
+   memset(readbuf, 0, DH_READBUF_SIZE);
+   int    read_bytes = max_read_bytes;
+   if (dh->dref->io_path.io_mode == DDCA_IO_I2C)
+      read_bytes = i2c_response_read_size(expected_response_type, max_read_bytes);
+   int    bytes_received = read_bytes;
    DDCA_Status    psc;
    *response_packet_ptr_loc = NULL;
 
    psc =  ddc_write_read_raw(
             dh,
             request_packet_ptr,
-            max_read_bytes,
+            read_bytes,
             readbuf,
             &bytes_received
      );
+   log_io_read_size(read_bytes, max_read_bytes);
    if (psc >= 0) {
        // readbuf[0] = 0x6e;
        // hex_dump(readbuf, bytes_received+1);
@@ -621,8 +813,6 @@ ddc_write_read(
        }
    }
 
-   free(readbuf);    // or does response_packet_ptr_loc point into here?
-
    // already done:
    // if (rc != 0)
    //    COUNT_STATUS_CODE(rc);
@@ -643,6 +833,26 @@ ddc_write_read(
 }
 
 
+// Returns the VCP feature code of a request packet, or -1 if the request
+// is not for a specific feature, e.g. a capabilities request.
+static int request_feature_code(DDC_Packet * request_packet_ptr) {
+   int result = -1;
+   if (get_data_len(request_packet_ptr) >= 2) {
+      switch(get_data_start(request_packet_ptr)[0]) {
+      case DDC_PACKET_TYPE_QUERY_VCP_REQUEST:
+      case DDC_PACKET_TYPE_SET_VCP_REQUEST:
+      case DDC_PACKET_TYPE_TABLE_READ_REQUEST:
+      case DDC_PACKET_TYPE_TABLE_WRITE_REQUEST:
+         result = get_data_start(request_packet_ptr)[1];
+         break;
+      default:
+         break;
+      }
+   }
+   return result;
+}
+
+
 /** Wraps #ddc_write_read() in retry logic.
  *
  *  \param dh                  display handle (for either I2C or ADL device)
@@ -683,6 +893,7 @@ ddc_write_read_with_retry(
    // show_backtrace(1);
 
    bool retry_null_response = !(dh->dref->flags & DREF_DDC_USES_NULL_RESPONSE_FOR_UNSUPPORTED);
+   latency_set_context(&dh->dref->io_path, request_feature_code(request_packet_ptr));
 
    DDCA_Status  psc;
    int  tryctr;
@@ -782,6 +993,14 @@ ddc_write_read_with_retry(
       }
    }
 
+   if (dh->dref->dsd) {
+      // Null and all zero responses are symptoms of insufficient sleep time,
+      // unless the monitor uses them to report an unsupported feature
+      int backoff_failure_ct = ( (retry_null_response)   ? ddcrc_null_response_ct : 0 ) +
+                               ( (all_zero_response_ok)  ? 0 : ddcrc_read_all_zero_ct );
+      dsd_record_exchange(dh->dref->dsd, psc == 0, tryctr, backoff_failure_ct);
+   }
+
    Error_Info * ddc_excp = NULL;
 
    if (psc < 0) {
@@ -808,6 +1027,7 @@ ddc_write_read_with_retry(
    }
 
    try_data_record_tries(write_read_stats_rec, psc, tryctr);
+   latency_clear_context();
 
    DBGTRC(debug, TRACE_GROUP, "Done.  Returning: %s", errinfo_summary(ddc_excp));
    return ddc_excp;
@@ -868,6 +1088,7 @@ ddc_write_only(
    DDCA_Status psc = 0;
    assert(dh->dref->io_path.io_mode != DDCA_IO_USB);
    if (dh->dref->io_path.io_mode == DDCA_IO_I2C) {
+      complete_deferred_sleep_dh(dh);
       psc = ddc_i2c_write_only(dh->fh, request_packet_ptr);
    }
    else {
@@ -917,6 +1138,8 @@ ddc_write_only_with_retry(
    bool               retryable;
    Error_Info *       try_errors[MAX_MAX_TRIES];
 
+   latency_set_context(&dh->dref->io_path, request_feature_code(request_packet_ptr));
+
    assert(max_write_only_exchange_tries > 0);
    for (tryctr=0, psc=-999, retryable=true;
        tryctr < max_write_only_exchange_tries && psc < 0 && retryable;
@@ -982,6 +1205,7 @@ ddc_write_only_with_retry(
    }
 
    try_data_record_tries(write_only_stats_rec, psc, tryctr);
+   latency_clear_context();
 
    DBGTRC(debug, TRACE_GROUP, "Done.  Returning: %s", errinfo_summary(ddc_excp));
    return ddc_excp;
@@ -39,6 +39,8 @@ void ddc_reset_write_only_stats();
 void ddc_report_write_only_stats(int depth);
 void ddc_reset_write_read_stats();
 void ddc_report_write_read_stats(int depth);
+void ddc_reset_combined_write_read_stats();
+void ddc_report_combined_write_read_stats(int depth);
 
 Error_Info * ddc_write_only(
       Display_Handle * dh,
@@ -47,6 +47,7 @@
 #include "usb/usb_displays.h"
 #endif
 
+#include "ddc/ddc_capabilities_cache.h"
 #include "ddc/ddc_multi_part_io.h"
 #include "ddc/ddc_packet_io.h"
 
@@ -111,6 +112,8 @@ get_capabilities_buffer(
 /* Gets the capabilities string for a display.
  *
  * The value is cached as this is an expensive operation.
+ * For DDC displays, it is also saved in the persistent
+ * capabilities cache for use by subsequent invocations.
  *
  * Arguments:
  *   dh       display handle
@@ -142,13 +145,20 @@ get_capabilities_string(
 #endif
       }
       else {
-         Buffer * pcaps_buffer;
-         ddc_excp = get_capabilities_buffer(dh, &pcaps_buffer);
-         // psc = (ddc_excp) ? ddc_excp->psc : 0;
-         psc = ERRINFO_STATUS(ddc_excp);
-         if (psc == 0) {
-            dh->dref->capabilities_string = strdup((char *) pcaps_buffer->bytes);
-            buffer_free(pcaps_buffer,__func__);
+         Parsed_Edid * pedid = dh->dref->pedid;
+         if (pedid)
+            dh->dref->capabilities_string = ddc_get_cached_capabilities(pedid->bytes);
+         if (!dh->dref->capabilities_string) {
+            Buffer * pcaps_buffer;
+            ddc_excp = get_capabilities_buffer(dh, &pcaps_buffer);
+            // psc = (ddc_excp) ? ddc_excp->psc : 0;
+            psc = ERRINFO_STATUS(ddc_excp);
+            if (psc == 0) {
+               dh->dref->capabilities_string = strdup((char *) pcaps_buffer->bytes);
+               buffer_free(pcaps_buffer,__func__);
+               if (pedid)
+                  ddc_set_cached_capabilities(pedid->bytes, dh->dref->capabilities_string);
+            }
          }
       }
    }
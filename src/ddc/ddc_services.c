@@ -16,19 +16,29 @@
 #include "base/base_init.h"
 #include "base/parms.h"
 #include "base/sleep.h"
+#include "base/execution_stats.h"
+#include "base/stats_export.h"
 #include "base/feature_metadata.h"
 
 #include "vcp/vcp_feature_codes.h"
 
 #include "dynvcp/dyn_feature_codes.h"
 
+#include "i2c/i2c_bus_cache.h"
 #include "i2c/i2c_do_io.h"
 
 #include "adl/adl_shim.h"
 
+#include "ddc/ddc_capabilities_cache.h"
 #include "ddc/ddc_display_lock.h"
+#include "ddc/ddc_dumpload.h"
+#include "ddc/ddc_hotplug.h"
 #include "ddc/ddc_multi_part_io.h"
 #include "ddc/ddc_packet_io.h"
+#include "ddc/ddc_try_stats.h"
+#include "ddc/ddc_value_cache.h"
+#include "ddc/ddc_watch.h"
+#include "ddc/ddc_worker_pool.h"
 
 #include "ddc/ddc_services.h"
 
@@ -64,6 +74,15 @@ void ddc_report_ddc_stats(int depth) {
 void ddc_reset_stats_main() {
    ddc_reset_ddc_stats();
    reset_execution_stats();
+   ddc_reset_capabilities_cache_stats();
+   i2c_reset_bus_cache_stats();
+   ddc_reset_worker_pool_stats();
+   ddc_reset_combined_write_read_stats();
+   ddc_reset_load_stats();
+   ddc_reset_watch_stats();
+   ddc_reset_hotplug_stats();
+   ddc_reset_display_lock_stats();
+   ddc_reset_value_cache_stats();
 }
 
 
@@ -86,7 +105,25 @@ void ddc_report_stats_main(DDCA_Stats_Type stats, int depth) {
       rpt_nl();
       report_io_call_stats(depth);
       rpt_nl();
+      ddc_report_combined_write_read_stats(depth);
+      rpt_nl();
       report_sleep_stats(depth);
+      rpt_nl();
+      ddc_report_capabilities_cache_stats(depth);
+      rpt_nl();
+      i2c_report_bus_cache_stats(depth);
+      rpt_nl();
+      ddc_report_worker_pool_stats(depth);
+      rpt_nl();
+      ddc_report_load_stats(depth);
+      rpt_nl();
+      ddc_report_watch_stats(depth);
+      rpt_nl();
+      ddc_report_hotplug_stats(depth);
+      rpt_nl();
+      ddc_report_display_lock_stats(depth);
+      rpt_nl();
+      ddc_report_value_cache_stats(depth);
    }
    if (stats & (DDCA_STATS_ELAPSED | DDCA_STATS_CALLS)) {
       rpt_nl();
@@ -95,6 +132,49 @@ void ddc_report_stats_main(DDCA_Stats_Type stats, int depth) {
 }
 
 
+/** Exports statistics as text, JSON, or Prometheus metrics.
+ *
+ * \param stats   bitflags indicating which statistics to export
+ * \param format  output format
+ * \param reset   if true, reset the exported statistics
+ * \return newly allocated string, caller must free
+ *
+ * \remark
+ * For JSON and Prometheus output, IO event, sleep, retry, status code and
+ * elapsed time statistics are exported.  When resetting, each value is read
+ * and reset in one atomic operation, so events that occur while exporting
+ * are counted in either this export or the next one.
+ * \remark
+ * Text output is the report of #ddc_report_stats_main().  When resetting,
+ * all statistics are reset after the report has been generated.
+ */
+char * ddc_export_stats_main(DDCA_Stats_Type stats, DDCA_Stats_Format format, bool reset) {
+   char * result = NULL;
+   if (format == DDCA_STATS_FORMAT_TEXT) {
+      char * bufstart = NULL;
+      size_t bufsize  = 0;
+      FILE * saved_fout = fout();
+      FILE * memfile = open_memstream(&bufstart, &bufsize);
+      set_fout(memfile);
+      ddc_report_stats_main(stats, 0);
+      set_fout(saved_fout);
+      fclose(memfile);
+      result = bufstart;
+      if (reset)
+         ddc_reset_stats_main();
+   }
+   else {
+      Stats_Export * exp = stats_export_new();
+      if (stats & DDCA_STATS_TRIES)
+         try_data_export_all(exp, reset);
+      export_execution_stats(exp, stats, reset);
+      result = stats_export_render(exp, format);
+      stats_export_free(exp);
+   }
+   return result;
+}
+
+
 /** Reports the current max try settings.
  *
  *  \param depth logical indentation depth
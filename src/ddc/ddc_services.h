@@ -9,6 +9,7 @@
 #ifndef DDC_SERVICES_H_
 #define DDC_SERVICES_H_
 
+#include <stdbool.h>
 #include <stdio.h>
 
 void init_ddc_services();
@@ -17,6 +18,7 @@ void ddc_reset_ddc_stats();
 void ddc_reset_stats_main();
 
 void ddc_report_stats_main(DDCA_Stats_Type stats, int depth);
+char * ddc_export_stats_main(DDCA_Stats_Type stats, DDCA_Stats_Format format, bool reset);
 void ddc_report_max_tries(int depth);
 
 #endif /* DDC_SERVICES_H_ */
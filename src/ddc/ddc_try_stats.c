@@ -36,6 +36,7 @@
 #include "base/core.h"
 #include "base/ddc_errno.h"
 #include "base/parms.h"
+#include "base/stats_export.h"
 
 #include "ddc/ddc_try_stats.h"
 
@@ -46,6 +47,7 @@ static char * TAG_VALUE = "STAT";
 
 static GMutex try_data_mutex;
 static bool debug_mutex = false;
+static GPtrArray * all_try_data = NULL;    // every Try_Data created, for export
 
 typedef
 struct {
@@ -79,6 +81,11 @@ void * try_data_create(char * stat_name, int max_tries) {
    memcpy(try_data->tag, TAG_VALUE,4);
    strcpy(try_data->stat_name, stat_name);
    try_data->max_tries = max_tries;
+   g_mutex_lock(&try_data_mutex);
+   if (!all_try_data)
+      all_try_data = g_ptr_array_new();
+   g_ptr_array_add(all_try_data, try_data);
+   g_mutex_unlock(&try_data_mutex);
    // DBGMSG("try_data->counters[MAX_MAX_TRIES+1]=%d, MAX_MAX_TRIES=%d", try_data->counters[MAX_MAX_TRIES+1], MAX_MAX_TRIES);
    return try_data;
 }
@@ -116,7 +123,7 @@ void try_data_reset(void * stats_rec) {
    Try_Data * try_data = unopaque(stats_rec);
 
    g_mutex_lock(&try_data_mutex);
-   for (int ndx=0; ndx < MAX_MAX_TRIES+1; ndx++)
+   for (int ndx=0; ndx < MAX_MAX_TRIES+2; ndx++)
       try_data->counters[ndx] = 0;
    g_mutex_unlock(&try_data_mutex);
 
@@ -228,3 +235,45 @@ void try_data_report(void * stats_rec, int depth) {
       rpt_vstring(d1, "Total attempts:                   %3d", try_data_get_total_attempts(stats_rec));
    }
 }
+
+
+/** Adds the statistics of every statistics record to an export.
+ *
+ *  \param exp    where to add statistics
+ *  \param reset  if true, reset the statistics while holding the lock
+ *                under which they are read, so no try is lost or counted twice
+ */
+void try_data_export_all(Stats_Export * exp, bool reset) {
+   bool debug = false || debug_mutex;
+   DBGMSF(debug, "Starting. reset=%d", reset);
+
+   stats_export_family(exp, "ddcutil_tries_total", STATS_COUNTER, false,
+                            "Operations by outcome, and for successful operations by number of tries required");
+   stats_export_family(exp, "ddcutil_max_tries", STATS_GAUGE, false,
+                            "Maximum tries allowed");
+   g_mutex_lock(&try_data_mutex);
+   for (int rndx = 0; all_try_data && rndx < all_try_data->len; rndx++) {
+      Try_Data * try_data = g_ptr_array_index(all_try_data, rndx);
+      int counters[MAX_MAX_TRIES+2];
+      memcpy(counters, try_data->counters, sizeof(counters));
+      if (reset)
+         memset(try_data->counters, 0, sizeof(try_data->counters));
+      int max_tries = try_data->max_tries;
+
+      for (int ndx=2; ndx <= max_tries+1; ndx++) {
+         char triesbuf[10];
+         snprintf(triesbuf, sizeof(triesbuf), "%d", ndx-1);
+         stats_export_add(exp, "ddcutil_tries_total", counters[ndx],
+                          "operation", try_data->stat_name, "outcome", "success", "tries", triesbuf, NULL);
+      }
+      stats_export_add(exp, "ddcutil_tries_total", counters[1],
+                       "operation", try_data->stat_name, "outcome", "max_tries_exceeded", NULL);
+      stats_export_add(exp, "ddcutil_tries_total", counters[0],
+                       "operation", try_data->stat_name, "outcome", "fatal_error", NULL);
+      stats_export_add(exp, "ddcutil_max_tries", max_tries,
+                       "operation", try_data->stat_name, NULL);
+   }
+   g_mutex_unlock(&try_data_mutex);
+
+   DBGMSF0(debug, "Done");
+}
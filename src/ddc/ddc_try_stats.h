@@ -24,6 +24,10 @@
 #ifndef TRY_STATS_H_
 #define TRY_STATS_H_
 
+#include <stdbool.h>
+
+#include "base/stats_export.h"
+
 #define MAX_STAT_NAME_LENGTH  31
 
 // Returns an opaque pointer to a Try_Data data structure
@@ -41,4 +45,6 @@ int  try_data_get_max_tries(void * stats_rec);
 
 void try_data_set_max_tries(void* stats_rec,int new_max_tries);
 
+void try_data_export_all(Stats_Export * exp, bool reset);
+
 #endif /* TRY_STATS_H_ */
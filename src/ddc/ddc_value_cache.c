@@ -0,0 +1,409 @@
+/** @file ddc_value_cache.c
+ *
+ *  Time bounded cache of non-table VCP feature values, for clients that
+ *  repeatedly read the same features, e.g. to position a brightness slider.
+ *
+ *  How long a value is retained depends on the feature's volatility class,
+ *  determined from its metadata:
+ *  - Features that describe the monitor itself, e.g. xC8 (display controller)
+ *    and xDF (VCP version), are retained for the life of the process.
+ *  - Continuous controls are retained for #VALUE_CACHE_CONTINUOUS_MILLIS,
+ *    since they can be changed using the monitor's buttons.
+ *  - Other read/write features are retained for #VALUE_CACHE_NC_MILLIS.
+ *  - x02 (new control value), x03 (soft controls), x52 (active control),
+ *    read-only features such as frequency measurements, and features without
+ *    metadata are never cached.
+ *
+ *  Writing any feature discards the cached non-static values for the display,
+ *  since setting one feature, e.g. color preset, can change others.
+ *
+ *  The cache is disabled by default.  It can be bypassed on the current
+ *  thread, in which case values are read from the monitor and the cache is
+ *  updated with the value read.
+ */
+
+// Copyright (C) 2019 Sanford Rockowitz <rockowitz@minsoft.com>
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+/** \cond */
+#include <assert.h>
+#include <glib-2.0/glib.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "util/report_util.h"
+#include "util/timestamp.h"
+/** \endcond */
+
+#include "base/core.h"
+#include "base/displays.h"
+#include "base/parms.h"
+
+#include "dynvcp/dyn_feature_codes.h"
+
+#include "ddc/ddc_value_cache.h"
+
+
+// Trace class for this file
+static DDCA_Trace_Group TRACE_GROUP = DDCA_TRC_DDC;
+
+typedef struct {
+   Vcp_Volatility  volatility;
+   bool            valid;
+   uint64_t        read_nanos;
+   Byte            mh;
+   Byte            ml;
+   Byte            sh;
+   Byte            sl;
+} Cached_Value;
+
+#define DISPLAY_VALUE_CACHE_MARKER "DVCH"
+typedef struct {
+   char            marker[4];
+   DDCA_IO_Path    dpath;
+   Cached_Value    values[256];
+} Display_Value_Cache;
+
+typedef struct {
+   int   hit_ct;
+   int   miss_ct;          // includes expired
+   int   expired_ct;
+   int   bypass_ct;
+} Value_Cache_Stats;
+
+static bool        value_cache_enabled = DEFAULT_VALUE_CACHE;
+static GMutex      value_cache_mutex;            // guards all of the following
+static GPtrArray * display_value_caches = NULL;  // only a handful of displays, never freed
+static Value_Cache_Stats  stats[VCP_VOLATILITY_CT];
+static int         invalidation_ct = 0;
+
+
+/** Returns the name of a #Vcp_Volatility value.
+ *
+ *  \param  volatility  volatility class
+ *  \return name
+ */
+char * vcp_volatility_name(Vcp_Volatility volatility) {
+   char * result = NULL;
+   switch(volatility) {
+   case VCP_VOLATILITY_UNCLASSIFIED:  result = "Unclassified";  break;
+   case VCP_VOLATILITY_VOLATILE:      result = "Volatile";      break;
+   case VCP_VOLATILITY_CONTINUOUS:    result = "Continuous";    break;
+   case VCP_VOLATILITY_NC:            result = "Non-continuous"; break;
+   case VCP_VOLATILITY_STATIC:        result = "Static";        break;
+   }
+   return result;
+}
+
+
+//
+// Settings
+//
+
+typedef struct {
+   bool   bypass;
+} Thread_Value_Cache_Settings;
+
+static Thread_Value_Cache_Settings * get_thread_value_cache_settings() {
+   static GPrivate per_thread_key = G_PRIVATE_INIT(g_free);
+
+   Thread_Value_Cache_Settings * settings = g_private_get(&per_thread_key);
+   if (!settings) {
+      settings = g_new0(Thread_Value_Cache_Settings, 1);
+      g_private_set(&per_thread_key, settings);
+   }
+   return settings;
+}
+
+
+/** Enables or disables the value cache.
+ *
+ *  \param  onoff  **true** for enabled, **false** for disabled
+ *  \return prior setting
+ *
+ *  \remark
+ *  Disabling the cache discards all cached values.
+ */
+bool ddc_enable_value_cache(bool onoff) {
+   bool old_value = value_cache_enabled;
+   value_cache_enabled = onoff;
+   if (!onoff)
+      ddc_discard_value_cache(NULL);
+   return old_value;
+}
+
+
+/** Reports whether the value cache is enabled.
+ *
+ *  \return **true** if enabled, **false** if not
+ */
+bool ddc_is_value_cache_enabled() {
+   return value_cache_enabled;
+}
+
+
+/** Controls whether the current thread bypasses the value cache.
+ *  Values read while the cache is bypassed still replace cached values.
+ *
+ *  \param  onoff  **true** to bypass the cache
+ *  \return prior setting
+ *
+ *  \remark
+ *  This setting is thread-specific.
+ */
+bool ddc_bypass_value_cache(bool onoff) {
+   Thread_Value_Cache_Settings * settings = get_thread_value_cache_settings();
+   bool old_value = settings->bypass;
+   settings->bypass = onoff;
+   return old_value;
+}
+
+
+//
+// Cache operations
+//
+
+// Must be called with value_cache_mutex locked
+static Display_Value_Cache * get_display_value_cache(Display_Ref * dref) {
+   if (!display_value_caches)
+      display_value_caches = g_ptr_array_new();
+   for (int ndx = 0; ndx < display_value_caches->len; ndx++) {
+      Display_Value_Cache * cur = g_ptr_array_index(display_value_caches, ndx);
+      if (dpath_eq(cur->dpath, dref->io_path))
+         return cur;
+   }
+   Display_Value_Cache * dcache = calloc(1, sizeof(Display_Value_Cache));
+   memcpy(dcache->marker, DISPLAY_VALUE_CACHE_MARKER, 4);
+   dcache->dpath = dref->io_path;
+   g_ptr_array_add(display_value_caches, dcache);
+   return dcache;
+}
+
+
+static Vcp_Volatility classify_feature(Display_Handle * dh, Byte feature_code) {
+   Vcp_Volatility result = VCP_VOLATILITY_VOLATILE;
+   switch(feature_code) {
+   case 0xb2:     // flat panel sub-pixel layout
+   case 0xb6:     // display technology type
+   case 0xc6:     // application enable key
+   case 0xc8:     // display controller type
+   case 0xc9:     // display firmware level
+   case 0xdf:     // VCP version, n. classified without metadata, which requires it
+      result = VCP_VOLATILITY_STATIC;
+      break;
+   case 0x02:     // new control value
+   case 0x03:     // soft controls
+   case 0x52:     // active control
+      result = VCP_VOLATILITY_VOLATILE;
+      break;
+   default:
+      {
+         Display_Feature_Metadata * dfm = dyn_get_feature_metadata_by_dh_dfm(feature_code, dh, false);
+         if (dfm) {
+            DDCA_Feature_Flags flags = dfm->feature_flags;
+            if ( (flags & DDCA_TABLE) || !(flags & DDCA_RW) )
+               result = VCP_VOLATILITY_VOLATILE;
+            else if (flags & DDCA_CONT)
+               result = VCP_VOLATILITY_CONTINUOUS;
+            else
+               result = VCP_VOLATILITY_NC;
+            dfm_free(dfm);
+         }
+      }
+   }
+   return result;
+}
+
+
+static uint64_t max_age_nanos(Vcp_Volatility volatility) {
+   uint64_t result = 0;
+   switch(volatility) {
+   case VCP_VOLATILITY_CONTINUOUS:  result = VALUE_CACHE_CONTINUOUS_MILLIS * (uint64_t) (1000*1000); break;
+   case VCP_VOLATILITY_NC:          result = VALUE_CACHE_NC_MILLIS         * (uint64_t) (1000*1000); break;
+   case VCP_VOLATILITY_STATIC:      result = UINT64_MAX; break;
+   default:                         break;
+   }
+   return result;
+}
+
+
+/** Looks up a non-table feature value in the cache.
+ *
+ *  \param  dh            display handle
+ *  \param  feature_code  VCP feature code
+ *  \param  response_loc  where to return a newly allocated response
+ *                        containing the cached value
+ *  \return **true** if the value was found, **false** if it must be read
+ *
+ *  \remark
+ *  It is the responsibility of the caller to free the returned response.
+ */
+bool ddc_value_cache_lookup(
+        Display_Handle *                dh,
+        Byte                            feature_code,
+        Parsed_Nontable_Vcp_Response ** response_loc)
+{
+   bool debug = false;
+   if (!value_cache_enabled)
+      return false;
+
+   bool found = false;
+   bool bypass = get_thread_value_cache_settings()->bypass;
+   uint64_t now = cur_realtime_nanosec();
+
+   g_mutex_lock(&value_cache_mutex);
+   Display_Value_Cache * dcache = get_display_value_cache(dh->dref);
+   Cached_Value * cv = &dcache->values[feature_code];
+   if (cv->volatility == VCP_VOLATILITY_UNCLASSIFIED) {
+      g_mutex_unlock(&value_cache_mutex);
+      Vcp_Volatility volatility = classify_feature(dh, feature_code);  // may perform I/O, so unlocked
+      g_mutex_lock(&value_cache_mutex);
+      cv->volatility = volatility;
+   }
+   Value_Cache_Stats * cstats = &stats[cv->volatility];
+   if (bypass) {
+      cstats->bypass_ct++;
+   }
+   else if (cv->valid) {
+      if (now - cv->read_nanos <= max_age_nanos(cv->volatility)) {
+         Parsed_Nontable_Vcp_Response * response = calloc(1, sizeof(Parsed_Nontable_Vcp_Response));
+         response->vcp_code         = feature_code;
+         response->valid_response   = true;
+         response->supported_opcode = true;
+         response->mh = cv->mh;
+         response->ml = cv->ml;
+         response->sh = cv->sh;
+         response->sl = cv->sl;
+         response->max_value = cv->mh << 8 | cv->ml;
+         response->cur_value = cv->sh << 8 | cv->sl;
+         *response_loc = response;
+         found = true;
+      }
+      else {
+         cv->valid = false;
+         cstats->expired_ct++;
+      }
+   }
+   if (!bypass) {
+      if (found)
+         cstats->hit_ct++;
+      else
+         cstats->miss_ct++;
+   }
+   g_mutex_unlock(&value_cache_mutex);
+
+   DBGTRC(debug, TRACE_GROUP, "dh=%s, feature_code=0x%02x, Returning: %s",
+                              dh_repr_t(dh), feature_code, bool_repr(found));
+   return found;
+}
+
+
+/** Saves a non-table feature value read from a display, if its
+ *  volatility class permits it to be cached.
+ *
+ *  \param  dh            display handle
+ *  \param  feature_code  VCP feature code
+ *  \param  response      value read
+ */
+void ddc_value_cache_save(
+        Display_Handle *                dh,
+        Byte                            feature_code,
+        Parsed_Nontable_Vcp_Response *  response)
+{
+   if (!value_cache_enabled)
+      return;
+
+   g_mutex_lock(&value_cache_mutex);
+   Display_Value_Cache * dcache = get_display_value_cache(dh->dref);
+   Cached_Value * cv = &dcache->values[feature_code];
+   if (cv->volatility > VCP_VOLATILITY_VOLATILE) {
+      cv->valid      = true;
+      cv->read_nanos = cur_realtime_nanosec();
+      cv->mh = response->mh;
+      cv->ml = response->ml;
+      cv->sh = response->sh;
+      cv->sl = response->sl;
+   }
+   g_mutex_unlock(&value_cache_mutex);
+}
+
+
+/** Discards the cached values for a display, other than static values,
+ *  e.g. after a value has been written.
+ *
+ *  \param  dref  display reference
+ */
+void ddc_value_cache_invalidate(Display_Ref * dref) {
+   if (!value_cache_enabled)
+      return;
+
+   g_mutex_lock(&value_cache_mutex);
+   Display_Value_Cache * dcache = get_display_value_cache(dref);
+   for (int ndx = 0; ndx < 256; ndx++) {
+      if (dcache->values[ndx].volatility != VCP_VOLATILITY_STATIC)
+         dcache->values[ndx].valid = false;
+   }
+   invalidation_ct++;
+   g_mutex_unlock(&value_cache_mutex);
+}
+
+
+/** Discards all cached values, including static values, for a display.
+ *
+ *  \param  dref  display reference, if NULL discard values for all displays
+ */
+void ddc_discard_value_cache(Display_Ref * dref) {
+   g_mutex_lock(&value_cache_mutex);
+   if (display_value_caches) {
+      for (int ndx = 0; ndx < display_value_caches->len; ndx++) {
+         Display_Value_Cache * cur = g_ptr_array_index(display_value_caches, ndx);
+         if (!dref || dpath_eq(cur->dpath, dref->io_path)) {
+            for (int code = 0; code < 256; code++)
+               cur->values[code].valid = false;
+         }
+      }
+   }
+   g_mutex_unlock(&value_cache_mutex);
+}
+
+
+//
+// Statistics
+//
+
+/** Resets value cache statistics. */
+void ddc_reset_value_cache_stats() {
+   g_mutex_lock(&value_cache_mutex);
+   memset(stats, 0, sizeof(stats));
+   invalidation_ct = 0;
+   g_mutex_unlock(&value_cache_mutex);
+}
+
+
+/** Reports value cache statistics, including hit rates by volatility class.
+ *
+ *  \param depth logical indentation depth
+ */
+void ddc_report_value_cache_stats(int depth) {
+   int d1 = depth+1;
+   rpt_title("VCP Value Cache Stats:", depth);
+   rpt_vstring(d1, "Value cache:  %s", (value_cache_enabled) ? "enabled" : "disabled");
+   if (!value_cache_enabled)
+      return;
+
+   g_mutex_lock(&value_cache_mutex);
+   rpt_vstring(d1, "%-16s %6s %6s %8s %9s %8s", "Class", "Hits", "Misses", "Expired", "Bypassed", "Hit rate");
+   for (int ndx = VCP_VOLATILITY_VOLATILE; ndx < VCP_VOLATILITY_CT; ndx++) {
+      Value_Cache_Stats * cur = &stats[ndx];
+      int lookup_ct = cur->hit_ct + cur->miss_ct;
+      char rate[20] = "-";
+      if (lookup_ct > 0 && ndx != VCP_VOLATILITY_VOLATILE)
+         g_snprintf(rate, sizeof(rate), "%5.1f%%", 100.0 * cur->hit_ct / lookup_ct);
+      rpt_vstring(d1, "%-16s %6d %6d %8d %9d %8s",
+                      vcp_volatility_name(ndx),
+                      cur->hit_ct, cur->miss_ct, cur->expired_ct, cur->bypass_ct, rate);
+   }
+   rpt_vstring(d1, "Invalidations due to writes: %d", invalidation_ct);
+   g_mutex_unlock(&value_cache_mutex);
+}
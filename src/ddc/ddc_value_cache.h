@@ -0,0 +1,51 @@
+/** @file ddc_value_cache.h
+ *
+ *  Time bounded cache of non-table VCP feature values
+ */
+
+// Copyright (C) 2019 Sanford Rockowitz <rockowitz@minsoft.com>
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+#ifndef DDC_VALUE_CACHE_H_
+#define DDC_VALUE_CACHE_H_
+
+/** \cond */
+#include <stdbool.h>
+/** \endcond */
+
+#include "base/core.h"
+#include "base/ddc_packets.h"
+#include "base/displays.h"
+
+/** How long a feature value can be cached, based on how it can change */
+typedef enum {
+   VCP_VOLATILITY_UNCLASSIFIED = 0,
+   VCP_VOLATILITY_VOLATILE,        ///< never cached, e.g. x02, x52, measurements
+   VCP_VOLATILITY_CONTINUOUS,      ///< continuous control, cached briefly
+   VCP_VOLATILITY_NC,              ///< non-continuous setting
+   VCP_VOLATILITY_STATIC,          ///< fixed for the monitor, e.g. xC8, xDF, cached for the session
+} Vcp_Volatility;
+
+#define VCP_VOLATILITY_CT 5
+
+char * vcp_volatility_name(Vcp_Volatility volatility);
+
+bool ddc_enable_value_cache(bool onoff);
+bool ddc_is_value_cache_enabled();
+bool ddc_bypass_value_cache(bool onoff);
+
+bool ddc_value_cache_lookup(
+        Display_Handle *                dh,
+        Byte                            feature_code,
+        Parsed_Nontable_Vcp_Response ** response_loc);
+void ddc_value_cache_save(
+        Display_Handle *                dh,
+        Byte                            feature_code,
+        Parsed_Nontable_Vcp_Response *  response);
+void ddc_value_cache_invalidate(Display_Ref * dref);
+void ddc_discard_value_cache(Display_Ref * dref);
+
+void ddc_reset_value_cache_stats();
+void ddc_report_value_cache_stats(int depth);
+
+#endif /* DDC_VALUE_CACHE_H_ */
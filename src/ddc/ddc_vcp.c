@@ -41,6 +41,7 @@
 
 #include "ddc/ddc_multi_part_io.h"
 #include "ddc/ddc_packet_io.h"
+#include "ddc/ddc_value_cache.h"
 #include "ddc/ddc_vcp_version.h"
 
 #include "ddc/ddc_vcp.h"
@@ -163,6 +164,8 @@ ddc_set_nontable_vcp_value(
       if (request_packet_ptr)
          free_ddc_packet(request_packet_ptr);
    }
+   // Setting one feature can change others, e.g. color preset
+   ddc_value_cache_invalidate(dh->dref);
 
    DBGTRC(debug, TRACE_GROUP, "Returning %s", psc_desc(psc));
    if ( psc==DDCRC_RETRIES && (debug || IS_TRACING()) )
@@ -211,6 +214,7 @@ set_table_vcp_value(
 
       buffer_free(new_value, __func__);
    }
+   ddc_value_cache_invalidate(dh->dref);
 
    DBGTRC(debug, TRACE_GROUP, "Returning: %s", psc_desc(psc));
    if ( (debug || IS_TRACING()) && psc == DDCRC_RETRIES )
@@ -466,20 +470,19 @@ mock_get_nontable_vcp_value(
 // Get VCP values
 //
 
-/** Gets the value for a non-table feature.
+/** Gets the value for a non-table feature, using a Get VCP request packet
+ *  supplied by the caller.
  *
- *  \param  dh                 handle for open display
- *  \param  feature_code       VCP feature code
- *  \param  ppInterpretedCode  where to return parsed response
+ *  \param  dh                  handle for open display
+ *  \param  request_packet_ptr  Get VCP request packet for **feature_code**
+ *  \param  feature_code        VCP feature code
+ *  \param  ppInterpretedCode   where to return parsed response
  *  \return NULL if success, pointer to #Error_Info if failure
- *
- * It is the responsibility of the caller to free the parsed response.
- *
- * The value pointed to by ppInterpretedCode is non-null iff the returned status code is 0.
  */
-Error_Info *
-ddc_get_nontable_vcp_value(
+static Error_Info *
+get_nontable_vcp_value_using_packet(
        Display_Handle *               dh,
+       DDC_Packet *                   request_packet_ptr,
        DDCA_Vcp_Feature_Code          feature_code,
        Parsed_Nontable_Vcp_Response** ppInterpretedCode)
 {
@@ -497,15 +500,16 @@ ddc_get_nontable_vcp_value(
       return mock_errinfo;
    }
 
-   DDC_Packet * request_packet_ptr  = NULL;
+   if (ddc_value_cache_lookup(dh, feature_code, ppInterpretedCode)) {
+      DBGTRC(debug, TRACE_GROUP, "Returning cached value for feature 0x%02x", feature_code);
+      return NULL;
+   }
+
    DDC_Packet * response_packet_ptr = NULL;
-   request_packet_ptr = create_ddc_getvcp_request_packet(
-                           feature_code, "ddc_get_nontable_vcp_value:request packet");
-   // dump_packet(request_packet_ptr);
 
    Byte expected_response_type = DDC_PACKET_TYPE_QUERY_VCP_RESPONSE;
    Byte expected_subtype = feature_code;
-   int max_read_bytes  = 20;    // actually 3 + 8 + 1, or is it 2 + 8 + 1?
+   int max_read_bytes  = 20;    // buffer size, ddc_write_read() reads exactly 3 + 8 bytes over I2C
 
    // retry:
    // psc = ddc_write_read_with_retry(
@@ -559,8 +563,6 @@ ddc_get_nontable_vcp_value(
       }
    }
 
-   if (request_packet_ptr)
-      free_ddc_packet(request_packet_ptr);
    if (response_packet_ptr)
       free_ddc_packet(response_packet_ptr);
 
@@ -580,12 +582,41 @@ ddc_get_nontable_vcp_value(
                 (parsed_response->sh<<8) | parsed_response->sl);
       }
    }
+   if (parsed_response)
+      ddc_value_cache_save(dh, feature_code, parsed_response);
    *ppInterpretedCode = parsed_response;
 
    return excp;
 }
 
 
+/** Gets the value for a non-table feature.
+ *
+ *  \param  dh                 handle for open display
+ *  \param  feature_code       VCP feature code
+ *  \param  ppInterpretedCode  where to return parsed response
+ *  \return NULL if success, pointer to #Error_Info if failure
+ *
+ * It is the responsibility of the caller to free the parsed response.
+ *
+ * The value pointed to by ppInterpretedCode is non-null iff the returned status code is 0.
+ */
+Error_Info *
+ddc_get_nontable_vcp_value(
+       Display_Handle *               dh,
+       DDCA_Vcp_Feature_Code          feature_code,
+       Parsed_Nontable_Vcp_Response** ppInterpretedCode)
+{
+   DDC_Packet * request_packet_ptr = create_ddc_getvcp_request_packet(
+                           feature_code, "ddc_get_nontable_vcp_value:request packet");
+   // dump_packet(request_packet_ptr);
+   Error_Info * excp = get_nontable_vcp_value_using_packet(
+                          dh, request_packet_ptr, feature_code, ppInterpretedCode);
+   free_ddc_packet(request_packet_ptr);
+   return excp;
+}
+
+
 /** Gets the value of a table feature in a newly allocated Buffer struct.
  *  It is the responsibility of the caller to free the Buffer.
  *
@@ -671,10 +702,14 @@ ddc_get_vcp_value(
       switch (call_type) {
 
           case (DDCA_NON_TABLE_VCP_VALUE):
-                psc = usb_get_nontable_vcp_value(
-                      dh,
-                      feature_code,
-                      &parsed_nontable_response);    //
+                if (!ddc_value_cache_lookup(dh, feature_code, &parsed_nontable_response)) {
+                   psc = usb_get_nontable_vcp_value(
+                         dh,
+                         feature_code,
+                         &parsed_nontable_response);    //
+                   if (psc == 0)
+                      ddc_value_cache_save(dh, feature_code, parsed_nontable_response);
+                }
                 if (psc == 0) {
                    valrec = create_nontable_vcp_value(
                                feature_code,
@@ -740,3 +775,86 @@ ddc_get_vcp_value(
    return ddc_excp;
 }
 
+
+/** Gets the values of multiple VCP features in a single operation.
+ *
+ *  The display remains open throughout.  Non-table features are read using a
+ *  single request packet that is updated for each feature, and the sleep
+ *  that follows each read is deferred until the next write, so that the time
+ *  spent processing a response overlaps it and no sleep is performed after
+ *  the final read of the batch unless the display is written again.
+ *
+ * \param  dh             handle for open display
+ * \param  ct             number of features
+ * \param  feature_codes  array of **ct** feature codes
+ * \param  value_types    array of **ct** value types
+ * \param  values         array of **ct** locations at which to return a newly
+ *                        allocated #DDCA_Any_Vcp_Value, set to NULL if the read failed
+ * \param  statuses       array of **ct** locations at which to return the status code
+ *                        for each feature
+ * \return number of features successfully read
+ *
+ * The caller is responsible for freeing the values returned.
+ */
+int
+ddc_get_multiple_vcp_values(
+       Display_Handle *              dh,
+       int                           ct,
+       const DDCA_Vcp_Feature_Code * feature_codes,
+       const DDCA_Vcp_Value_Type *   value_types,
+       DDCA_Any_Vcp_Value **         values,
+       DDCA_Status *                 statuses)
+{
+   bool debug = false;
+   DBGTRC(debug, TRACE_GROUP, "Starting. dh=%s, ct=%d", dh_repr_t(dh), ct);
+
+   int ok_ct = 0;
+   bool saved_defer = dh->defer_post_read_sleep;
+   dh->defer_post_read_sleep = true;
+   DDC_Packet * request_packet_ptr = NULL;
+
+   for (int ndx = 0; ndx < ct; ndx++) {
+      DDCA_Vcp_Feature_Code feature_code = feature_codes[ndx];
+      Error_Info * ddc_excp = NULL;
+      values[ndx] = NULL;
+
+      if (value_types[ndx] == DDCA_NON_TABLE_VCP_VALUE && dh->dref->io_path.io_mode != DDCA_IO_USB) {
+         if (request_packet_ptr)
+            update_ddc_getvcp_request_packet_feature_code(request_packet_ptr, feature_code);
+         else
+            request_packet_ptr = create_ddc_getvcp_request_packet(
+                                    feature_code, "ddc_get_multiple_vcp_values:request packet");
+         Parsed_Nontable_Vcp_Response * parsed_response = NULL;
+         ddc_excp = get_nontable_vcp_value_using_packet(
+                       dh, request_packet_ptr, feature_code, &parsed_response);
+         if (!ddc_excp) {
+            values[ndx] = create_nontable_vcp_value(
+                             feature_code,
+                             parsed_response->mh,
+                             parsed_response->ml,
+                             parsed_response->sh,
+                             parsed_response->sl);
+            free(parsed_response);
+         }
+      }
+      else {
+         ddc_excp = ddc_get_vcp_value(dh, feature_code, value_types[ndx], &values[ndx]);
+      }
+
+      statuses[ndx] = ERRINFO_STATUS(ddc_excp);
+      if (ddc_excp) {
+         DBGMSF(debug, "Feature 0x%02x: %s", feature_code, errinfo_summary(ddc_excp));
+         ERRINFO_FREE_WITH_REPORT(ddc_excp, debug || IS_TRACING() || report_freed_exceptions);
+      }
+      else {
+         ok_ct++;
+      }
+   }
+
+   if (request_packet_ptr)
+      free_ddc_packet(request_packet_ptr);
+   dh->defer_post_read_sleep = saved_defer;
+
+   DBGTRC(debug, TRACE_GROUP, "Done. Returning %d of %d features read", ok_ct, ct);
+   return ok_ct;
+}
@@ -65,4 +65,13 @@ ddc_get_vcp_value(
        DDCA_Vcp_Value_Type      call_type,
        DDCA_Any_Vcp_Value **    valrec_loc);
 
+int
+ddc_get_multiple_vcp_values(
+       Display_Handle *              dh,
+       int                           ct,
+       const DDCA_Vcp_Feature_Code * feature_codes,
+       const DDCA_Vcp_Value_Type *   value_types,
+       DDCA_Any_Vcp_Value **         values,
+       DDCA_Status *                 statuses);
+
 #endif /* DDC_VCP_H_ */
@@ -0,0 +1,570 @@
+/** @file ddc_watch.c
+ *
+ *  Watch displays for VCP feature changes made using the monitor controls.
+ *
+ *  Each watched display has its own thread.  For I2C and ADL displays,
+ *  feature x02 (New Control Value) is polled, and when it reports a change
+ *  the changed features are read from feature x52 and their new values
+ *  reported.  Polling is adaptive: the interval is short after a change,
+ *  and doubles on each check that finds no change, up to a slow idle
+ *  interval.  The display is opened only for the duration of each check,
+ *  so the watch does not lock out other users of the display.
+ *
+ *  USB connected monitors report changes on their hiddev device, which is
+ *  read instead of polling.
+ */
+
+// Copyright (C) 2019 Sanford Rockowitz <rockowitz@minsoft.com>
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+/** \cond */
+#include <config.h>
+
+#include <assert.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <glib-2.0/glib.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#ifdef USE_USB
+#include <linux/hiddev.h>
+#include <poll.h>
+#include <sys/ioctl.h>
+#endif
+
+#include "util/report_util.h"
+#include "util/string_util.h"
+#include "util/timestamp.h"
+/** \endcond */
+
+#include "base/core.h"
+#include "base/ddc_errno.h"
+#include "base/displays.h"
+#include "base/feature_metadata.h"
+#include "base/parms.h"
+#include "base/vcp_version.h"
+
+#include "dynvcp/dyn_feature_codes.h"
+
+#include "ddc/ddc_packet_io.h"
+#include "ddc/ddc_value_cache.h"
+#include "ddc/ddc_vcp.h"
+#include "ddc/ddc_vcp_version.h"
+
+#include "ddc/ddc_watch.h"
+
+
+// Trace class for this file
+static DDCA_Trace_Group TRACE_GROUP = DDCA_TRC_DDC;
+
+#define DISPLAY_WATCH_MARKER "DWAT"
+typedef struct {
+   char           marker[4];
+   Display_Ref *  dref;
+   GThread *      thread;
+   // statistics, guarded by watch_mutex
+   int            poll_ct;       ///< checks performed
+   int            change_ct;     ///< changes reported
+   int            busy_ct;       ///< checks skipped because display in use
+   int            error_ct;      ///< checks failed
+} Display_Watch;
+
+typedef struct {
+   DDCA_Vcp_Change_Callback  func;
+   void *                    data;
+} Vcp_Change_Callback_Rec;
+
+static GMutex      watch_mutex;            // guards all of the following
+static GCond       watch_cond;             // signalled when stop requested
+static GPtrArray * watches = NULL;         // Display_Watch for each watched display
+static bool        stop_requested = false;
+static int         fast_poll_millis = WATCH_POLL_FAST_MILLIS;
+static int         slow_poll_millis = WATCH_POLL_SLOW_MILLIS;
+
+static GMutex      callbacks_mutex;
+static GArray *    callbacks = NULL;       // Vcp_Change_Callback_Rec
+
+
+//
+// Callbacks
+//
+
+/** Registers a function to be called when a VCP feature change is detected.
+ *
+ *  \param  func   function to call
+ *  \param  data   passed to **func**
+ *  \return **true** if registered, **false** if already registered
+ *
+ *  \remark
+ *  The function is called in the thread watching the display.
+ */
+bool ddc_register_vcp_change_callback(DDCA_Vcp_Change_Callback func, void * data) {
+   assert(func);
+   bool result = true;
+   g_mutex_lock(&callbacks_mutex);
+   if (!callbacks)
+      callbacks = g_array_new(false, false, sizeof(Vcp_Change_Callback_Rec));
+   for (int ndx = 0; ndx < callbacks->len; ndx++) {
+      Vcp_Change_Callback_Rec * cur = &g_array_index(callbacks, Vcp_Change_Callback_Rec, ndx);
+      if (cur->func == func && cur->data == data) {
+         result = false;
+         break;
+      }
+   }
+   if (result) {
+      Vcp_Change_Callback_Rec rec = {func, data};
+      g_array_append_val(callbacks, rec);
+   }
+   g_mutex_unlock(&callbacks_mutex);
+   return result;
+}
+
+
+/** Unregisters a function registered with #ddc_register_vcp_change_callback().
+ *
+ *  \param  func   function
+ *  \param  data   data value specified when the function was registered
+ *  \return **true** if unregistered, **false** if not found
+ */
+bool ddc_unregister_vcp_change_callback(DDCA_Vcp_Change_Callback func, void * data) {
+   bool result = false;
+   g_mutex_lock(&callbacks_mutex);
+   if (callbacks) {
+      for (int ndx = 0; ndx < callbacks->len; ndx++) {
+         Vcp_Change_Callback_Rec * cur = &g_array_index(callbacks, Vcp_Change_Callback_Rec, ndx);
+         if (cur->func == func && cur->data == data) {
+            g_array_remove_index(callbacks, ndx);
+            result = true;
+            break;
+         }
+      }
+   }
+   g_mutex_unlock(&callbacks_mutex);
+   return result;
+}
+
+
+// Calls every registered callback.  The callback list is copied, so that
+// a callback can register or unregister callbacks.
+static void emit_vcp_change_event(Display_Watch * watch, DDCA_Vcp_Change_Event * event) {
+   bool debug = false;
+   DBGTRC(debug, TRACE_GROUP, "dref=%s, feature_code=0x%02x, status=%s",
+          dref_repr_t(watch->dref), event->feature_code, psc_desc(event->status));
+
+   g_mutex_lock(&watch_mutex);
+   watch->change_ct++;
+   g_mutex_unlock(&watch_mutex);
+
+   GArray * work = NULL;
+   g_mutex_lock(&callbacks_mutex);
+   if (callbacks && callbacks->len > 0) {
+      work = g_array_sized_new(false, false, sizeof(Vcp_Change_Callback_Rec), callbacks->len);
+      g_array_append_vals(work, callbacks->data, callbacks->len);
+   }
+   g_mutex_unlock(&callbacks_mutex);
+
+   if (work) {
+      for (int ndx = 0; ndx < work->len; ndx++) {
+         Vcp_Change_Callback_Rec * cur = &g_array_index(work, Vcp_Change_Callback_Rec, ndx);
+         cur->func(event, cur->data);
+      }
+      g_array_free(work, true);
+   }
+}
+
+
+//
+// Polling
+//
+
+/** Sets the intervals between checks for VCP feature changes on
+ *  I2C and ADL displays.
+ *
+ *  \param  fast_millis  interval after a change is detected
+ *  \param  slow_millis  maximum interval, reached when a display is idle
+ */
+void ddc_set_watch_poll_intervals(int fast_millis, int slow_millis) {
+   assert(fast_millis > 0 && slow_millis >= fast_millis);
+   g_mutex_lock(&watch_mutex);
+   fast_poll_millis = fast_millis;
+   slow_poll_millis = slow_millis;
+   g_mutex_unlock(&watch_mutex);
+}
+
+
+/** Gets the intervals between checks for VCP feature changes.
+ *
+ *  \param  fast_millis_loc  where to return interval after a change is detected
+ *  \param  slow_millis_loc  where to return maximum interval
+ */
+void ddc_get_watch_poll_intervals(int * fast_millis_loc, int * slow_millis_loc) {
+   g_mutex_lock(&watch_mutex);
+   *fast_millis_loc = fast_poll_millis;
+   *slow_millis_loc = slow_poll_millis;
+   g_mutex_unlock(&watch_mutex);
+}
+
+
+// Waits for the specified time, or until a stop is requested.
+// Returns true if a stop has been requested.
+static bool wait_for_stop(int millis) {
+   gint64 end_time = g_get_monotonic_time() + millis * G_TIME_SPAN_MILLISECOND;
+   g_mutex_lock(&watch_mutex);
+   while (!stop_requested) {
+      if (!g_cond_wait_until(&watch_cond, &watch_mutex, end_time))
+         break;
+   }
+   bool result = stop_requested;
+   g_mutex_unlock(&watch_mutex);
+   return result;
+}
+
+
+// Reads the new value of a changed feature, and reports the change
+static void report_changed_feature(
+      Display_Watch *        watch,
+      Display_Handle *       dh,
+      DDCA_Vcp_Feature_Code  feature_code)
+{
+   DDCA_Vcp_Change_Event event;
+   memset(&event, 0, sizeof(event));
+   event.dref = watch->dref;
+   event.feature_code = feature_code;
+   event.timestamp_nanos = cur_realtime_nanosec();
+
+   bool is_table = false;
+   Display_Feature_Metadata * dfm = dyn_get_feature_metadata_by_dh_dfm(feature_code, dh, false);
+   if (dfm) {
+      is_table = dfm->feature_flags & DDCA_TABLE;
+      dfm_free(dfm);
+   }
+
+   if (is_table) {
+      event.status = DDCRC_INVALID_OPERATION;
+   }
+   else {
+      Parsed_Nontable_Vcp_Response * response = NULL;
+      Error_Info * ddc_excp = ddc_get_nontable_vcp_value(dh, feature_code, &response);
+      event.status = ERRINFO_STATUS(ddc_excp);
+      if (ddc_excp) {
+         errinfo_free(ddc_excp);
+      }
+      else {
+         event.value.mh = response->mh;
+         event.value.ml = response->ml;
+         event.value.sh = response->sh;
+         event.value.sl = response->sl;
+         free(response);
+      }
+   }
+   emit_vcp_change_event(watch, &event);
+}
+
+
+// Checks an I2C or ADL display for changes, reporting each changed feature.
+// Returns the number of changes reported, -1 if the check failed.
+static int poll_display(Display_Watch * watch) {
+   bool debug = false;
+   DBGTRC(debug, TRACE_GROUP, "Starting. dref=%s", dref_repr_t(watch->dref));
+
+   Display_Handle * dh = NULL;
+   Public_Status_Code psc = ddc_open_display(watch->dref, CALLOPT_NONE, &dh);
+   if (!dh) {
+      g_mutex_lock(&watch_mutex);
+      if (psc == DDCRC_LOCKED)
+         watch->busy_ct++;
+      else
+         watch->error_ct++;
+      g_mutex_unlock(&watch_mutex);
+      DBGTRC(debug, TRACE_GROUP, "Done. Open failed: %s", psc_desc(psc));
+      return -1;
+   }
+
+   int change_ct = 0;
+   Parsed_Nontable_Vcp_Response * response = NULL;
+   // x02: x01 no new control values, x02 new control values exist, xff no user controls
+   Error_Info * ddc_excp = ddc_get_nontable_vcp_value(dh, 0x02, &response);
+   if (ddc_excp) {
+      change_ct = -1;
+   }
+   else {
+      bool changes_exist = (response->sl == 0x02);
+      free(response);
+      if (changes_exist) {
+         // Per the 3.0 and 2.2 specs, x52 is a FIFO to be read until x00
+         // indicates empty.  For earlier versions it holds a single feature.
+         DDCA_MCCS_Version_Spec vspec = get_vcp_version_by_display_handle(dh);
+         bool is_fifo = !vcp_version_le(vspec, DDCA_VSPEC_V21);
+         for (int ctr = 0; ctr < WATCH_MAX_CHANGES_PER_POLL; ctr++) {
+            ddc_excp = ddc_get_nontable_vcp_value(dh, 0x52, &response);
+            if (ddc_excp)
+               break;
+            DDCA_Vcp_Feature_Code feature_code = response->sl;
+            free(response);
+            if (feature_code == 0x00)
+               break;
+            report_changed_feature(watch, dh, feature_code);
+            change_ct++;
+            if (!is_fifo)
+               break;
+         }
+         if (ddc_excp) {
+            ERRINFO_FREE_WITH_REPORT(ddc_excp, debug || IS_TRACING());
+            ddc_excp = NULL;
+         }
+         ddc_excp = ddc_set_nontable_vcp_value(dh, 0x02, 0x01);   // reset
+      }
+   }
+
+   g_mutex_lock(&watch_mutex);
+   watch->poll_ct++;
+   if (ddc_excp)
+      watch->error_ct++;
+   g_mutex_unlock(&watch_mutex);
+   if (ddc_excp)
+      ERRINFO_FREE_WITH_REPORT(ddc_excp, debug || IS_TRACING());
+   ddc_close_display(dh);
+
+   DBGTRC(debug, TRACE_GROUP, "Done. Returning %d", change_ct);
+   return change_ct;
+}
+
+
+static void watch_by_polling(Display_Watch * watch) {
+   int fast_millis;
+   int slow_millis;
+   ddc_get_watch_poll_intervals(&fast_millis, &slow_millis);
+   int interval = fast_millis;
+   do {
+      int change_ct = poll_display(watch);
+      ddc_get_watch_poll_intervals(&fast_millis, &slow_millis);
+      if (change_ct > 0)
+         interval = fast_millis;
+      else
+         interval = MIN(interval * 2, slow_millis);
+   } while (!wait_for_stop(interval));
+}
+
+
+#ifdef USE_USB
+// USB connected monitors report changes as hiddev usage events.  The device
+// is opened separately, without locking the display, so that changes are
+// seen without blocking other users of the display.
+static void watch_usb_hiddev(Display_Watch * watch) {
+   bool debug = false;
+   DBGTRC(debug, TRACE_GROUP, "Starting. %s", watch->dref->usb_hiddev_name);
+
+   int fd = open(watch->dref->usb_hiddev_name, O_RDONLY);
+   if (fd < 0) {
+      DBGTRC(debug, TRACE_GROUP, "open(%s) failed, errno=%d", watch->dref->usb_hiddev_name, errno);
+      g_mutex_lock(&watch_mutex);
+      watch->error_ct++;
+      g_mutex_unlock(&watch_mutex);
+      return;
+   }
+   int flags = HIDDEV_FLAG_UREF;
+   if (ioctl(fd, HIDIOCSFLAG, &flags) < 0) {
+      REPORT_IOCTL_ERROR("HIDIOCSFLAG", errno);
+      close(fd);
+      g_mutex_lock(&watch_mutex);
+      watch->error_ct++;
+      g_mutex_unlock(&watch_mutex);
+      return;
+   }
+
+   int slow_millis;
+   int fast_millis;
+   do {
+      ddc_get_watch_poll_intervals(&fast_millis, &slow_millis);
+      struct pollfd pfd = {fd, POLLIN, 0};
+      // wakes up periodically to check for a stop request
+      int rc = poll(&pfd, 1, slow_millis);
+      if (rc < 0 && errno != EINTR)
+         break;
+      if (rc <= 0)
+         continue;
+      struct hiddev_usage_ref uref;
+      ssize_t ct = read(fd, &uref, sizeof(uref));
+      g_mutex_lock(&watch_mutex);
+      watch->poll_ct++;
+      if (ct < (ssize_t) sizeof(uref))
+         watch->error_ct++;
+      g_mutex_unlock(&watch_mutex);
+      if (ct < 0 && errno != EINTR)
+         break;
+      // VESA Monitor Control usage page x82, usage id is the VCP feature code
+      if (ct == sizeof(uref) && (uref.usage_code >> 16) == 0x0082) {
+         DDCA_Vcp_Change_Event event;
+         memset(&event, 0, sizeof(event));
+         event.dref            = watch->dref;
+         event.feature_code    = uref.usage_code & 0xff;
+         event.status          = 0;
+         event.value.sh        = (uref.value >> 8) & 0xff;
+         event.value.sl        = uref.value & 0xff;
+         event.timestamp_nanos = cur_realtime_nanosec();
+         emit_vcp_change_event(watch, &event);
+      }
+   } while (!wait_for_stop(0));
+
+   close(fd);
+   DBGTRC(debug, TRACE_GROUP, "Done.");
+}
+#endif
+
+
+static gpointer watch_thread_func(gpointer data) {
+   bool debug = false;
+   Display_Watch * watch = data;
+   ASSERT_MARKER(watch, DISPLAY_WATCH_MARKER);
+   DBGTRC(debug, TRACE_GROUP, "Starting. dref=%s", dref_repr_t(watch->dref));
+   ddc_bypass_value_cache(true);    // changes must be seen when they occur
+
+#ifdef USE_USB
+   if (watch->dref->io_path.io_mode == DDCA_IO_USB)
+      watch_usb_hiddev(watch);
+   else
+#endif
+      watch_by_polling(watch);
+
+   DBGTRC(debug, TRACE_GROUP, "Done. dref=%s", dref_repr_t(watch->dref));
+   return NULL;
+}
+
+
+//
+// Start and stop
+//
+
+/** Starts watching displays for VCP feature changes.  Each change is
+ *  reported to the functions registered using #ddc_register_vcp_change_callback().
+ *
+ *  \param  dref_ct   number of displays
+ *  \param  drefs     array of **dref_ct** display references
+ *  \retval 0                 success
+ *  \retval DDCRC_INVALID_OPERATION  a watch is already active
+ *
+ *  \remark
+ *  The watch runs until #ddc_stop_watch() is called.
+ */
+Public_Status_Code ddc_start_watch(int dref_ct, Display_Ref ** drefs) {
+   bool debug = false;
+   DBGTRC(debug, TRACE_GROUP, "Starting. dref_ct=%d", dref_ct);
+
+   Public_Status_Code psc = 0;
+   g_mutex_lock(&watch_mutex);
+   if (watches) {
+      psc = DDCRC_INVALID_OPERATION;
+   }
+   else {
+      stop_requested = false;
+      watches = g_ptr_array_new();
+      for (int ndx = 0; ndx < dref_ct; ndx++) {
+         Display_Watch * watch = calloc(1, sizeof(Display_Watch));
+         memcpy(watch->marker, DISPLAY_WATCH_MARKER, 4);
+         watch->dref = drefs[ndx];
+         g_ptr_array_add(watches, watch);
+      }
+      for (int ndx = 0; ndx < watches->len; ndx++) {
+         Display_Watch * watch = g_ptr_array_index(watches, ndx);
+         watch->thread = g_thread_new("ddc_watch", watch_thread_func, watch);
+      }
+   }
+   g_mutex_unlock(&watch_mutex);
+
+   DBGTRC(debug, TRACE_GROUP, "Done. Returning %s", psc_desc(psc));
+   return psc;
+}
+
+
+/** Stops watching for VCP feature changes, waiting for all watch threads
+ *  to terminate.  Does nothing if no watch is active.
+ *
+ *  \remark
+ *  Must not be called from a callback function.
+ */
+void ddc_stop_watch() {
+   bool debug = false;
+   DBGTRC(debug, TRACE_GROUP, "Starting.");
+
+   g_mutex_lock(&watch_mutex);
+   GPtrArray * stopping = watches;
+   stop_requested = true;
+   g_cond_broadcast(&watch_cond);
+   g_mutex_unlock(&watch_mutex);
+
+   if (stopping) {
+      for (int ndx = 0; ndx < stopping->len; ndx++) {
+         Display_Watch * watch = g_ptr_array_index(stopping, ndx);
+         g_thread_join(watch->thread);
+      }
+      g_mutex_lock(&watch_mutex);
+      for (int ndx = 0; ndx < stopping->len; ndx++) {
+         Display_Watch * watch = g_ptr_array_index(stopping, ndx);
+         watch->marker[3] = 'x';
+         free(watch);
+      }
+      g_ptr_array_free(stopping, true);
+      watches = NULL;
+      g_mutex_unlock(&watch_mutex);
+   }
+
+   DBGTRC(debug, TRACE_GROUP, "Done.");
+}
+
+
+/** Reports whether a watch is active.
+ *
+ *  \return **true** if displays are being watched for changes
+ */
+bool ddc_is_watching() {
+   g_mutex_lock(&watch_mutex);
+   bool result = (watches != NULL);
+   g_mutex_unlock(&watch_mutex);
+   return result;
+}
+
+
+//
+// Statistics
+//
+
+/** Resets the statistics for the displays currently being watched. */
+void ddc_reset_watch_stats() {
+   g_mutex_lock(&watch_mutex);
+   if (watches) {
+      for (int ndx = 0; ndx < watches->len; ndx++) {
+         Display_Watch * watch = g_ptr_array_index(watches, ndx);
+         watch->poll_ct   = 0;
+         watch->change_ct = 0;
+         watch->busy_ct   = 0;
+         watch->error_ct  = 0;
+      }
+   }
+   g_mutex_unlock(&watch_mutex);
+}
+
+
+/** Reports statistics for the displays currently being watched.
+ *
+ *  \param depth logical indentation depth
+ */
+void ddc_report_watch_stats(int depth) {
+   int d1 = depth+1;
+   rpt_title("VCP Change Watch Stats:", depth);
+   g_mutex_lock(&watch_mutex);
+   rpt_vstring(d1, "Poll interval: %d to %d milliseconds", fast_poll_millis, slow_poll_millis);
+   if (!watches) {
+      rpt_vstring(d1, "No watch active");
+   }
+   else {
+      for (int ndx = 0; ndx < watches->len; ndx++) {
+         Display_Watch * watch = g_ptr_array_index(watches, ndx);
+         rpt_vstring(d1, "%s: checks: %d, changes: %d, display busy: %d, errors: %d",
+                         dref_repr_t(watch->dref),
+                         watch->poll_ct, watch->change_ct, watch->busy_ct, watch->error_ct);
+      }
+   }
+   g_mutex_unlock(&watch_mutex);
+}
@@ -0,0 +1,34 @@
+/** @file ddc_watch.h
+ *
+ *  Watch displays for VCP feature changes made using the monitor controls.
+ */
+
+// Copyright (C) 2019 Sanford Rockowitz <rockowitz@minsoft.com>
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+#ifndef DDC_WATCH_H_
+#define DDC_WATCH_H_
+
+/** \cond */
+#include <stdbool.h>
+/** \endcond */
+
+#include "public/ddcutil_types.h"
+
+#include "base/displays.h"
+#include "base/status_code_mgt.h"
+
+bool ddc_register_vcp_change_callback(DDCA_Vcp_Change_Callback func, void * data);
+bool ddc_unregister_vcp_change_callback(DDCA_Vcp_Change_Callback func, void * data);
+
+void ddc_set_watch_poll_intervals(int fast_millis, int slow_millis);
+void ddc_get_watch_poll_intervals(int * fast_millis_loc, int * slow_millis_loc);
+
+Public_Status_Code ddc_start_watch(int dref_ct, Display_Ref ** drefs);
+void               ddc_stop_watch();
+bool               ddc_is_watching();
+
+void ddc_reset_watch_stats();
+void ddc_report_watch_stats(int depth);
+
+#endif /* DDC_WATCH_H_ */
@@ -0,0 +1,282 @@
+/** @file ddc_worker_pool.c
+ *
+ *  Shared pool of worker threads for display I/O, serialized per bus.
+ *
+ *  Work items are submitted with the #DDCA_IO_Path of the display they
+ *  access.  Items for the same path are queued and executed one at a time,
+ *  in submission order, since a bus carries only one transaction at a time.
+ *  Items for different paths run concurrently, on at most
+ *  #DDC_WORKER_POOL_MAX_THREADS threads.  The threads are created on first
+ *  use and reused thereafter, so that neither display detection nor
+ *  asynchronous feature reads create a thread per display or per call.
+ *
+ *  A work item may itself submit items and wait for them.  Since waiting in
+ *  a pool thread could exhaust the pool, and an item for the same path could
+ *  never start while the submitting item holds its queue, items submitted
+ *  with a work group from a pool thread are executed immediately instead.
+ */
+
+// Copyright (C) 2019 Sanford Rockowitz <rockowitz@minsoft.com>
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+/** \cond */
+#include <assert.h>
+#include <glib-2.0/glib.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+/** \endcond */
+
+#include "util/report_util.h"
+#include "util/string_util.h"
+
+#include "base/core.h"
+#include "base/displays.h"
+#include "base/parms.h"
+
+#include "ddc/ddc_worker_pool.h"
+
+
+// Trace class for this file
+static DDCA_Trace_Group TRACE_GROUP = DDCA_TRC_DDC;
+
+#define DDC_WORK_GROUP_MARKER "WGRP"
+struct DDC_Work_Group {
+   char     marker[4];
+   GMutex   mutex;
+   GCond    cond;
+   int      pending_ct;
+};
+
+typedef struct {
+   DDC_Work_Func     func;
+   gpointer          data;
+   DDC_Work_Group *  group;
+} Work_Item;
+
+#define BUS_QUEUE_MARKER "BUSQ"
+typedef struct {
+   char           marker[4];
+   DDCA_IO_Path   dpath;
+   GQueue *       items;        ///< pending #Work_Item records
+   bool           active;       ///< queued to or running in the thread pool
+} Bus_Queue;
+
+static GMutex        worker_pool_mutex;       // guards all of the following
+static GThreadPool * worker_pool = NULL;
+static GPtrArray *   bus_queues  = NULL;      // only a handful of buses, never freed
+static int           submitted_ct = 0;
+static int           inline_ct    = 0;
+static int           active_queue_ct     = 0;
+static int           max_active_queue_ct = 0;
+
+static GPrivate      worker_thread_key = G_PRIVATE_INIT(NULL);   // set in pool threads
+
+static bool in_worker_thread() {
+   return g_private_get(&worker_thread_key) != NULL;
+}
+
+
+//
+// Work groups
+//
+
+/** Creates a #DDC_Work_Group, used to wait for the completion of
+ *  the work items submitted with it.
+ *
+ *  \return newly allocated work group
+ */
+DDC_Work_Group * ddc_work_group_new() {
+   DDC_Work_Group * group = calloc(1, sizeof(DDC_Work_Group));
+   memcpy(group->marker, DDC_WORK_GROUP_MARKER, 4);
+   g_mutex_init(&group->mutex);
+   g_cond_init(&group->cond);
+   return group;
+}
+
+
+/** Waits until every work item submitted with a #DDC_Work_Group has
+ *  completed, then frees the group.
+ *
+ *  \param group  work group
+ *
+ *  \remark
+ *  When called from a worker thread, all items of the group have already
+ *  been executed in that thread by #ddc_worker_pool_submit(), so this
+ *  does not block.
+ */
+void ddc_work_group_wait_and_free(DDC_Work_Group * group) {
+   ASSERT_MARKER(group, DDC_WORK_GROUP_MARKER);
+   g_mutex_lock(&group->mutex);
+   assert(!in_worker_thread() || group->pending_ct == 0);
+   while (group->pending_ct > 0)
+      g_cond_wait(&group->cond, &group->mutex);
+   g_mutex_unlock(&group->mutex);
+
+   g_cond_clear(&group->cond);
+   g_mutex_clear(&group->mutex);
+   group->marker[3] = 'x';
+   free(group);
+}
+
+
+static void work_group_item_done(DDC_Work_Group * group) {
+   ASSERT_MARKER(group, DDC_WORK_GROUP_MARKER);
+   g_mutex_lock(&group->mutex);
+   if (--group->pending_ct == 0)
+      g_cond_broadcast(&group->cond);
+   g_mutex_unlock(&group->mutex);
+}
+
+
+static void execute_work_item(Work_Item * item) {
+   item->func(item->data);
+   if (item->group)
+      work_group_item_done(item->group);
+   free(item);
+}
+
+
+//
+// Thread pool
+//
+
+// Executes the items in a bus queue until it is empty.  Runs in a pool thread.
+static void run_bus_queue(gpointer data, gpointer user_data) {
+   bool debug = false;
+   Bus_Queue * bq = data;
+   ASSERT_MARKER(bq, BUS_QUEUE_MARKER);
+   DBGTRC(debug, TRACE_GROUP, "Starting. %s", dpath_repr_t(&bq->dpath));
+   g_private_set(&worker_thread_key, GINT_TO_POINTER(1));
+
+   while (true) {
+      g_mutex_lock(&worker_pool_mutex);
+      Work_Item * item = g_queue_pop_head(bq->items);
+      if (!item) {
+         bq->active = false;
+         active_queue_ct--;
+      }
+      g_mutex_unlock(&worker_pool_mutex);
+      if (!item)
+         break;
+      execute_work_item(item);
+   }
+
+   DBGTRC(debug, TRACE_GROUP, "Done.");
+}
+
+
+// Must be called with worker_pool_mutex locked
+static Bus_Queue * get_bus_queue(DDCA_IO_Path dpath) {
+   if (!bus_queues)
+      bus_queues = g_ptr_array_new();
+   for (int ndx = 0; ndx < bus_queues->len; ndx++) {
+      Bus_Queue * cur = g_ptr_array_index(bus_queues, ndx);
+      if (dpath_eq(cur->dpath, dpath))
+         return cur;
+   }
+   Bus_Queue * bq = calloc(1, sizeof(Bus_Queue));
+   memcpy(bq->marker, BUS_QUEUE_MARKER, 4);
+   bq->dpath = dpath;
+   bq->items = g_queue_new();
+   g_ptr_array_add(bus_queues, bq);
+   return bq;
+}
+
+
+/** Submits a work item to the shared worker pool.
+ *
+ *  \param  dpath  display path accessed by the work item.  Items for the
+ *                 same path are executed serially in submission order.
+ *  \param  func   function to execute
+ *  \param  data   argument passed to **func**
+ *  \param  group  if non-NULL, work group to be notified when the item completes
+ *
+ *  \remark
+ *  If the thread pool cannot be created, or the caller is itself a worker
+ *  thread and **group** is non-NULL, the item is executed immediately in
+ *  the calling thread.
+ */
+void ddc_worker_pool_submit(
+        DDCA_IO_Path      dpath,
+        DDC_Work_Func     func,
+        gpointer          data,
+        DDC_Work_Group *  group)
+{
+   bool debug = false;
+   DBGTRC(debug, TRACE_GROUP, "Starting. dpath=%s, group=%p", dpath_repr_t(&dpath), group);
+   assert(func);
+
+   Work_Item * item = calloc(1, sizeof(Work_Item));
+   item->func  = func;
+   item->data  = data;
+   item->group = group;
+   if (group) {
+      ASSERT_MARKER(group, DDC_WORK_GROUP_MARKER);
+      g_mutex_lock(&group->mutex);
+      group->pending_ct++;
+      g_mutex_unlock(&group->mutex);
+   }
+
+   g_mutex_lock(&worker_pool_mutex);
+   if (!worker_pool) {
+      GError * error = NULL;
+      worker_pool = g_thread_pool_new(run_bus_queue, NULL, DDC_WORKER_POOL_MAX_THREADS, false, &error);
+      if (!worker_pool) {
+         DBGMSF(debug, "g_thread_pool_new() failed: %s", error->message);
+         g_error_free(error);
+      }
+   }
+   submitted_ct++;
+   bool run_inline = !worker_pool || (group && in_worker_thread());
+   if (run_inline) {
+      inline_ct++;
+   }
+   else {
+      Bus_Queue * bq = get_bus_queue(dpath);
+      g_queue_push_tail(bq->items, item);
+      if (!bq->active) {
+         bq->active = true;
+         if (++active_queue_ct > max_active_queue_ct)
+            max_active_queue_ct = active_queue_ct;
+         g_thread_pool_push(worker_pool, bq, NULL);
+      }
+   }
+   g_mutex_unlock(&worker_pool_mutex);
+
+   if (run_inline)
+      execute_work_item(item);
+
+   DBGTRC(debug, TRACE_GROUP, "Done. run_inline=%s", bool_repr(run_inline));
+}
+
+
+//
+// Statistics
+//
+
+/** Resets worker pool statistics. */
+void ddc_reset_worker_pool_stats() {
+   g_mutex_lock(&worker_pool_mutex);
+   submitted_ct        = 0;
+   inline_ct           = 0;
+   max_active_queue_ct = active_queue_ct;
+   g_mutex_unlock(&worker_pool_mutex);
+}
+
+
+/** Reports worker pool statistics.
+ *
+ *  \param depth logical indentation depth
+ */
+void ddc_report_worker_pool_stats(int depth) {
+   int d1 = depth+1;
+   rpt_title("Worker Pool Stats:", depth);
+   g_mutex_lock(&worker_pool_mutex);
+   rpt_vstring(d1, "Maximum threads:                 %5d", DDC_WORKER_POOL_MAX_THREADS);
+   rpt_vstring(d1, "Bus queues:                      %5d", (bus_queues) ? bus_queues->len : 0);
+   rpt_vstring(d1, "Work items submitted:            %5d", submitted_ct);
+   rpt_vstring(d1, "Executed in calling thread:      %5d", inline_ct);
+   rpt_vstring(d1, "Maximum concurrently busy buses: %5d", max_active_queue_ct);
+   g_mutex_unlock(&worker_pool_mutex);
+}
@@ -0,0 +1,36 @@
+/** @file ddc_worker_pool.h
+ *
+ *  Shared pool of worker threads for display I/O, serialized per bus.
+ */
+
+// Copyright (C) 2019 Sanford Rockowitz <rockowitz@minsoft.com>
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+#ifndef DDC_WORKER_POOL_H_
+#define DDC_WORKER_POOL_H_
+
+/** \cond */
+#include <glib-2.0/glib.h>
+/** \endcond */
+
+#include "public/ddcutil_types.h"
+
+/** Function executed by a worker thread */
+typedef void (*DDC_Work_Func)(gpointer data);
+
+/** Opaque handle used to wait for a set of work items to complete */
+typedef struct DDC_Work_Group DDC_Work_Group;
+
+DDC_Work_Group * ddc_work_group_new();
+void             ddc_work_group_wait_and_free(DDC_Work_Group * group);
+
+void ddc_worker_pool_submit(
+        DDCA_IO_Path      dpath,
+        DDC_Work_Func     func,
+        gpointer          data,
+        DDC_Work_Group *  group);
+
+void ddc_reset_worker_pool_stats();
+void ddc_report_worker_pool_stats(int depth);
+
+#endif /* DDC_WORKER_POOL_H_ */
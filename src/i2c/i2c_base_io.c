@@ -263,6 +263,73 @@ Status_Errno_DDC ioctl_reader(int fh, int bytect, Byte * readbuf) {
 }
 
 
+/** Writes to and then reads from the I2C bus in a single ioctl(I2C_RDWR)
+ *  transaction, i.e. with a repeated start condition between the write and
+ *  the read rather than a stop condition.
+ *
+ * @param  fh              file handle
+ * @param  write_bytect    number of bytes to write
+ * @param  bytes_to_write  bytes to write
+ * @param  read_bytect     number of bytes to read
+ * @param  readbuf         read bytes into this buffer
+ *
+ * @retval 0         success
+ * @retval <0        negative Linux errno value
+ *
+ * @remark
+ * There is no wait between the write and the read other than what the
+ * monitor imposes by clock stretching, so not all monitors support this.
+ */
+Status_Errno_DDC ioctl_write_reader(
+      int    fh,
+      int    write_bytect,
+      Byte * bytes_to_write,
+      int    read_bytect,
+      Byte * readbuf)
+{
+   bool debug = false;
+   DBGMSF(debug, "Starting. fh=%d, write_bytect=%d, read_bytect=%d", fh, write_bytect, read_bytect);
+
+   struct i2c_msg              messages[2];
+   struct i2c_rdwr_ioctl_data  msgset;
+
+   messages[0].addr  = 0x37;
+   messages[0].flags = 0;
+   messages[0].len   = write_bytect;
+   messages[1].addr  = 0x37;
+   messages[1].flags = I2C_M_RD;
+   messages[1].len   = read_bytect;
+   // On Ubuntu and SuSE?, i2c_msg is defined in i2c-dev.h, with char *buf
+   // On Fedora, i2c_msg is defined in i2c.h, and it's --u8 * buf
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wpointer-sign"
+   messages[0].buf   = (char *) bytes_to_write;
+   messages[1].buf   = (char *) readbuf;
+#pragma GCC diagnostic pop
+
+   msgset.msgs  = messages;
+   msgset.nmsgs = 2;
+
+   // if success, returns the number of messages transferred
+   int rc = ioctl(fh, I2C_RDWR, &msgset);
+   int errsv = errno;
+   if (rc < 0) {
+      if (debug) {
+         REPORT_IOCTL_ERROR("I2C_RDWR", errno);
+      }
+      rc = -errsv;
+   }
+   else {
+      if (rc != 2)
+         DBGMSF(debug, "ioctl() write/read returned %d", rc);
+      rc = 0;
+   }
+
+   DBGMSF(debug, "Returning %d", rc);
+   return rc;
+}
+
+
 #ifdef WONT_COMPILE
 // i2c_sumbus_write_i2c_block_data_writer, and _reader are retained only for
 // possible further exploration.   They do not work.
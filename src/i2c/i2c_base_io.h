@@ -41,11 +41,16 @@
 typedef Status_Errno_DDC (*I2C_Writer)(int fh, int bytect, Byte * bytes_to_write);
 /** Function template for I2C read function */
 typedef Status_Errno_DDC (*I2C_Reader)(int fh, int bytect, Byte * readbuf);
+/** Function template for I2C function that writes and then reads in a single transaction */
+typedef Status_Errno_DDC (*I2C_Write_Reader)(
+      int fh, int write_bytect, Byte * bytes_to_write, int read_bytect, Byte * readbuf);
 
 Status_Errno_DDC write_writer(int fh, int bytect, Byte * pbytes);
 Status_Errno_DDC read_reader (int fh, int bytect, Byte * readbuf);
 Status_Errno_DDC ioctl_writer(int fh, int bytect, Byte * pbytes);
 Status_Errno_DDC ioctl_reader(int fh, int bytect, Byte * readbuf);
+Status_Errno_DDC ioctl_write_reader(
+      int fh, int write_bytect, Byte * bytes_to_write, int read_bytect, Byte * readbuf);
 
 // Don't work:
 Status_Errno_DDC i2c_smbus_write_i2c_block_data_writer(int fh, int bytect, Byte * bytes_to_write);
@@ -0,0 +1,575 @@
+/** @file i2c_bus_cache.c
+ *
+ *  Persistent cache of I2C bus inventory, validated against sysfs.
+ *
+ *  Probing an I2C bus opens /dev/i2c-N and attempts to read the EDID, which
+ *  involves a conservative sleep and retries even on buses that have no
+ *  monitor.  On systems with many buses this dominates startup.  The flags,
+ *  functionality, and EDID found for each bus are saved in file
+ *  ddcutil/bus_cache in the user's XDG cache directory, together with a
+ *  signature of the bus's sysfs state.  If the signature is unchanged on a
+ *  subsequent invocation the bus is not reopened.
+ *
+ *  The signature is a hash of the adapter name and sysfs device path and,
+ *  if the bus belongs to a DRM connector, of the connector's name, status
+ *  and EDID attributes, which the kernel updates on hotplug.  For a bus with
+ *  no DRM connector nothing in sysfs reflects whether a monitor is attached,
+ *  so the current boot id is hashed instead and each use of the entry is
+ *  revalidated by a brief read of slave address x50.
+ */
+
+// Copyright (C) 2019 Sanford Rockowitz <rockowitz@minsoft.com>
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+/** \cond */
+#include <assert.h>
+#include <dirent.h>
+#include <errno.h>
+#include <glib-2.0/glib.h>
+#include <inttypes.h>
+#include <limits.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+/** \endcond */
+
+#include "util/edid.h"
+#include "util/file_util.h"
+#include "util/report_util.h"
+#include "util/string_util.h"
+#include "util/sysfs_util.h"
+
+#include "base/core.h"
+#include "base/parms.h"
+
+#include "i2c/i2c_bus_cache.h"
+
+
+// Trace class for this file
+static DDCA_Trace_Group TRACE_GROUP = DDCA_TRC_I2C;
+
+#define I2C_BUS_CACHE_FN  "bus_cache"
+
+/** I2C_Bus_Info flags that record the results of probing a bus */
+#define I2C_BUS_CACHEABLE_FLAGS  ( I2C_BUS_ACCESSIBLE | \
+                                   I2C_BUS_ADDR_0X50  | \
+                                   I2C_BUS_ADDR_0X37  | \
+                                   I2C_BUS_ADDR_0X30  | \
+                                   I2C_BUS_EDP )
+
+// Signature prefixes, indicating how the signature was computed
+#define SIG_DRM_EDID     "drm+"     // DRM connector reports an EDID
+#define SIG_DRM_NO_EDID  "drm-"     // DRM connector reports no EDID
+#define SIG_BOOT         "boot"     // no DRM connector, revalidate by probing
+
+typedef struct {
+   int            busno;
+   char *         signature;
+   Byte           flags;              ///< I2C_BUS_CACHEABLE_FLAGS bits
+   unsigned long  functionality;
+   char *         edid_hex;           ///< hex representation of 128 byte EDID, or "-"
+   time_t         timestamp;          ///< time bus was last probed
+} Bus_Cache_Entry;
+
+static bool         bus_cache_enabled = true;
+static bool         bus_cache_loaded  = false;
+static bool         bus_cache_changed = false;
+static GHashTable * bus_cache         = NULL;     // key: busno
+static GMutex       bus_cache_mutex;
+static int          bus_cache_hit_ct   = 0;
+static int          bus_cache_miss_ct  = 0;
+static int          bus_cache_stale_ct = 0;
+
+
+static void free_bus_cache_entry(void * data) {
+   Bus_Cache_Entry * entry = data;
+   if (entry) {
+      free(entry->signature);
+      free(entry->edid_hex);
+      free(entry);
+   }
+}
+
+
+static char * bus_cache_file_name() {
+   return xdg_user_cache_file("ddcutil", I2C_BUS_CACHE_FN);
+}
+
+
+/** Enables or disables the persistent I2C bus cache.
+ *
+ *  \param  onoff  true to enable, false to disable
+ *  \return prior setting
+ */
+bool i2c_enable_bus_cache(bool onoff) {
+   bool old = bus_cache_enabled;
+   bus_cache_enabled = onoff;
+   return old;
+}
+
+
+/** Reports whether the persistent I2C bus cache is enabled.
+ *
+ *  \return true/false
+ */
+bool i2c_is_bus_cache_enabled() {
+   return bus_cache_enabled;
+}
+
+
+//
+// Signature
+//
+
+// FNV-1a
+static uint64_t hash_bytes(uint64_t hash, const void * data, size_t len) {
+   const Byte * p = data;
+   for (size_t ndx = 0; ndx < len; ndx++) {
+      hash ^= p[ndx];
+      hash *= 0x100000001b3ULL;
+   }
+   return hash;
+}
+
+static uint64_t hash_string(uint64_t hash, const char * s) {
+   if (s)
+      hash = hash_bytes(hash, s, strlen(s) + 1);   // include terminator as separator
+   else
+      hash = hash_bytes(hash, "", 1);
+   return hash;
+}
+
+
+/** Finds the DRM connector directory in /sys/class/drm for an I2C bus.
+ *
+ *  The bus is either a child of the connector device (e.g. a DP AUX channel),
+ *  or is the target of the connector's "ddc" link.
+ *
+ *  \param  busno  I2C bus number
+ *  \return connector directory name, caller must free, NULL if not found
+ */
+char * i2c_find_drm_connector_dir(int busno) {
+   char * result = NULL;
+   char i2c_name[20];
+   snprintf(i2c_name, sizeof(i2c_name), "i2c-%d", busno);
+
+   DIR * d = opendir("/sys/class/drm");
+   if (d) {
+      struct dirent * dent;
+      while (!result && (dent = readdir(d)) != NULL) {
+         if (!str_starts_with(dent->d_name, "card") || !strchr(dent->d_name, '-'))
+            continue;
+         char path[PATH_MAX];
+         snprintf(path, sizeof(path), "/sys/class/drm/%s/%s", dent->d_name, i2c_name);
+         if (directory_exists(path)) {
+            result = g_strdup_printf("/sys/class/drm/%s", dent->d_name);
+         }
+         else {
+            snprintf(path, sizeof(path), "/sys/class/drm/%s/ddc", dent->d_name);
+            char target[PATH_MAX];
+            ssize_t ct = readlink(path, target, sizeof(target)-1);
+            if (ct > 0) {
+               target[ct] = '\0';
+               char * base = strrchr(target, '/');
+               if (streq( (base) ? base+1 : target, i2c_name))
+                  result = g_strdup_printf("/sys/class/drm/%s", dent->d_name);
+            }
+         }
+      }
+      closedir(d);
+   }
+   return result;
+}
+
+
+/** Computes the signature of the current sysfs state of an I2C bus.
+ *
+ *  \param  busno  I2C bus number
+ *  \return signature, caller must free
+ */
+static char * bus_signature(int busno) {
+   bool debug = false;
+   uint64_t hash = 0xcbf29ce484222325ULL;
+
+   char devdir[PATH_MAX];
+   snprintf(devdir, sizeof(devdir), "/sys/bus/i2c/devices/i2c-%d", busno);
+   char * name = read_sysfs_attr(devdir, "name", false);
+   char * devpath = realpath(devdir, NULL);
+   hash = hash_string(hash, name);
+   hash = hash_string(hash, devpath);
+
+   const char * sigtype = SIG_BOOT;
+   char * connector_dir = i2c_find_drm_connector_dir(busno);
+   if (connector_dir) {
+      char * status = read_sysfs_attr(connector_dir, "status", false);
+      GByteArray * edid = read_binary_sysfs_attr(connector_dir, "edid", 256, false);
+      hash = hash_string(hash, connector_dir);
+      hash = hash_string(hash, status);
+      if (edid && edid->len > 0) {
+         hash = hash_bytes(hash, edid->data, edid->len);
+         sigtype = SIG_DRM_EDID;
+      }
+      else {
+         sigtype = SIG_DRM_NO_EDID;
+      }
+      if (edid)
+         g_byte_array_free(edid, true);
+      free(status);
+   }
+   else {
+      char * boot_id = file_get_first_line("/proc/sys/kernel/random/boot_id", false);
+      hash = hash_string(hash, boot_id);
+      free(boot_id);
+   }
+
+   char * result = g_strdup_printf("%s:%016" PRIx64, sigtype, hash);
+   DBGMSF(debug, "busno=%d, name=%s, devpath=%s, connector_dir=%s, returning: %s",
+                 busno, name, devpath, connector_dir, result);
+   free(connector_dir);
+   free(devpath);
+   free(name);
+   return result;
+}
+
+
+/** Returns the signature of the current sysfs state of an I2C bus, for
+ *  use with #i2c_update_bus_cache() when the bus is probed without
+ *  consulting the cache.
+ *
+ *  \param  busno  I2C bus number
+ *  \return signature, caller must free, NULL if the cache is disabled
+ */
+char * i2c_get_bus_signature(int busno) {
+   return (bus_cache_enabled) ? bus_signature(busno) : NULL;
+}
+
+
+//
+// Load and save
+//
+
+static bool parse_bus_cache_line(char * line, time_t now, Bus_Cache_Entry ** entry_loc) {
+   bool ok = false;
+   *entry_loc = NULL;
+   gchar ** fields = g_strsplit(line, "\t", -1);
+   if (g_strv_length(fields) == 6) {
+      char * endptr = NULL;
+      errno = 0;
+      long busno = strtol(fields[0], &endptr, 10);
+      bool valid = (errno == 0 && *endptr == '\0' && busno >= 0 && busno < I2C_BUS_MAX);
+      long flags = strtol(fields[2], &endptr, 16);
+      valid = valid && (errno == 0 && *endptr == '\0' && (flags & ~I2C_BUS_CACHEABLE_FLAGS) == 0);
+      unsigned long functionality = strtoul(fields[3], &endptr, 16);
+      valid = valid && (errno == 0 && *endptr == '\0');
+      long long timestamp = strtoll(fields[5], &endptr, 10);
+      valid = valid && (errno == 0 && *endptr == '\0');
+      valid = valid && (strlen(fields[4]) == 2*128 || streq(fields[4], "-"));
+      if (valid) {
+         ok = true;
+         // stale entries are syntactically valid, but are not loaded
+         if (timestamp <= now && now - timestamp <= I2C_BUS_CACHE_MAX_AGE_SECONDS) {
+            Bus_Cache_Entry * entry = calloc(1, sizeof(Bus_Cache_Entry));
+            entry->busno         = busno;
+            entry->signature     = strdup(fields[1]);
+            entry->flags         = flags;
+            entry->functionality = functionality;
+            entry->edid_hex      = strdup(fields[4]);
+            entry->timestamp     = timestamp;
+            *entry_loc = entry;
+         }
+      }
+   }
+   g_strfreev(fields);
+   return ok;
+}
+
+
+// Must be called with bus_cache_mutex locked
+static void load_bus_cache() {
+   bool debug = false;
+   if (bus_cache_loaded)
+      return;
+
+   bus_cache = g_hash_table_new_full(g_direct_hash, g_direct_equal, NULL, free_bus_cache_entry);
+   bus_cache_loaded = true;
+
+   char * fn = bus_cache_file_name();
+   if (fn && regular_file_exists(fn)) {
+      GPtrArray * lines = g_ptr_array_new_with_free_func(free);
+      file_getlines(fn, lines, false);
+      time_t now = time(NULL);
+      bool format_ok = false;
+      for (int ndx = 0; ndx < lines->len; ndx++) {
+         char * line = g_strstrip(g_ptr_array_index(lines, ndx));
+         if (strlen(line) == 0 || line[0] == '#')
+            continue;
+         if (!format_ok) {
+            int version = 0;
+            format_ok = (sscanf(line, "FORMAT %d", &version) == 1 &&
+                         version == I2C_BUS_CACHE_FORMAT_VERSION);
+            if (!format_ok) {
+               DBGMSF(debug, "Ignoring %s, unrecognized format: %s", fn, line);
+               bus_cache_changed = true;
+               break;
+            }
+            continue;
+         }
+         Bus_Cache_Entry * entry = NULL;
+         if (!parse_bus_cache_line(line, now, &entry)) {
+            DBGMSF(debug, "Ignoring invalid line: %s", line);
+            bus_cache_changed = true;
+         }
+         else if (!entry) {
+            bus_cache_changed = true;      // stale
+         }
+         else {
+            g_hash_table_replace(bus_cache, GINT_TO_POINTER(entry->busno), entry);
+         }
+      }
+      g_ptr_array_free(lines, true);
+   }
+   DBGTRC(debug, TRACE_GROUP, "Loaded %d entries from %s", g_hash_table_size(bus_cache), fn);
+   free(fn);
+}
+
+
+/** Writes the I2C bus cache file, if its contents have changed.
+ *
+ *  Entries for buses that no longer exist are dropped.
+ */
+void i2c_save_bus_cache() {
+   bool debug = false;
+   g_mutex_lock(&bus_cache_mutex);
+   char * fn = bus_cache_file_name();
+   GHashTableIter iter;
+   gpointer key, value;
+   if (bus_cache) {
+      g_hash_table_iter_init(&iter, bus_cache);
+      while (g_hash_table_iter_next(&iter, &key, &value)) {
+         if (!i2c_device_exists(GPOINTER_TO_INT(key))) {
+            DBGMSF(debug, "busno=%d no longer exists, dropping entry", GPOINTER_TO_INT(key));
+            g_hash_table_iter_remove(&iter);
+            bus_cache_changed = true;
+         }
+      }
+   }
+   if (bus_cache_enabled && bus_cache_changed && bus_cache && fn) {
+      GString * contents = g_string_new(NULL);
+      g_string_append(contents, "# ddcutil I2C bus cache, regenerated automatically\n");
+      g_string_append_printf(contents, "FORMAT %d\n", I2C_BUS_CACHE_FORMAT_VERSION);
+      g_hash_table_iter_init(&iter, bus_cache);
+      while (g_hash_table_iter_next(&iter, &key, &value)) {
+         Bus_Cache_Entry * entry = value;
+         g_string_append_printf(contents, "%d\t%s\t%02x\t%lx\t%s\t%lld\n",
+                                entry->busno, entry->signature, entry->flags,
+                                entry->functionality, entry->edid_hex,
+                                (long long) entry->timestamp);
+      }
+
+      char * dir = g_path_get_dirname(fn);
+      GError * error = NULL;
+      if (g_mkdir_with_parents(dir, 0755) != 0 ||
+          !g_file_set_contents(fn, contents->str, contents->len, &error))
+      {
+         DBGTRC(debug, TRACE_GROUP, "Unable to write %s: %s",
+                                    fn, (error) ? error->message : strerror(errno));
+         if (error)
+            g_error_free(error);
+      }
+      else {
+         bus_cache_changed = false;
+      }
+      g_free(dir);
+      g_string_free(contents, true);
+   }
+   free(fn);
+   g_mutex_unlock(&bus_cache_mutex);
+}
+
+
+//
+// Lookup and update
+//
+
+/** Fills in an #I2C_Bus_Info from the cache, if the bus is unchanged.
+ *
+ *  \param  businfo        bus to check, with busno set and not yet probed
+ *  \param  signature_loc  where to return the current signature of the bus,
+ *                         to be passed to #i2c_update_bus_cache() if the bus
+ *                         must be probed, NULL if the cache is disabled
+ *  \return true if the bus information was set from the cache, false if not
+ *
+ *  \remark
+ *  Only buses that were accessible when probed are cached.  The cached
+ *  entry is not used if /dev/i2c-N is not currently accessible.
+ *  \remark
+ *  If the bus has no DRM connector, the entry is used only if a brief
+ *  probe of slave address x50 finds the same monitor, or again no monitor.
+ */
+bool i2c_apply_bus_cache(I2C_Bus_Info * businfo, char ** signature_loc) {
+   bool debug = false;
+   assert(businfo);
+   assert(signature_loc);
+   *signature_loc = NULL;
+   bool applied = false;
+   if (!bus_cache_enabled)
+      return false;
+
+   char * signature = bus_signature(businfo->busno);
+   char devname[20];
+   snprintf(devname, sizeof(devname), "/dev/i2c-%d", businfo->busno);
+   bool accessible = (access(devname, R_OK|W_OK) == 0);
+
+   g_mutex_lock(&bus_cache_mutex);
+   load_bus_cache();
+   Bus_Cache_Entry * entry = g_hash_table_lookup(bus_cache, GINT_TO_POINTER(businfo->busno));
+   if (entry && (!streq(entry->signature, signature) || !accessible)) {
+      DBGMSF(debug, "busno=%d, signature or access changed, discarding entry", businfo->busno);
+      g_hash_table_remove(bus_cache, GINT_TO_POINTER(businfo->busno));
+      bus_cache_changed = true;
+      bus_cache_stale_ct++;
+      entry = NULL;
+   }
+   Parsed_Edid * edid = NULL;
+   bool          edid_ok = false;
+   Byte          flags = 0;
+   unsigned long functionality = 0;
+   if (entry) {
+      if (!streq(entry->edid_hex, "-")) {
+         Byte * edidbytes = NULL;
+         if (hhs_to_byte_array(entry->edid_hex, &edidbytes) == 128)
+            edid = create_parsed_edid(edidbytes);
+         free(edidbytes);
+      }
+      edid_ok       = streq(entry->edid_hex, "-") || edid;
+      flags         = entry->flags;
+      functionality = entry->functionality;
+   }
+   g_mutex_unlock(&bus_cache_mutex);
+
+   // n. probe without holding the mutex, buses are checked concurrently
+   if (edid_ok && str_starts_with(signature, SIG_BOOT) &&
+       !i2c_verify_bus_edid(businfo->busno, (edid) ? edid->bytes : NULL))
+   {
+      DBGMSF(debug, "busno=%d, x50 probe does not match entry, discarding", businfo->busno);
+      g_mutex_lock(&bus_cache_mutex);
+      g_hash_table_remove(bus_cache, GINT_TO_POINTER(businfo->busno));
+      bus_cache_changed = true;
+      bus_cache_stale_ct++;
+      g_mutex_unlock(&bus_cache_mutex);
+      edid_ok = false;
+   }
+
+   if (edid_ok) {
+      businfo->flags        |= flags | I2C_BUS_PROBED;
+      businfo->functionality = functionality;
+      businfo->edid          = edid;
+      applied = true;
+   }
+   else if (edid) {
+      free_parsed_edid(edid);
+   }
+
+   g_mutex_lock(&bus_cache_mutex);
+   if (applied)
+      bus_cache_hit_ct++;
+   else
+      bus_cache_miss_ct++;
+   g_mutex_unlock(&bus_cache_mutex);
+
+   *signature_loc = signature;
+   DBGTRC(debug, TRACE_GROUP, "busno=%d, signature=%s, returning: %s",
+                              businfo->busno, signature, bool_repr(applied));
+   return applied;
+}
+
+
+/** Records the result of probing a bus in the cache.
+ *
+ *  \param  businfo    probed bus
+ *  \param  signature  signature of the bus, computed before it was probed,
+ *                     as returned by #i2c_apply_bus_cache()
+ *
+ *  \remark
+ *  The bus is not cached if it was not accessible, or if its DRM connector
+ *  reports an EDID but none was read, since the probe may have failed
+ *  for a transient reason.
+ */
+void i2c_update_bus_cache(I2C_Bus_Info * businfo, const char * signature) {
+   bool debug = false;
+   assert(businfo);
+   if (!bus_cache_enabled || !signature)
+      return;
+
+   bool cacheable = (businfo->flags & I2C_BUS_ACCESSIBLE) &&
+                    !(str_starts_with(signature, SIG_DRM_EDID) && !businfo->edid);
+   if (cacheable) {
+      Bus_Cache_Entry * entry = calloc(1, sizeof(Bus_Cache_Entry));
+      entry->busno         = businfo->busno;
+      entry->signature     = strdup(signature);
+      entry->flags         = businfo->flags & I2C_BUS_CACHEABLE_FLAGS;
+      entry->functionality = businfo->functionality;
+      entry->edid_hex      = (businfo->edid) ? hexstring(businfo->edid->bytes, 128) : strdup("-");
+      entry->timestamp     = time(NULL);
+
+      g_mutex_lock(&bus_cache_mutex);
+      load_bus_cache();
+      g_hash_table_replace(bus_cache, GINT_TO_POINTER(entry->busno), entry);
+      bus_cache_changed = true;
+      g_mutex_unlock(&bus_cache_mutex);
+   }
+   DBGTRC(debug, TRACE_GROUP, "busno=%d, cacheable=%s", businfo->busno, bool_repr(cacheable));
+}
+
+
+/** Discards all cached bus information, both in memory and on disk. */
+void i2c_discard_bus_cache() {
+   bool debug = false;
+   g_mutex_lock(&bus_cache_mutex);
+   if (bus_cache)
+      g_hash_table_remove_all(bus_cache);
+   else
+      bus_cache = g_hash_table_new_full(g_direct_hash, g_direct_equal, NULL, free_bus_cache_entry);
+   bus_cache_loaded  = true;
+   bus_cache_changed = false;
+   char * fn = bus_cache_file_name();
+   if (fn) {
+      int rc = unlink(fn);
+      DBGTRC(debug, TRACE_GROUP, "unlink(%s) returned %d", fn, rc);
+      free(fn);
+   }
+   g_mutex_unlock(&bus_cache_mutex);
+}
+
+
+//
+// Statistics
+//
+
+/** Resets the I2C bus cache hit and miss counters. */
+void i2c_reset_bus_cache_stats() {
+   g_mutex_lock(&bus_cache_mutex);
+   bus_cache_hit_ct   = 0;
+   bus_cache_miss_ct  = 0;
+   bus_cache_stale_ct = 0;
+   g_mutex_unlock(&bus_cache_mutex);
+}
+
+
+/** Reports I2C bus cache statistics.
+ *
+ *  \param depth logical indentation depth
+ */
+void i2c_report_bus_cache_stats(int depth) {
+   int d1 = depth+1;
+   rpt_title("I2C Bus Cache Stats:", depth);
+   g_mutex_lock(&bus_cache_mutex);
+   rpt_vstring(d1, "Cache enabled:        %s",  (bus_cache_enabled) ? "true" : "false");
+   rpt_vstring(d1, "Hits:                 %5d", bus_cache_hit_ct);
+   rpt_vstring(d1, "Misses:               %5d", bus_cache_miss_ct);
+   rpt_vstring(d1, "Changed buses:        %5d", bus_cache_stale_ct);
+   g_mutex_unlock(&bus_cache_mutex);
+}
@@ -0,0 +1,34 @@
+/** @file i2c_bus_cache.h
+ *
+ *  Persistent cache of I2C bus inventory, validated against sysfs.
+ */
+
+// Copyright (C) 2019 Sanford Rockowitz <rockowitz@minsoft.com>
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+#ifndef I2C_BUS_CACHE_H_
+#define I2C_BUS_CACHE_H_
+
+/** \cond */
+#include <stdbool.h>
+/** \endcond */
+
+#include "i2c/i2c_bus_core.h"
+
+/** Version of the cache file format.  Files with a different version are ignored. */
+#define I2C_BUS_CACHE_FORMAT_VERSION  1
+
+bool i2c_enable_bus_cache(bool onoff);
+bool i2c_is_bus_cache_enabled();
+
+char * i2c_find_drm_connector_dir(int busno);
+char * i2c_get_bus_signature(int busno);
+bool i2c_apply_bus_cache(I2C_Bus_Info * businfo, char ** signature_loc);
+void i2c_update_bus_cache(I2C_Bus_Info * businfo, const char * signature);
+void i2c_save_bus_cache();
+void i2c_discard_bus_cache();
+
+void i2c_reset_bus_cache_stats();
+void i2c_report_bus_cache_stats(int depth);
+
+#endif /* I2C_BUS_CACHE_H_ */
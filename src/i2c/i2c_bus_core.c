@@ -15,6 +15,7 @@
 // #include <glib.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sys/file.h>
 #include <sys/ioctl.h>
 #include <sys/stat.h>
 #include <sys/types.h>
@@ -29,6 +30,7 @@
 #include "util/string_util.h"
 #include "util/subprocess_util.h"
 #include "util/sysfs_util.h"
+#include "util/timestamp.h"
 #include "util/udev_i2c_util.h"
 #include "util/utilrpt.h"
 
@@ -39,6 +41,7 @@
 #include "base/sleep.h"
 #include "base/status_code_mgt.h"
 
+#include "i2c/i2c_bus_cache.h"
 #include "i2c/i2c_do_io.h"
 #include "i2c/wrap_i2c-dev.h"
 
@@ -50,12 +53,68 @@ static DDCA_Trace_Group TRACE_GROUP = DDCA_TRC_I2C;
 
 /** All I2C buses.  GPtrArray of pointers to #I2C_Bus_Info - shared with i2c_bus_selector.c */
 /* static */ GPtrArray * i2c_buses = NULL;
+static GMutex             i2c_redetect_mutex;          // serializes i2c_redetect_bus()
+static GPtrArray *        retired_bus_arrays = NULL;   // arrays replaced by i2c_redetect_bus()
 
 /** Global variable.  Controls whether function #i2c_set_addr() attempts retry
  *  after EBUSY error by changing ioctl op I2C_SLAVE to I2C_SLAVE_FORCE.
  */
 bool i2c_force_slave_addr_flag = false;
 
+// Cross process locking of buses while probing, set from the ddc layer
+static bool   probe_lock_enabled = DEFAULT_CROSS_PROCESS_LOCK;
+static int    probe_lock_max_wait_millis = CROSS_PROCESS_LOCK_MAX_WAIT_MILLIS;
+
+
+/** Controls whether buses are locked against other processes while
+ *  being probed, i.e. by #i2c_check_bus() and #i2c_verify_bus_edid().
+ *
+ *  Normally called only when the cross process lock for open displays
+ *  is changed, so that detection and DDC communication are serialized
+ *  using the same flock() lock.
+ *
+ *  \param  onoff            **true** for enabled, **false** for disabled
+ *  \param  max_wait_millis  maximum time to wait for the lock
+ */
+void i2c_set_probe_lock(bool onoff, int max_wait_millis) {
+   probe_lock_enabled = onoff;
+   if (max_wait_millis >= 0)
+      probe_lock_max_wait_millis = max_wait_millis;
+}
+
+
+// Locks an open bus against other processes while it is probed, if enabled,
+// waiting a bounded time if another process holds the lock.  The lock is
+// released when the bus is closed.
+//
+// Returns false if the wait timed out.  Probing then proceeds unlocked,
+// since another process, e.g. the ddcutild service, can hold a display
+// open indefinitely, and failing the probe would hide the monitor.
+static bool lock_bus_for_probe(int fd, int busno) {
+   bool debug = false;
+   bool locked = true;
+   if (probe_lock_enabled) {
+      uint64_t start_nanos = cur_realtime_nanosec();
+      uint64_t max_wait_nanos = probe_lock_max_wait_millis * (uint64_t)(1000*1000);
+      int sleep_millis_ct = 1;
+      while (flock(fd, LOCK_EX|LOCK_NB) != 0) {
+         if (errno != EWOULDBLOCK ||
+             cur_realtime_nanosec() - start_nanos >= max_wait_nanos)
+         {
+            DBGTRC(debug, TRACE_GROUP, "Unable to lock /dev/i2c-%d, errno=%d. Probing unlocked.",
+                                       busno, errno);
+            locked = false;
+            break;
+         }
+         // back off, to poll the lock at most every 20 milliseconds
+         sleep_millis(sleep_millis_ct);
+         if (sleep_millis_ct < 20)
+            sleep_millis_ct *= 2;
+      }
+   }
+   return locked;
+}
+
 
 //
 // Basic I2C bus operations
@@ -82,7 +141,7 @@ int i2c_open_bus(int busno, Byte callopts) {
    snprintf(filename, 19, "/dev/i2c-%d", busno);
    RECORD_IO_EVENT(
          IE_OPEN,
-         ( file = open(filename, (callopts & CALLOPT_RDONLY) ? O_RDONLY : O_RDWR) )
+         ( file = open(filename, ((callopts & CALLOPT_RDONLY) ? O_RDONLY : O_RDWR) | O_CLOEXEC) )
          );
    // per man open:
    // returns file descriptor if successful
@@ -651,6 +710,46 @@ Status_Errno_DDC i2c_get_parsed_edid_by_fd(int fd, Parsed_Edid ** edid_ptr_loc)
 }
 
 
+/** Cheaply checks whether the monitor on an I2C bus, if any, is the one
+ *  described by an EDID read earlier.
+ *
+ *  Slave address x50 is accessed without the conservative sleep and retries
+ *  of #i2c_get_raw_edid_by_fd().  Only the manufacturer id, product code and
+ *  serial number (EDID bytes 8..17) are read, and compared to the prior EDID.
+ *
+ *  \param  busno      I2C bus number
+ *  \param  edidbytes  128 byte EDID previously read from the bus, NULL if
+ *                     x50 did not respond
+ *  \return true if the bus appears unchanged, false if it has changed or
+ *          cannot be checked
+ */
+bool i2c_verify_bus_edid(int busno, const Byte * edidbytes) {
+   bool debug = false;
+   bool unchanged = false;
+   bool present   = false;
+
+   int fd = i2c_open_bus(busno, CALLOPT_NONE);
+   if (fd >= 0) {
+      lock_bus_for_probe(fd, busno);
+      if (i2c_set_addr(fd, 0x50, CALLOPT_NONE) == 0) {
+         Byte offset = 8;
+         Byte idbytes[10];
+         present = (invoke_i2c_writer(fd, 1, &offset) == 0 &&
+                    invoke_i2c_reader(fd, sizeof(idbytes), idbytes) == 0);
+         if (edidbytes)
+            unchanged = present && memcmp(idbytes, edidbytes+8, sizeof(idbytes)) == 0;
+         else
+            unchanged = !present;
+      }
+      i2c_close_bus(fd, busno, CALLOPT_NONE);
+   }
+
+   DBGTRC(debug, TRACE_GROUP, "busno=%d, x50 present=%s, returning: %s",
+                              busno, bool_repr(present), bool_repr(unchanged));
+   return unchanged;
+}
+
+
 //
 // I2C Bus Inspection - Fill in and report Bus_Info
 //
@@ -703,6 +802,7 @@ static void i2c_check_bus(I2C_Bus_Info * bus_info) {
 
          if (file >= 0) {
             bus_info->flags |= I2C_BUS_ACCESSIBLE;
+            lock_bus_for_probe(file, bus_info->busno);
 
             bus_info->functionality = i2c_get_functionality_flags_by_fd(file);
             // DBGMSF(debug, "i2c_get_functionality_flags_by_fd() returned %lu", bus_info->functionality);
@@ -952,6 +1052,40 @@ int i2c_device_count() {
 // Bus inventory
 //
 
+/** Probes a single bus, using the bus cache if possible.
+ *
+ *  \param  data       pointer to #I2C_Bus_Info, with busno set
+ *  \param  user_data  unused
+ *
+ *  \remark
+ *  Called in a #GThreadPool worker thread by #i2c_detect_buses().
+ */
+static void i2c_probe_bus_worker(gpointer data, gpointer user_data) {
+   I2C_Bus_Info * businfo = data;
+   assert( memcmp(businfo->marker, I2C_BUS_INFO_MARKER, 4) == 0);
+
+   DDCA_IO_Path dpath = {.io_mode = DDCA_IO_I2C, .path.i2c_busno = businfo->busno};
+   event_ring_set_display(&dpath);
+   char * signature = NULL;
+   if (!i2c_apply_bus_cache(businfo, &signature)) {
+      i2c_check_bus(businfo);
+      i2c_update_bus_cache(businfo, signature);
+   }
+   free(signature);
+   event_ring_set_display(NULL);
+}
+
+
+/** Detects and probes all I2C buses, creating the internal array of
+ *  #I2C_Bus_Info records if it does not already exist.
+ *
+ *  Buses are probed concurrently by at most #I2C_BUS_PROBE_MAX_THREADS
+ *  threads, so that detection time is governed by the slowest bus rather
+ *  than the sum of all buses.  The array is ordered by bus number
+ *  regardless of the order in which probes complete.
+ *
+ *  \return number of buses detected
+ */
 int i2c_detect_buses() {
    bool debug = false;
    DBGTRC(debug, DDCA_TRC_I2C, "Starting.  i2c_buses = %p", i2c_buses);
@@ -961,15 +1095,37 @@ int i2c_detect_buses() {
       i2c_buses = g_ptr_array_sized_new(bva_length(i2c_bus_bva));
       for (int ndx = 0; ndx < bva_length(i2c_bus_bva); ndx++) {
          int busno = bva_get(i2c_bus_bva, ndx);
-         DBGMSF(debug, "Checking busno = %d", busno);
          I2C_Bus_Info * businfo = i2c_new_bus_info(busno);
          businfo->flags = I2C_BUS_EXISTS;
-         i2c_check_bus(businfo);
-         // if (debug || IS_TRACING() )
-         //    i2c_dbgrpt_bus_info(businfo, 0);
          g_ptr_array_add(i2c_buses, businfo);
       }
       bva_free(i2c_bus_bva);
+
+      GThreadPool * pool = NULL;
+      if (i2c_buses->len > 1 && I2C_BUS_PROBE_MAX_THREADS > 1) {
+         GError * error = NULL;
+         pool = g_thread_pool_new(i2c_probe_bus_worker, NULL,
+                                  MIN(i2c_buses->len, I2C_BUS_PROBE_MAX_THREADS),
+                                  false, &error);
+         if (!pool) {
+            DBGMSF(debug, "g_thread_pool_new() failed: %s", error->message);
+            g_error_free(error);
+         }
+      }
+      for (int ndx = 0; ndx < i2c_buses->len; ndx++) {
+         I2C_Bus_Info * businfo = g_ptr_array_index(i2c_buses, ndx);
+         DBGMSF(debug, "Checking busno = %d", businfo->busno);
+         if (pool)
+            g_thread_pool_push(pool, businfo, NULL);
+         else
+            i2c_probe_bus_worker(businfo, NULL);
+      }
+      if (pool)
+         g_thread_pool_free(pool, false, true);   // waits for all probes to finish
+      // if (debug || IS_TRACING() )
+      //    i2c_dbgrpt_bus_info(businfo, 0);
+
+      i2c_save_bus_cache();
    }
    int result = i2c_buses->len;
    DBGTRC(debug, DDCA_TRC_I2C, "Returning: %d", result);
@@ -996,6 +1152,99 @@ I2C_Bus_Info * detect_single_bus(int busno) {
 
 
 
+// Tests whether two probes of the same bus found the same state
+static bool i2c_same_bus_state(I2C_Bus_Info * businfo1, I2C_Bus_Info * businfo2) {
+   Byte probed_flags = I2C_BUS_ACCESSIBLE | I2C_BUS_ADDR_0X50 | I2C_BUS_ADDR_0X37 |
+                       I2C_BUS_ADDR_0X30  | I2C_BUS_EDP;
+   bool same = (businfo1->flags & probed_flags) == (businfo2->flags & probed_flags) &&
+               businfo1->functionality == businfo2->functionality;
+   if (same) {
+      if (businfo1->edid && businfo2->edid)
+         same = memcmp(businfo1->edid->bytes, businfo2->edid->bytes, 128) == 0;
+      else
+         same = !businfo1->edid && !businfo2->edid;
+   }
+   return same;
+}
+
+
+/** Re-probes a single I2C bus after a hotplug event, replacing its
+ *  #I2C_Bus_Info in the array of detected buses, adding one if the bus
+ *  is new, or removing it if the bus no longer exists.  As in
+ *  #i2c_detect_buses(), buses that cannot have a monitor, e.g. SMBus
+ *  devices, are not probed and are treated as not existing.
+ *
+ *  If the probe finds the bus unchanged, the existing #I2C_Bus_Info is
+ *  retained, and the array is not replaced.
+ *
+ *  Other threads may be iterating over the array, or using the replaced
+ *  #I2C_Bus_Info as the detail of a #Display_Ref.  So the array is
+ *  replaced by an updated copy rather than modified in place, and neither
+ *  the prior array nor the records it contains are freed.  Hotplug events
+ *  are infrequent, so the memory retained is small.
+ *
+ *  \param  busno  I2C bus number
+ *  \return #I2C_Bus_Info for the bus, either the existing record if the bus
+ *          is unchanged or a newly allocated one, NULL if it no longer exists
+ *          or is ignorable
+ *
+ *  \remark
+ *  The bus cache is not consulted, since the monitor on a bus can change
+ *  without changing the bus signature, but is updated with the result.
+ *  #i2c_detect_buses() must already have been called.
+ */
+I2C_Bus_Info * i2c_redetect_bus(int busno) {
+   bool debug = false;
+   DBGTRC(debug, DDCA_TRC_I2C, "Starting.  busno = %d", busno);
+   assert(i2c_buses);
+
+   g_mutex_lock(&i2c_redetect_mutex);
+   I2C_Bus_Info * old_businfo = i2c_find_bus_info_by_busno(busno);
+   I2C_Bus_Info * businfo = NULL;
+   if (i2c_device_exists(busno) && !is_ignorable_i2c_device(busno)) {
+      char * signature = i2c_get_bus_signature(busno);    // n. computed before probing
+      businfo = i2c_new_bus_info(busno);
+      businfo->flags = I2C_BUS_EXISTS;
+      i2c_check_bus(businfo);
+      i2c_update_bus_cache(businfo, signature);
+      i2c_save_bus_cache();
+      free(signature);
+   }
+
+   if (old_businfo && businfo && i2c_same_bus_state(old_businfo, businfo)) {
+      i2c_free_bus_info(businfo);
+      businfo = old_businfo;
+   }
+   else if (old_businfo || businfo) {
+      // keep the array ordered by bus number
+      GPtrArray * old_buses = i2c_buses;
+      GPtrArray * new_buses = g_ptr_array_sized_new(old_buses->len + 1);
+      bool inserted = (businfo == NULL);
+      for (int ndx = 0; ndx < old_buses->len; ndx++) {
+         I2C_Bus_Info * cur_info = g_ptr_array_index(old_buses, ndx);
+         if (!inserted && cur_info->busno > busno) {
+            g_ptr_array_add(new_buses, businfo);
+            inserted = true;
+         }
+         if (cur_info->busno != busno)
+            g_ptr_array_add(new_buses, cur_info);
+      }
+      if (!inserted)
+         g_ptr_array_add(new_buses, businfo);
+      g_atomic_pointer_set(&i2c_buses, new_buses);
+
+      if (!retired_bus_arrays)
+         retired_bus_arrays = g_ptr_array_new();
+      g_ptr_array_add(retired_bus_arrays, old_buses);
+   }
+   g_mutex_unlock(&i2c_redetect_mutex);
+
+   DBGTRC(debug, DDCA_TRC_I2C, "Done.  busno=%d, changed=%s, returning: %p",
+                               busno, sbool(businfo != old_businfo), businfo);
+   return businfo;
+}
+
+
 //
 // Bus_Info retrieval
 //
@@ -1051,10 +1300,11 @@ I2C_Bus_Info * i2c_find_bus_info_by_busno(int busno) {
    bool debug = false;
    DBGMSF(debug, "Starting. busno=%d", busno);
 
-   assert(i2c_buses);   // fails if using temporary dref
+   GPtrArray * buses = i2c_buses;    // n. may be replaced by i2c_redetect_bus()
+   assert(buses);   // fails if using temporary dref
    I2C_Bus_Info * result = NULL;
-   for (int ndx = 0; ndx < i2c_buses->len; ndx++) {
-      I2C_Bus_Info * cur_info = g_ptr_array_index(i2c_buses, ndx);
+   for (int ndx = 0; ndx < buses->len; ndx++) {
+      I2C_Bus_Info * cur_info = g_ptr_array_index(buses, ndx);
       if (cur_info->busno == busno) {
          result = cur_info;
          break;
@@ -42,6 +42,7 @@ extern bool i2c_force_slave_addr_flag;
 int           i2c_open_bus(int busno, Call_Options callopts);
 Status_Errno  i2c_close_bus(int fd, int busno, Call_Options callopts);
 Status_Errno  i2c_set_addr(int fd, int addr, Call_Options callopts);
+void          i2c_set_probe_lock(bool onoff, int max_wait_millis);
 
 // Bus functionality flags
 unsigned long i2c_get_functionality_flags_by_fd(int fd);
@@ -54,6 +55,7 @@ void          i2c_report_functionality_flags(long functionality, int maxline, in
 // EDID inspection
 Status_Errno_DDC i2c_get_raw_edid_by_fd(int fd, Buffer * rawedid);
 Status_Errno_DDC i2c_get_parsed_edid_by_fd(int fd, Parsed_Edid ** edid_ptr_loc);
+bool             i2c_verify_bus_edid(int busno, const Byte * edidbytes);
 
 // Retrieve and inspect bus information
 
@@ -65,6 +67,13 @@ Status_Errno_DDC i2c_get_parsed_edid_by_fd(int fd, Parsed_Edid ** edid_ptr_loc);
 #define I2C_BUS_EDP           0x04      ///< bus associated with eDP display
 #define I2C_BUS_PROBED        0x01      ///< has bus been checked?
 
+/** Whether the monitor on a bus handles a DDC write and read in a single I2C transaction */
+typedef enum {
+   I2C_COMBINED_WRITE_READ_UNTESTED = 0,   ///< not yet determined
+   I2C_COMBINED_WRITE_READ_OK,             ///< single transaction has succeeded
+   I2C_COMBINED_WRITE_READ_UNSUPPORTED     ///< single transaction fails, use separate write and read
+} I2C_Combined_Write_Read_State;
+
 #define I2C_BUS_INFO_MARKER "BINF"
 /** Information about one I2C bus */
 typedef
@@ -74,6 +83,9 @@ struct {
    unsigned long    functionality;      ///< i2c bus functionality flags
    Parsed_Edid *    edid;               ///< parsed EDID, if slave address x50 active
    Byte             flags;              ///< I2C_BUS_* flags
+   I2C_Combined_Write_Read_State
+                    combined_write_read;   ///< single transaction write/read support
+   int              combined_failure_ct;   ///< failures while combined_write_read untested
 } I2C_Bus_Info;
 
 void i2c_dbgrpt_bus_info(I2C_Bus_Info * bus_info, int depth);
@@ -86,6 +98,7 @@ int  i2c_device_count();           // simple /dev/i2c-n count, no side effects
 // Bus inventory - detect and probe buses
 int i2c_detect_buses();            // creates internal array of Bus_Info for I2C buses
 I2C_Bus_Info * detect_single_bus(int busno);
+I2C_Bus_Info * i2c_redetect_bus(int busno);
 void i2c_free_bus_info(I2C_Bus_Info * bus_info);
 
 // Simple Bus_Info retrieval
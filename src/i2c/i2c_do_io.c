@@ -49,14 +49,27 @@ I2C_IO_Strategy  i2c_file_io_strategy = {
       write_writer,
       read_reader,
       "read_writer",
-      "read_reader"
+      "read_reader",
+      NULL,
+      NULL
 };
 
 I2C_IO_Strategy i2c_ioctl_io_strategy = {
       ioctl_writer,
       ioctl_reader,
       "ioctl_writer",
-      "ioctl_reader"
+      "ioctl_reader",
+      NULL,
+      NULL
+};
+
+I2C_IO_Strategy i2c_ioctl_combined_io_strategy = {
+      ioctl_writer,
+      ioctl_reader,
+      "ioctl_writer",
+      "ioctl_reader",
+      ioctl_write_reader,
+      "ioctl_write_reader"
 };
 
 
@@ -74,10 +87,23 @@ void i2c_set_io_strategy(I2C_IO_Strategy_Id strategy_id) {
    case (I2C_IO_STRATEGY_IOCTL):
          i2c_io_strategy= &i2c_ioctl_io_strategy;
          break;
+   case (I2C_IO_STRATEGY_IOCTL_COMBINED):
+         i2c_io_strategy= &i2c_ioctl_combined_io_strategy;
+         break;
    }
 }
 
 
+/** Reports whether the currently active strategy can write and read
+ *  in a single transaction, using #invoke_i2c_write_reader().
+ *
+ *  @return true/false
+ */
+bool i2c_io_strategy_has_write_reader() {
+   return i2c_io_strategy->i2c_write_reader;
+}
+
+
 /** Writes to the I2C bus, using the function specified in the
  * currently active strategy.
  *
@@ -135,6 +161,44 @@ Status_Errno_DDC invoke_i2c_reader(
      return rc;
 }
 
+
+/** Writes to and then reads from the I2C bus in a single transaction,
+ * using the function specified in the currently active strategy.
+ *
+ * @param   fh              file handle for open /dev/i2c bus
+ * @param   write_bytect    number of bytes to write
+ * @param   bytes_to_write  pointer to bytes to be written
+ * @param   read_bytect     number of bytes to read
+ * @param   readbuf         location where bytes will be read to
+ * @return  status code
+ *
+ * @remark
+ * Must only be called if #i2c_io_strategy_has_write_reader() is true.
+ */
+Status_Errno_DDC invoke_i2c_write_reader(
+       int        fh,
+       int        write_bytect,
+       Byte *     bytes_to_write,
+       int        read_bytect,
+       Byte *     readbuf)
+{
+   bool debug = false;
+   DBGTRC(debug, TRACE_GROUP, "write_reader=%s, bytes_to_write=%s, read_bytect=%d",
+                 i2c_io_strategy->i2c_write_reader_name,
+                 hexstring_t(bytes_to_write, write_bytect), read_bytect);
+   assert(i2c_io_strategy->i2c_write_reader);
+
+   Status_Errno_DDC rc;
+   RECORD_IO_EVENT(
+      IE_WRITE_READ,
+      ( rc = i2c_io_strategy->i2c_write_reader(fh, write_bytect, bytes_to_write, read_bytect, readbuf) )
+     );
+   assert (rc <= 0);
+
+   DBGTRC(debug, TRACE_GROUP, "Returning rc=%s", psc_desc(rc));
+   return rc;
+}
+
 #ifdef TEST_THAT_DIDNT_WORK
 // fails
 Status_Errno_DDC invoke_single_byte_i2c_reader(
@@ -37,20 +37,24 @@
 
 /** Describes one I2C IO strategy */
 typedef struct {
-   I2C_Writer i2c_writer;          ///< writer function
-   I2C_Reader i2c_reader;          ///< read function
-   char *     i2c_writer_name;     ///< write function name
-   char *     i2c_reader_name;     ///< read function name
+   I2C_Writer       i2c_writer;              ///< writer function
+   I2C_Reader       i2c_reader;              ///< read function
+   char *           i2c_writer_name;         ///< write function name
+   char *           i2c_reader_name;         ///< read function name
+   I2C_Write_Reader i2c_write_reader;        ///< combined write/read function, may be NULL
+   char *           i2c_write_reader_name;   ///< combined write/read function name
 } I2C_IO_Strategy;
 
 // may need to move this definition to base
 /** I2C IO strategy ids */
 typedef enum {
-   I2C_IO_STRATEGY_FILEIO,    ///< use file write() and read()
-   I2C_IO_STRATEGY_IOCTL}     ///< use ioctl(I2C_RDWR)
+   I2C_IO_STRATEGY_FILEIO,            ///< use file write() and read()
+   I2C_IO_STRATEGY_IOCTL,             ///< use ioctl(I2C_RDWR)
+   I2C_IO_STRATEGY_IOCTL_COMBINED}    ///< use ioctl(I2C_RDWR), write/read in one transaction
 I2C_IO_Strategy_Id;
 
 void i2c_set_io_strategy(I2C_IO_Strategy_Id strategy_id);
+bool i2c_io_strategy_has_write_reader();
 
 Status_Errno_DDC invoke_i2c_writer(
       int    fh,
@@ -62,6 +66,13 @@ Status_Errno_DDC invoke_i2c_reader(
        int        bytect,
        Byte *     readbuf);
 
+Status_Errno_DDC invoke_i2c_write_reader(
+       int        fh,
+       int        write_bytect,
+       Byte *     bytes_to_write,
+       int        read_bytect,
+       Byte *     readbuf);
+
 #ifdef TEST_THAT_DIDNT_WORK
 Status_Errno_DDC invoke_single_byte_i2c_reader(
        int        fh,
@@ -15,13 +15,19 @@
 #include "base/base_init.h"
 #include "base/build_info.h"
 #include "base/core.h"
+#include "base/dynamic_sleep.h"
+#include "base/event_ring.h"
+#include "base/latency_stats.h"
 #include "base/parms.h"
 
 #include "adl/adl_shim.h"
 
+#include "ddc/ddc_display_lock.h"
+#include "ddc/ddc_dumpload.h"
 #include "ddc/ddc_multi_part_io.h"
 #include "ddc/ddc_packet_io.h"
 #include "ddc/ddc_services.h"
+#include "ddc/ddc_value_cache.h"
 #include "ddc/ddc_vcp.h"
 
 #include "public/ddcutil_c_api.h"
@@ -481,6 +487,66 @@ ddca_is_verify_enabled() {
 }
 
 
+bool
+ddca_enable_dynamic_sleep(bool onoff) {
+   return dsa_enable(onoff);
+}
+
+
+bool
+ddca_is_dynamic_sleep_enabled() {
+   return dsa_is_enabled();
+}
+
+
+bool
+ddca_enable_differential_load(bool onoff) {
+   return ddc_enable_differential_load(onoff);
+}
+
+
+bool
+ddca_is_differential_load_enabled() {
+   return ddc_is_differential_load_enabled();
+}
+
+
+bool
+ddca_enable_cross_process_lock(bool onoff) {
+   return ddc_enable_cross_process_lock(onoff);
+}
+
+
+bool
+ddca_is_cross_process_lock_enabled() {
+   return ddc_is_cross_process_lock_enabled();
+}
+
+
+int
+ddca_set_cross_process_lock_max_wait(int millis) {
+   return ddc_set_cross_process_lock_max_wait(millis);
+}
+
+
+bool
+ddca_enable_value_cache(bool onoff) {
+   return ddc_enable_value_cache(onoff);
+}
+
+
+bool
+ddca_is_value_cache_enabled() {
+   return ddc_is_value_cache_enabled();
+}
+
+
+bool
+ddca_bypass_value_cache(bool onoff) {
+   return ddc_bypass_value_cache(onoff);
+}
+
+
 
 #ifdef FUTURE
 
@@ -530,6 +596,20 @@ ddca_set_trace_groups(DDCA_Trace_Group trace_flags) {
 }
 
 
+bool
+ddca_enable_event_ring(bool onoff) {
+   return event_ring_enable(onoff);
+}
+
+
+DDCA_Status
+ddca_dump_event_ring(const char * filename) {
+   if (!filename)
+      return DDCRC_ARG;
+   return event_ring_dump(filename);
+}
+
+
 //
 // Statistics
 //
@@ -541,7 +621,6 @@ ddca_reset_stats(void) {
    ddc_reset_stats_main();
 }
 
-// TODO: Functions that return stats in data structures
 void
 ddca_show_stats(DDCA_Stats_Type stats_types, int depth) {
    ddc_report_stats_main( stats_types,    // stats to show
@@ -549,3 +628,39 @@ ddca_show_stats(DDCA_Stats_Type stats_types, int depth) {
 }
 
 
+DDCA_Status
+ddca_export_stats(
+      DDCA_Stats_Type    stats,
+      DDCA_Stats_Format  format,
+      bool               reset,
+      char **            text_loc)
+{
+   if (!text_loc)
+      return DDCRC_ARG;
+   if (format != DDCA_STATS_FORMAT_TEXT &&
+       format != DDCA_STATS_FORMAT_JSON &&
+       format != DDCA_STATS_FORMAT_PROMETHEUS)
+   {
+      *text_loc = NULL;
+      return DDCRC_ARG;
+   }
+   *text_loc = ddc_export_stats_main(stats, format, reset);
+   return DDCRC_OK;
+}
+
+
+DDCA_Status
+ddca_get_latency_stats(DDCA_Latency_Stats_List ** stats_loc) {
+   if (!stats_loc)
+      return DDCRC_ARG;
+   *stats_loc = get_latency_stats();
+   return DDCRC_OK;
+}
+
+
+void
+ddca_free_latency_stats(DDCA_Latency_Stats_List * stats) {
+   free(stats);
+}
+
+
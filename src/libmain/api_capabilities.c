@@ -32,6 +32,7 @@
 #include "dynvcp/dyn_feature_codes.h"
 #include "dynvcp/dyn_parsed_capabilities.h"
 
+#include "ddc/ddc_capabilities_cache.h"
 #include "ddc/ddc_read_capabilities.h"
 #include "ddc/ddc_vcp_version.h"
 
@@ -75,6 +76,24 @@ ddca_get_capabilities_string(
 }
 
 
+bool
+ddca_enable_capabilities_cache(bool onoff) {
+   return ddc_enable_capabilities_cache(onoff);
+}
+
+
+bool
+ddca_is_capabilities_cache_enabled() {
+   return ddc_is_capabilities_cache_enabled();
+}
+
+
+void
+ddca_discard_capabilities_cache() {
+   ddc_discard_capabilities_cache();
+}
+
+
 DDCA_Status
 ddca_parse_capabilities_string(
       char *                   capabilities_string,
@@ -16,6 +16,7 @@
 #include "public/ddcutil_c_api.h"
 
 #include "ddc/ddc_displays.h"
+#include "ddc/ddc_hotplug.h"
 #include "ddc/ddc_packet_io.h"
 #include "ddc/ddc_vcp_version.h"
 
@@ -854,3 +855,52 @@ ddca_report_displays(bool include_invalid_displays, int depth) {
    return ddc_report_displays(include_invalid_displays, depth);
 }
 
+
+//
+// Watch for displays being connected and disconnected
+//
+
+DDCA_Status
+ddca_register_display_event_callback(
+      DDCA_Display_Event_Callback  func,
+      void *                       data)
+{
+   free_thread_error_detail();
+   if (!func)
+      return DDCRC_ARG;
+   return (ddc_register_display_event_callback(func, data)) ? DDCRC_OK : DDCRC_INVALID_OPERATION;
+}
+
+
+DDCA_Status
+ddca_unregister_display_event_callback(
+      DDCA_Display_Event_Callback  func,
+      void *                       data)
+{
+   free_thread_error_detail();
+   return (ddc_unregister_display_event_callback(func, data)) ? DDCRC_OK : DDCRC_NOT_FOUND;
+}
+
+
+DDCA_Status
+ddca_start_watching_displays(void) {
+   assert(library_initialized);
+   free_thread_error_detail();
+   return ddc_start_hotplug_watch();
+}
+
+
+DDCA_Status
+ddca_stop_watching_displays(void) {
+   free_thread_error_detail();
+   ddc_stop_hotplug_watch();
+   return DDCRC_OK;
+}
+
+
+int
+ddca_redetect_displays(void) {
+   assert(library_initialized);
+   free_thread_error_detail();
+   return ddc_redetect_displays();
+}
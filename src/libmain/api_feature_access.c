@@ -29,6 +29,8 @@
 #include "ddc/ddc_dumpload.h"
 #include "ddc/ddc_vcp_version.h"
 #include "ddc/ddc_vcp.h"
+#include "ddc/ddc_watch.h"
+#include "ddc/ddc_worker_pool.h"
 
 #include "libmain/api_base_internal.h"
 #include "libmain/api_displays_internal.h"
@@ -274,6 +276,145 @@ ddca_get_any_vcp_value_using_implicit_type(
 }
 
 
+/** Reads all the features in a feature list from one display.
+ *
+ *  \param  dh            display handle
+ *  \param  feature_list  features to read
+ *  \return newly allocated #DDCA_Vcp_Value_Result_List
+ */
+static DDCA_Vcp_Value_Result_List *
+get_multiple_vcp_values_by_dh(
+       Display_Handle *     dh,
+       DDCA_Feature_List *  feature_list)
+{
+   bool debug = false;
+   int ct = ddca_feature_list_count(feature_list);
+   DBGMSF(debug, "Starting. dh=%s, feature count=%d", dh_repr_t(dh), ct);
+
+   DDCA_Vcp_Feature_Code * feature_codes = calloc(ct+1, sizeof(DDCA_Vcp_Feature_Code));
+   DDCA_Vcp_Value_Type *   value_types   = calloc(ct+1, sizeof(DDCA_Vcp_Value_Type));
+   DDCA_Any_Vcp_Value **   values        = calloc(ct+1, sizeof(DDCA_Any_Vcp_Value *));
+   DDCA_Status *           statuses      = calloc(ct+1, sizeof(DDCA_Status));
+
+   int ndx = 0;
+   for (int code = 0; code < 256; code++) {
+      if (ddca_feature_list_contains(feature_list, code)) {
+         feature_codes[ndx] = code;
+         if (get_value_type(dh, code, &value_types[ndx]) != 0)
+            value_types[ndx] = DDCA_NON_TABLE_VCP_VALUE;
+         ndx++;
+      }
+   }
+   assert(ndx == ct);
+
+   ddc_get_multiple_vcp_values(dh, ct, feature_codes, value_types, values, statuses);
+
+   DDCA_Vcp_Value_Result_List * results =
+         calloc(1, sizeof(DDCA_Vcp_Value_Result_List) + ct * sizeof(DDCA_Vcp_Value_Result));
+   results->ct = ct;
+   for (ndx = 0; ndx < ct; ndx++) {
+      results->results[ndx].feature_code = feature_codes[ndx];
+      results->results[ndx].status       = statuses[ndx];
+      results->results[ndx].value        = values[ndx];
+   }
+
+   free(feature_codes);
+   free(value_types);
+   free(values);
+   free(statuses);
+   DBGMSF(debug, "Done. Returning %p", results);
+   return results;
+}
+
+
+DDCA_Status
+ddca_get_multiple_vcp_values(
+       DDCA_Display_Handle            ddca_dh,
+       DDCA_Feature_List *            feature_list,
+       DDCA_Vcp_Value_Result_List **  results_loc)
+{
+   assert(feature_list);
+   assert(results_loc);
+   *results_loc = NULL;
+
+   WITH_DH(ddca_dh,
+      {
+         *results_loc = get_multiple_vcp_values_by_dh(dh, feature_list);
+      }
+   );
+}
+
+
+#define MULTI_DISPLAY_READ_MARKER "MDRD"
+typedef struct {
+   char                           marker[4];
+   Display_Handle *               dh;
+   DDCA_Feature_List *            feature_list;
+   DDCA_Vcp_Value_Result_List **  results_loc;
+} Multi_Display_Read;
+
+// function to be run in a worker pool thread
+static void pooled_get_multiple_vcp_values(gpointer data) {
+   Multi_Display_Read * parms = data;
+   assert(memcmp(parms->marker, MULTI_DISPLAY_READ_MARKER, 4) == 0);
+   *parms->results_loc = get_multiple_vcp_values_by_dh(parms->dh, parms->feature_list);
+}
+
+
+DDCA_Status
+ddca_get_multiple_vcp_values_on_displays(
+       int                            dh_ct,
+       DDCA_Display_Handle *          ddca_dhs,
+       DDCA_Feature_List *            feature_list,
+       DDCA_Vcp_Value_Result_List **  results_locs)
+{
+   bool debug = false;
+   DBGMSF(debug, "Starting. dh_ct=%d", dh_ct);
+   assert(library_initialized);
+   assert(feature_list);
+   assert(dh_ct == 0 || (ddca_dhs && results_locs));
+   free_thread_error_detail();
+
+   for (int ndx = 0; ndx < dh_ct; ndx++) {
+      results_locs[ndx] = NULL;
+      Display_Handle * dh = (Display_Handle *) ddca_dhs[ndx];
+      if ( !dh || memcmp(dh->marker, DISPLAY_HANDLE_MARKER, 4) != 0 )
+         return DDCRC_ARG;
+   }
+
+   // Reads for displays on different buses run concurrently, each in its own
+   // pool thread, so that the protocol sleeps on one bus overlap the
+   // exchanges on others.  Reads for a display are performed in order.
+   Multi_Display_Read * parms = calloc(dh_ct+1, sizeof(Multi_Display_Read));
+   DDC_Work_Group * group = ddc_work_group_new();
+   for (int ndx = 0; ndx < dh_ct; ndx++) {
+      Display_Handle * dh = (Display_Handle *) ddca_dhs[ndx];
+      memcpy(parms[ndx].marker, MULTI_DISPLAY_READ_MARKER, 4);
+      parms[ndx].dh           = dh;
+      parms[ndx].feature_list = feature_list;
+      parms[ndx].results_loc  = &results_locs[ndx];
+      ddc_worker_pool_submit(dh->dref->io_path, pooled_get_multiple_vcp_values, &parms[ndx], group);
+   }
+   ddc_work_group_wait_and_free(group);
+   free(parms);
+
+   DBGMSF(debug, "Done.");
+   return DDCRC_OK;
+}
+
+
+void
+ddca_free_vcp_value_result_list(
+       DDCA_Vcp_Value_Result_List *   results)
+{
+   if (results) {
+      for (int ndx = 0; ndx < results->ct; ndx++)
+         ddca_free_any_vcp_value(results->results[ndx].value);
+      free(results);
+   }
+}
+
+
 void
 ddca_free_table_vcp_value(
       DDCA_Table_Vcp_Value * table_value)
@@ -924,6 +1065,71 @@ ddca_set_profile_related_values(
 }
 
 
+//
+// Watch for VCP feature changes
+//
+
+DDCA_Status
+ddca_register_vcp_change_callback(
+      DDCA_Vcp_Change_Callback  func,
+      void *                    data)
+{
+   free_thread_error_detail();
+   if (!func)
+      return DDCRC_ARG;
+   return (ddc_register_vcp_change_callback(func, data)) ? DDCRC_OK : DDCRC_INVALID_OPERATION;
+}
+
+
+DDCA_Status
+ddca_unregister_vcp_change_callback(
+      DDCA_Vcp_Change_Callback  func,
+      void *                    data)
+{
+   free_thread_error_detail();
+   return (ddc_unregister_vcp_change_callback(func, data)) ? DDCRC_OK : DDCRC_NOT_FOUND;
+}
+
+
+DDCA_Status
+ddca_start_watching_vcp_changes(
+      int                 dref_ct,
+      DDCA_Display_Ref *  drefs)
+{
+   assert(library_initialized);
+   free_thread_error_detail();
+   if (dref_ct < 0 || (dref_ct > 0 && !drefs))
+      return DDCRC_ARG;
+   for (int ndx = 0; ndx < dref_ct; ndx++) {
+      Display_Ref * dref = (Display_Ref *) drefs[ndx];
+      if (!dref || memcmp(dref->marker, DISPLAY_REF_MARKER, 4) != 0)
+         return DDCRC_ARG;
+   }
+   return ddc_start_watch(dref_ct, (Display_Ref **) drefs);
+}
+
+
+DDCA_Status
+ddca_stop_watching_vcp_changes(void) {
+   free_thread_error_detail();
+   ddc_stop_watch();
+   return DDCRC_OK;
+}
+
+
+DDCA_Status
+ddca_set_vcp_change_poll_intervals(
+      int  fast_millis,
+      int  slow_millis)
+{
+   free_thread_error_detail();
+   if (fast_millis <= 0 || slow_millis < fast_millis)
+      return DDCRC_ARG;
+   ddc_set_watch_poll_intervals(fast_millis, slow_millis);
+   return DDCRC_OK;
+}
+
+
 //
 // Async operation - experimental
 //
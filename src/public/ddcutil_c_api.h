@@ -232,6 +232,130 @@ ddca_enable_verify(
 bool
 ddca_is_verify_enabled(void);
 
+/** Controls whether DDC protocol sleep times are adjusted for each display
+ *  based on the observed rate of DDC Null and all zero responses.
+ *
+ * \param[in] onoff true/false
+ * \return  prior value
+ *
+ * \remark This setting is global to all threads.
+ * \since 0.9.5
+ */
+bool
+ddca_enable_dynamic_sleep(
+      bool onoff);
+
+/** Query whether dynamic sleep adjustment is enabled.
+ * \retval true  sleep times are adjusted
+ * \retval false sleep times are as specified by the DDC protocol
+ *
+ * \since 0.9.5
+ */
+bool
+ddca_is_dynamic_sleep_enabled(void);
+
+/** Controls whether loading profile values (see #ddca_set_profile_related_values())
+ *  first reads the current feature values and writes only those that differ.
+ *
+ * \param[in] onoff true/false
+ * \return  prior value
+ *
+ * \remark This setting is global to all threads.
+ * \since 0.9.5
+ */
+bool
+ddca_enable_differential_load(
+      bool onoff);
+
+/** Query whether loading profile values writes only changed values.
+ * \retval true  only values that differ from the current values are written
+ * \retval false all values are written
+ *
+ * \since 0.9.5
+ */
+bool
+ddca_is_differential_load_enabled(void);
+
+/** Controls whether an open display is also locked against access by
+ *  other processes using ddcutil or libddcutil, so that their DDC exchanges
+ *  on the same bus do not interleave.
+ *
+ * \param[in] onoff true/false
+ * \return  prior value
+ *
+ * \remark This setting is global to all threads.
+ * \remark The lock is released when the display is closed or the process exits.
+ * \since 0.9.5
+ */
+bool
+ddca_enable_cross_process_lock(
+      bool onoff);
+
+/** Query whether open displays are locked against access by other processes.
+ * \retval true  cross process locking enabled
+ * \retval false cross process locking disabled
+ *
+ * \since 0.9.5
+ */
+bool
+ddca_is_cross_process_lock_enabled(void);
+
+/** Sets the maximum time #ddca_open_display2() waits for another process
+ *  to release a display, after which it fails with DDCRC_LOCKED.
+ *
+ * \param[in] millis  maximum wait in milliseconds, 0 for no wait
+ * \return  prior value
+ *
+ * \since 0.9.5
+ */
+int
+ddca_set_cross_process_lock_max_wait(
+      int millis);
+
+/** Controls whether recently read VCP feature values are cached, so that
+ *  repeated reads of the same feature do not each require a DDC exchange.
+ *
+ *  How long a value is retained depends on the feature.  Values of features
+ *  describing the monitor itself, e.g. xC8 and xDF, are retained for the
+ *  session.  Values of continuous features are retained briefly, those of
+ *  other read/write features somewhat longer.  Values of features that can
+ *  change at any time, e.g. x02 and x52, are never cached.  Writing any
+ *  feature discards the values cached for the display.
+ *
+ * \param[in] onoff true/false
+ * \return  prior value
+ *
+ * \remark This setting is global to all threads.
+ * \remark The cache is disabled by default.
+ * \since 0.9.5
+ */
+bool
+ddca_enable_value_cache(
+      bool onoff);
+
+/** Query whether VCP feature values are cached.
+ * \retval true  value cache enabled
+ * \retval false value cache disabled
+ *
+ * \since 0.9.5
+ */
+bool
+ddca_is_value_cache_enabled(void);
+
+/** Controls whether the current thread bypasses the value cache, so that
+ *  feature values are always read from the monitor.  Values read are
+ *  still saved in the cache.
+ *
+ * \param[in] onoff true/false
+ * \return  prior value
+ *
+ * \remark This setting is thread-specific.
+ * \since 0.9.5
+ */
+bool
+ddca_bypass_value_cache(
+      bool onoff);
+
 
 //
 // Output Redirection
@@ -367,6 +491,35 @@ void
 ddca_set_trace_groups(
       DDCA_Trace_Group trace_flags);
 
+/** Controls whether trace, I/O, sleep, and status code events are recorded
+ *  in per-thread event rings.
+ *
+ *  Recording is lightweight enough to be left enabled in production.
+ *  The most recent events for each thread are retained.
+ *
+ *  \param[in] onoff true/false
+ *  \return  prior value
+ *
+ *  \remark This setting is global to all threads.
+ *  \since 0.9.5
+ */
+bool
+ddca_enable_event_ring(
+      bool onoff);
+
+/** Writes the contents of the event rings to a file, which can be
+ *  rendered as text or Chrome trace JSON by command "ddcutil events".
+ *
+ *  \param[in] filename  name of file to write
+ *  \retval 0       success
+ *  \retval -errno  error writing file
+ *
+ *  \since 0.9.5
+ */
+DDCA_Status
+ddca_dump_event_ring(
+      const char * filename);
+
 
 //
 // Statistics and Diagnostics
@@ -388,7 +541,54 @@ ddca_show_stats(
       DDCA_Stats_Type stats,
       int             depth);
 
-// TODO: Add functions to get stats
+/** Exports execution statistics in a form suitable for monitoring tools.
+ *
+ *  \param[in]  stats     bitflags of statistics types to export
+ *  \param[in]  format    output format
+ *  \param[in]  reset     if true, reset the exported statistics
+ *  \param[out] text_loc  where to return a pointer to a newly allocated string
+ *  \retval DDCRC_OK      success
+ *  \retval DDCRC_ARG     text_loc is NULL or format is invalid
+ *
+ *  \remark
+ *  For #DDCA_STATS_FORMAT_JSON and #DDCA_STATS_FORMAT_PROMETHEUS, each
+ *  value is read and reset in a single atomic operation, so no event is lost
+ *  or counted twice when an application exports statistics periodically.
+ *  \remark
+ *  The caller is responsible for freeing the returned string.
+ *  \since 0.9.5
+ */
+DDCA_Status
+ddca_export_stats(
+      DDCA_Stats_Type    stats,
+      DDCA_Stats_Format  format,
+      bool               reset,
+      char **            text_loc);
+
+/** Gets latency statistics for each display, VCP feature, and operation type,
+ *  i.e. write, read, write/read, or sleep, for which an operation was recorded.
+ *
+ *  \param[out] stats_loc  where to return a pointer to a newly allocated
+ *                         #DDCA_Latency_Stats_List
+ *  \retval DDCRC_OK       success
+ *  \retval DDCRC_ARG      stats_loc is NULL
+ *
+ *  \remark
+ *  Use #ddca_free_latency_stats() to free the returned list.
+ *  \since 0.9.5
+ */
+DDCA_Status
+ddca_get_latency_stats(
+      DDCA_Latency_Stats_List ** stats_loc);
+
+/** Frees a #DDCA_Latency_Stats_List returned by #ddca_get_latency_stats().
+ *
+ *  \param[in] stats  pointer to list, may be NULL
+ *  \since 0.9.5
+ */
+void
+ddca_free_latency_stats(
+      DDCA_Latency_Stats_List * stats);
 
 /** Enable display of internal exception reports (Error_Info).
  *
@@ -746,12 +946,48 @@ ddca_display_ref_from_handle(
  *  @return     status code
  *
  *  It is the responsibility of the caller to free the returned string.
+ *
+ *  @remark
+ *  If the persistent capabilities cache is enabled, the string is taken
+ *  from the cache when available, and saved there after it has been read
+ *  from the monitor.
  */
 DDCA_Status
 ddca_get_capabilities_string(
       DDCA_Display_Handle     ddca_dh,
       char**                  caps_loc);
 
+/** Controls whether capabilities strings are saved in, and retrieved from,
+ *  a persistent cache keyed by EDID.
+ *
+ *  @param[in] onoff true/false
+ *  @return    prior value
+ *
+ *  @remark This setting is global to all threads.
+ *  @since 0.9.5
+ */
+bool
+ddca_enable_capabilities_cache(
+      bool onoff);
+
+/** Query whether the persistent capabilities cache is enabled.
+ *
+ *  @retval true  cache enabled
+ *  @retval false cache disabled
+ *
+ *  @since 0.9.5
+ */
+bool
+ddca_is_capabilities_cache_enabled(void);
+
+/** Discards all entries in the persistent capabilities cache,
+ *  forcing capabilities strings to be reread from the monitors.
+ *
+ *  @since 0.9.5
+ */
+void
+ddca_discard_capabilities_cache(void);
+
 /** Parse the capabilities string.
  *
  *  @param[in] capabilities_string      unparsed capabilities string
@@ -1391,6 +1627,74 @@ ddca_get_any_vcp_value_using_implicit_type(
        DDCA_Vcp_Feature_Code       feature_code,
        DDCA_Any_Vcp_Value **       valrec_loc);
 
+/** Gets the values of multiple VCP features in a single call.
+ *
+ *  The type of each feature is determined using ddcutil's internal
+ *  feature description table.  Features for which the type is unknown,
+ *  e.g. manufacturer-specific features, are read as non-table features.
+ *
+ *  This is considerably faster than reading the features individually,
+ *  as protocol sleeps are overlapped with processing and per-call
+ *  overhead is incurred once.
+ *
+ * @param[in]  ddca_dh       display handle
+ * @param[in]  feature_list  features to read
+ * @param[out] results_loc   address at which to return a pointer to a newly
+ *                           allocated #DDCA_Vcp_Value_Result_List
+ * @retval     DDCRC_OK      results returned, check the status of each feature
+ * @retval     DDCRC_ARG     invalid display handle
+ *
+ * @remark
+ * The status code for each feature is returned in its #DDCA_Vcp_Value_Result.
+ * No detailed error report is saved for individual features.
+ * @remark
+ * Free the result list using #ddca_free_vcp_value_result_list().
+ * @since 0.9.5
+ */
+DDCA_Status
+ddca_get_multiple_vcp_values(
+       DDCA_Display_Handle            ddca_dh,
+       DDCA_Feature_List *            feature_list,
+       DDCA_Vcp_Value_Result_List **  results_loc);
+
+/** Gets the values of multiple VCP features from each of several displays.
+ *
+ *  The displays are read concurrently.  Exchanges on one I2C bus overlap
+ *  the protocol sleeps on others, so for displays on separate buses the
+ *  elapsed time is close to that of reading a single display, rather than
+ *  the sum over all displays.  Features are read from each display in
+ *  ascending feature code order, as with #ddca_get_multiple_vcp_values().
+ *
+ * @param[in]  dh_ct         number of display handles
+ * @param[in]  ddca_dhs      array of **dh_ct** display handles
+ * @param[in]  feature_list  features to read
+ * @param[out] results_locs  array of **dh_ct** locations at which to return
+ *                           a pointer to a newly allocated #DDCA_Vcp_Value_Result_List
+ *                           for the corresponding display
+ * @retval     DDCRC_OK      results returned, check the status of each feature
+ * @retval     DDCRC_ARG     invalid display handle, nothing was read
+ *
+ * @remark
+ * Each display handle must be distinct and must not be used by
+ * another thread until this function returns.
+ * @since 0.9.5
+ */
+DDCA_Status
+ddca_get_multiple_vcp_values_on_displays(
+       int                            dh_ct,
+       DDCA_Display_Handle *          ddca_dhs,
+       DDCA_Feature_List *            feature_list,
+       DDCA_Vcp_Value_Result_List **  results_locs);
+
+/** Frees a #DDCA_Vcp_Value_Result_List, including the values it contains.
+ *
+ * @param[in] results  pointer to #DDCA_Vcp_Value_Result_List, may be NULL
+ * @since 0.9.5
+ */
+void
+ddca_free_vcp_value_result_list(
+       DDCA_Vcp_Value_Result_List *   results);
+
 /** Returns a string containing a formatted representation of the VCP value
  *  of a feature.  It is the responsibility of the caller to free this value.
  *
@@ -1556,6 +1860,160 @@ ddca_set_profile_related_values(
       char *               profile_values_string);
 
 
+//
+// Watch for VCP feature changes
+//
+
+/** Registers a function to be called when a change to a VCP feature value,
+ *  made using the monitor's controls, is detected on a watched display.
+ *
+ * @param[in] func   function to call
+ * @param[in] data   value passed to **func**
+ * @retval    DDCRC_OK               success
+ * @retval    DDCRC_ARG              **func** is NULL
+ * @retval    DDCRC_INVALID_OPERATION  **func** already registered with **data**
+ *
+ * @remark
+ * The function is called in a thread created by the library, and must
+ * not call #ddca_stop_watching_vcp_changes().
+ * @since 0.9.5
+ */
+DDCA_Status
+ddca_register_vcp_change_callback(
+      DDCA_Vcp_Change_Callback  func,
+      void *                    data);
+
+/** Unregisters a function registered using #ddca_register_vcp_change_callback().
+ *
+ * @param[in] func   function
+ * @param[in] data   value specified when the function was registered
+ * @retval    DDCRC_OK         success
+ * @retval    DDCRC_NOT_FOUND  function not registered with **data**
+ * @since 0.9.5
+ */
+DDCA_Status
+ddca_unregister_vcp_change_callback(
+      DDCA_Vcp_Change_Callback  func,
+      void *                    data);
+
+/** Starts watching displays for VCP feature changes.
+ *
+ *  Each display is watched by its own thread.  I2C displays are polled
+ *  using features x02 and x52, more frequently after a change and less
+ *  frequently when idle (see #ddca_set_vcp_change_poll_intervals()).
+ *  The display is opened only while it is polled.  USB connected monitors
+ *  report changes themselves, and are not polled.
+ *
+ * @param[in] dref_ct  number of display references
+ * @param[in] drefs    array of **dref_ct** display references
+ * @retval    DDCRC_OK                 success
+ * @retval    DDCRC_ARG                invalid display reference
+ * @retval    DDCRC_INVALID_OPERATION  a watch is already active
+ * @since 0.9.5
+ */
+DDCA_Status
+ddca_start_watching_vcp_changes(
+      int                 dref_ct,
+      DDCA_Display_Ref *  drefs);
+
+/** Stops watching displays for VCP feature changes, waiting for the
+ *  watch threads to terminate.  Does nothing if no watch is active.
+ *
+ * @return DDCRC_OK
+ * @since 0.9.5
+ */
+DDCA_Status
+ddca_stop_watching_vcp_changes(void);
+
+/** Sets the polling intervals used when watching I2C displays.
+ *  After a change is detected, a display is polled every **fast_millis**
+ *  milliseconds.  Each poll that finds no change doubles the interval,
+ *  up to **slow_millis**.
+ *
+ * @param[in] fast_millis  interval after a change
+ * @param[in] slow_millis  maximum interval, used when idle
+ * @retval    DDCRC_OK   success
+ * @retval    DDCRC_ARG  fast_millis <= 0 or slow_millis < fast_millis
+ * @since 0.9.5
+ */
+DDCA_Status
+ddca_set_vcp_change_poll_intervals(
+      int  fast_millis,
+      int  slow_millis);
+
+
+//
+// Watch for displays being connected and disconnected
+//
+
+/** Registers a function to be called when a display is connected or
+ *  disconnected.
+ *
+ * @param[in] func   function to call
+ * @param[in] data   value passed to **func**
+ * @retval    DDCRC_OK               success
+ * @retval    DDCRC_ARG              **func** is NULL
+ * @retval    DDCRC_INVALID_OPERATION  **func** already registered with **data**
+ *
+ * @remark
+ * The function is called in the thread performing redetection, and must
+ * not call #ddca_stop_watching_displays().
+ * @since 0.9.5
+ */
+DDCA_Status
+ddca_register_display_event_callback(
+      DDCA_Display_Event_Callback  func,
+      void *                       data);
+
+/** Unregisters a function registered using #ddca_register_display_event_callback().
+ *
+ * @param[in] func   function
+ * @param[in] data   value specified when **func** was registered
+ * @retval    DDCRC_OK         success
+ * @retval    DDCRC_NOT_FOUND  function not registered with **data**
+ * @since 0.9.5
+ */
+DDCA_Status
+ddca_unregister_display_event_callback(
+      DDCA_Display_Event_Callback  func,
+      void *                       data);
+
+/** Starts watching for displays being connected or disconnected, using
+ *  udev events.
+ *
+ *  Rather than redetecting all displays, only the I2C buses and USB devices
+ *  that may have changed are re-probed.  A display that is disconnected
+ *  remains a valid display reference, but attempts to open it fail with
+ *  DDCRC_INVALID_DISPLAY.
+ *
+ * @retval    DDCRC_OK                 success
+ * @retval    DDCRC_INVALID_OPERATION  already watching
+ * @retval    -errno                   unable to monitor udev events
+ * @since 0.9.5
+ */
+DDCA_Status
+ddca_start_watching_displays(void);
+
+/** Stops watching for displays being connected or disconnected, waiting
+ *  for the watch thread to terminate.  Does nothing if no watch is active.
+ *
+ * @return DDCRC_OK
+ * @since 0.9.5
+ */
+DDCA_Status
+ddca_stop_watching_displays(void);
+
+/** Checks for displays that have been connected or disconnected since they
+ *  were last detected, without watching for udev events.  Each change is
+ *  reported to the registered display event callbacks.
+ *
+ * @return number of displays connected or disconnected
+ * @since 0.9.5
+ */
+int
+ddca_redetect_displays(void);
+
+
 #ifdef __cplusplus
 }
 #endif
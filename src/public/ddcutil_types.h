@@ -160,6 +160,15 @@ typedef enum {
    DDCA_STATS_ALL      = 0xFF     ///< indicates all statistics types
 } DDCA_Stats_Type;
 
+//! Format in which statistics are exported, see #ddca_export_stats()
+//!
+//!  @since 0.9.5
+typedef enum {
+   DDCA_STATS_FORMAT_TEXT       = 0,   ///< report formatted for people, as shown by #ddca_show_stats()
+   DDCA_STATS_FORMAT_JSON       = 1,   ///< JSON object, keyed by metric name
+   DDCA_STATS_FORMAT_PROMETHEUS = 2    ///< Prometheus text exposition format
+} DDCA_Stats_Format;
+
 
 //
 // Output capture
@@ -321,6 +330,43 @@ typedef struct {
 } DDCA_IO_Path;
 
 
+//! Operation whose latency is recorded by #ddca_get_latency_stats()
+//!
+//! @since 0.9.5
+typedef enum {
+   DDCA_LATENCY_WRITE,          ///< write call
+   DDCA_LATENCY_READ,           ///< read call
+   DDCA_LATENCY_WRITE_READ,     ///< combined write/read call
+   DDCA_LATENCY_SLEEP,          ///< sleep mandated by the DDC protocol
+} DDCA_Latency_Event_Type;
+
+//! Latency of one operation type for one VCP feature on one display.
+//!
+//! Percentiles are estimated from a histogram with power of 2 buckets,
+//! and are accurate to within a factor of 2.
+//!
+//! @since 0.9.5
+typedef struct {
+   DDCA_IO_Path             io_path;        ///< display
+   int                      feature_code;   ///< VCP feature code, -1 if none, e.g. capabilities
+   DDCA_Latency_Event_Type  event_type;     ///< operation
+   int                      count;          ///< number of operations
+   uint64_t                 total_nanos;    ///< total elapsed time
+   uint64_t                 max_nanos;      ///< longest elapsed time
+   uint64_t                 p50_nanos;      ///< median elapsed time
+   uint64_t                 p95_nanos;      ///< 95th percentile elapsed time
+   uint64_t                 p99_nanos;      ///< 99th percentile elapsed time
+} DDCA_Latency_Stats;
+
+//! Collection of #DDCA_Latency_Stats
+//!
+//! @since 0.9.5
+typedef struct {
+   int                 ct;         ///< number of records
+   DDCA_Latency_Stats  stats[];    ///< array whose size is determined by ct
+} DDCA_Latency_Stats_List;
+
+
 // Maximum length of strings extracted from EDID, plus 1 for trailing NULL
 #define DDCA_EDID_MFG_ID_FIELD_SIZE 4
 #define DDCA_EDID_MODEL_NAME_FIELD_SIZE 14
@@ -528,4 +574,63 @@ typedef struct {
 #define VALREC_CUR_VAL(valrec) ( valrec->val.c_nc.sh << 8 | valrec->val.c_nc.sl )
 #define VALREC_MAX_VAL(valrec) ( valrec->val.c_nc.mh << 8 | valrec->val.c_nc.ml )
 
+
+/** Result of reading one feature using #ddca_get_multiple_vcp_values() */
+typedef struct {
+   DDCA_Vcp_Feature_Code  feature_code;   /**< VCP feature code */
+   DDCA_Status            status;         /**< status code of the read */
+   DDCA_Any_Vcp_Value *   value;          /**< value read, NULL if status is not 0 */
+} DDCA_Vcp_Value_Result;
+
+/** Results of #ddca_get_multiple_vcp_values(), in ascending feature code order */
+typedef struct {
+   int                    ct;             /**< number of results */
+   DDCA_Vcp_Value_Result  results[];      /**< array whose size is determined by ct */
+} DDCA_Vcp_Value_Result_List;
+
+
+//
+// Watch for VCP feature changes
+//
+
+/** Describes a change to a VCP feature value made using the monitor's controls */
+typedef struct {
+   DDCA_Display_Ref          dref;             /**< display on which the change occurred */
+   DDCA_Vcp_Feature_Code     feature_code;     /**< changed feature */
+   DDCA_Status               status;           /**< status of reading the new value,
+                                                    #DDCRC_INVALID_OPERATION if a table feature */
+   DDCA_Non_Table_Vcp_Value  value;            /**< new value, valid if status is 0 */
+   uint64_t                  timestamp_nanos;  /**< time change detected, CLOCK_REALTIME */
+} DDCA_Vcp_Change_Event;
+
+/** Signature of a function called when a VCP feature value change is detected.
+ *  The event is valid only for the duration of the call. */
+typedef void (*DDCA_Vcp_Change_Callback)(DDCA_Vcp_Change_Event * event, void * data);
+
+
+//
+// Display hotplug events
+//
+
+/** Type of display hotplug event */
+typedef enum {
+   DDCA_DISPLAY_ADDED   = 1,    /**< display connected */
+   DDCA_DISPLAY_REMOVED = 2     /**< display disconnected */
+} DDCA_Display_Event_Type;
+
+/** Describes a display being connected or disconnected */
+typedef struct {
+   DDCA_Display_Event_Type   event_type;       /**< added or removed */
+   DDCA_Display_Ref          dref;             /**< display reference, for a removed display
+                                                    remains valid but cannot be opened */
+   DDCA_IO_Path              io_path;          /**< physical access path to display */
+   int                       dispno;           /**< display number, -1 if the display
+                                                    does not support DDC */
+   uint64_t                  timestamp_nanos;  /**< time change detected, CLOCK_REALTIME */
+} DDCA_Display_Event;
+
+/** Signature of a function called when a display is connected or disconnected.
+ *  The event is valid only for the duration of the call. */
+typedef void (*DDCA_Display_Event_Callback)(DDCA_Display_Event * event, void * data);
+
 #endif /* DDCUTIL_TYPES_H_ */
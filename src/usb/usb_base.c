@@ -77,7 +77,8 @@ int usb_open_hiddev_device(
                  hiddev_devname, calloptions, interpret_call_options_t(calloptions) );
 
    int  file;
-   int mode = (calloptions & CALLOPT_RDONLY) ? O_RDONLY : O_RDWR;
+   // O_CLOEXEC: a child process must not inherit the display lock, see lock_display_device()
+   int mode = ((calloptions & CALLOPT_RDONLY) ? O_RDONLY : O_RDWR) | O_CLOEXEC;
 
    RECORD_IO_EVENT(
          IE_OPEN,
@@ -298,6 +298,100 @@ static char * usb_synthesize_capabilities_string(Usb_Monitor_Info * moninfo) {
 // Probe HID devices, create USB_Mon_Info data stuctures
 //
 
+/*  Examines a hiddev device to see if it is a USB HID compliant monitor.
+ *  If so, obtains the EDID, determines which reports to use for VCP feature
+ *  values, etc.
+ *
+ *  Arguments:
+ *    hiddev_fn    device name, e.g. /dev/usb/hiddev0
+ *    ol           output level, messages are issued if verbose
+ *
+ *  Returns:   newly allocated Usb_Monitor_Info, NULL if not a monitor
+ */
+static Usb_Monitor_Info * probe_hiddev_monitor(char * hiddev_fn, DDCA_Output_Level ol) {
+   bool debug = false;
+   DBGMSF(debug, "Examining device: %s", hiddev_fn);
+   Usb_Monitor_Info * moninfo = NULL;
+
+   // will need better message handling for API
+   Byte calloptions = CALLOPT_RDONLY;
+   if (ol >= DDCA_OL_VERBOSE)
+      calloptions |= CALLOPT_ERR_MSG;
+   int fd = usb_open_hiddev_device(hiddev_fn, calloptions);
+   if (fd < 0 && ol >= DDCA_OL_VERBOSE) {
+      Usb_Detailed_Device_Summary * devsum = lookup_udev_usb_device_by_devname(hiddev_fn);
+      if (devsum) {
+         // report_usb_detailed_device_summary(devsum, 2);
+         f0printf(fout(), "  USB bus %s, device %s, vid:pid: %s:%s - %s:%s\n",
+                        devsum->busnum_s,
+                        devsum->devnum_s,
+                        devsum->vendor_id,
+                        devsum->product_id,
+                        devsum->vendor_name,
+                        devsum->product_name);
+         free_usb_detailed_device_summary(devsum);
+      }
+   }
+   else if (fd > 1) {     // fd == 0 should never occur
+      // Declare variables here and initialize them to NULL so that code at label close: works
+      struct hiddev_devinfo *   devinfo     = NULL;
+      char *                    cgname      = NULL;
+      Parsed_Edid *             parsed_edid = NULL;
+      GPtrArray *               vcp_reports = NULL;
+
+      cgname = get_hiddev_name(fd);               // HIDIOCGNAME
+      devinfo = calloc(1,sizeof(struct hiddev_devinfo));
+      if ( hiddev_get_device_info(fd, devinfo, CALLOPT_ERR_MSG) != 0 )
+         goto close;
+      if (!is_hiddev_monitor(fd))
+         goto close;
+
+      parsed_edid = get_hiddev_edid_with_fallback(fd, devinfo);
+      if (!parsed_edid) {
+         f0printf(ferr(),
+                 "Monitor on device %s reports no EDID or has invalid EDID. Ignoring.\n",
+                 hiddev_fn);
+         goto close;
+      }
+
+      vcp_reports = collect_vcp_reports(fd);
+
+      moninfo = calloc(1,sizeof(Usb_Monitor_Info));
+      memcpy(moninfo->marker, USB_MONITOR_INFO_MARKER, 4);
+      moninfo-> hiddev_device_name = strdup(hiddev_fn);
+      moninfo->edid = parsed_edid;
+      moninfo->hiddev_devinfo = devinfo;
+      devinfo = NULL;        // so that struct not freed
+
+      // Distribute the accumulated vcp reports by feature code
+      for (int ndx = 0; ndx < vcp_reports->len; ndx++) {
+          Usb_Monitor_Vcp_Rec * cur_vcp_rec = g_ptr_array_index(vcp_reports, ndx);
+          Byte curvcp = cur_vcp_rec->vcp_code;
+          GPtrArray * cur_code_table_entry = moninfo->vcp_codes[curvcp];
+          if (!cur_code_table_entry) {
+             cur_code_table_entry = g_ptr_array_new();
+             moninfo->vcp_codes[curvcp] = cur_code_table_entry;
+          }
+          g_ptr_array_add(cur_code_table_entry, cur_vcp_rec);
+      }
+      // free vcp_reports without freeing the entries, which are now pointed to
+      // by moninfo->vcp_codes
+      // n. no free function set
+      g_ptr_array_free(vcp_reports, true);
+
+close:
+      if (devinfo)
+         free(devinfo);
+      if (cgname)
+         free(cgname);
+      usb_close_device(fd, hiddev_fn, CALLOPT_NONE); // return error if failure
+   }  // monitor opened
+
+   DBGMSF(debug, "Returning %p", moninfo);
+   return moninfo;
+}
+
+
 /*  Examines all hiddev devices to see if they are USB HID compliant monitors.
  *  If so, obtains the EDID, determines which reports to use for VCP feature
  *  values, etc.
@@ -319,83 +413,9 @@ GPtrArray * get_usb_monitor_list() {
    GPtrArray * hiddev_names = get_hiddev_device_names();
    for (int devname_ndx = 0; devname_ndx < hiddev_names->len; devname_ndx++) {
       char * hiddev_fn = g_ptr_array_index(hiddev_names, devname_ndx);
-      DBGMSF(debug, "Examining device: %s", hiddev_fn);
-      // will need better message handling for API
-      Byte calloptions = CALLOPT_RDONLY;
-      if (ol >= DDCA_OL_VERBOSE)
-         calloptions |= CALLOPT_ERR_MSG;
-      int fd = usb_open_hiddev_device(hiddev_fn, calloptions);
-      if (fd < 0 && ol >= DDCA_OL_VERBOSE) {
-         Usb_Detailed_Device_Summary * devsum = lookup_udev_usb_device_by_devname(hiddev_fn);
-         if (devsum) {
-            // report_usb_detailed_device_summary(devsum, 2);
-            f0printf(fout(), "  USB bus %s, device %s, vid:pid: %s:%s - %s:%s\n",
-                           devsum->busnum_s,
-                           devsum->devnum_s,
-                           devsum->vendor_id,
-                           devsum->product_id,
-                           devsum->vendor_name,
-                           devsum->product_name);
-            free_usb_detailed_device_summary(devsum);
-         }
-      }
-      else if (fd > 1) {     // fd == 0 should never occur
-         // Declare variables here and initialize them to NULL so that code at label close: works
-         struct hiddev_devinfo *   devinfo     = NULL;
-         char *                    cgname      = NULL;
-         Parsed_Edid *             parsed_edid = NULL;
-         GPtrArray *               vcp_reports = NULL;
-         Usb_Monitor_Info *        moninfo =     NULL;
-
-         cgname = get_hiddev_name(fd);               // HIDIOCGNAME
-         devinfo = calloc(1,sizeof(struct hiddev_devinfo));
-         if ( hiddev_get_device_info(fd, devinfo, CALLOPT_ERR_MSG) != 0 )
-            goto close;
-         if (!is_hiddev_monitor(fd))
-            goto close;
-
-         parsed_edid = get_hiddev_edid_with_fallback(fd, devinfo);
-         if (!parsed_edid) {
-            f0printf(ferr(),
-                    "Monitor on device %s reports no EDID or has invalid EDID. Ignoring.\n",
-                    hiddev_fn);
-            goto close;
-         }
-
-         vcp_reports = collect_vcp_reports(fd);
-
-         moninfo = calloc(1,sizeof(Usb_Monitor_Info));
-         memcpy(moninfo->marker, USB_MONITOR_INFO_MARKER, 4);
-         moninfo-> hiddev_device_name = strdup(hiddev_fn);
-         moninfo->edid = parsed_edid;
-         moninfo->hiddev_devinfo = devinfo;
-         devinfo = NULL;        // so that struct not freed
-
-         // Distribute the accumulated vcp reports by feature code
-         for (int ndx = 0; ndx < vcp_reports->len; ndx++) {
-             Usb_Monitor_Vcp_Rec * cur_vcp_rec = g_ptr_array_index(vcp_reports, ndx);
-             Byte curvcp = cur_vcp_rec->vcp_code;
-             GPtrArray * cur_code_table_entry = moninfo->vcp_codes[curvcp];
-             if (!cur_code_table_entry) {
-                cur_code_table_entry = g_ptr_array_new();
-                moninfo->vcp_codes[curvcp] = cur_code_table_entry;
-             }
-             g_ptr_array_add(cur_code_table_entry, cur_vcp_rec);
-         }
-         // free vcp_reports without freeing the entries, which are now pointed to
-         // by moninfo->vcp_codes
-         // n. no free function set
-         g_ptr_array_free(vcp_reports, true);
-
+      Usb_Monitor_Info * moninfo = probe_hiddev_monitor(hiddev_fn, ol);
+      if (moninfo)
          g_ptr_array_add(usb_monitors, moninfo);
-
- close:
-         if (devinfo)
-            free(devinfo);
-         if (cgname)
-            free(cgname);
-         usb_close_device(fd, hiddev_fn, CALLOPT_NONE); // return error if failure
-      }  // monitor opened
    } // loop over device names
 
    g_ptr_array_set_free_func(hiddev_names, free);
@@ -410,6 +430,50 @@ GPtrArray * get_usb_monitor_list() {
 }
 
 
+/*  Re-examines a single hiddev device after a hotplug event, replacing its
+ *  entry in the cached monitor list, adding an entry if the device is a
+ *  newly connected monitor, or removing the entry if the device is gone.
+ *
+ *  Other threads may be iterating over the list, or using the replaced
+ *  Usb_Monitor_Info as the detail of a Display_Ref.  So the list is replaced
+ *  by an updated copy, and neither the prior list nor its entries are freed.
+ *
+ *  Arguments:
+ *    hiddev_fn    device name, e.g. /dev/usb/hiddev0
+ *
+ *  Returns:   newly allocated Usb_Monitor_Info, NULL if not a monitor
+ *
+ *  Must not be called concurrently with itself.
+ */
+Usb_Monitor_Info * usb_redetect_hiddev_monitor(char * hiddev_fn) {
+   bool debug = false;
+   DBGMSF(debug, "Starting. hiddev_fn=%s", hiddev_fn);
+   static GPtrArray * retired_monitor_lists = NULL;
+
+   GPtrArray * old_monitors = get_usb_monitor_list();
+   Usb_Monitor_Info * moninfo = NULL;
+   if (access(hiddev_fn, F_OK) == 0)
+      moninfo = probe_hiddev_monitor(hiddev_fn, DDCA_OL_NORMAL);
+
+   GPtrArray * new_monitors = g_ptr_array_sized_new(old_monitors->len + 1);
+   for (int ndx = 0; ndx < old_monitors->len; ndx++) {
+      Usb_Monitor_Info * curmon = g_ptr_array_index(old_monitors, ndx);
+      if (!streq(curmon->hiddev_device_name, hiddev_fn))
+         g_ptr_array_add(new_monitors, curmon);
+   }
+   if (moninfo)
+      g_ptr_array_add(new_monitors, moninfo);
+   g_atomic_pointer_set(&usb_monitors, new_monitors);
+
+   if (!retired_monitor_lists)
+      retired_monitor_lists = g_ptr_array_new();
+   g_ptr_array_add(retired_monitor_lists, old_monitors);
+
+   DBGMSF(debug, "Returning %p", moninfo);
+   return moninfo;
+}
+
+
 
 //
 // Functions to find Usb_Monitor_Info for a display
@@ -418,10 +482,11 @@ GPtrArray * get_usb_monitor_list() {
 static Usb_Monitor_Info * usb_find_monitor_by_busnum_devnum(int busnum, int devnum) {
    bool debug = false;
    DBGMSF(debug, "Starting. busnum=%d, devnum=%d", busnum, devnum);
-   assert(usb_monitors);
+   GPtrArray * monitors = usb_monitors;    // n. may be replaced by usb_redetect_hiddev_monitor()
+   assert(monitors);
    Usb_Monitor_Info * result = NULL;
-   for (int ndx = 0; ndx < usb_monitors->len; ndx++) {
-      struct usb_monitor_info * curmon = g_ptr_array_index(usb_monitors, ndx);
+   for (int ndx = 0; ndx < monitors->len; ndx++) {
+      struct usb_monitor_info * curmon = g_ptr_array_index(monitors, ndx);
       struct hiddev_devinfo * devinfo = curmon->hiddev_devinfo;
       if (busnum == devinfo->busnum &&
           devnum == devinfo->devnum)
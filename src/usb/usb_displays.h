@@ -102,5 +102,6 @@ void report_usb_monitor_info(Usb_Monitor_Info * moninfo, int depth);
 Usb_Monitor_Info * usb_find_monitor_by_display_handle(Display_Handle * dh);
 
 GPtrArray * get_usb_monitor_list();
+Usb_Monitor_Info * usb_redetect_hiddev_monitor(char * hiddev_fn);
 
 #endif /* USB_DISPLAYS_H_ */
@@ -590,9 +590,9 @@ void probe_libusb(bool possible_monitors_only, int depth) {
    if (debug)
       printf("(%s) Starting\n", __func__);
 
-   bool ok = devid_ensure_initialized();
+   bool ok = devid_usb_ids_available();
    if (!ok) {
-      printf("(%s) devid_ensure_initialized() failed.  Terminating probe_libusb()\n", __func__);
+      printf("(%s) devid_usb_ids_available() failed.  Terminating probe_libusb()\n", __func__);
       return;
    }
 
@@ -648,9 +648,9 @@ bool libusb_is_monitor_by_path(ushort busno, ushort devno, ushort intfno) {
 
    if (intfno == 0) {     // monitors never have more than 1 interface
 
-      bool ok = devid_ensure_initialized();
+      bool ok = devid_usb_ids_available();
       if (!ok) {
-         printf("(%s) devid_ensure_initialized() failed.  Terminating probe_libusb()\n", __func__);
+         printf("(%s) devid_usb_ids_available() failed.  Terminating probe_libusb()\n", __func__);
          goto bye;
       }
 
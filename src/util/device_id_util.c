@@ -23,13 +23,24 @@
 
 /** @file device_id_util.c
  * Lookup PCI and USB device ids
+ *
+ * The contents of pci.ids and usb.ids are compiled into a compact binary
+ * index, which is cached in the user's XDG cache directory and memory
+ * mapped on subsequent use.  Only the tables needed are loaded, and a
+ * cached index is used only if the path, modification time, and size of
+ * the source file are unchanged.  If the index cannot be cached, it is
+ * built in memory.
+ *
+ * The index is a single array of #Id_Index_Entry, in which the children of
+ * each entry occupy a contiguous range sorted by id, so that each level
+ * of a lookup is a binary search.
  */
 
 /** \cond */
 #include <assert.h>
 #include <ctype.h>
-#include <dirent.h>
 #include <errno.h>
+#include <fcntl.h>
 #include <glib-2.0/glib.h>
 #include <limits.h>
 #include <linux/limits.h>
@@ -37,13 +48,13 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sys/mman.h>
 #include <sys/stat.h>
 #include <time.h>
 #include <unistd.h>
 /** \endcond */
 
 #include "file_util.h"
-#include "multi_level_map.h"
 #include "report_util.h"
 #include "string_util.h"
 
@@ -114,628 +125,564 @@ char * devid_find_file(Device_Id_Type id_type) {
 
 
 //
-// Simple_Id_Table
+// *** Index format ***
 //
-// A simple data structure for the simple case where there is only a single
-// level of lookup
+
+/** Tables in an index.  Only #ID_TABLE_DEVICES is present for pci.ids */
+typedef enum {
+   ID_TABLE_DEVICES,     ///< vendor, device, subsystem (pci.ids) or interface (usb.ids)
+   ID_TABLE_HID,         ///< HID descriptor types,      tag HID
+   ID_TABLE_HID_ITEM,    ///< HID descriptor item types, tag R
+   ID_TABLE_HCC,         ///< HID country codes,         tag HCC
+   ID_TABLE_HUT,         ///< HID usage pages and usage ids, tag HUT
+   ID_TABLE_CT
+} Id_Table;
+
+#define ID_INDEX_MAX_LEVELS      3
+#define ID_INDEX_MAGIC           "DEVIDIDX"
+#define ID_INDEX_FORMAT_VERSION  1
+#define ID_INDEX_BYTE_ORDER      0x01020304
 
 typedef struct {
-   ushort  id;
-   char *  name;
-} Simple_Id_Table_Entry;
+   char      magic[8];
+   uint32_t  format_version;
+   uint32_t  byte_order;               // detects an index built on another architecture
+   int64_t   source_mtime_sec;
+   int64_t   source_mtime_nsec;
+   int64_t   source_size;
+   uint32_t  source_fn_offset;         // in string pool
+   uint32_t  entry_ct;
+   uint32_t  entries_offset;           // from start of index
+   uint32_t  strings_offset;           // from start of index
+   uint32_t  strings_size;
+   uint32_t  tables[ID_TABLE_CT][2];   // first entry, count of top level entries
+} Id_Index_Header;
 
+typedef struct {
+   uint32_t  id;
+   uint32_t  name_offset;              // in string pool
+   uint32_t  child_first;              // index of first child entry
+   uint32_t  child_ct;
+} Id_Index_Entry;
 
-typedef GPtrArray  Simple_Id_Table;    // array of Simple_Id_Table_Entry
-/* Creates a new Simple_Id_Table
- *
- * Arguments:
- *    initial_size     if > 0, size for initial allocation
- *
- * Returns:            pointer to newly allocated table
- */
-static Simple_Id_Table *
-create_simple_id_table(int initial_size) {
-   Simple_Id_Table * new_table = NULL;
-   if (initial_size > 0)
-      new_table = g_ptr_array_sized_new(initial_size);
-   else
-      new_table = g_ptr_array_new();
-   // printf("(%s) Returning: %p\n", __func__, new_table);
-   return new_table;
+typedef struct {
+   void *                   data;      // mapped file, or index built in memory
+   size_t                   size;
+   bool                     mapped;
+   const Id_Index_Header *  header;
+   const Id_Index_Entry *   entries;
+   const char *             strings;
+} Id_Index;
+
+// stats 12/2015:
+//   lines in pci.ids:  25,339
+//   vendors:            2,066
+//   total devices:     11,745
+//   subsystem:         10,974
+
+static GMutex     index_mutex;                   // guards loading of the following
+static Id_Index * id_indexes[2];                 // indexed by Device_Id_Type
+static bool       id_index_loaded[2];            // load attempted?
+
+
+//
+// *** Index construction ***
+//
+
+typedef struct {
+   uint32_t  id;
+   uint32_t  name_offset;
+   int       table;
+   int       level;
+   int       parent;       // index in nodes, -1 if top level
+   uint32_t  position;     // index in entry array
+} Build_Node;
+
+typedef struct {
+   GArray *     nodes;                           // Build_Node
+   GByteArray * strings;
+   int          cur_nodes[ID_INDEX_MAX_LEVELS];  // most recent node at each level, -1 if none
+} Index_Builder;
+
+
+static uint32_t builder_add_string(Index_Builder * builder, const char * s) {
+   uint32_t offset = builder->strings->len;
+   g_byte_array_append(builder->strings, (const guint8 *) s, strlen(s)+1);
+   return offset;
 }
 
 
-/* Adds an entry to a Simple_Id_Table
- *
- * Arguments:
- *   simple_table  pointer to Simple_Id_Table
- *   id            key of entry
- *   name          value of entry
- */
-static Simple_Id_Table_Entry *
-sit_add(Simple_Id_Table * simple_table, ushort id, char * name) {
-   Simple_Id_Table_Entry * new_entry = calloc(1, sizeof(Simple_Id_Table_Entry));
-   new_entry->id = id;
-   new_entry->name = strdup(name);
-   g_ptr_array_add(simple_table, new_entry);
-   return new_entry;
+// Forgets the current node at a level and all lower levels,
+// so that subsequent lines at lower levels are ignored
+static void builder_reset_level(Index_Builder * builder, int level) {
+   for (int ndx = level; ndx < ID_INDEX_MAX_LEVELS; ndx++)
+      builder->cur_nodes[ndx] = -1;
 }
 
 
-void
-report_simple_id_table(Simple_Id_Table * simple_table, int depth) {
-   rpt_structure_loc("Simple_Id_Table", simple_table, depth);
-   for (int ndx = 0; ndx < simple_table->len; ndx++) {
-      Simple_Id_Table_Entry * cur_entry = g_ptr_array_index(simple_table, ndx);
-      rpt_vstring(depth+1, "0x%04x -> |%s|", cur_entry->id, cur_entry->name);
-   }
+static void builder_add_node(Index_Builder * builder, Id_Table table, int level, uint32_t id, char * name) {
+   assert(level < ID_INDEX_MAX_LEVELS);
+   int parent = (level > 0) ? builder->cur_nodes[level-1] : -1;
+   if (level > 0 && parent < 0)
+      return;        // no enclosing node, e.g. following a line in error
+   Build_Node node = {id, builder_add_string(builder, name), table, level, parent, 0};
+   g_array_append_val(builder->nodes, node);
+   builder_reset_level(builder, level);
+   builder->cur_nodes[level] = builder->nodes->len-1;
 }
 
-char * get_simple_id_name(Simple_Id_Table * simple_table, ushort id) {
-   char * result = NULL;
-   for (int ndx = 0; ndx < simple_table->len; ndx++) {
-      Simple_Id_Table_Entry * cur_entry = g_ptr_array_index(simple_table, ndx);
-      if (cur_entry->id == id) {
-         result = cur_entry->name;
-         break;
-      }
+
+// Orders nodes so that top level nodes are grouped by table and the children
+// of each node are contiguous, in both cases sorted by id.  Ties are broken
+// by the order in the source file, so that the first of duplicates is found.
+static gint compare_build_nodes(gconstpointer a, gconstpointer b, gpointer data) {
+   Build_Node * nodes = data;
+   int andx = *(const int *) a;
+   int bndx = *(const int *) b;
+   Build_Node * na = &nodes[andx];
+   Build_Node * nb = &nodes[bndx];
+   if (na->level == 0) {
+      if (na->table != nb->table)
+         return (na->table < nb->table) ? -1 : 1;
    }
-   return result;
+   else {
+      uint32_t apos = nodes[na->parent].position;
+      uint32_t bpos = nodes[nb->parent].position;
+      if (apos != bpos)
+         return (apos < bpos) ? -1 : 1;
+   }
+   if (na->id != nb->id)
+      return (na->id < nb->id) ? -1 : 1;
+   return (andx < bndx) ? -1 : (andx > bndx);
 }
 
 
+/* Parses the lines of a pci.ids or usb.ids file.
+ *
+ * Arguments:
+ *    builder     accumulates nodes
+ *    id_type     ID_TYPE_PCI or ID_TYPE_USB
+ *    contents    file contents, modified by this function
+ */
+static void parse_id_file(Index_Builder * builder, Device_Id_Type id_type, char * contents) {
+   bool debug = false;
+   int total_nodes[ID_TABLE_CT] = {0};
+   bool device_ids_done = false;    // end of device id section seen?
+   int  segment_table = -1;         // table of current segment after device ids
 
-//
-// *** Global Variables ***
-//
+   char * a_line = contents;
+   while (a_line) {
+      char * next_line = strchr(a_line, '\n');
+      if (next_line)
+         *next_line++ = '\0';
 
-// stats 12/2015:
-//   lines in pci.ids:  25,339
-//   vendors:            2,066
-//   total devices:     11,745
-//   subsystem:         10,974
+      int tabct = 0;
+      while (a_line[tabct] == '\t')
+         tabct++;
+      if (strlen(rtrim_in_place(a_line+tabct)) == 0 || a_line[tabct] == '#')
+         goto next;
+
+      // usb.ids: hacky test for end of id section, the C (class) segment follows
+      if (!device_ids_done && id_type == ID_TYPE_USB && a_line[tabct] == 'C')
+         device_ids_done = true;
+
+      if (!device_ids_done) {
+         ushort cur_id = 0;
+         ushort cur_subdevice_id = 0;
+         char * cur_name = NULL;
+         int ct;
+         switch(tabct) {
+         case 0:         // vendor
+         case 1:         // device or product
+            ct = sscanf(a_line+tabct, "%4hx %m[^\n]", &cur_id, &cur_name);
+            if (ct != 2) {
+               printf("(%s) Error reading line: %s\n", __func__, a_line+tabct);
+               builder_reset_level(builder, tabct);
+            }
+            else {
+               builder_add_node(builder, ID_TABLE_DEVICES, tabct, cur_id, cur_name);
+               total_nodes[ID_TABLE_DEVICES]++;
+               // usb.ids has no final ffff field, test works only for pci.ids
+               if (tabct == 0 && cur_id == 0xffff)
+                  device_ids_done = true;
+            }
+            break;
+         case 2:         // subsystem or interface
+            if (id_type == ID_TYPE_PCI) {
+               ct = sscanf(a_line+tabct, "%4hx %4hx %m[^\n]", &cur_id, &cur_subdevice_id, &cur_name);
+               if (ct == 3)
+                  builder_add_node(builder, ID_TABLE_DEVICES, 2, (uint32_t) cur_id << 16 | cur_subdevice_id, cur_name);
+            }
+            else {
+               ct = sscanf(a_line+tabct, "%4hx  %m[^\n]", &cur_id, &cur_name);
+               if (ct == 2)
+                  builder_add_node(builder, ID_TABLE_DEVICES, 2, cur_id, cur_name);
+            }
+            if (cur_name)
+               total_nodes[ID_TABLE_DEVICES]++;
+            else
+               printf("(%s) Error reading line: %s\n", __func__, a_line+tabct);
+            break;
+         default:
+            printf("Unexpected number of leading tabs in line: %s\n", a_line);
+         }
+         free(cur_name);
+      }
 
-static Multi_Level_Map * pci_vendors_mlm = {0};
-static Multi_Level_Map * usb_vendors_mlm = {0};
+      else if (id_type == ID_TYPE_USB) {
+         // segments after the device ids, each line begins with a tag
+         if (tabct == 0) {
+            char   atag[40];
+            ushort acode = 0;
+            char * aname = NULL;
+            int ct = sscanf(a_line, "%39s %hx %m[^\n]", atag, &acode, &aname);
+            segment_table = -1;
+            if (ct >= 1) {
+               if      (streq(atag, "HID"))  segment_table = ID_TABLE_HID;
+               else if (streq(atag, "R"))    segment_table = ID_TABLE_HID_ITEM;
+               else if (streq(atag, "HCC"))  segment_table = ID_TABLE_HCC;
+               else if (streq(atag, "HUT"))  segment_table = ID_TABLE_HUT;
+            }
+            if (segment_table >= 0 && ct == 3) {
+               builder_add_node(builder, segment_table, 0, acode, aname);
+               total_nodes[segment_table]++;
+            }
+            else {
+               builder_reset_level(builder, 0);
+            }
+            free(aname);
+         }
+         else if (tabct == 1 && segment_table == ID_TABLE_HUT) {
+            ushort acode = 0;
+            char * aname = NULL;
+            int ct = sscanf(a_line+tabct, "%4hx  %m[^\n]", &acode, &aname);
+            if (ct == 2) {
+               builder_add_node(builder, ID_TABLE_HUT, 1, acode, aname);
+               total_nodes[ID_TABLE_HUT]++;
+            }
+            free(aname);
+         }
+      }
 
-static Simple_Id_Table * hid_descriptor_types;       // tag HID
-static Simple_Id_Table * hid_descriptor_item_types;  // tag R
-static Simple_Id_Table * hid_country_codes;          // tag HCC - for keyboards
-static Multi_Level_Map * hid_usages_table;           // tag HUT
+next:
+      a_line = next_line;
+   }
 
+   if (debug) {
+      printf("(%s) id_type=%d, device nodes: %d, HID: %d, R: %d, HCC: %d, HUT: %d\n",
+             __func__, id_type, total_nodes[ID_TABLE_DEVICES], total_nodes[ID_TABLE_HID],
+             total_nodes[ID_TABLE_HID_ITEM], total_nodes[ID_TABLE_HCC], total_nodes[ID_TABLE_HUT]);
+   }
+}
 
-//
-// *** Input File Parsing ***
-//
 
-/* Parses a subrange of an array of text lines into an empty Simple_Id_Table
+/* Builds the index for a pci.ids or usb.ids file.
  *
  * Arguments:
- *   simple_table
- *   all_lines       array of pointer to text lines to parse
- *   segment_tag     first token in lines, when this changes it indicates segment exhausted
- *   cur_pos         first line of all_lines to parse
- *   end_pos         updated with line number after last line of segment
+ *    id_type       ID_TYPE_PCI or ID_TYPE_USB
+ *    source_fn     fully qualified name of pci.ids or usb.ids
+ *    source_stat   result of stat() for the source file
+ *
+ * Returns:         index contents, NULL if the file cannot be read
  */
-static void
-load_simple_id_segment(
-      Simple_Id_Table * simple_table,      // empty GPtrArray, will be filled in w Simple_Id_Table_Entry *
-      GPtrArray *       all_lines,         // array of pointers to lines
-      char *            segment_tag,
-      int               cur_pos,
-      int *             end_pos)
-{
+static GByteArray * build_id_index(Device_Id_Type id_type, const char * source_fn, struct stat * source_stat) {
    bool debug = false;
-   assert(simple_table);
-   if (debug) {
-      printf("(%s) Starting. simple_table=%p, segment_tag=%s, curpos=%d, -> |%s|\n",
-             __func__, simple_table, segment_tag, cur_pos, (char *) g_ptr_array_index(all_lines,cur_pos));
+   gchar * contents = NULL;
+   if (!g_file_get_contents(source_fn, &contents, NULL, NULL))
+      return NULL;
+
+   Index_Builder builder;
+   builder.nodes   = g_array_sized_new(false, false, sizeof(Build_Node), 30000);
+   builder.strings = g_byte_array_sized_new(1024*1024);
+   builder_reset_level(&builder, 0);
+   builder_add_string(&builder, "");
+   uint32_t source_fn_offset = builder_add_string(&builder, source_fn);
+   parse_id_file(&builder, id_type, contents);
+   g_free(contents);
+
+   // Assign entry positions one level at a time.  Since the nodes at each
+   // level are sorted by the position of their parent, the children of
+   // each node are contiguous.
+   Build_Node * nodes = (Build_Node *) builder.nodes->data;
+   int node_ct = builder.nodes->len;
+   int * node_at_position = calloc(node_ct+1, sizeof(int));
+   GArray * level_nodes = g_array_sized_new(false, false, sizeof(int), node_ct);
+   uint32_t next_position = 0;
+   for (int level = 0; level < ID_INDEX_MAX_LEVELS; level++) {
+      g_array_set_size(level_nodes, 0);
+      for (int ndx = 0; ndx < node_ct; ndx++) {
+         if (nodes[ndx].level == level)
+            g_array_append_val(level_nodes, ndx);
+      }
+      g_array_sort_with_data(level_nodes, compare_build_nodes, nodes);
+      for (int ndx = 0; ndx < level_nodes->len; ndx++) {
+         int node_ndx = g_array_index(level_nodes, int, ndx);
+         nodes[node_ndx].position = next_position;
+         node_at_position[next_position++] = node_ndx;
+      }
    }
-   bool more = true;
-   int linect = all_lines->len;
-   while (more && cur_pos < linect) {
-      char * a_line = g_ptr_array_index(all_lines, cur_pos++);
-      rtrim_in_place(a_line);
-      // printf("(%s) curpos=%d, a_line=|%s|\n", __func__, cur_pos-1, a_line);
-      if ( strlen(a_line) == 0 || a_line[0] == '#') {
-         // printf("(%s) Comment line\n", __func__);
-         continue;
+   g_array_free(level_nodes, true);
+
+   Id_Index_Header header;
+   memset(&header, 0, sizeof(header));
+   memcpy(header.magic, ID_INDEX_MAGIC, sizeof(header.magic));
+   header.format_version    = ID_INDEX_FORMAT_VERSION;
+   header.byte_order        = ID_INDEX_BYTE_ORDER;
+   header.source_mtime_sec  = source_stat->st_mtim.tv_sec;
+   header.source_mtime_nsec = source_stat->st_mtim.tv_nsec;
+   header.source_size       = source_stat->st_size;
+   header.source_fn_offset  = source_fn_offset;
+   header.entry_ct          = node_ct;
+   header.entries_offset    = sizeof(Id_Index_Header);
+   header.strings_offset    = header.entries_offset + node_ct * sizeof(Id_Index_Entry);
+   header.strings_size      = builder.strings->len;
+
+   Id_Index_Entry * entries = calloc(node_ct+1, sizeof(Id_Index_Entry));
+   for (uint32_t pos = 0; pos < node_ct; pos++) {
+      Build_Node * node = &nodes[node_at_position[pos]];
+      entries[pos].id          = node->id;
+      entries[pos].name_offset = node->name_offset;
+      if (node->parent >= 0) {
+         Id_Index_Entry * parent_entry = &entries[nodes[node->parent].position];
+         if (parent_entry->child_ct == 0)
+            parent_entry->child_first = pos;
+         parent_entry->child_ct++;
       }
-      // split into: tag hexvalue  name
-      char   atag[40];
-      ushort acode;
-      char*  aname = NULL;
-      int ct = sscanf(a_line, "%s %hx %m[^\n]",
-                          atag,
-                          &acode,
-                          &aname);
-      // printf("(%s) ct = %d, atag=|%s|, acode=0x%08x, aname=|%s|\n",
-      //        __func__, ct, atag, acode, aname);
-      // do something with return code to avoid coverity warning
-      assert(ct >= 0);
-      if (!streq(atag, segment_tag)) {
-         // printf("(%s) Tag doesn't match\n", __func__);
-         free(aname);
-         break;
+      else {
+         if (header.tables[node->table][1] == 0)
+            header.tables[node->table][0] = pos;
+         header.tables[node->table][1]++;
       }
-
-      sit_add(simple_table, acode, aname);
-      free(aname);
    }
 
-   if (cur_pos <= linect)
-      cur_pos--;
-   *end_pos = cur_pos;
+   GByteArray * result = g_byte_array_sized_new(header.strings_offset + header.strings_size);
+   g_byte_array_append(result, (guint8 *) &header,  sizeof(header));
+   g_byte_array_append(result, (guint8 *) entries,  node_ct * sizeof(Id_Index_Entry));
+   g_byte_array_append(result, builder.strings->data, builder.strings->len);
+
+   free(entries);
+   free(node_at_position);
+   g_array_free(builder.nodes, true);
+   g_byte_array_free(builder.strings, true);
    if (debug)
-      printf("(%s) Set end_pos = %d\n", __func__, cur_pos);
+      printf("(%s) Built index for %s, %d entries, %d bytes\n", __func__, source_fn, node_ct, result->len);
+   return result;
 }
 
 
+//
+// *** Index loading ***
+//
 
-static  Multi_Level_Map * load_multi_level_segment(
-      Multi_Level_Map * header,
-      char *            segment_tag,
-      GPtrArray *       all_lines,
-      int*              curpos)
+/* Checks that an index is well formed, and was built from the current
+ * version of the source file.
+ */
+static bool id_index_is_valid(
+      const char *  data,
+      size_t        size,
+      const char *  source_fn,
+      struct stat * source_stat)
 {
-   bool debug = false;
-   guint linendx = *curpos;  // guint to avoid warning re implicit conversion on while() test below
-   if (debug)
-      printf("(%s) Starting. linendx=%d, -> |%s|\n",
-             __func__, linendx, (char *) g_ptr_array_index(all_lines,linendx));
+   if (size < sizeof(Id_Index_Header))
+      return false;
+   const Id_Index_Header * header = (const Id_Index_Header *) data;
+   if (memcmp(header->magic, ID_INDEX_MAGIC, sizeof(header->magic)) != 0 ||
+       header->format_version != ID_INDEX_FORMAT_VERSION                  ||
+       header->byte_order != ID_INDEX_BYTE_ORDER                          ||
+       header->entries_offset != sizeof(Id_Index_Header)                  ||
+       header->strings_offset != header->entries_offset + (uint64_t) header->entry_ct * sizeof(Id_Index_Entry) ||
+       header->strings_size == 0                                          ||
+       (uint64_t) header->strings_offset + header->strings_size > size    ||
+       data[header->strings_offset + header->strings_size - 1] != '\0'    ||
+       header->source_fn_offset >= header->strings_size)
+   {
+      return false;
+   }
 
-   MLM_Node * cur_nodes[8] = {NULL};     // todo: deal properly w max levels
+   const char * strings = data + header->strings_offset;
+   if (!streq(strings + header->source_fn_offset, source_fn)     ||
+       header->source_mtime_sec  != source_stat->st_mtim.tv_sec  ||
+       header->source_mtime_nsec != source_stat->st_mtim.tv_nsec ||
+       header->source_size       != source_stat->st_size)
+   {
+      return false;
+   }
 
-   for (int ndx = 0; ndx < header->levels; ndx++) {
-      header->level_detail[ndx].total_entries = 0;
-      header->level_detail[ndx].cur_entry = NULL;
+   // guard against a damaged file, so that lookups need not check bounds
+   for (int ndx = 0; ndx < ID_TABLE_CT; ndx++) {
+      if ((uint64_t) header->tables[ndx][0] + header->tables[ndx][1] > header->entry_ct)
+         return false;
+   }
+   const Id_Index_Entry * entries = (const Id_Index_Entry *) (data + header->entries_offset);
+   for (uint32_t ndx = 0; ndx < header->entry_ct; ndx++) {
+      if (entries[ndx].name_offset >= header->strings_size ||
+          (uint64_t) entries[ndx].child_first + entries[ndx].child_ct > header->entry_ct)
+         return false;
    }
+   return true;
+}
 
-   ushort cur_code;
-   char * cur_name;
 
-   bool more = true;
-   while (more && linendx < all_lines->len) {
-      char * a_line = g_ptr_array_index(all_lines, linendx++);
-      int tabct = 0;
-      while (a_line[tabct] == '\t')
-         tabct++;
-      if (strlen(rtrim_in_place(a_line+tabct)) == 0 || a_line[tabct] == '#')
-         continue;
-
-      if (tabct == 0) {
-         char cur_tag[40];
-         cur_name = NULL;
-         int ct = sscanf(a_line+tabct, "%s %4hx %m[^\n]",
-                              cur_tag,
-                              &cur_code,    // &header->level_detail[tabct].cur_entry->code,
-                              &cur_name);   // &header->level_detail[tabct].cur_entry->name );
-         if (!streq(cur_tag, segment_tag)) {
-            if (cur_name)
-               free(cur_name);
-            // more = false;   // needed for continue
-            break;     // or continue?
-         }
-         if (ct != 3) {
-            printf("(%s) Error processing line %d: \"%s\"\n", __func__, linendx, a_line);
-            printf("(%s) Lines has %d fields, not 3.  Ignoring\n", __func__, ct);
-            // hex_dump(a_line+tabct, strlen(a_line+tabct));
-         }
-         else {
-            header->level_detail[tabct].total_entries++;
-            cur_nodes[tabct] = mlm_add_node(header, NULL, cur_code, cur_name);
-            for (int lvl = tabct+1; lvl < header->levels; lvl++) {
-                header->level_detail[lvl].cur_entry = NULL;
-                cur_nodes[lvl] = NULL;
-            }
-            // printf("Successful level 0 node added. set header->level_detail[%d].cur_entry (addr %p) to %p\n",
-            //        tabct, &(header->level_detail[tabct].cur_entry), header->level_detail[tabct].cur_entry   );
-            // mlt_cur_entries(header);
-         }
-      }  // tabct == 0
-
-     else  {    // intermediate or leaf node
-        if (!cur_nodes[tabct-1]) {
-           printf("Error processing line %d: \"%s\"\n", linendx-1, a_line);
-           printf("No enclosing level %d node\n", tabct-1);
-           // printf("(A) tabct=%d\n", tabct);
-           // mlt_cur_entries(header);
-           // A free(header->level_detail[tabct].cur_entry);
-           header->level_detail[tabct].cur_entry = NULL;
-
-        }
-        else {
-           int ct = sscanf(a_line+tabct, "%4hx  %m[^\n]",
-                            &cur_code,   // &header->level_detail[tabct].cur_entry->code,
-                            &cur_name);  // &header->level_detail[tabct].cur_entry->name);
-            if (ct != 2) {
-               printf("(%s) Error reading line %d: %s\n",
-                      __func__, linendx-1, a_line);
-            }
-            else {
-               header->level_detail[tabct].total_entries++;
-               // A if (tabct < header->levels-1)  // if not a leaf
-               // A    header->level_detail[tabct].cur_entry->children = g_ptr_array_sized_new(20);
-               // A g_ptr_array_add(header->level_detail[tabct-1].cur_entry->children, header->level_detail[tabct].cur_entry);
-               cur_nodes[tabct] = mlm_add_node(header, cur_nodes[tabct-1],  cur_code, cur_name);
-               for (int lvl = tabct+1; lvl < header->levels; lvl++) {
-                   header->level_detail[lvl].cur_entry = NULL;
-                   cur_nodes[lvl] = NULL;
-               }
-            }
-        }
-     }     // intermediate or leaf node
-   }       // while loop over lines
+static Id_Index * new_id_index(void * data, size_t size, bool mapped) {
+   Id_Index * index = calloc(1, sizeof(Id_Index));
+   index->data    = data;
+   index->size    = size;
+   index->mapped  = mapped;
+   index->header  = data;
+   index->entries = (const Id_Index_Entry *) ((char *) data + index->header->entries_offset);
+   index->strings = (const char *) data + index->header->strings_offset;
+   return index;
+}
 
-   if (debug) {
-      for (int lvlndx=0; lvlndx<header->levels; lvlndx++) {
-         printf("(%s) Table %s (tag %s): total level %d (%s) nodes: %d\n",
-             __func__,
-             header->table_name,
-             header->segment_tag,
-             lvlndx,
-             header->level_detail[lvlndx].name,
-             header->level_detail[lvlndx].total_entries);
+
+// Maps a cached index file, returning NULL if it does not exist or is not current
+static Id_Index * map_cached_id_index(const char * index_fn, const char * source_fn, struct stat * source_stat) {
+   Id_Index * index = NULL;
+   int fd = open(index_fn, O_RDONLY|O_CLOEXEC);
+   if (fd >= 0) {
+      struct stat index_stat;
+      if (fstat(fd, &index_stat) == 0 && index_stat.st_size >= sizeof(Id_Index_Header)) {
+         void * data = mmap(NULL, index_stat.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+         if (data != MAP_FAILED) {
+            if (id_index_is_valid(data, index_stat.st_size, source_fn, source_stat))
+               index = new_id_index(data, index_stat.st_size, true);
+            else
+               munmap(data, index_stat.st_size);
+         }
       }
+      close(fd);
    }
-
-   *curpos = linendx;
-   return header;
+   return index;
 }
 
 
-/* Find the start of the next segment in a line array,
- * i.e. a non-comment line that begins with a different tag
+/* Locates a pci.ids or usb.ids file and loads its index, using the cached
+ * index if current, otherwise building the index and saving it in the cache.
  *
  * Arguments:
- *    lines         array of pointers to lines
- *    cur_ndx       current position in line array
- *    segment_tag   first token of lines in current segment
- *
- * Returns:         line number of start of next segment
- *
- * The buffer pointed to by segment_tag is updated with the newly
- * found tag.
+ *    id_type
  *
- * TODO: eliminate this side effect, apparently left over from refactoring (2/1018)
+ * Returns:    index, NULL if the source file is not found or cannot be read
  */
-int find_next_segment_start(GPtrArray* lines, int cur_ndx, char* segment_tag) {
+static Id_Index * load_id_index(Device_Id_Type id_type) {
    bool debug = false;
    if (debug)
-      printf("(%s) Starting cur_ndx=%d, segment_tag=|%s|\n", __func__, cur_ndx, segment_tag);
+      printf("(%s) id_type=%d\n", __func__, id_type);
 
-   int linect = lines->len;
-   for(; cur_ndx < linect; cur_ndx++) {
-      char * a_line = g_ptr_array_index(lines, cur_ndx);
-      int tabct = 0;
-      while (a_line[tabct] == '\t')
-         tabct++;
-      rtrim_in_place(a_line+tabct);
-      if (strlen(a_line+tabct) == 0 || a_line[tabct] == '#')
-         continue;    // always skip comment and blank lines
-      if (segment_tag) {  // skipping the current segment
-         if (tabct == 0) {
-            char   atag[40];
-            char*  rest = NULL;
-            int ct = sscanf(a_line, "%s %m[^\n]",
-                             atag,
-                             &rest);
-            // printf("(%s) ct = %d\n", __func__, ct);
-            // coverity scan gets unhappy if nothing sscanf's return code is not checked.
-            // this does something trivial with it.
-            assert(ct >= 0);
-            if (rest)
-               free(rest);
-            if (!streq(atag,segment_tag)) {
-               strcpy(segment_tag, atag);
-               // free(rest);
-               break;
+   Id_Index * index = NULL;
+   char * source_fn = devid_find_file(id_type);
+   struct stat source_stat;
+   if (source_fn && stat(source_fn, &source_stat) == 0) {
+      char index_simple_fn[20];
+      snprintf(index_simple_fn, sizeof(index_simple_fn), "%s.idx", simple_device_fn[id_type]);
+      char * index_fn = xdg_user_cache_file("ddcutil", index_simple_fn);
+      if (index_fn)
+         index = map_cached_id_index(index_fn, source_fn, &source_stat);
+      if (debug)
+         printf("(%s) Cached index %s %s\n", __func__, index_fn, (index) ? "used" : "not current");
+
+      if (!index) {
+         GByteArray * contents = build_id_index(id_type, source_fn, &source_stat);
+         if (contents) {
+            if (index_fn) {
+               char * dir = g_path_get_dirname(index_fn);
+               GError * error = NULL;
+               if (g_mkdir_with_parents(dir, 0755) != 0 ||
+                   !g_file_set_contents(index_fn, (gchar *) contents->data, contents->len, &error))
+               {
+                  if (debug)
+                     printf("(%s) Unable to write %s: %s\n",
+                            __func__, index_fn, (error) ? error->message : strerror(errno));
+                  if (error)
+                     g_error_free(error);
+               }
+               g_free(dir);
             }
+            // use the index just built rather than mapping the file written
+            guint size = contents->len;
+            index = new_id_index(g_byte_array_free(contents, false), size, false);
          }
       }
+      free(index_fn);
    }
-   return cur_ndx;
+   free(source_fn);
+
+   if (debug)
+      printf("(%s) Done.  Returning %p\n", __func__, index);
+   return index;
 }
 
 
-// returns line number of end of segment
-int load_device_ids(Device_Id_Type id_type, GPtrArray * all_lines) {
-   bool debug = false;
-    int total_vendors = 0;
-    int total_devices = 0;
-    int total_subsys  = 0;
-
-    MLM_Level usb_id_levels[] = {
-          {"vendor", 5000, 0},
-          {"product",  20, 0},
-          {"interface", 10, 0}
-    };
-
-    MLM_Level pci_id_levels[] = {
-          {"vendor",   10000, 0},
-          {"device",      20, 0},
-          {"subsystem",    5, 0}
-    };
-
-#define MAX_LEVELS 5
-     Multi_Level_Map * mlm = NULL;
-     int levelct = 3;
-
-     if (id_type == ID_TYPE_PCI) {
-        mlm = mlm_create("PCI Devices", 3, pci_id_levels);
-     }
-     else
-        mlm = mlm_create("USB Devices", 3, usb_id_levels);
-
-    MLM_Node * cur_node[MAX_LEVELS] = {NULL};
-
-    int linect = all_lines->len;
-    int linendx;
-    char * a_line;
-    bool device_ids_done = false;    // end of PCI id section seen?
-    for (linendx=0; linendx<linect && !device_ids_done; linendx++) {
-       a_line = g_ptr_array_index(all_lines, linendx);
-       int tabct = 0;
-       while (a_line[tabct] == '\t')
-          tabct++;
-       if (strlen(rtrim_in_place(a_line+tabct)) == 0 || a_line[tabct] == '#')
-          continue;
-       if (id_type == ID_TYPE_USB) {
-          // hacky test for end of id section
-          if (memcmp(a_line+tabct, "C", 1) == 0) {
-             device_ids_done = true;
-             continue;
-          }
-       }
-
-       switch(tabct) {
-
-       case (0):
-          {
-             ushort cur_id = 0;
-             char * cur_name = NULL;
-             int ct = sscanf(a_line+tabct, "%4hx %m[^\n]",
-                             &cur_id,
-                             &cur_name);
-
-             if (ct != 2) {
-                printf("(%s) Error reading line: %s\n", __func__, a_line+tabct);
-                // hex_dump(a_line+tabct, strlen(a_line+tabct));
-                for (int ndx = tabct; ndx < levelct; ndx++) {
-                   cur_node[ndx] = NULL;
-                }
-             }
-             else {
-                total_vendors++;
-                // usb.ids has no final ffff field, test works only for pci.ids
-                if (cur_id == 0xffff)
-                   device_ids_done = true;
-                cur_node[tabct] = mlm_add_node(mlm, NULL, cur_id, cur_name);
-                for (int ndx = tabct+1; ndx < levelct; ndx++) {
-                   cur_node[ndx] = NULL;
-                }
-             }
-             break;
-          }
-
-       case (1):
-          {
-             if (cur_node[tabct-1])  {
-                ushort cur_id;
-                char * cur_name;
-                int ct = sscanf(a_line+tabct, "%4hx %m[^\n]", &cur_id, &cur_name);
-
-                if (ct != 2) {
-                   printf("(%s) Error reading line: %s\n", __func__, a_line+tabct);
-                }
-                else {
-                   total_devices++;
-                   cur_node[tabct] = mlm_add_node(mlm, cur_node[tabct-1], cur_id, cur_name);
-                   for (int ndx = tabct+1; ndx < levelct; ndx++) {
-                      cur_node[ndx] = NULL;
-                   }
-                }
-
-             }
-             else {
-                // TODO: handle bad data case
-             }
-             break;
-          }
-
-       case (2):
-          {
-             if (cur_node[tabct-1]) {
-                if (id_type == ID_TYPE_PCI) {
-                   ushort this_subvendor_id = 0;
-                   ushort this_subdevice_id = 0;
-                   char * this_name = NULL;
-                   int ct = sscanf(a_line+tabct, "%4hx %4hx %m[^\n]",
-                                   &this_subvendor_id,
-                                   &this_subdevice_id,
-                                   &this_name);
-                   // transitional:
-
-                   uint   this_id = this_subvendor_id << 16 | this_subdevice_id;
-
-                   if (ct != 3) {
-                      printf("(%s) Error reading line: %s\n", __func__, a_line+tabct);
-                   }
-                   else {
-                      total_subsys++;
-                      cur_node[tabct] = mlm_add_node(mlm, cur_node[tabct-1], this_id, this_name);
-                   }
-                }  // ID_TYPE_PCI
-                else {     // ID_TYPE_USB
-                   ushort this_id = 0;
-                   char * this_name = NULL;
-                   int ct = sscanf(a_line+tabct, "%4hx  %m[^\n]",
-                                   &this_id,
-                                   &this_name);
-
-                   if (ct != 2) {
-                      printf("(%s) Error reading line: %s\n", __func__, a_line+tabct);
-                   }
-                   else {
-                      total_subsys++;
-                      // new
-                      cur_node[tabct] = mlm_add_node(mlm, cur_node[tabct-1], this_id, this_name);
-                   }
-                }  //ID_TYPE_USB
-             }  // if (cur_device)
-             break;
-          }
-
-       default:
-          printf("Unexpected number of leading tabs in line: %s\n", a_line);
-       } // switch
-    }    // line loop
-
-    if (id_type == ID_TYPE_PCI) {
-       pci_vendors_mlm = mlm;
-    }
-    else {
-       usb_vendors_mlm = mlm;
-    }
-
-    if (debug) {
-       char * level3_name = (id_type == ID_TYPE_PCI) ? "subsystems" : "interfaces";
-       printf("(%s) Total vendors: %d, total devices: %d, total %s: %d\n",
-              __func__, total_vendors, total_devices, level3_name, total_subsys);
-    }
-
-   return linendx;
+static Id_Index * get_id_index(Device_Id_Type id_type) {
+   g_mutex_lock(&index_mutex);
+   if (!id_index_loaded[id_type]) {
+      id_indexes[id_type] = load_id_index(id_type);
+      id_index_loaded[id_type] = true;
+   }
+   g_mutex_unlock(&index_mutex);
+   return id_indexes[id_type];
 }
 
 
-static void load_file_lines(Device_Id_Type id_type, GPtrArray * all_lines) {
-   bool debug = false;
-   if (debug)
-      printf("(%s) Starting.  id_type=%d\n", __func__, id_type);
-
-   int linendx;
-   // char * a_line;
-
-   linendx = load_device_ids(id_type, all_lines);
-
-   // if usb.ids, look for additional segments
-   if (id_type == ID_TYPE_USB) {
-         // a_line = g_ptr_array_index(all_lines, linendx);
-         // printf("(%s) First line of next segment: |%s|, linendx=%d\n", __func__, a_line, linendx);
-      linendx--; //  start looking on comment line before segment
-         // a_line = g_ptr_array_index(all_lines, linendx);
-         // printf("(%s) First line of next segment: |%s|, linendx=%d\n", __func__, a_line, linendx);
-#define MAX_TAG_SIZE 40
-      char tagbuf[MAX_TAG_SIZE];
-      tagbuf[0] = '\0';
-
-      // cast to avoid warning re loss of sign in implicit conversion
-      // signed int is more than ample to hold number of lines
-      int linect = all_lines->len;
-      while (linendx < linect) {
-            //printf("(%s) Before find_next_segment_start(), linendx=%d: |%s|\n",
-            //       __func__, linendx, (char *) g_ptr_array_index(all_lines, linendx));
-         linendx = find_next_segment_start(all_lines, linendx, tagbuf);
-            // printf("(%s) Next segment starts at line %d: |%s|\n",
-            //        __func__, linendx, (char *) g_ptr_array_index(all_lines, linendx));
-         if (linendx >= linect)
-            break;
+//
+// *** Index lookup ***
+//
 
-         if ( streq(tagbuf,"HID") ) {
-            hid_descriptor_types = create_simple_id_table(0);
-            load_simple_id_segment(hid_descriptor_types, all_lines, tagbuf, linendx, &linendx);
-            if (debug) {
-               printf("(%s) After processing tag HID, linendx=%d\n", __func__, linendx);
-               rpt_title("hid_descriptor_types: ", 0);
-               report_simple_id_table(hid_descriptor_types, 1);
-            }
-         }
-         else if ( streq(tagbuf,"R") ) {
-             hid_descriptor_item_types = create_simple_id_table(0);
-             load_simple_id_segment(hid_descriptor_item_types, all_lines, tagbuf, linendx, &linendx);
-             if (debug) {
-                printf("(%s) After processing tag R, linendx=%d\n", __func__, linendx);
-                rpt_title("hid_descriptor_item_types: ", 0);
-                report_simple_id_table(hid_descriptor_item_types, 1);
-             }
-          }
-         else if ( streq(tagbuf,"HCC") ) {
-             hid_country_codes = create_simple_id_table(0);
-             load_simple_id_segment(hid_country_codes, all_lines, tagbuf, linendx, &linendx);
-             if (debug) {
-                printf("(%s) After HCC, linendx=%d\n", __func__, linendx);
-                rpt_title("hid_country_codes: ", 0);
-                report_simple_id_table(hid_country_codes, 1);
-             }
-          }
-
-          else if ( streq(tagbuf,"HUT") ) {
-#ifdef OLD
-             hid_usages_table = mlm_create(
-                                                    hid_usages_table0.table_name,
-                                                    hid_usages_table0.levels,
-                                                    hid_usages_table0.level_detail);
-#endif
-             MLM_Level hut_level_desc[] = {
-                   {"usage page", 20, 0},
-                   {"usage_id",   20, 0}
-             };
-
-             hid_usages_table = mlm_create(
-                                  "HUT",
-                                  2,
-                                  hut_level_desc);
-
-
-             load_multi_level_segment(hid_usages_table, tagbuf, all_lines, &linendx);
-                // printf("(%s) After HUT, linendx=%d\n", __func__, linendx);
-                // rpt_title("usages table: ", 0);
-                // report_multi_level_table(hid_usages_table, 1);
-          }
-      }
+// Finds the first entry with the specified id within a range of entries sorted by id
+static const Id_Index_Entry * find_id_entry(Id_Index * index, uint32_t first, uint32_t ct, uint32_t id) {
+   uint32_t lo = first;
+   uint32_t hi = first + ct;
+   while (lo < hi) {
+      uint32_t mid = lo + (hi - lo) / 2;
+      if (index->entries[mid].id < id)
+         lo = mid + 1;
+      else
+         hi = mid;
    }
-
-   if (debug)
-      printf("(%s) Done.  id_type=%d\n", __func__, id_type);
+   return (lo < first + ct && index->entries[lo].id == id) ? &index->entries[lo] : NULL;
 }
 
 
-/* Locates a pci.ids or usb.ids file and loads its contents into internal tables.
+/* Looks up the names for a sequence of ids in an index table, e.g.
+ * vendor id, device id, subsystem id.
  *
  * Arguments:
- *    id_type
+ *    id_type     ID_TYPE_PCI or ID_TYPE_USB
+ *    table       table within index
+ *    levelct     number of ids
+ *    ids         ids to look up
+ *    names       where to return names, set to NULL for levels not found
  *
- * Returns:    nothing
+ * Returns:       number of levels found
  */
-static void load_id_file(Device_Id_Type id_type){
-   bool debug = false;
-
-   if (debug)
-      printf("(%s) id_type=%d\n", __func__, id_type);
-
-   // char * id_fn = simple_device_fn[id_type];
-   char * device_id_fqfn = devid_find_file(id_type);
-   if (device_id_fqfn) {
-      // char device_id_fqfn[MAX_PATH];
-      // snprintf(device_id_fqfn, MAX_PATH, id_fqfn, id_fn);  // ???
-      if (debug)
-         printf("(%s) device_id_fqfn = %s\n", __func__, device_id_fqfn);
-
-      GPtrArray * all_lines = g_ptr_array_sized_new(30000);
-      int linect = file_getlines(device_id_fqfn, all_lines, true);
-      if (linect > 0) {
-         load_file_lines(id_type, all_lines);
-      }       // if (all_lines)
-      // to do: call
+static int get_id_names(Device_Id_Type id_type, Id_Table table, int levelct, uint32_t * ids, char ** names) {
+   assert(levelct >= 1 && levelct <= ID_INDEX_MAX_LEVELS);
+   for (int ndx = 0; ndx < levelct; ndx++)
+      names[ndx] = NULL;
+
+   int found_ct = 0;
+   Id_Index * index = get_id_index(id_type);
+   if (index) {
+      uint32_t first = index->header->tables[table][0];
+      uint32_t ct    = index->header->tables[table][1];
+      for (; found_ct < levelct; found_ct++) {
+         const Id_Index_Entry * entry = find_id_entry(index, first, ct, ids[found_ct]);
+         if (!entry)
+            break;
+         names[found_ct] = (char *) index->strings + entry->name_offset;
+         first = entry->child_first;
+         ct    = entry->child_ct;
+      }
+   }
+   return found_ct;
+}
 
-      g_ptr_array_set_free_func(all_lines, free);
-      g_ptr_array_free(all_lines, true);
-      free(device_id_fqfn);
-   }          // if pci.ids or usb.ids was found
 
-   if (debug)
-      printf("(%s) Done\n", __func__);
-   return;
+static char * get_simple_id_name(Id_Table table, ushort id) {
+   uint32_t ids[1] = {id};
+   char * names[1];
+   get_id_names(ID_TYPE_USB, table, 1, ids, names);
+   return names[0];
 }
 
 
@@ -750,37 +697,34 @@ static void load_id_file(Device_Id_Type id_type){
  *
  * Returns:    nothing
  */
-void report_device_ids_mlm(Device_Id_Type id_type) {
-   Multi_Level_Map * all_devices = (id_type == ID_TYPE_PCI) ? pci_vendors_mlm : usb_vendors_mlm;
-   GPtrArray * top_level_nodes = all_devices->root;
+void report_device_ids(Device_Id_Type id_type) {
+   Id_Index * index = get_id_index(id_type);
+   if (!index) {
+      printf("(%s) %s not found\n", __func__, simple_device_fn[id_type]);
+      return;
+   }
    int total_vendors = 0;
    int total_devices = 0;
    int total_subsys  = 0;
-   int vctr, dctr, sctr;
-   MLM_Node * cur_vendor;
-   MLM_Node * cur_device;
-   MLM_Node * cur_subsys;
-   for (vctr=0; vctr < top_level_nodes->len; vctr++) {
+   uint32_t vfirst = index->header->tables[ID_TABLE_DEVICES][0];
+   uint32_t vct    = index->header->tables[ID_TABLE_DEVICES][1];
+   for (uint32_t vndx = vfirst; vndx < vfirst + vct; vndx++) {
       total_vendors++;
-      cur_vendor = g_ptr_array_index(top_level_nodes, vctr);
-      printf("%04x %s\n", cur_vendor->code, cur_vendor->name);
-      if (cur_vendor->children) {
-         for (dctr=0; dctr<cur_vendor->children->len; dctr++) {
-            total_devices++;
-            cur_device = g_ptr_array_index(cur_vendor->children, dctr);
-            printf("\t%04x %s\n", cur_device->code, cur_device->name);
-            if (cur_device->children) {
-               for (sctr=0; sctr<cur_device->children->len; sctr++) {
-                  total_subsys++;
-                  cur_subsys = g_ptr_array_index(cur_device->children, sctr);
-                  if (id_type == ID_TYPE_PCI)
-                     printf("\t\t%04x %04x %s\n",
-                            cur_subsys->code>>16, cur_subsys->code&0xffff, cur_subsys->name);
-                  else
-                     printf("\t\t%04x %s\n",
-                            cur_subsys->code, cur_subsys->name);
-               }
-            }
+      const Id_Index_Entry * cur_vendor = &index->entries[vndx];
+      printf("%04x %s\n", cur_vendor->id, index->strings + cur_vendor->name_offset);
+      for (uint32_t dndx = cur_vendor->child_first; dndx < cur_vendor->child_first + cur_vendor->child_ct; dndx++) {
+         total_devices++;
+         const Id_Index_Entry * cur_device = &index->entries[dndx];
+         printf("\t%04x %s\n", cur_device->id, index->strings + cur_device->name_offset);
+         for (uint32_t sndx = cur_device->child_first; sndx < cur_device->child_first + cur_device->child_ct; sndx++) {
+            total_subsys++;
+            const Id_Index_Entry * cur_subsys = &index->entries[sndx];
+            if (id_type == ID_TYPE_PCI)
+               printf("\t\t%04x %04x %s\n",
+                      cur_subsys->id>>16, cur_subsys->id&0xffff, index->strings + cur_subsys->name_offset);
+            else
+               printf("\t\t%04x %s\n",
+                      cur_subsys->id, index->strings + cur_subsys->name_offset);
          }
       }
    }
@@ -825,20 +769,20 @@ Pci_Usb_Id_Names devid_get_pci_names(
              vendor_id, device_id, subvendor_id, subdevice_id);
    }
    assert( argct==1 || argct==2 || argct==4);
-   devid_ensure_initialized();
-   uint ids[3] = {vendor_id, device_id, subvendor_id << 16 | subdevice_id};   // only diff from usb_id_get_names
+   uint32_t ids[3] = {vendor_id, device_id, (uint32_t) subvendor_id << 16 | subdevice_id};   // only diff from usb_id_get_names
    int levelct = (argct == 4) ? 3 : argct;              // also this
-   Multi_Level_Names mlm_names =  mlm_get_names2(pci_vendors_mlm, levelct, ids);  // and this
+   char * names[3];
+   int found_ct = get_id_names(ID_TYPE_PCI, ID_TABLE_DEVICES, levelct, ids, names);
    Pci_Usb_Id_Names names2;
-   names2.vendor_name = mlm_names.names[0];
-   names2.device_name = mlm_names.names[1];
-   names2.subsys_or_interface_name = mlm_names.names[2];
-   if (levelct == 3 && mlm_names.levels == 2) {
+   names2.vendor_name = names[0];
+   names2.device_name = (levelct > 1) ? names[1] : NULL;
+   names2.subsys_or_interface_name = (levelct > 2) ? names[2] : NULL;
+   if (levelct == 3 && found_ct == 2) {
       // couldn't find the subsystem, see if at least we can look up the subsystem vendor
-      uint ids[1] = {subvendor_id};
-      Multi_Level_Names mlm_names3 = mlm_get_names2(pci_vendors_mlm, 1, ids);
-      if (mlm_names3.levels == 1) {
-         names2.subsys_or_interface_name = mlm_names3.names[0];
+      uint32_t subvendor_ids[1] = {subvendor_id};
+      char * subvendor_names[1];
+      if (get_id_names(ID_TYPE_PCI, ID_TABLE_DEVICES, 1, subvendor_ids, subvendor_names) == 1) {
+         names2.subsys_or_interface_name = subvendor_names[0];
       }
    }
 
@@ -876,13 +820,13 @@ Pci_Usb_Id_Names devid_get_usb_names(
              vendor_id, device_id, interface_id);
    }
    assert( argct==1 || argct==2 || argct==3);
-   devid_ensure_initialized();
-   uint ids[3] = {vendor_id, device_id, interface_id};
-   Multi_Level_Names mlm_names =  mlm_get_names2(usb_vendors_mlm, argct, ids);
+   uint32_t ids[3] = {vendor_id, device_id, interface_id};
+   char * names[3];
+   get_id_names(ID_TYPE_USB, ID_TABLE_DEVICES, argct, ids, names);
    Pci_Usb_Id_Names names2;
-   names2.vendor_name = mlm_names.names[0];
-   names2.device_name = mlm_names.names[1];
-   names2.subsys_or_interface_name = mlm_names.names[2];
+   names2.vendor_name = names[0];
+   names2.device_name = (argct > 1) ? names[1] : NULL;
+   names2.subsys_or_interface_name = (argct > 2) ? names[2] : NULL;
 
    if (debug) {
       printf("(%s) names2: vendor_name=%s, device_name=%s, subsys_or_interface_name=%s\n",
@@ -905,7 +849,6 @@ Pci_Usb_Id_Names devid_get_usb_names(
  * - Corresponds to names_huts() in names.c
  */
 char * devid_usage_code_page_name(ushort usage_page_code) {
-   devid_ensure_initialized();
    // Per USB HID Usage Tables spec v1.12, section 3.0,
    // Usage page ID xff00..xffff are vendor defined
    //               x0092..xfeff are reserved
@@ -919,10 +862,10 @@ char * devid_usage_code_page_name(ushort usage_page_code) {
    if (usage_page_code > 0xff00)
       result = "Vendor-defined";
    else {
-      // ushort * args = {usage_page_code};
-      Multi_Level_Names names_found = mlm_get_names(hid_usages_table, /*argct=*/ 1, usage_page_code);
-      if (names_found.levels == 1)
-         result = names_found.names[0];
+      uint32_t ids[1] = {usage_page_code};
+      char * names[1];
+      if (get_id_names(ID_TYPE_USB, ID_TABLE_HUT, 1, ids, names) == 1)
+         result = names[0];
    }
    return result;
 }
@@ -946,17 +889,16 @@ char * devid_usage_code_id_name(ushort usage_page_code, ushort usage_simple_id)
       printf("(%s) usage_page_code=0x%04x, usage_simple_id=0x%04x\n",
              __func__, usage_page_code, usage_simple_id);
    }
-   devid_ensure_initialized();
    char * result = NULL;
    if (usage_page_code == 0x81) {
       snprintf(resultbuf, 11, "ENUM_%d", usage_simple_id);
       result = resultbuf;
    }
    else {
-      // ushort * args = {usage_page_code, usage_simple_id};
-      Multi_Level_Names names_found = mlm_get_names(hid_usages_table, 2, usage_page_code, usage_simple_id);
-      if (names_found.levels == 2)
-         result = names_found.names[1];
+      uint32_t ids[2] = {usage_page_code, usage_simple_id};
+      char * names[2];
+      if (get_id_names(ID_TYPE_USB, ID_TABLE_HUT, 2, ids, names) == 2)
+         result = names[1];
    }
    return result;
 }
@@ -987,27 +929,18 @@ char * devid_usage_code_name_by_extended_id(uint32_t extended_usage) {
  * - This function corresponds to names.c function names_reporttag()
  */
 char * devid_hid_descriptor_item_type(ushort id) {
-   devid_ensure_initialized();
-   char * result = NULL;
-   result = get_simple_id_name(hid_descriptor_item_types, id);
-   return result;
+   return get_simple_id_name(ID_TABLE_HID_ITEM, id);
 }
 
 
-// not used, but without this valgrind complains of memory leak
+// not used
 char * devid_hid_descriptor_type(ushort id) {
-   devid_ensure_initialized();
-   char * result = NULL;
-   result = get_simple_id_name(hid_descriptor_types, id);
-   return result;
+   return get_simple_id_name(ID_TABLE_HID, id);
 }
 
-// not used, but without this valgrind complains of memory leak
+// not used
 char * devid_hid_descriptor_country_code(ushort id) {
-   devid_ensure_initialized();
-   char * result = NULL;
-   result = get_simple_id_name(hid_country_codes, id);
-   return result;
+   return get_simple_id_name(ID_TABLE_HCC, id);
 }
 
 
@@ -1017,31 +950,35 @@ char * devid_hid_descriptor_country_code(ushort id) {
 //
 
 /** Initializes the PCI and USB id tables.
- *  If the tables are already initialized, does nothing.
+ *
+ *  @return true
+ *
+ *  @remark
+ *  The lookup functions load the table they need on first use, so this
+ *  function does nothing.  It is retained for compatibility.  To test
+ *  whether a table can be loaded, use #devid_pci_ids_available() or
+ *  #devid_usb_ids_available().
  */
 bool devid_ensure_initialized() {
-   bool debug = false;
-   if (debug)
-      printf("(%s) Starting\n", __func__);
-   bool ok = (pci_vendors_mlm && usb_vendors_mlm);
+   return true;
+}
 
-   if (!ok) {
-      if (debug)
-         printf("(%s) Loading.  pci_vendors_mlm=%p, usb_vendors_mlm=%p\n",
-                __func__,  pci_vendors_mlm, usb_vendors_mlm);
-      load_id_file(ID_TYPE_PCI);
-      load_id_file(ID_TYPE_USB);
-      ok = true;
-      if (ok && debug) {
-         // report_device_ids(ID_TYPE_PCI);
-         // report_device_ids_mlm(ID_TYPE_PCI);
-         // report_device_ids(ID_TYPE_USB);
-         // report_device_ids_mlm(ID_TYPE_USB);
-      }
-   }
-   if (debug)
-      printf("(%s) Returning: %s\n", __func__, bool_repr(ok));
-   return ok;
+
+/** Reports whether the PCI id table can be used for name lookup,
+ *  loading it if not yet loaded.
+ *
+ *  @return true if pci.ids was found and loaded, false if not
+ */
+bool devid_pci_ids_available() {
+   return get_id_index(ID_TYPE_PCI) != NULL;
 }
 
 
+/** Reports whether the USB id table can be used for name lookup,
+ *  loading it if not yet loaded.
+ *
+ *  @return true if usb.ids was found and loaded, false if not
+ */
+bool devid_usb_ids_available() {
+   return get_id_index(ID_TYPE_USB) != NULL;
+}
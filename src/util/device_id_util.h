@@ -37,6 +37,8 @@
 
 // *** Initialization ***
 bool devid_ensure_initialized();
+bool devid_pci_ids_available();
+bool devid_usb_ids_available();
 
 
 // *** Device ID lookup ***
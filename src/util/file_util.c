@@ -458,3 +458,47 @@ int filename_for_fd(int fd, char** p_fn) {
    return rc;
 }
 
+
+/** Returns the name of the base directory for user specific cache files,
+ *  as specified by the XDG Base Directory Specification.
+ *
+ *  @return directory name, caller must free, NULL if it cannot be determined
+ *
+ *  @remark
+ *  Uses $XDG_CACHE_HOME if set, otherwise $HOME/.cache
+ */
+char * xdg_cache_home_dir() {
+   char * result = NULL;
+   char * xdg_cache_home = getenv("XDG_CACHE_HOME");
+   if (xdg_cache_home && strlen(xdg_cache_home) > 0 && xdg_cache_home[0] == '/') {
+      result = strdup(xdg_cache_home);
+   }
+   else {
+      char * home = getenv("HOME");
+      if (home && strlen(home) > 0)
+         result = g_strdup_printf("%s/.cache", home);
+   }
+   return result;
+}
+
+
+/** Returns the fully qualified name of a user specific cache file.
+ *
+ *  @param  application  subdirectory of the XDG cache directory, e.g. "ddcutil"
+ *  @param  simple_fn    simple file name
+ *  @return fully qualified file name, caller must free, NULL if the
+ *          cache directory cannot be determined
+ *
+ *  @remark
+ *  Neither the directory nor the file need exist.
+ */
+char * xdg_user_cache_file(const char * application, const char * simple_fn) {
+   char * result = NULL;
+   char * cache_dir = xdg_cache_home_dir();
+   if (cache_dir) {
+      result = g_strdup_printf("%s/%s/%s", cache_dir, application, simple_fn);
+      free(cache_dir);
+   }
+   return result;
+}
+
@@ -58,4 +58,7 @@ GPtrArray * get_filenames_by_filter(const char * dirnames[], Dirent_Filter filte
 
 int filename_for_fd(int fd, char** p_fn);
 
+char * xdg_cache_home_dir();
+char * xdg_user_cache_file(const char * application, const char * simple_fn);
+
 #endif /* FILE_UTIL_H_ */
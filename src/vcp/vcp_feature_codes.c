@@ -43,6 +43,15 @@ static DDCA_Feature_Value_Entry xca_v22_osd_button_sh_values[];
 
 static bool vcp_feature_codes_initialized = false;
 
+// Dense index of vcp_code_table[] by feature code, built by init_vcp_feature_codes()
+static VCP_Feature_Table_Entry * vcp_code_index[256];
+
+// Flags resolved for each vcp_code_table[] entry, by feature code and
+// version class (see vspec_class()), built by init_vcp_feature_codes().
+#define VSPEC_CLASS_CT 4
+static DDCA_Version_Feature_Flags resolved_specific_flags[256][VSPEC_CLASS_CT];
+static DDCA_Version_Feature_Flags resolved_sensitive_flags[256][VSPEC_CLASS_CT];
+
 //
 // Functions implementing the VCPINFO command
 //
@@ -566,18 +575,42 @@ int vcp_get_feature_code_count() {
 }
 
 
-/* Gets the appropriate VCP flags value for a feature, given
- * the VCP version for the monitor.
- *
- * Arguments:
- *   pvft_entry  vcp_feature_table entry
- *   vcp_version VCP version for monitor
- *
- * Returns:
- *   flags, 0 if feature is not defined for version
+/* Maps a VCP version to the class of versions for which feature table
+ * lookups resolve identically:
+ *   0 - undefined, or less than 2.1
+ *   1 - 2.1
+ *   2 - 2.2 or later 2.x
+ *   3 - 3.0 or later
  */
-DDCA_Version_Feature_Flags
-get_version_specific_feature_flags(
+static inline int vspec_class(DDCA_MCCS_Version_Spec vcp_version) {
+   if (vcp_version.major >= 3)
+      return 3;
+   if (vcp_version.major == 2 && vcp_version.minor >= 2)
+      return 2;
+   if (vcp_version.major == 2 && vcp_version.minor == 1)
+      return 1;
+   return 0;
+}
+
+
+/* Returns the resolved flags index slot for an entry in vcp_code_table[],
+ * NULL if the entry is synthetic or user defined or the index has not
+ * yet been built.
+ */
+static inline DDCA_Version_Feature_Flags *
+resolved_flags_slot(
+      DDCA_Version_Feature_Flags     resolved[256][VSPEC_CLASS_CT],
+      VCP_Feature_Table_Entry *      pvft_entry,
+      DDCA_MCCS_Version_Spec         vcp_version)
+{
+   if (vcp_feature_codes_initialized && vcp_code_index[pvft_entry->code] == pvft_entry)
+      return &resolved[pvft_entry->code][vspec_class(vcp_version)];
+   return NULL;
+}
+
+
+static DDCA_Version_Feature_Flags
+resolve_version_specific_feature_flags(
        VCP_Feature_Table_Entry *  pvft_entry,
        DDCA_MCCS_Version_Spec     vcp_version)
 {
@@ -638,6 +671,52 @@ get_version_specific_feature_flags(
 }
 
 
+static DDCA_Version_Feature_Flags
+resolve_version_sensitive_feature_flags(
+       VCP_Feature_Table_Entry * pvft_entry,
+       DDCA_MCCS_Version_Spec    vcp_version)
+{
+   DDCA_Version_Feature_Flags result =
+         resolve_version_specific_feature_flags(pvft_entry, vcp_version);
+
+   if (!result) {
+      // vcp_version is lower than the first version level at which the field
+      // was defined.  This can occur e.g. if scanning.  Pick the best
+      // possible flags by scanning up in versions.
+      if (pvft_entry->v21_flags)
+         result = pvft_entry->v21_flags;
+      else if (pvft_entry->v30_flags)
+         result = pvft_entry->v30_flags;
+      else if (pvft_entry->v22_flags)
+         result = pvft_entry->v22_flags;
+   }
+   return result;
+}
+
+
+/* Gets the appropriate VCP flags value for a feature, given
+ * the VCP version for the monitor.
+ *
+ * Arguments:
+ *   pvft_entry  vcp_feature_table entry
+ *   vcp_version VCP version for monitor
+ *
+ * Returns:
+ *   flags, 0 if feature is not defined for version
+ */
+DDCA_Version_Feature_Flags
+get_version_specific_feature_flags(
+       VCP_Feature_Table_Entry *  pvft_entry,
+       DDCA_MCCS_Version_Spec     vcp_version)
+{
+   DDCA_Version_Feature_Flags * slot =
+         resolved_flags_slot(resolved_specific_flags, pvft_entry, vcp_version);
+   if (slot)
+      return *slot;
+   return resolve_version_specific_feature_flags(pvft_entry, vcp_version);
+}
+
+
 bool is_feature_supported_in_version(
       VCP_Feature_Table_Entry *  pvft_entry,
       DDCA_MCCS_Version_Spec     vcp_version)
@@ -671,24 +750,16 @@ get_version_sensitive_feature_flags(
        DDCA_MCCS_Version_Spec    vcp_version)
 {
    bool debug = false;
-   DDCA_Version_Feature_Flags result = get_version_specific_feature_flags(pvft_entry, vcp_version);
-
+   DDCA_Version_Feature_Flags * slot =
+         resolved_flags_slot(resolved_sensitive_flags, pvft_entry, vcp_version);
+   DDCA_Version_Feature_Flags result = (slot)
+         ? *slot
+         : resolve_version_sensitive_feature_flags(pvft_entry, vcp_version);
    if (!result) {
-      // vcp_version is lower than the first version level at which the field
-      // was defined.  This can occur e.g. if scanning.  Pick the best
-      // possible flags by scanning up in versions.
-      if (pvft_entry->v21_flags)
-         result = pvft_entry->v21_flags;
-      else if (pvft_entry->v30_flags)
-         result = pvft_entry->v30_flags;
-      else if (pvft_entry->v22_flags)
-         result = pvft_entry->v22_flags;
-      if (!result) {
-         PROGRAM_LOGIC_ERROR(
-            "Feature = 0x%02x, Version=%d.%d: No version sensitive feature flags found",
-            pvft_entry->code, vcp_version.major, vcp_version.minor);
-         assert(false);
-      }
+      PROGRAM_LOGIC_ERROR(
+         "Feature = 0x%02x, Version=%d.%d: No version sensitive feature flags found",
+         pvft_entry->code, vcp_version.major, vcp_version.minor);
+      assert(false);
    }
 
    DBGMSF(debug, "Feature = 0x%02x, vcp version=%d.%d, returning 0x%02x",
@@ -1412,6 +1483,9 @@ vcp_create_table_dummy_feature_for_hexid(DDCA_Vcp_Feature_Code id) {
 VCP_Feature_Table_Entry *
 vcp_find_feature_by_hexid(DDCA_Vcp_Feature_Code id) {
    // DBGMSG("Starting. id=0x%02x ", id );
+   if (vcp_feature_codes_initialized)
+      return vcp_code_index[id];
+
    int ndx = 0;
    VCP_Feature_Table_Entry * result = NULL;
 
@@ -4678,8 +4752,21 @@ void init_vcp_feature_codes() {
 #ifdef DEVELOPMENT_ONLY
    validate_vcp_feature_table();  // enable for development
 #endif
+   // Representative version for each version class, see vspec_class()
+   static const DDCA_MCCS_Version_Spec class_vspecs[VSPEC_CLASS_CT] =
+         { {2,0}, {2,1}, {2,2}, {3,0} };
    for (int ndx=0; ndx < vcp_feature_code_count; ndx++) {
-      memcpy( vcp_code_table[ndx].marker, VCP_FEATURE_TABLE_ENTRY_MARKER, 4);
+      VCP_Feature_Table_Entry * pentry = &vcp_code_table[ndx];
+      memcpy( pentry->marker, VCP_FEATURE_TABLE_ENTRY_MARKER, 4);
+      if (!vcp_code_index[pentry->code]) {     // first entry wins, as in a linear scan
+         vcp_code_index[pentry->code] = pentry;
+         for (int vclass = 0; vclass < VSPEC_CLASS_CT; vclass++) {
+            resolved_specific_flags[pentry->code][vclass] =
+                  resolve_version_specific_feature_flags(pentry, class_vspecs[vclass]);
+            resolved_sensitive_flags[pentry->code][vclass] =
+                  resolve_version_sensitive_feature_flags(pentry, class_vspecs[vclass]);
+         }
+      }
    }
    init_func_name_table();
    // dbgrpt_func_name_table(0);